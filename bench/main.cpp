@@ -0,0 +1,500 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/record_index.hpp>
+#include <read-excel/column_storage.hpp>
+#include <read-excel/csv_storage.hpp>
+
+// C++ include.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+//
+// Benchmark
+//
+
+//! Result of one benchmark.
+struct Benchmark {
+	//! Name.
+	std::string m_name;
+	//! Count of iterations.
+	size_t m_iterations;
+	//! Time of one iteration in nanoseconds.
+	double m_ns;
+	//! Bytes processed by one iteration.
+	size_t m_bytes;
+	//! Cells processed by one iteration.
+	size_t m_cells;
+}; // struct Benchmark
+
+
+//
+// Options
+//
+
+//! Command line options.
+struct Options {
+	//! Minimal time to run every benchmark, in seconds.
+	double m_minTime = 0.5;
+	//! Run only benchmarks which names contain this string.
+	std::string m_filter;
+	//! Files to benchmark.
+	std::vector< std::string > m_files;
+}; // struct Options
+
+
+//
+// runBenchmark
+//
+
+//! Run \a func repeatedly, doubling iterations count until the run takes
+//! at least Options::m_minTime, and print the result.
+inline void
+runBenchmark( const Options & opts, const std::string & name,
+	size_t bytes, size_t cells, const std::function< void() > & func )
+{
+	if( !opts.m_filter.empty() && name.find( opts.m_filter ) == std::string::npos )
+		return;
+
+	using clock = std::chrono::steady_clock;
+
+	// Warm up caches and lazy initialization.
+	func();
+
+	size_t iterations = 1;
+	double seconds = 0.0;
+
+	while( true )
+	{
+		const auto start = clock::now();
+
+		for( size_t i = 0; i < iterations; ++i )
+			func();
+
+		seconds = std::chrono::duration< double > ( clock::now() - start ).count();
+
+		if( seconds >= opts.m_minTime || iterations >= ( size_t( 1 ) << 30 ) )
+			break;
+
+		iterations *= 2;
+	}
+
+	Benchmark b;
+	b.m_name = name;
+	b.m_iterations = iterations;
+	b.m_ns = seconds * 1E9 / iterations;
+	b.m_bytes = bytes;
+	b.m_cells = cells;
+
+	std::printf( "%-48s %12.0f ns %10zu", b.m_name.c_str(), b.m_ns, b.m_iterations );
+
+	if( b.m_bytes )
+		std::printf( " %10.2f MB/s", b.m_bytes / ( b.m_ns / 1E9 ) / ( 1024.0 * 1024.0 ) );
+	else
+		std::printf( " %15s", "" );
+
+	if( b.m_cells )
+		std::printf( " %12.3f M cells/s", b.m_cells / ( b.m_ns / 1E9 ) / 1E6 );
+
+	std::printf( "\n" );
+	std::fflush( stdout );
+} // runBenchmark
+
+
+//
+// CountingStorage
+//
+
+//! Storage that only counts cells.
+struct CountingStorage
+	:	public Excel::EmptyStorage
+{
+	//! Count of cells.
+	size_t m_cells = 0;
+
+protected:
+	void onCellSharedString( size_t, size_t, size_t, size_t ) override { ++m_cells; }
+	void onCell( size_t, size_t, size_t, const std::wstring & ) override { ++m_cells; }
+	void onCell( size_t, size_t, size_t, double ) override { ++m_cells; }
+	void onCell( size_t, const Excel::Formula & ) override { ++m_cells; }
+}; // struct CountingStorage
+
+
+//
+// NullBuffer
+//
+
+//! Stream buffer that drops everything.
+struct NullBuffer
+	:	public std::streambuf
+{
+protected:
+	std::streamsize xsputn( const char *, std::streamsize n ) override { return n; }
+	int_type overflow( int_type c ) override { return traits_type::not_eof( c ); }
+}; // struct NullBuffer
+
+
+//
+// readFile
+//
+
+//! \return Content of the file.
+inline std::string
+readFile( const std::string & fileName )
+{
+	std::ifstream file( fileName, std::ios::in | std::ios::binary );
+
+	return std::string( std::istreambuf_iterator< char > ( file ),
+		std::istreambuf_iterator< char > () );
+}
+
+
+//
+// fileName
+//
+
+//! \return Name of the file without directories.
+inline std::string
+fileName( const std::string & path )
+{
+	const auto pos = path.find_last_of( "/\\" );
+
+	return ( pos == std::string::npos ? path : path.substr( pos + 1 ) );
+}
+
+
+//
+// benchFile
+//
+
+//! Run per-stage benchmarks on the file.
+inline void
+benchFile( const Options & opts, const std::string & path )
+{
+	const std::string content = readFile( path );
+	const std::string name = fileName( path );
+
+	if( content.empty() )
+	{
+		std::printf( "%s: unable to read, skipped\n", path.c_str() );
+
+		return;
+	}
+
+	runBenchmark( opts, name + "/header+msat+sat", 0, 0,
+		[&] ()
+		{
+			std::istringstream stream( content );
+
+			CompoundFile::Header header( stream );
+			CompoundFile::MSAT msat( header, stream );
+			CompoundFile::SAT sat = msat.buildSAT();
+			CompoundFile::SAT ssat = CompoundFile::loadSSAT( header, stream, sat );
+		} );
+
+	runBenchmark( opts, name + "/open+directory", 0, 0,
+		[&] ()
+		{
+			std::istringstream stream( content );
+
+			CompoundFile::File file( stream );
+		} );
+
+	std::istringstream fileStream( content );
+	CompoundFile::File file( fileStream );
+
+	const auto dir = file.hasDirectory( L"Workbook" ) ? file.directory( L"Workbook" )
+	                                                  : file.directory( L"Book" );
+
+	const std::vector< char > workbook = file.readStreamFully( dir );
+	const int32_t workbookSize = static_cast< int32_t > ( workbook.size() );
+
+	Excel::MemoryStream stream( workbook.data(), workbookSize, file.byteOrder() );
+	const Excel::RecordIndex index( stream );
+
+	size_t cells = 0;
+
+	try {
+		CountingStorage storage;
+
+		Excel::Parser::loadBook( file, storage );
+
+		cells = storage.m_cells;
+	}
+	catch( const Excel::Exception & x )
+	{
+		std::printf( "%s: %ls, skipped\n", path.c_str(), x.whatAsWString().c_str() );
+
+		return;
+	}
+
+	runBenchmark( opts, name + "/record-index", workbook.size(), 0,
+		[&] ()
+		{
+			stream.seek( 0, Excel::Stream::FromBeginning );
+
+			Excel::RecordIndex idx( stream );
+		} );
+
+	runBenchmark( opts, name + "/record", workbook.size(), 0,
+		[&] ()
+		{
+			for( const auto & info : index.records() )
+			{
+				stream.seek( info.m_offset, Excel::Stream::FromBeginning );
+
+				Excel::Record record( stream );
+			}
+		} );
+
+	for( const auto & info : index.records() )
+	{
+		if( info.m_code == Excel::XL_SST )
+		{
+			stream.seek( info.m_offset, Excel::Stream::FromBeginning );
+
+			runBenchmark( opts, name + "/parseSST", info.m_length, 0,
+				[&] ()
+				{
+					stream.seek( info.m_offset, Excel::Stream::FromBeginning );
+
+					Excel::Record record( stream );
+					Excel::EmptyStorage storage;
+
+					Excel::Parser::parseSST( record, storage );
+				} );
+
+			break;
+		}
+	}
+
+	runBenchmark( opts, name + "/Book", content.size(), cells,
+		[&] ()
+		{
+			std::istringstream stream( content );
+
+			Excel::Book book( stream );
+		} );
+
+	runBenchmark( opts, name + "/Book(pipelined)", content.size(), cells,
+		[&] ()
+		{
+			std::istringstream stream( content );
+			CompoundFile::File file( stream );
+			file.setPipelined();
+
+			Excel::Book book;
+			Excel::Parser::loadBook( file, book );
+		} );
+
+	runBenchmark( opts, name + "/Book(arena)", content.size(), cells,
+		[&] ()
+		{
+			std::istringstream stream( content );
+			Excel::MonotonicArena arena;
+
+			Excel::Book book( stream, &arena );
+		} );
+
+	runBenchmark( opts, name + "/ColumnStorage", content.size(), cells,
+		[&] ()
+		{
+			std::istringstream stream( content );
+			Excel::ColumnStorage storage;
+
+			Excel::Parser::loadBook( stream, storage );
+		} );
+
+	runBenchmark( opts, name + "/CsvStorage", content.size(), cells,
+		[&] ()
+		{
+			std::istringstream stream( content );
+			NullBuffer buffer;
+			std::ostream out( &buffer );
+
+			Excel::CsvStorage storage( [&] ( size_t, const Excel::String & ) -> std::ostream*
+				{ return &out; } );
+
+			Excel::Parser::loadBook( stream, storage );
+		} );
+
+	runBenchmark( opts, name + "/Book(file)", content.size(), cells,
+		[&] ()
+		{
+			Excel::Book book( path );
+		} );
+} // benchFile
+
+
+//
+// benchSynthetic
+//
+
+//! Run benchmarks of the stages on the generated data.
+inline void
+benchSynthetic( const Options & opts )
+{
+	// 1000 strings of 32 characters, half of them compressed.
+	{
+		const int count = 1000;
+		const int chars = 32;
+		std::vector< char > data;
+
+		for( int i = 0; i < count; ++i )
+		{
+			const bool wide = ( i % 2 );
+
+			data.push_back( static_cast< char > ( chars ) );
+			data.push_back( 0 );
+			data.push_back( wide ? 0x01 : 0x00 );
+
+			for( int c = 0; c < chars; ++c )
+			{
+				data.push_back( static_cast< char > ( 'a' + ( i + c ) % 26 ) );
+
+				if( wide )
+					data.push_back( 0 );
+			}
+		}
+
+		Excel::MemoryStream stream( data.data(), static_cast< int32_t > ( data.size() ) );
+		const std::vector< int32_t > borders;
+
+		runBenchmark( opts, "synthetic/loadString", data.size(), count,
+			[&] ()
+			{
+				stream.seek( 0, Excel::Stream::FromBeginning );
+
+				for( int i = 0; i < count; ++i )
+					Excel::loadString( stream, borders );
+			} );
+
+		runBenchmark( opts, "synthetic/loadStringUtf8", data.size(), count,
+			[&] ()
+			{
+				stream.seek( 0, Excel::Stream::FromBeginning );
+
+				for( int i = 0; i < count; ++i )
+					Excel::loadStringUtf8( stream, borders );
+			} );
+	}
+
+	// MULRK with 256 cells.
+	{
+		const int16_t count = 256;
+		const uint16_t length = static_cast< uint16_t > ( 6 + 6 * count );
+		std::vector< char > data;
+
+		auto push16 = [&] ( uint16_t v )
+		{
+			data.push_back( static_cast< char > ( v & 0xFF ) );
+			data.push_back( static_cast< char > ( v >> 8 ) );
+		};
+
+		push16( Excel::XL_MULRK );
+		push16( length );
+		push16( 0 );
+		push16( 0 );
+
+		for( int16_t i = 0; i < count; ++i )
+		{
+			// XF index.
+			push16( 0 );
+			// Integer RK value.
+			const uint32_t rk = ( static_cast< uint32_t > ( i ) << 2 ) | 0x02u;
+			push16( static_cast< uint16_t > ( rk & 0xFFFF ) );
+			push16( static_cast< uint16_t > ( rk >> 16 ) );
+		}
+
+		push16( static_cast< uint16_t > ( count - 1 ) );
+
+		Excel::MemoryStream stream( data.data(), static_cast< int32_t > ( data.size() ) );
+		Excel::Record record( stream );
+		CountingStorage storage;
+
+		runBenchmark( opts, "synthetic/handleMULRK", length, count,
+			[&] ()
+			{
+				record.dataStream().seek( 0, Excel::Stream::FromBeginning );
+
+				Excel::Parser::handleMULRK( record, 0, storage );
+			} );
+	}
+} // benchSynthetic
+
+
+//
+// main
+//
+
+int main( int argc, char ** argv )
+{
+	Options opts;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		const std::string arg = argv[ i ];
+
+		if( arg.compare( 0, 11, "--min-time=" ) == 0 )
+			opts.m_minTime = std::atof( arg.c_str() + 11 );
+		else if( arg.compare( 0, 9, "--filter=" ) == 0 )
+			opts.m_filter = arg.substr( 9 );
+		else if( arg == "--help" || arg == "-h" )
+		{
+			std::printf( "Usage: %s [--min-time=SECONDS] [--filter=SUBSTRING] [files...]\n",
+				argv[ 0 ] );
+
+			return 0;
+		}
+		else
+			opts.m_files.push_back( arg );
+	}
+
+	if( opts.m_files.empty() )
+	{
+		const std::string dataDir = READ_EXCEL_BENCH_DATA_DIR;
+
+		for( const char * f : { "sample.xls", "test.xls", "datetime.xls",
+			"stringformula.xls", "MiscOperatorTests.xls", "strange.xls", "big.xls" } )
+				opts.m_files.push_back( dataDir + "/" + f );
+	}
+
+	std::printf( "%-48s %15s %10s %15s %20s\n", "Benchmark", "Time", "Iterations",
+		"MB/s", "Cells/s" );
+
+	benchSynthetic( opts );
+
+	for( const auto & f : opts.m_files )
+	{
+		try {
+			benchFile( opts, f );
+		}
+		catch( const Excel::Exception & x )
+		{
+			std::printf( "%s: %ls, skipped\n", f.c_str(), x.whatAsWString().c_str() );
+		}
+		catch( const CompoundFile::Exception & x )
+		{
+			std::printf( "%s: %ls, skipped\n", f.c_str(), x.whatAsWString().c_str() );
+		}
+		catch( const std::exception & x )
+		{
+			std::printf( "%s: %s, skipped\n", f.c_str(), x.what() );
+		}
+	}
+
+	return 0;
+}
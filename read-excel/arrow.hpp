@@ -0,0 +1,492 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__ARROW_HPP__INCLUDED
+#define EXCEL__ARROW_HPP__INCLUDED
+
+// Excel include.
+#include "sheet.hpp"
+#include "utf8.hpp"
+#include "format.hpp"
+
+// C++ include.
+#include <vector>
+#include <string>
+#include <memory>
+#include <limits>
+#include <cstdint>
+
+
+//
+// Arrow C Data Interface
+//
+
+// Structures are defined by the specification of Apache Arrow, the guard
+// is the same as in arrow/c/abi.h, so both headers can be used together.
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+	// Array type description
+	const char * format;
+	const char * name;
+	const char * metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema ** children;
+	struct ArrowSchema * dictionary;
+
+	// Release callback
+	void ( *release )( struct ArrowSchema * );
+	// Opaque producer-specific data
+	void * private_data;
+};
+
+struct ArrowArray {
+	// Array data description
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void ** buffers;
+	struct ArrowArray ** children;
+	struct ArrowArray * dictionary;
+
+	// Release callback
+	void ( *release )( struct ArrowArray * );
+	// Opaque producer-specific data
+	void * private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+
+namespace Excel {
+
+//
+// ArrowExporter
+//
+
+//! Export of the sheets to Arrow C Data Interface.
+/*!
+	Sheet is exported as struct array with one child per column, named
+	as in Excel: A, B, ..., Z, AA, ... Type of the column is inferred from
+	its cells:
+
+	- only numbers and numeric formulas - float64;
+	- only boolean formulas - boolean;
+	- only strings and string formulas - utf8;
+	- mix of them - utf8 with numbers and booleans printed;
+	- nothing - float64 with all nulls.
+
+	Empty cells and error formulas are nulls in validity bitmaps.
+
+	Exported structures own copies of the data and must be released by
+	the consumer with their release callbacks, as the specification says.
+	They don't refer to the sheet, so the book can be destroyed right after
+	the export.
+*/
+class ArrowExporter final {
+public:
+	//! Type of the column.
+	enum ColumnType {
+		//! float64.
+		DoubleColumn,
+		//! boolean.
+		BooleanColumn,
+		//! utf8, or large utf8 if text of the column is longer than
+		//! INT32_MAX bytes.
+		StringColumn
+	}; // enum ColumnType
+
+	//! Export sheet to \a schema and \a array.
+	static void exportSheet( const Sheet & sheet, ArrowSchema * schema, ArrowArray * array );
+
+	//! \return Type of the column inferred from its cells.
+	static ColumnType columnType( const Sheet & sheet, size_t column );
+
+	//! \return Name of the column as in Excel.
+	static std::string columnName( size_t column );
+
+private:
+	//! Data of the schema.
+	struct SchemaData {
+		//! Format.
+		std::string m_format;
+		//! Name.
+		std::string m_name;
+		//! Children.
+		std::vector< ArrowSchema* > m_children;
+	}; // struct SchemaData
+
+	//! Data of the array.
+	struct ArrayData {
+		//! Validity bitmap.
+		std::vector< uint8_t > m_validity;
+		//! Values of float64 array.
+		std::vector< double > m_doubles;
+		//! Values of boolean array.
+		std::vector< uint8_t > m_booleans;
+		//! Offsets of utf8 array.
+		std::vector< int32_t > m_offsets;
+		//! Offsets of large utf8 array, with more than INT32_MAX bytes of text.
+		std::vector< int64_t > m_largeOffsets;
+		//! Characters of utf8 array.
+		std::string m_chars;
+		//! Pointers to the buffers.
+		std::vector< const void* > m_buffers;
+		//! Children.
+		std::vector< ArrowArray* > m_children;
+	}; // struct ArrayData
+
+	//! Fill schema.
+	static void initSchema( ArrowSchema * schema, SchemaData * data, int64_t flags );
+
+	//! Fill array of the column.
+	static void exportColumn( const Sheet & sheet, size_t column,
+		ArrowSchema * schema, ArrowArray * array );
+
+	//! Release schema.
+	static void releaseSchema( ArrowSchema * schema );
+
+	//! Release array.
+	static void releaseArray( ArrowArray * array );
+}; // class ArrowExporter
+
+
+inline std::string
+ArrowExporter::columnName( size_t column )
+{
+	std::string name;
+
+	for( size_t n = column + 1; n > 0; n = ( n - 1 ) / 26 )
+		name.insert( name.begin(), static_cast< char > ( 'A' + ( n - 1 ) % 26 ) );
+
+	return name;
+}
+
+inline ArrowExporter::ColumnType
+ArrowExporter::columnType( const Sheet & sheet, size_t column )
+{
+	bool numbers = false;
+	bool booleans = false;
+	bool strings = false;
+
+	for( size_t row = 0; row < sheet.rowsCount(); ++row )
+	{
+		const Cell & cell = sheet.cell( row, column );
+
+		switch( cell.dataType() )
+		{
+			case Cell::DataType::Double :
+				numbers = true;
+				break;
+
+			case Cell::DataType::String :
+				strings = true;
+				break;
+
+			case Cell::DataType::Formula :
+			{
+				switch( cell.getFormula().valueType() )
+				{
+					case Formula::DoubleValue :
+						numbers = true;
+						break;
+
+					case Formula::BooleanValue :
+						booleans = true;
+						break;
+
+					case Formula::StringValue :
+						strings = true;
+						break;
+
+					default :
+						break;
+				}
+			}
+				break;
+
+			default :
+				break;
+		}
+	}
+
+	if( strings || ( numbers && booleans ) )
+		return StringColumn;
+	else if( booleans )
+		return BooleanColumn;
+	else
+		return DoubleColumn;
+}
+
+inline void
+ArrowExporter::initSchema( ArrowSchema * schema, SchemaData * data, int64_t flags )
+{
+	schema->format = data->m_format.c_str();
+	schema->name = data->m_name.c_str();
+	schema->metadata = nullptr;
+	schema->flags = flags;
+	schema->n_children = static_cast< int64_t > ( data->m_children.size() );
+	schema->children = ( data->m_children.empty() ? nullptr : data->m_children.data() );
+	schema->dictionary = nullptr;
+	schema->release = &ArrowExporter::releaseSchema;
+	schema->private_data = data;
+}
+
+inline void
+ArrowExporter::exportColumn( const Sheet & sheet, size_t column,
+	ArrowSchema * schema, ArrowArray * array )
+{
+	const ColumnType type = columnType( sheet, column );
+	const size_t rows = sheet.rowsCount();
+
+	std::unique_ptr< ArrayData > data( new ArrayData );
+	data->m_validity.resize( ( rows + 7 ) / 8 + 1, 0 );
+
+	if( type == DoubleColumn )
+		data->m_doubles.resize( rows + 1, 0.0 );
+	else if( type == BooleanColumn )
+		data->m_booleans.resize( ( rows + 7 ) / 8 + 1, 0 );
+	else
+		data->m_largeOffsets.reserve( rows + 1 );
+
+	int64_t nulls = 0;
+
+	auto setValid = [&] ( size_t row ) {
+		data->m_validity[ row / 8 ] |= static_cast< uint8_t > ( 1u << ( row % 8 ) );
+	};
+
+	for( size_t row = 0; row < rows; ++row )
+	{
+		if( type == StringColumn )
+			data->m_largeOffsets.push_back( static_cast< int64_t > ( data->m_chars.size() ) );
+
+		const Cell & cell = sheet.cell( row, column );
+
+		bool isNumber = false;
+		bool isBoolean = false;
+		double number = 0.0;
+		bool boolean = false;
+		const String * str = nullptr;
+
+		if( cell.dataType() == Cell::DataType::Double )
+		{
+			isNumber = true;
+			number = cell.getDouble();
+		}
+		else if( cell.dataType() == Cell::DataType::String )
+			str = &cell.getString();
+		else if( cell.dataType() == Cell::DataType::Formula )
+		{
+			const Formula & f = cell.getFormula();
+
+			if( f.valueType() == Formula::DoubleValue )
+			{
+				isNumber = true;
+				number = f.getDouble();
+			}
+			else if( f.valueType() == Formula::BooleanValue )
+			{
+				isBoolean = true;
+				boolean = f.getBoolean();
+			}
+			else if( f.valueType() == Formula::StringValue )
+				str = &f.getString();
+		}
+
+		if( !isNumber && !isBoolean && !str )
+		{
+			++nulls;
+
+			continue;
+		}
+
+		setValid( row );
+
+		switch( type )
+		{
+			case DoubleColumn :
+				data->m_doubles[ row ] = number;
+				break;
+
+			case BooleanColumn :
+				if( boolean )
+					data->m_booleans[ row / 8 ] |= static_cast< uint8_t > ( 1u << ( row % 8 ) );
+				break;
+
+			case StringColumn :
+				if( str )
+					data->m_chars += Utf8::fromString( *str );
+				else if( isNumber )
+					data->m_chars += formatNumber( number );
+				else
+					data->m_chars += ( boolean ? "TRUE" : "FALSE" );
+				break;
+		}
+	}
+
+	data->m_buffers.push_back( nulls ? data->m_validity.data() : nullptr );
+
+	switch( type )
+	{
+		case DoubleColumn :
+			data->m_buffers.push_back( data->m_doubles.data() );
+			break;
+
+		case BooleanColumn :
+			data->m_buffers.push_back( data->m_booleans.data() );
+			break;
+
+		case StringColumn :
+		{
+			data->m_largeOffsets.push_back( static_cast< int64_t > ( data->m_chars.size() ) );
+
+			// utf8 has int32 offsets, more text is exported as large utf8.
+			if( data->m_chars.size() <= static_cast< size_t > ( std::numeric_limits< int32_t >::max() ) )
+			{
+				data->m_offsets.assign( data->m_largeOffsets.cbegin(), data->m_largeOffsets.cend() );
+				data->m_largeOffsets = std::vector< int64_t > ();
+				data->m_buffers.push_back( data->m_offsets.data() );
+			}
+			else
+				data->m_buffers.push_back( data->m_largeOffsets.data() );
+
+			data->m_buffers.push_back( data->m_chars.data() );
+		}
+			break;
+	}
+
+	SchemaData * schemaData = new SchemaData;
+
+	if( type == DoubleColumn )
+		schemaData->m_format = "g";
+	else if( type == BooleanColumn )
+		schemaData->m_format = "b";
+	else
+		schemaData->m_format = ( data->m_largeOffsets.empty() ? "u" : "U" );
+
+	schemaData->m_name = columnName( column );
+
+	initSchema( schema, schemaData, ARROW_FLAG_NULLABLE );
+
+	array->length = static_cast< int64_t > ( rows );
+	array->null_count = nulls;
+	array->offset = 0;
+	array->n_buffers = static_cast< int64_t > ( data->m_buffers.size() );
+	array->n_children = 0;
+	array->buffers = data->m_buffers.data();
+	array->children = nullptr;
+	array->dictionary = nullptr;
+	array->release = &ArrowExporter::releaseArray;
+	array->private_data = data.release();
+}
+
+inline void
+ArrowExporter::exportSheet( const Sheet & sheet, ArrowSchema * schema, ArrowArray * array )
+{
+	const size_t columns = sheet.columnsCount();
+
+	SchemaData * schemaData = new SchemaData;
+	schemaData->m_format = "+s";
+	schemaData->m_name = Utf8::fromString( sheet.sheetName() );
+
+	ArrayData * data = new ArrayData;
+	data->m_buffers.push_back( nullptr );
+
+	try {
+		for( size_t c = 0; c < columns; ++c )
+		{
+			schemaData->m_children.push_back( nullptr );
+			data->m_children.push_back( nullptr );
+
+			schemaData->m_children.back() = new ArrowSchema;
+			schemaData->m_children.back()->release = nullptr;
+			data->m_children.back() = new ArrowArray;
+			data->m_children.back()->release = nullptr;
+
+			exportColumn( sheet, c, schemaData->m_children.back(), data->m_children.back() );
+		}
+	}
+	catch( ... )
+	{
+		ArrowSchema s;
+		initSchema( &s, schemaData, 0 );
+		releaseSchema( &s );
+
+		ArrowArray a;
+		a.private_data = data;
+		releaseArray( &a );
+
+		throw;
+	}
+
+	initSchema( schema, schemaData, 0 );
+
+	array->length = static_cast< int64_t > ( sheet.rowsCount() );
+	array->null_count = 0;
+	array->offset = 0;
+	array->n_buffers = 1;
+	array->n_children = static_cast< int64_t > ( columns );
+	array->buffers = data->m_buffers.data();
+	array->children = ( columns ? data->m_children.data() : nullptr );
+	array->dictionary = nullptr;
+	array->release = &ArrowExporter::releaseArray;
+	array->private_data = data;
+}
+
+inline void
+ArrowExporter::releaseSchema( ArrowSchema * schema )
+{
+	SchemaData * data = static_cast< SchemaData* > ( schema->private_data );
+
+	for( ArrowSchema * child : data->m_children )
+	{
+		if( child )
+		{
+			if( child->release )
+				child->release( child );
+
+			delete child;
+		}
+	}
+
+	delete data;
+
+	schema->release = nullptr;
+}
+
+inline void
+ArrowExporter::releaseArray( ArrowArray * array )
+{
+	ArrayData * data = static_cast< ArrayData* > ( array->private_data );
+
+	for( ArrowArray * child : data->m_children )
+	{
+		if( child )
+		{
+			if( child->release )
+				child->release( child );
+
+			delete child;
+		}
+	}
+
+	delete data;
+
+	array->release = nullptr;
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__ARROW_HPP__INCLUDED
@@ -0,0 +1,385 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__BATCH_LOADER_HPP__INCLUDED
+#define EXCEL__BATCH_LOADER_HPP__INCLUDED
+
+// Excel include.
+#include "parser.hpp"
+#include "exceptions.hpp"
+
+// C++ include.
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <istream>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+
+
+namespace Excel {
+
+//
+// BatchResult
+//
+
+//! Result of loading of one workbook of the batch.
+template< typename Storage >
+struct BatchResult {
+	//! Storage with loaded workbook, nullptr on error.
+	std::unique_ptr< Storage > m_storage;
+	//! Reason of the error, empty if the workbook is loaded.
+	std::wstring m_error;
+
+	//! \return Is workbook loaded.
+	bool ok() const
+	{
+		return ( m_storage != nullptr );
+	}
+}; // struct BatchResult
+
+
+//
+// BatchStorage
+//
+
+//! Type of storage created by the factory, the factory returns
+//! std::unique_ptr< Storage > for index of the workbook in the batch.
+template< typename Factory >
+struct BatchStorage {
+	typedef typename std::decay< decltype( std::declval< Factory& > () (
+		std::declval< size_t > () ) ) >::type::element_type type;
+}; // struct BatchStorage
+
+
+//
+// BatchLoader
+//
+
+//! Loader of many workbooks on the pool of threads.
+/*!
+	Workbooks of the batch are spread over queues of the workers, worker
+	takes workbooks from the back of its own queue and when it's empty
+	steals from the front of queues of other workers, so small and large
+	files are balanced without central queue.
+
+	Threads live as long as the loader, so buffers of records and strings
+	of the parser, that are per thread, are reused by all workbooks of all
+	batches loaded by the worker.
+
+	Errors of workbooks and of the factory are returned in BatchResult,
+	they don't stop the batch.
+
+	\code
+	Excel::BatchLoader loader;
+
+	auto results = loader.load( files,
+		[] ( size_t ) { return std::make_unique< Excel::Book > (); } );
+
+	for( size_t i = 0; i < results.size(); ++i )
+	{
+		if( results[ i ].ok() )
+			process( *results[ i ].m_storage );
+		else
+			report( files[ i ], results[ i ].m_error );
+	}
+	\endcode
+*/
+class BatchLoader final {
+public:
+	//! Start \a threadsCount workers, hardware concurrency if 0.
+	explicit BatchLoader( size_t threadsCount = 0 );
+	~BatchLoader();
+
+	BatchLoader( const BatchLoader & ) = delete;
+	BatchLoader & operator = ( const BatchLoader & ) = delete;
+
+	//! \return Count of workers.
+	size_t threadsCount() const;
+
+	//! Load files, storages are created by \a factory in the workers,
+	//! it's called from several threads at once.
+	//! \return Results in order of the files.
+	template< typename Factory >
+	std::vector< BatchResult< typename BatchStorage< Factory >::type > >
+	load( const std::vector< std::string > & fileNames, Factory factory );
+
+	//! Load streams, every stream is read by one worker only.
+	//! \return Results in order of the streams.
+	template< typename Factory >
+	std::vector< BatchResult< typename BatchStorage< Factory >::type > >
+	load( const std::vector< std::istream* > & streams, Factory factory );
+
+	//! Run \a task for every index from 0 to \a count on the workers.
+	//! \a task must not throw.
+	void run( size_t count, const std::function< void( size_t ) > & task );
+
+private:
+	//! Queue of the worker.
+	struct Queue {
+		//! Mutex.
+		std::mutex m_mutex;
+		//! Indexes of the tasks.
+		std::deque< size_t > m_tasks;
+	}; // struct Queue
+
+	//! Load workbooks with \a loadBook( index, storage ).
+	template< typename Storage, typename Factory, typename Load >
+	std::vector< BatchResult< Storage > > loadAll( size_t count,
+		Factory & factory, Load loadBook );
+
+	//! Loop of the worker.
+	void work( size_t idx );
+
+	//! Take task from own queue or steal it from others.
+	//! \return false if all queues are empty.
+	bool take( size_t idx, size_t & task );
+
+private:
+	//! Queues of the workers.
+	std::vector< std::unique_ptr< Queue > > m_queues;
+	//! Workers.
+	std::vector< std::thread > m_threads;
+	//! Serializes run().
+	std::mutex m_runMutex;
+	//! Mutex of the state below.
+	std::mutex m_mutex;
+	//! Start of the batch.
+	std::condition_variable m_start;
+	//! End of the batch.
+	std::condition_variable m_done;
+	//! Task of the current batch.
+	const std::function< void( size_t ) > * m_task;
+	//! Number of the current batch.
+	size_t m_generation;
+	//! Count of not finished tasks of the current batch.
+	size_t m_pending;
+	//! Stop workers.
+	bool m_stop;
+}; // class BatchLoader
+
+inline
+BatchLoader::BatchLoader( size_t threadsCount )
+	:	m_task( nullptr )
+	,	m_generation( 0 )
+	,	m_pending( 0 )
+	,	m_stop( false )
+{
+	if( !threadsCount )
+		threadsCount = std::max( std::thread::hardware_concurrency(), 1u );
+
+	for( size_t i = 0; i < threadsCount; ++i )
+		m_queues.push_back( std::make_unique< Queue > () );
+
+	for( size_t i = 0; i < threadsCount; ++i )
+		m_threads.emplace_back( &BatchLoader::work, this, i );
+}
+
+inline
+BatchLoader::~BatchLoader()
+{
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+
+		m_stop = true;
+	}
+
+	m_start.notify_all();
+
+	for( auto & t : m_threads )
+		t.join();
+}
+
+inline size_t
+BatchLoader::threadsCount() const
+{
+	return m_threads.size();
+}
+
+inline void
+BatchLoader::run( size_t count, const std::function< void( size_t ) > & task )
+{
+	if( !count )
+		return;
+
+	std::lock_guard< std::mutex > runLock( m_runMutex );
+
+	std::unique_lock< std::mutex > lock( m_mutex );
+
+	// Task is set before queues are filled, worker that is still in the
+	// loop of the previous batch can take new index right away.
+	m_task = &task;
+	m_pending = count;
+	++m_generation;
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		Queue & q = *m_queues[ i % m_queues.size() ];
+
+		std::lock_guard< std::mutex > queueLock( q.m_mutex );
+
+		q.m_tasks.push_back( i );
+	}
+
+	m_start.notify_all();
+
+	m_done.wait( lock, [this] () { return m_pending == 0; } );
+
+	m_task = nullptr;
+}
+
+inline bool
+BatchLoader::take( size_t idx, size_t & task )
+{
+	{
+		Queue & own = *m_queues[ idx ];
+
+		std::lock_guard< std::mutex > lock( own.m_mutex );
+
+		if( !own.m_tasks.empty() )
+		{
+			task = own.m_tasks.back();
+			own.m_tasks.pop_back();
+
+			return true;
+		}
+	}
+
+	for( size_t i = 1; i < m_queues.size(); ++i )
+	{
+		Queue & other = *m_queues[ ( idx + i ) % m_queues.size() ];
+
+		std::lock_guard< std::mutex > lock( other.m_mutex );
+
+		if( !other.m_tasks.empty() )
+		{
+			task = other.m_tasks.front();
+			other.m_tasks.pop_front();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+inline void
+BatchLoader::work( size_t idx )
+{
+	size_t generation = 0;
+
+	while( true )
+	{
+		{
+			std::unique_lock< std::mutex > lock( m_mutex );
+
+			m_start.wait( lock, [&] () { return m_stop || m_generation != generation; } );
+
+			if( m_stop )
+				return;
+
+			generation = m_generation;
+		}
+
+		size_t i = 0;
+
+		while( take( idx, i ) )
+		{
+			const std::function< void( size_t ) > * task = nullptr;
+
+			{
+				std::lock_guard< std::mutex > lock( m_mutex );
+
+				task = m_task;
+			}
+
+			( *task )( i );
+
+			std::lock_guard< std::mutex > lock( m_mutex );
+
+			if( --m_pending == 0 )
+				m_done.notify_all();
+		}
+	}
+}
+
+template< typename Storage, typename Factory, typename Load >
+inline std::vector< BatchResult< Storage > >
+BatchLoader::loadAll( size_t count, Factory & factory, Load loadBook )
+{
+	std::vector< BatchResult< Storage > > results( count );
+
+	run( count, [&] ( size_t i )
+		{
+			BatchResult< Storage > & r = results[ i ];
+
+			try {
+				std::unique_ptr< Storage > storage = factory( i );
+
+				if( !storage )
+					throw Exception( L"Storage factory returned nullptr." );
+
+				loadBook( i, *storage );
+
+				r.m_storage = std::move( storage );
+			}
+			catch( const Exception & x )
+			{
+				r.m_error = x.whatAsWString();
+			}
+			catch( const std::exception & x )
+			{
+				const std::string what = x.what();
+
+				r.m_error.assign( what.cbegin(), what.cend() );
+			}
+			catch( ... )
+			{
+				r.m_error = L"Unknown error.";
+			}
+		} );
+
+	return results;
+}
+
+template< typename Factory >
+inline std::vector< BatchResult< typename BatchStorage< Factory >::type > >
+BatchLoader::load( const std::vector< std::string > & fileNames, Factory factory )
+{
+	typedef typename BatchStorage< Factory >::type Storage;
+
+	return loadAll< Storage > ( fileNames.size(), factory,
+		[&] ( size_t i, Storage & storage )
+		{
+			Parser::loadBook( fileNames[ i ], storage );
+		} );
+}
+
+template< typename Factory >
+inline std::vector< BatchResult< typename BatchStorage< Factory >::type > >
+BatchLoader::load( const std::vector< std::istream* > & streams, Factory factory )
+{
+	typedef typename BatchStorage< Factory >::type Storage;
+
+	return loadAll< Storage > ( streams.size(), factory,
+		[&] ( size_t i, Storage & storage )
+		{
+			if( !streams[ i ] )
+				throw Exception( L"Stream is nullptr." );
+
+			Parser::loadBook( *streams[ i ], storage );
+		} );
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__BATCH_LOADER_HPP__INCLUDED
@@ -15,6 +15,11 @@
 #include "exceptions.hpp"
 #include "stream.hpp"
 #include "parser.hpp"
+#include "memory_resource.hpp"
+#include "snapshot.hpp"
+#include "sheet_cache.hpp"
+#include "hash.hpp"
+#include "cancellation.hpp"
 
 #include "compoundfile/compoundfile.hpp"
 #include "compoundfile/compoundfile_exceptions.hpp"
@@ -24,10 +29,17 @@
 #include <string>
 #include <memory>
 #include <sstream>
+#include <functional>
+#include <fstream>
+#include <cstdio>
+#include <unordered_map>
 
 
 namespace Excel {
 
+class FrozenBook;
+
+
 //
 // Book
 //
@@ -47,21 +59,39 @@ public:
 	}; // enum DateMode
 
 public:
-	Book();
-	explicit Book( std::istream & stream );
-	explicit Book( const std::string & fileName );
+	//! All constructors take resource for rows of the sheets and for the
+	//! shared string table with its strings, strings of cells use standard
+	//! allocator. With MonotonicArena the book must be destroyed or cleared
+	//! before the arena is released.
+	explicit Book( MemoryResource * resource = defaultResource() );
+	explicit Book( std::istream & stream,
+		MemoryResource * resource = defaultResource() );
+	explicit Book( const std::string & fileName,
+		MemoryResource * resource = defaultResource() );
 	~Book();
 
 protected:
-	void onSharedString( size_t sstSize, size_t idx, const std::wstring & value ) override;
+	void onSharedString( size_t sstSize, size_t idx, const String & value ) override;
 	void onDateMode( uint16_t mode ) override;
-	void onSheet( size_t idx, const std::wstring & name ) override;
+	void onSheet( size_t idx, const String & name ) override;
 	void onCellSharedString( size_t sheetIdx, size_t row, size_t column, size_t sstIndex ) override;
-	void onCell( size_t sheetIdx, size_t row, size_t column, const std::wstring & value ) override;
+	void onCell( size_t sheetIdx, size_t row, size_t column, const String & value ) override;
 	void onCell( size_t sheetIdx, size_t row, size_t column, double value ) override;
 	void onCell( size_t sheetIdx, const Formula & value ) override;
-	void onHeader( size_t sheetIdx, const std::wstring & value ) override;
-	void onFooter( size_t sheetIdx, const std::wstring & value ) override;
+	void onCell( size_t sheetIdx, Formula && value ) override;
+	void onHeader( size_t sheetIdx, const String & value ) override;
+	void onFooter( size_t sheetIdx, const String & value ) override;
+	void onSharedStringView( size_t sstSize, size_t idx, StringView value ) override;
+	void onCellView( size_t sheetIdx, size_t row, size_t column, StringView value ) override;
+	void onHeaderView( size_t sheetIdx, StringView value ) override;
+	void onFooterView( size_t sheetIdx, StringView value ) override;
+	bool wantsSheetHash() const override;
+	uint64_t sharedStringHash( size_t sstIndex ) override;
+	void onSheetHash( size_t sheetIdx, const SheetHash & hash ) override;
+	bool isCancelled() const override;
+	uint32_t progressInterval() const override;
+	void onProgress( const Progress & progress ) override;
+	bool wantsFormulaTokens() const override;
 
 public:
 	//! \return Date mode.
@@ -70,48 +100,220 @@ public:
 	//! \return Count of the sheets.
 	size_t sheetsCount() const;
 
-	//! \return Sheet with given index,
-	//! or NULL if there is no sheet with such index.
-	Sheet * sheet( size_t index ) const;
+	//! \return Sheet with given index, or NULL for charts and macro sheets.
+	//! Throws if there is no sheet with such index.
+	const Sheet * sheet( size_t index ) const;
+
+	//! \return Sheet with given index, or NULL for charts and macro sheets.
+	//! Throws if there is no sheet with such index or if the sheet is
+	//! shared through SheetCache, such sheet is read-only, see detachSheet().
+	Sheet * sheet( size_t index );
+
+	//! \return Sheet with given index that can be changed, or NULL for
+	//! charts and macro sheets. Sheet shared through SheetCache is replaced
+	//! with a private copy first, pointers to it got before are not valid.
+	//! Throws if there is no sheet with such index.
+	Sheet * detachSheet( size_t index );
+
+	//! \return Is sheet with given index shared through SheetCache.
+	bool isSheetShared( size_t index ) const;
+
+	//! \return Immutable copy of the book for concurrent readers.
+	std::shared_ptr< const FrozenBook > freeze() const &;
+
+	//! \return Immutable book with cells moved from this one, that is left
+	//! empty. Sheets shared through SheetCache are copied.
+	std::shared_ptr< const FrozenBook > freeze() &&;
 
 	//! Clear book.
 	void clear();
 
+	//! \return Memory resource of the book.
+	MemoryResource * resource() const;
+
+	//! Set cache of decoded sheets for the next loads, nullptr turns it off.
+	//! Sheets put to or taken from the cache are shared with other books and
+	//! are read-only, see detachSheet(). The cache is used only with the
+	//! default memory resource, as cached sheets may outlive the book.
+	/*!
+		\code
+		Excel::Book book;
+		book.setSheetCache( &Excel::SheetCache::global() );
+		Excel::Parser::loadBook( "data.xls", book );
+		\endcode
+	*/
+	void setSheetCache( SheetCache * cache );
+
+	//! \return Cache of decoded sheets.
+	SheetCache * sheetCache() const;
+
+	//! Set token to stop the next loads, nullptr turns it off. Cancelled
+	//! load leaves the book with sheets and cells loaded so far.
+	void setCancellationToken( const CancellationToken * token );
+
+	//! Set handler of progress of the next loads, called every \a interval
+	//! bytes of the Workbook stream. Empty handler turns it off.
+	/*!
+		\code
+		Excel::Book book;
+		book.setProgressHandler( [] ( const Excel::Progress & p )
+			{ std::cout << p.m_bytesRead * 100 / p.m_bytesTotal << "%" << std::endl; } );
+		Excel::Parser::loadBook( "data.xls", book );
+		\endcode
+	*/
+	void setProgressHandler( std::function< void( const Progress & ) > handler,
+		uint32_t interval = c_defaultProgressInterval );
+
+	//! Default interval of progress reports.
+	static const uint32_t c_defaultProgressInterval = 1024 * 1024;
+
+	//! Keep tokens of formulas on the next loads, see Formula::tokens().
+	//! Snapshots keep only values of formulas, so SnapshotCache parses
+	//! books that keep tokens.
+	void setFormulaTokens( bool on = true );
+
+	//! \return Are tokens of formulas kept.
+	bool formulaTokens() const;
+
+	//! Save the book to the snapshot file, see Snapshot for the layout.
+	//! \a source is identity of the source file kept in the snapshot.
+	//! File is written under temporary name and renamed, so readers never
+	//! see partially written snapshot. Tokens of formulas are not saved.
+	void saveSnapshot( const std::string & fileName,
+		const SnapshotKey & source = SnapshotKey() ) const;
+
+	//! Replace content of the book with the snapshot file, that is
+	//! mapped to memory and read in place.
+	//! \return Identity of the source file kept in the snapshot.
+	SnapshotKey loadSnapshot( const std::string & fileName );
+
 private:
-	//! Parsed WorkSheets.
+	//! String of SST, allocated from the memory resource.
+	typedef std::basic_string< Char, std::char_traits< Char >, Allocator< Char > > SharedString;
+
+	//! Resize SST, new strings take the memory resource.
+	void resizeSst( size_t size );
+
+private:
+	//! Memory resource.
+	MemoryResource * m_resource;
+	//! Parsed WorkSheets owned by the book, nullptr for shared ones.
 	std::vector< std::unique_ptr< Sheet > > m_sheets;
+	//! WorkSheets shared through SheetCache, nullptr for own ones.
+	std::vector< std::shared_ptr< const Sheet > > m_sharedSheets;
 	//! Shared string table.
-	std::vector< std::wstring > m_sst;
+	std::vector< SharedString, Allocator< SharedString > > m_sst;
 	//! Date mode.
 	DateMode m_dateMode;
+	//! Cache of decoded sheets.
+	SheetCache * m_sheetCache;
+	//! Hashes of SST strings, computed for the first hashed sheet.
+	std::vector< uint64_t > m_sstHashes;
+	//! Token to stop loading.
+	const CancellationToken * m_cancellation;
+	//! Handler of progress.
+	std::function< void( const Progress & ) > m_progressHandler;
+	//! Interval of progress reports.
+	uint32_t m_progressInterval;
+	//! Keep tokens of formulas.
+	bool m_formulaTokens;
 }; // class Book
 
+
+//
+// FrozenBook
+//
+
+//! Immutable book for concurrent readers.
+/*!
+	Made by Book::freeze(). Nothing is changed after construction, so any
+	count of threads can read the book at the same time without locks.
+	It's held by std::shared_ptr, so a new version of the book can replace
+	the old one while readers still use it:
+
+	\code
+	std::shared_ptr< const Excel::FrozenBook > current;
+
+	// Reload.
+	Excel::Book book( "data.xls" );
+	std::atomic_store( &current, std::move( book ).freeze() );
+
+	// Request.
+	auto book = std::atomic_load( &current );
+	const Excel::Cell & cell = book->sheet( 0 )->cell( 0, 0 );
+	\endcode
+*/
+class FrozenBook final {
+public:
+	//! \return Date mode.
+	Book::DateMode dateMode() const;
+
+	//! \return Count of the sheets.
+	size_t sheetsCount() const;
+
+	//! \return Sheet with given index, or NULL for charts and macro sheets.
+	//! Throws if there is no sheet with such index.
+	const FrozenSheet * sheet( size_t index ) const;
+
+private:
+	friend class Book;
+
+	FrozenBook( std::vector< std::unique_ptr< const FrozenSheet > > && sheets,
+		Book::DateMode dateMode );
+
+private:
+	//! Sheets.
+	std::vector< std::unique_ptr< const FrozenSheet > > m_sheets;
+	//! Date mode.
+	Book::DateMode m_dateMode;
+}; // class FrozenBook
+
+
 inline
-Book::Book()
-	:	m_dateMode( DateMode::Unknown )
+Book::Book( MemoryResource * resource )
+	:	m_resource( resource )
+	,	m_sst( Allocator< SharedString > ( resource ) )
+	,	m_dateMode( DateMode::Unknown )
+	,	m_sheetCache( nullptr )
+	,	m_cancellation( nullptr )
+	,	m_progressInterval( c_defaultProgressInterval )
+	,	m_formulaTokens( false )
 {
 }
 
 inline
-Book::Book( std::istream & stream )
-	:	m_dateMode( DateMode::Unknown )
+Book::Book( std::istream & stream, MemoryResource * resource )
+	:	m_resource( resource )
+	,	m_sst( Allocator< SharedString > ( resource ) )
+	,	m_dateMode( DateMode::Unknown )
+	,	m_sheetCache( nullptr )
+	,	m_cancellation( nullptr )
+	,	m_progressInterval( c_defaultProgressInterval )
+	,	m_formulaTokens( false )
 {
 	Parser::loadBook( stream, *this );
 }
 
 inline
-Book::Book( const std::string & fileName )
-	:	m_dateMode( DateMode::Unknown )
+Book::Book( const std::string & fileName, MemoryResource * resource )
+	:	m_resource( resource )
+	,	m_sst( Allocator< SharedString > ( resource ) )
+	,	m_dateMode( DateMode::Unknown )
+	,	m_sheetCache( nullptr )
+	,	m_cancellation( nullptr )
+	,	m_progressInterval( c_defaultProgressInterval )
+	,	m_formulaTokens( false )
 {
-	std::ifstream fileStream( fileName, std::ios::in | std::ios::binary );
-	Parser::loadBook( fileStream, *this, fileName );
+	Parser::loadBook( fileName, *this );
 }
 
 inline void
 Book::clear()
 {
 	m_sheets.clear();
+	m_sharedSheets.clear();
 	m_sst.clear();
+	m_sstHashes.clear();
 }
 
 inline
@@ -119,6 +321,473 @@ Book::~Book()
 {
 }
 
+inline MemoryResource *
+Book::resource() const
+{
+	return m_resource;
+}
+
+inline void
+Book::setSheetCache( SheetCache * cache )
+{
+	m_sheetCache = cache;
+}
+
+inline SheetCache *
+Book::sheetCache() const
+{
+	return m_sheetCache;
+}
+
+inline void
+Book::setCancellationToken( const CancellationToken * token )
+{
+	m_cancellation = token;
+}
+
+inline bool
+Book::isCancelled() const
+{
+	return ( m_cancellation && m_cancellation->isCancelled() );
+}
+
+inline void
+Book::setProgressHandler( std::function< void( const Progress & ) > handler,
+	uint32_t interval )
+{
+	m_progressHandler = std::move( handler );
+	m_progressInterval = interval;
+}
+
+inline uint32_t
+Book::progressInterval() const
+{
+	return ( m_progressHandler ? m_progressInterval : 0 );
+}
+
+inline void
+Book::onProgress( const Progress & progress )
+{
+	m_progressHandler( progress );
+}
+
+inline void
+Book::setFormulaTokens( bool on )
+{
+	m_formulaTokens = on;
+}
+
+inline bool
+Book::formulaTokens() const
+{
+	return m_formulaTokens;
+}
+
+inline bool
+Book::wantsFormulaTokens() const
+{
+	return m_formulaTokens;
+}
+
+inline bool
+Book::wantsSheetHash() const
+{
+	return ( m_sheetCache && m_resource == defaultResource() );
+}
+
+inline uint64_t
+Book::sharedStringHash( size_t sstIndex )
+{
+	if( m_sstHashes.size() != m_sst.size() )
+	{
+		m_sstHashes.resize( m_sst.size() );
+
+		for( size_t i = 0; i < m_sst.size(); ++i )
+		{
+			ContentHash hash;
+			hash.update( m_sst[ i ].data(), m_sst[ i ].size() * sizeof( Char ) );
+
+			m_sstHashes[ i ] = hash.value();
+		}
+	}
+
+	return ( sstIndex < m_sstHashes.size() ? m_sstHashes[ sstIndex ] : sstIndex );
+}
+
+inline void
+Book::onSheetHash( size_t sheetIdx, const SheetHash & hash )
+{
+	// Name is kept in Sheet, so it's a part of the key, as well as tokens
+	// of formulas that are kept only if wanted.
+	const String & name = sheet( sheetIdx )->sheetName();
+	const uint8_t tokens = ( m_formulaTokens ? 1 : 0 );
+
+	ContentHash named;
+	named.update( &hash.m_hash, sizeof( hash.m_hash ) );
+	named.update( name.data(), name.size() * sizeof( Char ) );
+	named.update( &tokens, sizeof( tokens ) );
+
+	SheetHash key = hash;
+	key.m_hash = named.value();
+
+	// Decoded copy of the cached sheet is dropped, otherwise the decoded
+	// sheet goes to the cache. Either way it's read-only from now on.
+	auto cached = m_sheetCache->find( key );
+
+	if( !cached )
+	{
+		cached = std::move( m_sheets[ sheetIdx ] );
+		m_sheetCache->insert( key, cached );
+	}
+
+	m_sheets[ sheetIdx ].reset();
+	m_sharedSheets[ sheetIdx ] = std::move( cached );
+}
+
+inline void
+Book::saveSnapshot( const std::string & fileName, const SnapshotKey & source ) const
+{
+	Snapshot::Header h = Snapshot::header();
+	h.m_dateMode = static_cast< int32_t > ( m_dateMode );
+	h.m_source = source;
+
+	// Strings of SST keep their indices, other strings are looked up among
+	// already added ones.
+	std::vector< StringView > strings;
+	std::unordered_map< StringView, uint32_t, Snapshot::StringHash > index;
+	uint64_t charsCount = 0;
+
+	auto addString = [&] ( StringView str ) -> uint32_t
+	{
+		auto it = index.find( str );
+
+		if( it != index.cend() )
+			return it->second;
+
+		if( strings.size() >= Snapshot::c_noString - 1 )
+			throw Exception( L"Too many strings for the snapshot." );
+
+		const uint32_t idx = static_cast< uint32_t > ( strings.size() );
+
+		strings.push_back( str );
+		index.emplace( str, idx );
+		charsCount += str.size();
+
+		return idx;
+	};
+
+	for( const auto & s : m_sst )
+	{
+		const StringView str( s.data(), s.size() );
+
+		strings.push_back( str );
+		index.emplace( str, static_cast< uint32_t > ( strings.size() - 1 ) );
+		charsCount += str.size();
+	}
+
+	std::vector< Snapshot::SheetEntry > sheets( m_sheets.size() );
+	uint64_t cellsCount = 0;
+
+	for( size_t i = 0; i < sheets.size(); ++i )
+	{
+		Snapshot::SheetEntry & e = sheets[ i ];
+		e.m_name = Snapshot::c_noString;
+		e.m_header = Snapshot::c_noString;
+		e.m_footer = Snapshot::c_noString;
+		e.m_reserved = 0;
+		e.m_firstCell = cellsCount;
+		e.m_cellsCount = 0;
+
+		// Charts and macro sheets have no Sheet, their entries have no name.
+		if( !sheet( i ) )
+			continue;
+
+		const Sheet & s = *sheet( i );
+
+		e.m_name = addString( s.sheetName() );
+		e.m_header = addString( s.sheetHeader() );
+		e.m_footer = addString( s.sheetFooter() );
+
+		for( size_t row = 0; row < s.rowsCount(); ++row )
+		{
+			for( size_t column = 0; column < s.columnsCount(); ++column )
+			{
+				const Cell & cell = s.cell( row, column );
+
+				if( cell.dataType() == Cell::DataType::Unknown )
+					continue;
+
+				++e.m_cellsCount;
+
+				if( cell.dataType() == Cell::DataType::String )
+					addString( cell.getString() );
+				else if( cell.dataType() == Cell::DataType::Formula &&
+					cell.getFormula().valueType() == Formula::StringValue )
+				{
+					addString( cell.getFormula().getString() );
+				}
+			}
+		}
+
+		cellsCount += e.m_cellsCount;
+	}
+
+	h.m_stringsCount = strings.size();
+	h.m_sstCount = m_sst.size();
+	h.m_sheetsCount = sheets.size();
+	h.m_stringsOffset = Snapshot::align( sizeof( h ) );
+	h.m_charsOffset = Snapshot::align( h.m_stringsOffset +
+		( strings.size() + 1 ) * sizeof( uint64_t ) );
+	h.m_sheetsOffset = Snapshot::align( h.m_charsOffset + charsCount * sizeof( Char ) );
+	h.m_cellsOffset = h.m_sheetsOffset + sheets.size() * sizeof( Snapshot::SheetEntry );
+	h.m_size = h.m_cellsOffset + cellsCount * sizeof( Snapshot::CellEntry );
+
+	const std::string tmpName = Snapshot::tempName( fileName );
+
+	{
+		std::ofstream stream( tmpName, std::ios::out | std::ios::binary | std::ios::trunc );
+
+		if( !stream )
+			throw Exception( L"Unable to create snapshot file." );
+
+		const char zeroes[ 8 ] = {};
+		uint64_t pos = 0;
+
+		auto write = [&] ( const void * data, uint64_t size )
+		{
+			stream.write( static_cast< const char* > ( data ),
+				static_cast< std::streamsize > ( size ) );
+			pos += size;
+		};
+
+		auto pad = [&] ( uint64_t offset )
+		{
+			write( zeroes, offset - pos );
+		};
+
+		write( &h, sizeof( h ) );
+		pad( h.m_stringsOffset );
+
+		std::vector< uint64_t > offsets;
+		offsets.reserve( strings.size() + 1 );
+		offsets.push_back( 0 );
+
+		for( const auto & str : strings )
+			offsets.push_back( offsets.back() + str.size() );
+
+		write( offsets.data(), offsets.size() * sizeof( uint64_t ) );
+		pad( h.m_charsOffset );
+
+		for( const auto & str : strings )
+			write( str.data(), str.size() * sizeof( Char ) );
+
+		pad( h.m_sheetsOffset );
+
+		write( sheets.data(), sheets.size() * sizeof( Snapshot::SheetEntry ) );
+
+		std::vector< Snapshot::CellEntry > cells;
+		cells.reserve( 4096 );
+
+		for( size_t i = 0; i < sheets.size(); ++i )
+		{
+			const Sheet * s = sheet( i );
+
+			if( !s )
+				continue;
+
+			for( size_t row = 0; row < s->rowsCount(); ++row )
+			{
+				for( size_t column = 0; column < s->columnsCount(); ++column )
+				{
+					const Cell & cell = s->cell( row, column );
+
+					if( cell.dataType() == Cell::DataType::Unknown )
+						continue;
+
+					Snapshot::CellEntry e;
+					e.m_row = static_cast< uint32_t > ( row );
+					e.m_column = static_cast< uint16_t > ( column );
+					e.m_type = static_cast< uint8_t > ( cell.dataType() );
+					e.m_valueType = 0;
+					e.m_string = Snapshot::c_noString;
+					e.m_value = 0;
+					e.m_double = 0.0;
+
+					switch( cell.dataType() )
+					{
+						case Cell::DataType::String :
+							e.m_string = index.at( cell.getString() );
+							break;
+
+						case Cell::DataType::Double :
+							e.m_double = cell.getDouble();
+							break;
+
+						case Cell::DataType::Formula :
+						{
+							const Formula & f = cell.getFormula();
+
+							e.m_valueType = static_cast< uint8_t > ( f.valueType() );
+							e.m_double = f.getDouble();
+
+							if( f.valueType() == Formula::StringValue )
+								e.m_string = index.at( f.getString() );
+							else if( f.valueType() == Formula::BooleanValue )
+								e.m_value = f.getBoolean();
+							else if( f.valueType() == Formula::ErrorValue )
+								e.m_value = static_cast< uint32_t > ( f.getErrorValue() );
+						}
+							break;
+
+						default :
+							break;
+					}
+
+					cells.push_back( e );
+
+					if( cells.size() == cells.capacity() )
+					{
+						write( cells.data(), cells.size() * sizeof( Snapshot::CellEntry ) );
+						cells.clear();
+					}
+				}
+			}
+		}
+
+		write( cells.data(), cells.size() * sizeof( Snapshot::CellEntry ) );
+
+		stream.flush();
+
+		if( !stream )
+		{
+			stream.close();
+			std::remove( tmpName.c_str() );
+
+			throw Exception( L"Unable to write snapshot file." );
+		}
+	}
+
+	if( std::rename( tmpName.c_str(), fileName.c_str() ) != 0 )
+	{
+		// Windows doesn't replace existing file on rename.
+		std::remove( fileName.c_str() );
+
+		if( std::rename( tmpName.c_str(), fileName.c_str() ) != 0 )
+		{
+			std::remove( tmpName.c_str() );
+
+			throw Exception( L"Unable to write snapshot file." );
+		}
+	}
+}
+
+inline SnapshotKey
+Book::loadSnapshot( const std::string & fileName )
+{
+	MappedFile file( fileName );
+
+	const Snapshot::Header & h = Snapshot::check( file.data(), file.size() );
+
+	const uint64_t * offsets = reinterpret_cast< const uint64_t* > (
+		file.data() + h.m_stringsOffset );
+	const Char * chars = reinterpret_cast< const Char* > ( file.data() + h.m_charsOffset );
+	const Snapshot::SheetEntry * sheets = reinterpret_cast< const Snapshot::SheetEntry* > (
+		file.data() + h.m_sheetsOffset );
+	const Snapshot::CellEntry * cells = reinterpret_cast< const Snapshot::CellEntry* > (
+		file.data() + h.m_cellsOffset );
+
+	auto string = [&] ( uint32_t idx ) -> StringView
+	{
+		if( idx == Snapshot::c_noString )
+			return StringView();
+
+		return StringView( chars + offsets[ idx ],
+			static_cast< size_t > ( offsets[ idx + 1 ] - offsets[ idx ] ) );
+	};
+
+	clear();
+
+	switch( h.m_dateMode )
+	{
+		case 0 :
+			m_dateMode = DateMode::Dec31_1899;
+			break;
+
+		case 1 :
+			m_dateMode = DateMode::Jan01_1904;
+			break;
+
+		default :
+			m_dateMode = DateMode::Unknown;
+			break;
+	}
+
+	m_sst.clear();
+	resizeSst( static_cast< size_t > ( h.m_sstCount ) );
+
+	for( size_t i = 0; i < m_sst.size(); ++i )
+	{
+		const StringView str = string( static_cast< uint32_t > ( i ) );
+
+		m_sst[ i ].assign( str.data(), str.size() );
+	}
+
+	m_sheets.resize( static_cast< size_t > ( h.m_sheetsCount ) );
+	m_sharedSheets.resize( m_sheets.size() );
+
+	for( size_t i = 0; i < h.m_sheetsCount; ++i )
+	{
+		const Snapshot::SheetEntry & e = sheets[ i ];
+
+		if( e.m_name == Snapshot::c_noString )
+			continue;
+
+		onSheet( i, string( e.m_name ).str() );
+
+		Sheet & s = *m_sheets[ i ];
+		s.setHeader( string( e.m_header ).str() );
+		s.setFooter( string( e.m_footer ).str() );
+
+		for( const Snapshot::CellEntry * c = cells + e.m_firstCell,
+			* last = c + e.m_cellsCount; c != last; ++c )
+		{
+			switch( static_cast< Cell::DataType > ( c->m_type ) )
+			{
+				case Cell::DataType::String :
+					s.setCell( c->m_row, c->m_column, string( c->m_string ) );
+					break;
+
+				case Cell::DataType::Double :
+					s.setCell( c->m_row, c->m_column, c->m_double );
+					break;
+
+				case Cell::DataType::Formula :
+				{
+					Formula f( static_cast< uint16_t > ( c->m_row ), c->m_column,
+						static_cast< Formula::ValueType > ( c->m_valueType ) );
+
+					f.setDouble( c->m_double );
+					f.setBoolean( c->m_value != 0 );
+					f.setErrorValue( f.valueType() == Formula::ErrorValue ?
+						static_cast< Formula::ErrorValues > ( c->m_value ) :
+						Formula::UnknownError );
+
+					if( c->m_string != Snapshot::c_noString )
+						f.setString( string( c->m_string ).str() );
+
+					s.setCell( c->m_row, c->m_column, std::move( f ) );
+				}
+					break;
+
+				default :
+					break;
+			}
+		}
+	}
+
+	return h.m_source;
+}
+
 inline Book::DateMode
 Book::dateMode() const
 {
@@ -126,10 +795,17 @@ Book::dateMode() const
 }
 
 inline void
-Book::onSharedString( size_t sstSize, size_t idx, const std::wstring & value )
+Book::onSharedString( size_t sstSize, size_t idx, const String & value )
+{
+	resizeSst( sstSize );
+	m_sst[ idx ].assign( value.data(), value.size() );
+}
+
+inline void
+Book::onSharedStringView( size_t sstSize, size_t idx, StringView value )
 {
-	m_sst.resize( sstSize );
-	m_sst[ idx ] = value;
+	resizeSst( sstSize );
+	m_sst[ idx ].assign( value.data(), value.size() );
 }
 
 inline void
@@ -142,22 +818,47 @@ Book::onDateMode( uint16_t mode )
 }
 
 inline void
-Book::onSheet( size_t idx, const std::wstring & name )
+Book::onSheet( size_t idx, const String & name )
 {
-	auto sheet = std::make_unique< Sheet > ( name );
+	auto sheet = std::make_unique< Sheet > ( name, m_resource );
 	if( m_sheets.size() <= idx )
+	{
 		m_sheets.resize( idx + 1 );
+		m_sharedSheets.resize( idx + 1 );
+	}
 	m_sheets[ idx ] = std::move( sheet );
+	m_sharedSheets[ idx ].reset();
 }
 
 inline void
 Book::onCellSharedString( size_t sheetIdx, size_t row, size_t column, size_t sstIndex )
 {
-	onCell( sheetIdx, row, column, m_sst[ sstIndex ] );
+	const SharedString & str = m_sst[ sstIndex ];
+
+	sheet( sheetIdx )->setCell( row, column, StringView( str.data(), str.size() ) );
+}
+
+inline void
+Book::resizeSst( size_t size )
+{
+	// Not resize(), default-constructed strings would take the default resource.
+	if( m_sst.size() > size )
+		m_sst.erase( m_sst.begin() + static_cast< std::ptrdiff_t > ( size ), m_sst.end() );
+
+	m_sst.reserve( size );
+
+	while( m_sst.size() < size )
+		m_sst.emplace_back( Allocator< Char > ( m_resource ) );
+}
+
+inline void
+Book::onCell( size_t sheetIdx, size_t row, size_t column, const String & value )
+{
+	sheet( sheetIdx )->setCell( row, column, value );
 }
 
 inline void
-Book::onCell( size_t sheetIdx, size_t row, size_t column, const std::wstring & value )
+Book::onCellView( size_t sheetIdx, size_t row, size_t column, StringView value )
 {
 	sheet( sheetIdx )->setCell( row, column, value );
 }
@@ -175,25 +876,151 @@ Book::onCell( size_t sheetIdx, const Formula & formula )
 }
 
 inline void
-Book::onHeader(size_t sheetIdx, const std::wstring & value)
+Book::onCell( size_t sheetIdx, Formula && formula )
+{
+	const size_t row = formula.getRow();
+	const size_t column = formula.getColumn();
+
+	sheet( sheetIdx )->setCell( row, column, std::move( formula ) );
+}
+
+inline void
+Book::onHeader(size_t sheetIdx, const String & value)
 {
 	sheet( sheetIdx )->setHeader( value );
 }
 
 inline void
-Book::onFooter(size_t sheetIdx, const std::wstring & value)
+Book::onFooter(size_t sheetIdx, const String & value)
 {
 	sheet( sheetIdx )->setFooter( value );
 }
 
+inline void
+Book::onHeaderView( size_t sheetIdx, StringView value )
+{
+	sheet( sheetIdx )->setHeader( value.str() );
+}
+
+inline void
+Book::onFooterView( size_t sheetIdx, StringView value )
+{
+	sheet( sheetIdx )->setFooter( value.str() );
+}
+
 inline size_t
 Book::sheetsCount() const
 {
 	return m_sheets.size();
 }
 
+inline std::shared_ptr< const FrozenBook >
+Book::freeze() const &
+{
+	std::vector< std::unique_ptr< const FrozenSheet > > sheets( m_sheets.size() );
+
+	for( size_t i = 0; i < m_sheets.size(); ++i )
+	{
+		if( const Sheet * s = sheet( i ) )
+			sheets[ i ].reset( new FrozenSheet( *s ) );
+	}
+
+	return std::shared_ptr< const FrozenBook > ( new FrozenBook( std::move( sheets ),
+		m_dateMode ) );
+}
+
+inline std::shared_ptr< const FrozenBook >
+Book::freeze() &&
+{
+	std::vector< std::unique_ptr< const FrozenSheet > > sheets( m_sheets.size() );
+
+	for( size_t i = 0; i < m_sheets.size(); ++i )
+	{
+		// Sheet of SheetCache is used by other books, it's copied.
+		if( m_sharedSheets[ i ] )
+			sheets[ i ].reset( new FrozenSheet( *m_sharedSheets[ i ] ) );
+		else if( m_sheets[ i ] )
+			sheets[ i ].reset( new FrozenSheet( std::move( *m_sheets[ i ] ) ) );
+	}
+
+	std::shared_ptr< const FrozenBook > book( new FrozenBook( std::move( sheets ),
+		m_dateMode ) );
+
+	clear();
+
+	return book;
+}
+
 inline Sheet *
+Book::sheet( size_t index )
+{
+	if( isSheetShared( index ) )
+		throw Exception( L"Sheet is shared through SheetCache and is read-only, "
+			L"use Book::detachSheet() to change it." );
+
+	return m_sheets[ index ].get();
+}
+
+inline const Sheet *
 Book::sheet( size_t index ) const
+{
+	if( isSheetShared( index ) )
+		return m_sharedSheets[ index ].get();
+
+	return m_sheets[ index ].get();
+}
+
+inline Sheet *
+Book::detachSheet( size_t index )
+{
+	if( isSheetShared( index ) )
+	{
+		m_sheets[ index ] = std::make_unique< Sheet > ( *m_sharedSheets[ index ] );
+		m_sharedSheets[ index ].reset();
+	}
+
+	return m_sheets[ index ].get();
+}
+
+inline bool
+Book::isSheetShared( size_t index ) const
+{
+	if( index < m_sheets.size() )
+		return static_cast< bool > ( m_sharedSheets[ index ] );
+
+	std::wstringstream stream;
+	stream << L"There is no such sheet with index : " << index;
+
+	throw Exception( stream.str() );
+}
+
+
+//
+// FrozenBook
+//
+
+inline
+FrozenBook::FrozenBook( std::vector< std::unique_ptr< const FrozenSheet > > && sheets,
+	Book::DateMode dateMode )
+	:	m_sheets( std::move( sheets ) )
+	,	m_dateMode( dateMode )
+{
+}
+
+inline Book::DateMode
+FrozenBook::dateMode() const
+{
+	return m_dateMode;
+}
+
+inline size_t
+FrozenBook::sheetsCount() const
+{
+	return m_sheets.size();
+}
+
+inline const FrozenSheet *
+FrozenBook::sheet( size_t index ) const
 {
 	if( index < m_sheets.size() )
 		return m_sheets[ index ].get();
@@ -0,0 +1,73 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__CANCELLATION_HPP__INCLUDED
+#define EXCEL__CANCELLATION_HPP__INCLUDED
+
+// C++ include.
+#include <atomic>
+
+
+namespace Excel {
+
+//
+// CancellationToken
+//
+
+//! Flag to stop parsing from any thread.
+/*!
+	Storage returns isCancelled() of the token from IStorage::isCancelled(),
+	Book does it with Book::setCancellationToken().
+*/
+class CancellationToken final {
+public:
+	CancellationToken();
+
+	CancellationToken( const CancellationToken & ) = delete;
+	CancellationToken & operator = ( const CancellationToken & ) = delete;
+
+	//! Request to stop.
+	void cancel();
+
+	//! Clear the request, so the token can be used again.
+	void reset();
+
+	//! \return Is stop requested.
+	bool isCancelled() const;
+
+private:
+	//! Is stop requested.
+	std::atomic< bool > m_cancelled;
+}; // class CancellationToken
+
+
+inline
+CancellationToken::CancellationToken()
+	:	m_cancelled( false )
+{
+}
+
+inline void
+CancellationToken::cancel()
+{
+	m_cancelled.store( true, std::memory_order_relaxed );
+}
+
+inline void
+CancellationToken::reset()
+{
+	m_cancelled.store( false, std::memory_order_relaxed );
+}
+
+inline bool
+CancellationToken::isCancelled() const
+{
+	return m_cancelled.load( std::memory_order_relaxed );
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__CANCELLATION_HPP__INCLUDED
@@ -13,6 +13,7 @@
 // C++ include
 #include <string>
 #include <sstream>
+#include <utility>
 
 
 namespace Excel {
@@ -42,7 +43,7 @@ public:
 	DataType dataType() const;
 
 	//! \return String data in the cell.
-	const std::wstring & getString() const;
+	const String & getString() const;
 
 	//! \return Double data in the cell.
 	const double & getDouble() const;
@@ -51,7 +52,16 @@ public:
 	const Formula & getFormula() const;
 
 	//! Set data.
-	void setData( const std::wstring & d );
+	void setData( const String & d );
+
+	//! Set data.
+	void setData( String && d );
+
+	//! Set data.
+	void setData( StringView d );
+
+	//! Set data.
+	void setData( const Char * d );
 
 	//! Set data.
 	void setData( const double & d );
@@ -59,12 +69,15 @@ public:
 	//! Set data.
 	void setData( const Formula & f );
 
+	//! Set data.
+	void setData( Formula && f );
+
 	//! \return true if there is no data.
 	bool isNull() const;
 
 private:
 	//! Cell's string data.
-	std::wstring m_stringData;
+	String m_stringData;
 	//! Cell's double data.
 	double m_doubleData;
 	//! Cell's formula.
@@ -89,7 +102,7 @@ Cell::dataType() const
 	return m_type;
 }
 
-inline const std::wstring &
+inline const String &
 Cell::getString() const
 {
 	return m_stringData;
@@ -108,13 +121,35 @@ Cell::getFormula() const
 }
 
 inline void
-Cell::setData( const std::wstring & d )
+Cell::setData( const String & d )
 {
 	m_stringData = d;
 	m_isNull = false;
 	m_type = DataType::String;
 }
 
+inline void
+Cell::setData( String && d )
+{
+	m_stringData = std::move( d );
+	m_isNull = false;
+	m_type = DataType::String;
+}
+
+inline void
+Cell::setData( StringView d )
+{
+	m_stringData.assign( d.data(), d.size() );
+	m_isNull = false;
+	m_type = DataType::String;
+}
+
+inline void
+Cell::setData( const Char * d )
+{
+	setData( StringView( d ) );
+}
+
 inline void
 Cell::setData( const double & d )
 {
@@ -131,6 +166,14 @@ Cell::setData( const Formula & f )
 	m_type = DataType::Formula;
 }
 
+inline void
+Cell::setData( Formula && f )
+{
+	m_formula = std::move( f );
+	m_isNull = false;
+	m_type = DataType::Formula;
+}
+
 inline bool
 Cell::isNull() const
 {
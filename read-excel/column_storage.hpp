@@ -0,0 +1,290 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__COLUMN_STORAGE_HPP__INCLUDED
+#define EXCEL__COLUMN_STORAGE_HPP__INCLUDED
+
+// Excel include.
+#include "storage.hpp"
+#include "exceptions.hpp"
+
+// C++ include.
+#include <vector>
+#include <limits>
+#include <sstream>
+
+
+namespace Excel {
+
+//
+// ColumnStorage
+//
+
+//! Storage that collects numbers of the columns into contiguous buffers.
+/*!
+	Numbers and numeric formulas go straight to std::vector< double >
+	per column while parsing, Cell objects are never created. Strings are
+	only looked at through views, so they cost nothing.
+
+	\code
+	Excel::ColumnStorage storage( { 1, 2 } );
+	Excel::Parser::loadBook( "data.xls", storage );
+
+	const std::vector< double > & prices = storage.column( 0, 2 );
+	\endcode
+*/
+class ColumnStorage
+	:	public IStorage
+{
+public:
+	//! Collect given \a columns, or all columns if it's empty. Cells without
+	//! numbers have \a missing value.
+	explicit ColumnStorage( const std::vector< size_t > & columns = std::vector< size_t > (),
+		double missing = std::numeric_limits< double >::quiet_NaN() );
+
+	//! \return Count of the sheets.
+	size_t sheetsCount() const;
+
+	//! \return Name of the sheet.
+	const String & sheetName( size_t sheetIdx ) const;
+
+	//! \return Count of rows in the sheet, including rows without numbers.
+	size_t rowsCount( size_t sheetIdx ) const;
+
+	//! \return Count of columns in the sheet that have collected numbers.
+	size_t columnsCount( size_t sheetIdx ) const;
+
+	//! \return Numbers of the column, one per row of the sheet.
+	const std::vector< double > & column( size_t sheetIdx, size_t column );
+
+protected:
+	void onSharedString( size_t sstSize, size_t idx, const String & value ) override;
+	void onDateMode( uint16_t mode ) override;
+	void onSheet( size_t idx, const String & name ) override;
+	void onCellSharedString( size_t sheetIdx, size_t row, size_t column, size_t sstIndex ) override;
+	void onCell( size_t sheetIdx, size_t row, size_t column, const String & value ) override;
+	void onCell( size_t sheetIdx, size_t row, size_t column, double value ) override;
+	void onCell( size_t sheetIdx, const Formula & value ) override;
+	void onHeader( size_t sheetIdx, const String & value ) override;
+	void onFooter( size_t sheetIdx, const String & value ) override;
+	void onSharedStringView( size_t sstSize, size_t idx, StringView value ) override;
+	void onCellView( size_t sheetIdx, size_t row, size_t column, StringView value ) override;
+	void onHeaderView( size_t sheetIdx, StringView value ) override;
+	void onFooterView( size_t sheetIdx, StringView value ) override;
+
+private:
+	//! Columns of one sheet.
+	struct SheetColumns {
+		//! Name.
+		String m_name;
+		//! Count of rows.
+		size_t m_rows = 0;
+		//! Numbers by columns.
+		std::vector< std::vector< double > > m_columns;
+	}; // struct SheetColumns
+
+	//! \return Sheet with given index.
+	SheetColumns & sheet( size_t sheetIdx );
+
+	//! \return Sheet with given index.
+	const SheetColumns & sheet( size_t sheetIdx ) const;
+
+	//! Count row of the cell.
+	void addRow( size_t sheetIdx, size_t row );
+
+	//! Store number.
+	void addNumber( size_t sheetIdx, size_t row, size_t column, double value );
+
+private:
+	//! Is column collected, empty if all columns are collected.
+	std::vector< bool > m_collected;
+	//! Value of cells without numbers.
+	double m_missing;
+	//! Sheets.
+	std::vector< SheetColumns > m_sheets;
+}; // class ColumnStorage
+
+inline
+ColumnStorage::ColumnStorage( const std::vector< size_t > & columns, double missing )
+	:	m_missing( missing )
+{
+	for( const auto c : columns )
+	{
+		if( m_collected.size() <= c )
+			m_collected.resize( c + 1, false );
+
+		m_collected[ c ] = true;
+	}
+}
+
+inline size_t
+ColumnStorage::sheetsCount() const
+{
+	return m_sheets.size();
+}
+
+inline const String &
+ColumnStorage::sheetName( size_t sheetIdx ) const
+{
+	return sheet( sheetIdx ).m_name;
+}
+
+inline size_t
+ColumnStorage::rowsCount( size_t sheetIdx ) const
+{
+	return sheet( sheetIdx ).m_rows;
+}
+
+inline size_t
+ColumnStorage::columnsCount( size_t sheetIdx ) const
+{
+	return sheet( sheetIdx ).m_columns.size();
+}
+
+inline const std::vector< double > &
+ColumnStorage::column( size_t sheetIdx, size_t column )
+{
+	SheetColumns & s = sheet( sheetIdx );
+
+	if( s.m_columns.size() <= column )
+		s.m_columns.resize( column + 1 );
+
+	s.m_columns[ column ].resize( s.m_rows, m_missing );
+
+	return s.m_columns[ column ];
+}
+
+inline ColumnStorage::SheetColumns &
+ColumnStorage::sheet( size_t sheetIdx )
+{
+	return const_cast< SheetColumns& > (
+		static_cast< const ColumnStorage* > ( this )->sheet( sheetIdx ) );
+}
+
+inline const ColumnStorage::SheetColumns &
+ColumnStorage::sheet( size_t sheetIdx ) const
+{
+	if( sheetIdx < m_sheets.size() )
+		return m_sheets[ sheetIdx ];
+
+	std::wstringstream stream;
+	stream << L"There is no such sheet with index : " << sheetIdx;
+
+	throw Exception( stream.str() );
+}
+
+inline void
+ColumnStorage::addRow( size_t sheetIdx, size_t row )
+{
+	SheetColumns & s = sheet( sheetIdx );
+
+	if( s.m_rows <= row )
+		s.m_rows = row + 1;
+}
+
+inline void
+ColumnStorage::addNumber( size_t sheetIdx, size_t row, size_t column, double value )
+{
+	addRow( sheetIdx, row );
+
+	if( !m_collected.empty() && ( column >= m_collected.size() || !m_collected[ column ] ) )
+		return;
+
+	SheetColumns & s = m_sheets[ sheetIdx ];
+
+	if( s.m_columns.size() <= column )
+		s.m_columns.resize( column + 1 );
+
+	std::vector< double > & c = s.m_columns[ column ];
+
+	if( c.size() <= row )
+		c.resize( row + 1, m_missing );
+
+	c[ row ] = value;
+}
+
+inline void
+ColumnStorage::onSharedString( size_t, size_t, const String & )
+{
+}
+
+inline void
+ColumnStorage::onDateMode( uint16_t )
+{
+}
+
+inline void
+ColumnStorage::onSheet( size_t idx, const String & name )
+{
+	if( m_sheets.size() <= idx )
+		m_sheets.resize( idx + 1 );
+
+	m_sheets[ idx ].m_name = name;
+}
+
+inline void
+ColumnStorage::onCellSharedString( size_t sheetIdx, size_t row, size_t, size_t )
+{
+	addRow( sheetIdx, row );
+}
+
+inline void
+ColumnStorage::onCell( size_t sheetIdx, size_t row, size_t, const String & )
+{
+	addRow( sheetIdx, row );
+}
+
+inline void
+ColumnStorage::onCell( size_t sheetIdx, size_t row, size_t column, double value )
+{
+	addNumber( sheetIdx, row, column, value );
+}
+
+inline void
+ColumnStorage::onCell( size_t sheetIdx, const Formula & value )
+{
+	const size_t row = value.getRow();
+
+	if( value.valueType() == Formula::DoubleValue )
+		addNumber( sheetIdx, row, value.getColumn(), value.getDouble() );
+	else
+		addRow( sheetIdx, row );
+}
+
+inline void
+ColumnStorage::onHeader( size_t, const String & )
+{
+}
+
+inline void
+ColumnStorage::onFooter( size_t, const String & )
+{
+}
+
+inline void
+ColumnStorage::onSharedStringView( size_t, size_t, StringView )
+{
+}
+
+inline void
+ColumnStorage::onCellView( size_t sheetIdx, size_t row, size_t, StringView )
+{
+	addRow( sheetIdx, row );
+}
+
+inline void
+ColumnStorage::onHeaderView( size_t, StringView )
+{
+}
+
+inline void
+ColumnStorage::onFooterView( size_t, StringView )
+{
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__COLUMN_STORAGE_HPP__INCLUDED
@@ -13,6 +13,7 @@
 #include "sat.hpp"
 #include "msat.hpp"
 #include "utils.hpp"
+#include "reader.hpp"
 #include "compoundfile_exceptions.hpp"
 
 // C++ include.
@@ -20,6 +21,8 @@
 #include <fstream>
 #include <memory>
 #include <map>
+#include <vector>
+#include <algorithm>
 
 
 namespace CompoundFile {
@@ -42,8 +45,40 @@ public:
 	bool hasDirectory( const std::wstring & name ) const;
 
 	//! \return Stream in the directory.
+	//! Returned streams are independent and can be read from different
+	//! threads, if File was opened by the file name.
 	std::unique_ptr< Excel::Stream > stream( const Directory & dir );
 
+	//! Set count of the next sectors to prefetch in the background while
+	//! reading streams. Useful on network storages where latency dominates.
+	//! Applied to streams created after this call. 0 turns read-ahead off.
+	void setReadAhead( int32_t sectors );
+
+	//! \return Count of the sectors to prefetch.
+	int32_t readAhead() const;
+
+	//! Set whether large streams created after this call read all their
+	//! sectors at once with one batch of reads. Sectors are fetched with
+	//! io_uring if it's enabled, or with several threads otherwise.
+	void setPreload( bool on = true );
+
+	//! \return Are streams preloaded.
+	bool preload() const;
+
+	//! Set whether Excel::Parser reads records of the sheets in other
+	//! thread than decodes them.
+	void setPipelined( bool on = true );
+
+	//! \return Are sheets loaded in two threads.
+	bool pipelined() const;
+
+	//! \return Whole stream in the directory as one contiguous buffer.
+	//! Sectors are read with one batch of reads.
+	std::vector< char > readStreamFully( const Directory & dir ) const;
+
+	//! \return Byte order in the file.
+	Excel::Stream::ByteOrder byteOrder() const;
+
 private:
 	//! Read stream and initialize m_dirs.
     void initialize( const std::string& fileName );
@@ -53,6 +88,8 @@ private:
 	std::ifstream m_fileStream;
 	//! Stream.
 	std::istream & m_stream;
+	//! Positional reader of the sectors.
+	std::unique_ptr< Reader > m_reader;
 	//! Header of the compound file.
 	Header m_header;
 	//! SAT.
@@ -63,6 +100,12 @@ private:
 	SecID m_shortStreamFirstSector;
 	//! All directories defined in the compound file.
 	std::map< int32_t, Directory > m_dirs;
+	//! Count of the sectors to prefetch.
+	int32_t m_readAhead;
+	//! Are streams preloaded.
+	bool m_preload;
+	//! Are sheets loaded in two threads.
+	bool m_pipelined;
 }; // class File
 
 
@@ -144,6 +187,10 @@ loadChildDirectories( std::map< int32_t, Directory > & dirs,
 inline
 File::File( std::istream & stream, const std::string & fileName )
 	:	m_stream( stream )
+	,	m_reader( new IStreamReader( m_stream ) )
+	,	m_readAhead( 0 )
+	,	m_preload( false )
+	,	m_pipelined( false )
 {
 	initialize( fileName );
 }
@@ -152,7 +199,10 @@ inline
 File::File( const std::string & fileName )
 	:	m_fileStream( fileName, std::ios::in | std::ios::binary )
 	,	m_stream( m_fileStream )
-	
+	,	m_reader( new FileReader( fileName ) )
+	,	m_readAhead( 0 )
+	,	m_preload( false )
+	,	m_pipelined( false )
 {
 	initialize( fileName );
 }
@@ -192,8 +242,114 @@ File::hasDirectory( const std::wstring & name ) const
 inline std::unique_ptr< Excel::Stream >
 File::stream( const Directory & dir )
 {
-	return std::make_unique< CompoundFile::Stream > ( m_header,
-		m_sat, m_ssat, dir, m_shortStreamFirstSector, m_stream );
+	auto stream = std::make_unique< CompoundFile::Stream > ( m_header,
+		m_sat, m_ssat, dir, m_shortStreamFirstSector, *m_reader );
+
+	stream->setReadAhead( m_readAhead );
+
+	if( m_preload )
+		stream->preload();
+
+	return stream;
+}
+
+inline void
+File::setReadAhead( int32_t sectors )
+{
+	m_readAhead = sectors;
+}
+
+inline int32_t
+File::readAhead() const
+{
+	return m_readAhead;
+}
+
+inline void
+File::setPreload( bool on )
+{
+	m_preload = on;
+}
+
+inline bool
+File::preload() const
+{
+	return m_preload;
+}
+
+inline void
+File::setPipelined( bool on )
+{
+	m_pipelined = on;
+}
+
+inline bool
+File::pipelined() const
+{
+	return m_pipelined;
+}
+
+inline std::vector< char >
+File::readStreamFully( const Directory & dir ) const
+{
+	const int32_t size = std::max( dir.streamSize(), 0 );
+
+	if( size == 0 )
+		return std::vector< char > ();
+
+	if( size >= m_header.streamMinSize() )
+	{
+		const std::vector< SecID > chain = m_sat.sectors( dir.streamSecID() );
+
+		std::vector< char > data( chain.size() * m_header.sectorSize() );
+
+		readChain( *m_reader, chain, m_header.sectorSize(), &data[ 0 ] );
+
+		Excel::ParseStatsPolicy::onSectors( chain.size(), data.size() );
+
+		if( data.size() < static_cast< size_t > ( size ) )
+			throw Exception( L"Stream is larger than its chain of sectors." );
+
+		data.resize( size );
+
+		return data;
+	}
+
+	const std::vector< SecID > containerChain =
+		m_sat.sectors( m_shortStreamFirstSector );
+	const std::vector< SecID > chain = m_ssat.sectors( dir.streamSecID() );
+	const int32_t shortSectorSize = m_header.shortSectorSize();
+	const int32_t shortSectorsInLarge = m_header.sectorSize() / shortSectorSize;
+
+	std::vector< char > data( chain.size() * shortSectorSize );
+	std::vector< ReadRequest > requests;
+	requests.reserve( chain.size() );
+
+	for( size_t i = 0; i < chain.size(); ++i )
+	{
+		const SecID largeSector = containerChain.at( chain[ i ] / shortSectorsInLarge );
+
+		requests.push_back( { calcFileOffset( largeSector, m_header.sectorSize() ) +
+				( chain[ i ] % shortSectorsInLarge ) * shortSectorSize,
+			&data[ i * shortSectorSize ], static_cast< size_t > ( shortSectorSize ) } );
+	}
+
+	m_reader->read( requests );
+
+	Excel::ParseStatsPolicy::onSectors( requests.size(), data.size() );
+
+	if( data.size() < static_cast< size_t > ( size ) )
+		throw Exception( L"Stream is larger than its chain of sectors." );
+
+	data.resize( size );
+
+	return data;
+}
+
+inline Excel::Stream::ByteOrder
+File::byteOrder() const
+{
+	return m_header.byteOrder();
 }
 
 inline void
@@ -208,7 +364,7 @@ File::initialize( const std::string & fileName )
 
 		m_ssat = loadSSAT( m_header, m_stream, m_sat );
 
-		Stream stream( m_header, m_sat, m_header.dirStreamSecID(), m_stream );
+		Stream stream( m_header, m_sat, m_header.dirStreamSecID(), *m_reader );
 
 		Directory root;
 		root.load( stream );
@@ -11,6 +11,7 @@
 #include "header.hpp"
 #include "sat.hpp"
 #include "utils.hpp"
+#include "reader.hpp"
 
 // Excel include.
 #include "../stream.hpp"
@@ -18,6 +19,8 @@
 // C++ include.
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <cstring>
 
 
 namespace CompoundFile {
@@ -97,6 +100,11 @@ private:
 //
 
 //! Stream in a compound file.
+/*!
+	Stream keeps its own position and sector buffer and reads sectors
+	with positional reads of the Reader, so different streams of one
+	File can be read from different threads.
+*/
 class Stream
 	:	public Excel::Stream
 {
@@ -107,7 +115,7 @@ protected:
 	Stream( const Header & header,
 		const SAT & sat,
 		const SecID & secID,
-		std::istream & stream );
+		const Reader & reader );
 
 public:
 	Stream( const Header & header,
@@ -115,7 +123,7 @@ public:
 		const SAT & ssat,
 		const Directory & dir,
 		const SecID & shortStreamFirstSector,
-		std::istream & cstream );
+		const Reader & reader );
 
 	//! Read one byte from the stream.
 	char getByte() override;
@@ -129,9 +137,37 @@ public:
 	//! \return Position in the stream.
 	int32_t pos() override;
 
+	//! Read \a size bytes from the stream, copying sector by sector.
+	//! \return Count of read bytes, less than \a size on the end of stream.
+	int32_t readBytes( char * data, int32_t size ) override;
+
+	//! \return Size of the stream.
+	int32_t size() const override;
+
+	//! Set count of the next sectors in the chain to prefetch
+	//! while reading. 0 turns read-ahead off.
+	void setReadAhead( int32_t sectors );
+
+	//! \return Count of the sectors to prefetch.
+	int32_t readAhead() const;
+
+	//! Read all sectors of the stream with one batch of reads, after
+	//! that the stream doesn't touch the file. Does nothing for the
+	//! short stream.
+	void preload();
+
+	//! \return Is stream preloaded.
+	bool isPreloaded() const;
+
 private:
+	//! Read sector of the large stream or of the short-stream container
+	//! into the buffer.
+	void readLargeSector( const SecID & id );
 	//! Seek internal stream to the next sector.
 	void seekToNextSector();
+	//! Prefetch next sectors of the large stream if read-ahead window
+	//! is half consumed.
+	void prefetch();
 	//! \return Offset in sectors from the beginning of the large
 	//! stream sector.
 	int32_t whereIsShortSector( const SecID & shortSector,
@@ -144,8 +180,8 @@ private:
 	std::vector< SecID > m_largeStreamChain;
 	//! Short stream sectors chain.
 	std::vector< SecID > m_shortStreamChain;
-	//! File's stream.
-	std::istream & m_stream;
+	//! Reader of the file.
+	const Reader & m_reader;
 
 	//! Mode of the stream.
 	enum Mode {
@@ -176,16 +212,22 @@ private:
 	int32_t m_pos;
 	//! Current large sector ID.
 	SecID m_currentLargeSectorID;
+	//! Count of the sectors to prefetch.
+	int32_t m_readAhead;
+	//! Index in the large stream chain of the first not prefetched sector.
+	int32_t m_prefetchedIdx;
+	//! Is stream preloaded. Then buffer keeps all sectors of the chain.
+	bool m_isPreloaded;
 }; // class Stream
 
 inline
 Stream::Stream( const Header & header,
 	const SAT & sat,
 	const SecID & secID,
-	std::istream & stream )
+	const Reader & reader )
 	:	Excel::Stream( header.byteOrder() )
 	,	m_header( header )
-	,	m_stream( stream )
+	,	m_reader( reader )
 	,	m_mode( LargeStream )
 	,	m_bytesReaded( 0 )
 	,	m_sectorSize( m_header.sectorSize() )
@@ -194,19 +236,19 @@ Stream::Stream( const Header & header,
 	,	m_largeSecIDIdx( 0 )
 	,	m_streamSize( 0 )
 	,	m_pos( 0 )
+	,	m_readAhead( 0 )
+	,	m_prefetchedIdx( 1 )
+	,	m_isPreloaded( false )
 {
 	m_largeStreamChain = sat.sectors( secID );
 
-	m_stream.seekg( calcFileOffset( m_largeStreamChain.front(),
-		m_sectorSize ) );
-
 	m_currentLargeSectorID = m_largeStreamChain.front();
 
 	m_streamSize = static_cast< int32_t > ( m_largeStreamChain.size() ) * m_sectorSize;
 
 	m_buf.resize( m_sectorSize );
 
-	m_stream.read( &m_buf[ 0 ], m_sectorSize );
+	readLargeSector( m_currentLargeSectorID );
 }
 
 inline
@@ -215,10 +257,10 @@ Stream::Stream( const Header & header,
 	const SAT & ssat,
 	const Directory & dir,
 	const SecID & shortStreamFirstSector,
-	std::istream & cstream )
+	const Reader & reader )
 	:	Excel::Stream( header.byteOrder() )
 	,	m_header( header )
-	,	m_stream( cstream )
+	,	m_reader( reader )
 	,	m_mode(
 		( dir.streamSize() < m_header.streamMinSize() ? ShortStream : LargeStream ) )
 	,	m_bytesReaded( 0 )
@@ -230,17 +272,18 @@ Stream::Stream( const Header & header,
 	,	m_largeSecIDIdx( 0 )
 	,	m_streamSize( dir.streamSize() )
 	,	m_pos( 0 )
+	,	m_readAhead( 0 )
+	,	m_prefetchedIdx( 1 )
+	,	m_isPreloaded( false )
 {
 	m_buf.resize( m_header.sectorSize() );
 
 	if( m_mode == LargeStream )
 	{
 		m_largeStreamChain = sat.sectors( dir.streamSecID() );
-		m_stream.seekg( calcFileOffset( m_largeStreamChain.front(),
-			m_header.sectorSize() ) );
 		m_currentLargeSectorID = m_largeStreamChain.front();
 
-		m_stream.read( &m_buf[ 0 ], m_sectorSize );
+		readLargeSector( m_currentLargeSectorID );
 	}
 	else
 	{
@@ -253,12 +296,7 @@ Stream::Stream( const Header & header,
 
 		m_currentLargeSectorID = largeSector;
 
-		std::streampos pos = calcFileOffset( largeSector,
-			m_header.sectorSize() );
-
-		m_stream.seekg( pos );
-
-		m_stream.read( &m_buf[ 0 ], m_header.sectorSize() );
+		readLargeSector( largeSector );
 
 		m_pos = offset * m_header.shortSectorSize();
 	}
@@ -273,6 +311,8 @@ Stream::eof() const
 inline void
 Stream::seek( int32_t pos, SeekType type )
 {
+	Excel::ParseStatsPolicy::onSeek();
+
 	if( type == FromCurrent )
 	{
 		pos += m_bytesReaded;
@@ -299,7 +339,13 @@ Stream::seek( int32_t pos, SeekType type )
 	m_bytesReaded = pos;
 	m_sectorBytesReaded = offset;
 
-	if( m_mode == LargeStream )
+	if( m_mode == LargeStream && m_isPreloaded )
+	{
+		m_largeSecIDIdx = sectorIdx;
+		m_currentLargeSectorID = m_largeStreamChain.at( m_largeSecIDIdx );
+		m_pos = sectorIdx * m_sectorSize + offset;
+	}
+	else if( m_mode == LargeStream )
 	{
 		m_largeSecIDIdx = sectorIdx;
 
@@ -307,10 +353,9 @@ Stream::seek( int32_t pos, SeekType type )
 		{
 			m_currentLargeSectorID = m_largeStreamChain.at( m_largeSecIDIdx );
 
-			m_stream.seekg( calcFileOffset( m_largeStreamChain.at( m_largeSecIDIdx ),
-				m_sectorSize ), std::ios::beg );
+			readLargeSector( m_currentLargeSectorID );
 
-			m_stream.read( &m_buf[ 0 ], m_sectorSize );
+			prefetch();
 		}
 
 		m_pos = offset;
@@ -329,12 +374,7 @@ Stream::seek( int32_t pos, SeekType type )
 		{
 			m_currentLargeSectorID = largeSector;
 
-			std::streampos pos = calcFileOffset( largeSector,
-				m_header.sectorSize() );
-
-			m_stream.seekg( pos, std::ios::beg );
-
-			m_stream.read( &m_buf[ 0 ], m_header.sectorSize() );
+			readLargeSector( largeSector );
 		}
 
 		m_pos = offsetInLargeSector * m_header.shortSectorSize();
@@ -351,6 +391,70 @@ Stream::pos()
 		return m_bytesReaded;
 }
 
+inline int32_t
+Stream::size() const
+{
+	return m_streamSize;
+}
+
+inline void
+Stream::setReadAhead( int32_t sectors )
+{
+	m_readAhead = std::max( sectors, 0 );
+
+	prefetch();
+}
+
+inline int32_t
+Stream::readAhead() const
+{
+	return m_readAhead;
+}
+
+inline void
+Stream::prefetch()
+{
+	if( m_mode != LargeStream || m_readAhead == 0 || m_isPreloaded ||
+		m_prefetchedIdx - m_largeSecIDIdx > m_readAhead / 2 )
+			return;
+
+	const int32_t first = std::max( m_prefetchedIdx, m_largeSecIDIdx + 1 );
+	const int32_t last = std::min( m_largeSecIDIdx + 1 + m_readAhead,
+		static_cast< int32_t > ( m_largeStreamChain.size() ) );
+
+	if( first < last )
+	{
+		for( const auto & r : chainRequests( m_largeStreamChain, first, last,
+			m_sectorSize, nullptr ) )
+				m_reader.prefetch( r.m_offset, r.m_size );
+	}
+
+	m_prefetchedIdx = std::max( m_prefetchedIdx, last );
+}
+
+inline void
+Stream::preload()
+{
+	if( m_mode != LargeStream || m_isPreloaded )
+		return;
+
+	m_buf.resize( m_largeStreamChain.size() * m_sectorSize );
+
+	readChain( m_reader, m_largeStreamChain, m_sectorSize, &m_buf[ 0 ] );
+
+	Excel::ParseStatsPolicy::onSectors( m_largeStreamChain.size(), m_buf.size() );
+
+	m_isPreloaded = true;
+
+	m_pos += m_largeSecIDIdx * m_sectorSize;
+}
+
+inline bool
+Stream::isPreloaded() const
+{
+	return m_isPreloaded;
+}
+
 inline int32_t
 Stream::whereIsShortSector( const SecID & shortSector,
 	SecID & largeSector )
@@ -367,6 +471,16 @@ Stream::whereIsShortSector( const SecID & shortSector,
 	return offset;
 }
 
+inline void
+Stream::readLargeSector( const SecID & id )
+{
+	const int32_t size = m_header.sectorSize();
+
+	m_reader.read( calcFileOffset( id, size ), &m_buf[ 0 ], size );
+
+	Excel::ParseStatsPolicy::onSectors( 1, size );
+}
+
 inline void
 Stream::seekToNextSector()
 {
@@ -374,14 +488,18 @@ Stream::seekToNextSector()
 	{
 		++m_largeSecIDIdx;
 
-		m_stream.seekg( calcFileOffset( m_largeStreamChain.at( m_largeSecIDIdx ),
-			m_sectorSize ), std::ios::beg );
-
 		m_currentLargeSectorID = m_largeStreamChain.at( m_largeSecIDIdx );
 
-		m_stream.read( &m_buf[ 0 ], m_sectorSize );
+		if( m_isPreloaded )
+			m_pos = m_largeSecIDIdx * m_sectorSize;
+		else
+		{
+			readLargeSector( m_currentLargeSectorID );
+
+			prefetch();
 
-		m_pos = 0;
+			m_pos = 0;
+		}
 	}
 	else
 	{
@@ -396,12 +514,7 @@ Stream::seekToNextSector()
 		{
 			m_currentLargeSectorID = largeSector;
 
-			std::streampos pos = calcFileOffset( largeSector,
-				m_header.sectorSize() );
-
-			m_stream.seekg( pos, std::ios::beg );
-
-			m_stream.read( &m_buf[ 0 ], m_header.sectorSize() );
+			readLargeSector( largeSector );
 		}
 
 		m_pos = offset * m_header.shortSectorSize();
@@ -433,6 +546,38 @@ Stream::getByte()
 	return ch;
 }
 
+inline int32_t
+Stream::readBytes( char * data, int32_t size )
+{
+	int32_t done = 0;
+
+	while( done < size && m_bytesReaded < m_streamSize )
+	{
+		if( m_sectorBytesReaded == m_sectorSize )
+		{
+			m_sectorBytesReaded = 0;
+
+			seekToNextSector();
+		}
+
+		const int32_t bytes = std::min( { size - done,
+			m_sectorSize - m_sectorBytesReaded,
+			m_streamSize - m_bytesReaded } );
+
+		if( m_pos + bytes > static_cast< int32_t >( m_buf.size() ) )
+			throw Exception( L"Stream position out of bounds - corrupted compound file" );
+
+		std::memcpy( data + done, &m_buf[ m_pos ], bytes );
+
+		m_sectorBytesReaded += bytes;
+		m_bytesReaded += bytes;
+		m_pos += bytes;
+		done += bytes;
+	}
+
+	return done;
+}
+
 
 //
 // Directory
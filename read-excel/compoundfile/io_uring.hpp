@@ -0,0 +1,375 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef COMPOUNDFILE__IO_URING_HPP__INCLUDED
+#define COMPOUNDFILE__IO_URING_HPP__INCLUDED
+
+// CompoundFile include.
+#include "utils.hpp"
+
+// C++ include.
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+
+// Linux include.
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace CompoundFile {
+
+//
+// IoUring
+//
+
+//! io_uring instance for batches of positional reads.
+/*!
+	Talks to the kernel with raw system calls, so liburing is not needed.
+	If io_uring is not available (old kernel, seccomp) isValid() returns
+	false and caller should read in another way.
+
+	Not thread-safe, one batch at a time.
+*/
+class IoUring {
+public:
+	explicit IoUring( unsigned entries = 64 );
+	~IoUring();
+
+	IoUring( const IoUring & ) = delete;
+	IoUring & operator = ( const IoUring & ) = delete;
+
+	//! \return Is ring ready to use.
+	bool isValid() const;
+
+	//! Read all requests from the file descriptor keeping queue full.
+	//! \return false if kernel refused the requests.
+	bool read( int fd, const std::vector< ReadRequest > & requests,
+		size_t & bytes );
+
+private:
+	//! Submit queued SQEs and wait for at least \a wait completions.
+	//! \a submitted is set to count of SQEs taken by the kernel.
+	bool enter( unsigned submit, unsigned wait, unsigned * submitted = nullptr );
+
+	//! Wait for \a inFlight requests and drop their completions, so
+	//! the kernel doesn't write to the buffers after return.
+	//! \return false if the ring can't wait.
+	bool drain( unsigned & inFlight );
+
+private:
+	//! Ring's file descriptor.
+	int m_fd;
+	//! Mapped submission ring.
+	void * m_sqRing;
+	//! Size of mapped submission ring.
+	size_t m_sqRingSize;
+	//! Mapped completion ring.
+	void * m_cqRing;
+	//! Size of mapped completion ring.
+	size_t m_cqRingSize;
+	//! Mapped submission entries.
+	io_uring_sqe * m_sqes;
+	//! Size of mapped submission entries.
+	size_t m_sqesSize;
+	//! Count of submission entries.
+	unsigned m_entries;
+	//! Head of submission ring.
+	unsigned * m_sqHead;
+	//! Tail of submission ring.
+	unsigned * m_sqTail;
+	//! Mask of submission ring.
+	unsigned * m_sqMask;
+	//! Indexes array of submission ring.
+	unsigned * m_sqArray;
+	//! Head of completion ring.
+	unsigned * m_cqHead;
+	//! Tail of completion ring.
+	unsigned * m_cqTail;
+	//! Mask of completion ring.
+	unsigned * m_cqMask;
+	//! Completion entries.
+	io_uring_cqe * m_cqes;
+}; // class IoUring
+
+inline
+IoUring::IoUring( unsigned entries )
+	:	m_fd( -1 )
+	,	m_sqRing( MAP_FAILED )
+	,	m_sqRingSize( 0 )
+	,	m_cqRing( MAP_FAILED )
+	,	m_cqRingSize( 0 )
+	,	m_sqes( nullptr )
+	,	m_sqesSize( 0 )
+	,	m_entries( 0 )
+	,	m_sqHead( nullptr )
+	,	m_sqTail( nullptr )
+	,	m_sqMask( nullptr )
+	,	m_sqArray( nullptr )
+	,	m_cqHead( nullptr )
+	,	m_cqTail( nullptr )
+	,	m_cqMask( nullptr )
+	,	m_cqes( nullptr )
+{
+#ifdef __NR_io_uring_setup
+	io_uring_params params;
+	std::memset( &params, 0, sizeof( params ) );
+
+	m_fd = static_cast< int > ( ::syscall( __NR_io_uring_setup, entries, &params ) );
+
+	if( m_fd < 0 )
+	{
+		m_fd = -1;
+
+		return;
+	}
+
+	m_entries = params.sq_entries;
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+
+	const bool singleMap = ( params.features & IORING_FEAT_SINGLE_MMAP );
+
+	if( singleMap )
+	{
+		if( m_cqRingSize > m_sqRingSize )
+			m_sqRingSize = m_cqRingSize;
+
+		m_cqRingSize = m_sqRingSize;
+	}
+
+	m_sqRing = ::mmap( nullptr, m_sqRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING );
+
+	if( m_sqRing == MAP_FAILED )
+		return;
+
+	if( singleMap )
+		m_cqRing = m_sqRing;
+	else
+	{
+		m_cqRing = ::mmap( nullptr, m_cqRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING );
+
+		if( m_cqRing == MAP_FAILED )
+			return;
+	}
+
+	m_sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+
+	void * sqes = ::mmap( nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES );
+
+	if( sqes == MAP_FAILED )
+		return;
+
+	m_sqes = static_cast< io_uring_sqe* > ( sqes );
+
+	char * sq = static_cast< char* > ( m_sqRing );
+	char * cq = static_cast< char* > ( m_cqRing );
+
+	m_sqHead = reinterpret_cast< unsigned* > ( sq + params.sq_off.head );
+	m_sqTail = reinterpret_cast< unsigned* > ( sq + params.sq_off.tail );
+	m_sqMask = reinterpret_cast< unsigned* > ( sq + params.sq_off.ring_mask );
+	m_sqArray = reinterpret_cast< unsigned* > ( sq + params.sq_off.array );
+	m_cqHead = reinterpret_cast< unsigned* > ( cq + params.cq_off.head );
+	m_cqTail = reinterpret_cast< unsigned* > ( cq + params.cq_off.tail );
+	m_cqMask = reinterpret_cast< unsigned* > ( cq + params.cq_off.ring_mask );
+	m_cqes = reinterpret_cast< io_uring_cqe* > ( cq + params.cq_off.cqes );
+#else
+	(void) entries;
+#endif // __NR_io_uring_setup
+}
+
+inline
+IoUring::~IoUring()
+{
+	if( m_sqes )
+		::munmap( m_sqes, m_sqesSize );
+
+	if( m_cqRing != MAP_FAILED && m_cqRing != m_sqRing )
+		::munmap( m_cqRing, m_cqRingSize );
+
+	if( m_sqRing != MAP_FAILED )
+		::munmap( m_sqRing, m_sqRingSize );
+
+	if( m_fd != -1 )
+		::close( m_fd );
+}
+
+inline bool
+IoUring::isValid() const
+{
+	return ( m_sqes != nullptr );
+}
+
+inline bool
+IoUring::enter( unsigned submit, unsigned wait, unsigned * submitted )
+{
+#ifdef __NR_io_uring_enter
+	while( true )
+	{
+		const long res = ::syscall( __NR_io_uring_enter, m_fd, submit, wait,
+			( wait ? IORING_ENTER_GETEVENTS : 0u ), nullptr, 0 );
+
+		if( res >= 0 )
+		{
+			if( submitted )
+				*submitted = static_cast< unsigned > ( res );
+
+			return true;
+		}
+
+		if( errno != EINTR )
+			return false;
+	}
+#else
+	(void) submit;
+	(void) wait;
+	(void) submitted;
+
+	return false;
+#endif // __NR_io_uring_enter
+}
+
+inline bool
+IoUring::drain( unsigned & inFlight )
+{
+	unsigned head = *m_cqHead;
+
+	while( inFlight )
+	{
+		while( inFlight && head != __atomic_load_n( m_cqTail, __ATOMIC_ACQUIRE ) )
+		{
+			++head;
+			--inFlight;
+		}
+
+		__atomic_store_n( m_cqHead, head, __ATOMIC_RELEASE );
+
+		if( inFlight && !enter( 0, 1 ) )
+			return false;
+	}
+
+	return true;
+}
+
+inline bool
+IoUring::read( int fd, const std::vector< ReadRequest > & requests,
+	size_t & bytes )
+{
+	bytes = 0;
+
+	if( !isValid() )
+		return false;
+
+	// Bytes read by every request.
+	std::vector< size_t > done( requests.size(), 0 );
+	// Indexes of the requests waiting for submission, short reads are
+	// queued again for the rest of the bytes.
+	std::vector< size_t > queue;
+	queue.reserve( requests.size() );
+
+	for( size_t i = 0; i < requests.size(); ++i )
+	{
+		if( requests[ i ].m_size )
+			queue.push_back( i );
+	}
+
+	size_t queueHead = 0;
+	// Requests taken by the kernel and not completed.
+	unsigned inFlight = 0;
+	// SQEs in the ring not taken by the kernel yet.
+	unsigned queued = 0;
+
+	while( queueHead < queue.size() || inFlight || queued )
+	{
+		unsigned tail = *m_sqTail;
+
+		while( queueHead < queue.size() && inFlight + queued < m_entries )
+		{
+			const size_t idx = queue[ queueHead++ ];
+			const ReadRequest & r = requests[ idx ];
+			const unsigned slot = tail & *m_sqMask;
+
+			io_uring_sqe & sqe = m_sqes[ slot ];
+			std::memset( &sqe, 0, sizeof( sqe ) );
+			sqe.opcode = IORING_OP_READ;
+			sqe.fd = fd;
+			sqe.off = r.m_offset + done[ idx ];
+			sqe.addr = reinterpret_cast< uint64_t > ( r.m_data + done[ idx ] );
+			sqe.len = static_cast< uint32_t > ( r.m_size - done[ idx ] );
+			sqe.user_data = idx;
+
+			m_sqArray[ slot ] = slot;
+
+			++tail;
+			++queued;
+		}
+
+		__atomic_store_n( m_sqTail, tail, __ATOMIC_RELEASE );
+
+		unsigned submitted = 0;
+
+		if( !enter( queued, 1, &submitted ) )
+		{
+			// Nothing is taken on error, so SQEs are taken back, and reads
+			// of the previous rounds are waited, as the caller reads to the
+			// same buffers in another way.
+			__atomic_store_n( m_sqTail, tail - queued, __ATOMIC_RELEASE );
+			drain( inFlight );
+
+			return false;
+		}
+
+		queued -= submitted;
+		inFlight += submitted;
+
+		unsigned head = *m_cqHead;
+
+		while( head != __atomic_load_n( m_cqTail, __ATOMIC_ACQUIRE ) )
+		{
+			const io_uring_cqe & cqe = m_cqes[ head & *m_cqMask ];
+			const size_t idx = static_cast< size_t > ( cqe.user_data );
+
+			++head;
+			--inFlight;
+
+			if( cqe.res > 0 )
+			{
+				done[ idx ] += static_cast< size_t > ( cqe.res );
+				bytes += static_cast< size_t > ( cqe.res );
+
+				if( done[ idx ] < requests[ idx ].m_size )
+					queue.push_back( idx );
+			}
+			else if( cqe.res == -EINTR || cqe.res == -EAGAIN )
+				queue.push_back( idx );
+			else if( cqe.res < 0 )
+			{
+				__atomic_store_n( m_cqHead, head, __ATOMIC_RELEASE );
+
+				// SQEs not taken by the kernel are taken back.
+				__atomic_store_n( m_sqTail, tail - queued, __ATOMIC_RELEASE );
+				drain( inFlight );
+
+				return false;
+			}
+		}
+
+		__atomic_store_n( m_cqHead, head, __ATOMIC_RELEASE );
+	}
+
+	return true;
+}
+
+} /* namespace CompoundFile */
+
+#endif // COMPOUNDFILE__IO_URING_HPP__INCLUDED
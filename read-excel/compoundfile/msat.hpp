@@ -111,7 +111,8 @@ loadMSATSector( std::istream & stream, std::vector< SecID > & msat,
 
 		readData( stream, secID, 4 );
 
-		msat.push_back( secID );
+		if( secID != SecID::FreeSecID )
+			msat.push_back( secID );
 	}
 
 	int32_t nextSecID = 0;
@@ -0,0 +1,210 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef COMPOUNDFILE__READ_POOL_HPP__INCLUDED
+#define COMPOUNDFILE__READ_POOL_HPP__INCLUDED
+
+// C++ include.
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <system_error>
+#include <cstddef>
+
+
+namespace CompoundFile {
+
+//
+// ReadPool
+//
+
+//! Long-lived threads for batches of positional reads.
+/*!
+	Batches of sectors are small, so starting threads for every batch
+	costs as much as reading. Threads of the pool live as long as the pool
+	and sleep between batches.
+
+	The calling thread takes part in the batch. One batch runs at a time,
+	if the pool is busy with another batch the caller runs all tasks
+	itself instead of waiting.
+*/
+class ReadPool final {
+public:
+	//! Start \a threadsCount threads, fewer if threads can't be created.
+	explicit ReadPool( size_t threadsCount );
+	~ReadPool();
+
+	ReadPool( const ReadPool & ) = delete;
+	ReadPool & operator = ( const ReadPool & ) = delete;
+
+	//! \return Pool shared by all readers, with up to 3 threads.
+	static ReadPool & global();
+
+	//! \return Count of threads.
+	size_t threadsCount() const;
+
+	//! Run \a task for every index from 0 to \a count on the threads of
+	//! the pool and on the calling thread. \a task must not throw.
+	void run( size_t count, const std::function< void( size_t ) > & task );
+
+private:
+	//! Loop of the thread.
+	void work();
+
+	//! Run tasks of the current batch while there are any.
+	void runTasks();
+
+private:
+	//! Threads.
+	std::vector< std::thread > m_threads;
+	//! Serializes batches.
+	std::mutex m_runMutex;
+	//! Mutex of the state below.
+	std::mutex m_mutex;
+	//! Start of the batch.
+	std::condition_variable m_start;
+	//! All threads are done with the batch.
+	std::condition_variable m_done;
+	//! Task of the current batch.
+	const std::function< void( size_t ) > * m_task;
+	//! Count of tasks of the current batch.
+	size_t m_count;
+	//! Next index to run.
+	std::atomic< size_t > m_next;
+	//! Number of the current batch.
+	size_t m_generation;
+	//! Count of threads not done with the current batch.
+	size_t m_active;
+	//! Stop threads.
+	bool m_stop;
+}; // class ReadPool
+
+inline
+ReadPool::ReadPool( size_t threadsCount )
+	:	m_task( nullptr )
+	,	m_count( 0 )
+	,	m_next( 0 )
+	,	m_generation( 0 )
+	,	m_active( 0 )
+	,	m_stop( false )
+{
+	for( size_t i = 0; i < threadsCount; ++i )
+	{
+		try {
+			m_threads.emplace_back( &ReadPool::work, this );
+		}
+		catch( const std::system_error & )
+		{
+			break;
+		}
+	}
+}
+
+inline
+ReadPool::~ReadPool()
+{
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+
+		m_stop = true;
+	}
+
+	m_start.notify_all();
+
+	for( auto & t : m_threads )
+		t.join();
+}
+
+inline ReadPool &
+ReadPool::global()
+{
+	static ReadPool pool( std::min< size_t > ( 3,
+		std::max( std::thread::hardware_concurrency(), 1u ) - 1 ) );
+
+	return pool;
+}
+
+inline size_t
+ReadPool::threadsCount() const
+{
+	return m_threads.size();
+}
+
+inline void
+ReadPool::runTasks()
+{
+	for( size_t i = m_next++; i < m_count; i = m_next++ )
+		( *m_task )( i );
+}
+
+inline void
+ReadPool::run( size_t count, const std::function< void( size_t ) > & task )
+{
+	std::unique_lock< std::mutex > runLock( m_runMutex, std::try_to_lock );
+
+	if( !runLock.owns_lock() || m_threads.empty() || count < 2 )
+	{
+		for( size_t i = 0; i < count; ++i )
+			task( i );
+
+		return;
+	}
+
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+
+		m_task = &task;
+		m_count = count;
+		m_next = 0;
+		m_active = m_threads.size();
+		++m_generation;
+	}
+
+	m_start.notify_all();
+
+	runTasks();
+
+	std::unique_lock< std::mutex > lock( m_mutex );
+
+	m_done.wait( lock, [this] () { return m_active == 0; } );
+
+	m_task = nullptr;
+}
+
+inline void
+ReadPool::work()
+{
+	size_t generation = 0;
+
+	while( true )
+	{
+		{
+			std::unique_lock< std::mutex > lock( m_mutex );
+
+			m_start.wait( lock, [&] () { return m_stop || m_generation != generation; } );
+
+			if( m_stop )
+				return;
+
+			generation = m_generation;
+		}
+
+		runTasks();
+
+		std::lock_guard< std::mutex > lock( m_mutex );
+
+		if( --m_active == 0 )
+			m_done.notify_all();
+	}
+}
+
+} /* namespace CompoundFile */
+
+#endif // COMPOUNDFILE__READ_POOL_HPP__INCLUDED
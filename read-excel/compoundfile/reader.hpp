@@ -0,0 +1,373 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef COMPOUNDFILE__READER_HPP__INCLUDED
+#define COMPOUNDFILE__READER_HPP__INCLUDED
+
+// CompoundFile include.
+#include "utils.hpp"
+#include "read_pool.hpp"
+
+#if defined( READ_EXCEL_WITH_IO_URING ) && defined( __linux__ )
+	#include "io_uring.hpp"
+#endif
+
+// C++ include.
+#include <istream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+
+namespace CompoundFile {
+
+//
+// Reader
+//
+
+//! Positional reader of the compound file's bytes.
+/*!
+	Reader doesn't have current position, every read says where
+	to read from. So any count of CompoundFile::Stream objects
+	can read through one reader from different threads.
+*/
+class Reader {
+public:
+	virtual ~Reader();
+
+	//! Read \a size bytes at the given offset from the beginning of the file.
+	//! \return Count of read bytes.
+	virtual size_t read( uint64_t offset, char * data, size_t size ) const = 0;
+
+	//! Hint that \a size bytes at the given offset will be read soon.
+	//! Doesn't block, default implementation does nothing.
+	virtual void prefetch( uint64_t offset, size_t size ) const;
+
+	//! Read all requests. Default implementation reads them one by one.
+	//! \return Count of read bytes.
+	virtual size_t read( const std::vector< ReadRequest > & requests ) const;
+}; // class Reader
+
+
+//
+// IStreamReader
+//
+
+//! Reader over std::istream.
+/*!
+	std::istream has only one position, so reads are serialized with
+	the mutex.
+*/
+class IStreamReader
+	:	public Reader
+{
+public:
+	explicit IStreamReader( std::istream & stream );
+
+	//! Read \a size bytes at the given offset from the beginning of the file.
+	//! \return Count of read bytes.
+	size_t read( uint64_t offset, char * data, size_t size ) const override;
+
+	using Reader::read;
+
+private:
+	//! Stream.
+	std::istream & m_stream;
+	//! Guard of the stream's position.
+	mutable std::mutex m_mutex;
+}; // class IStreamReader
+
+
+//
+// FileReader
+//
+
+//! Reader of the file on the disk.
+/*!
+	On POSIX systems reads are done with pread() on the file descriptor
+	and don't need any locking. On other systems reads are serialized on
+	the std::ifstream.
+*/
+class FileReader
+	:	public Reader
+{
+public:
+	explicit FileReader( const std::string & fileName );
+	~FileReader();
+
+	//! \return Is file opened.
+	bool isOpen() const;
+
+	//! Read \a size bytes at the given offset from the beginning of the file.
+	//! \return Count of read bytes.
+	size_t read( uint64_t offset, char * data, size_t size ) const override;
+
+	//! Hint that \a size bytes at the given offset will be read soon.
+	//! Asks the OS to start reading of these bytes in the background.
+	void prefetch( uint64_t offset, size_t size ) const override;
+
+	//! Read all requests at once. With READ_EXCEL_WITH_IO_URING on Linux
+	//! requests are submitted to io_uring, otherwise, or if io_uring is
+	//! not available, they are read with pread() on ReadPool::global().
+	//! \return Count of read bytes.
+	size_t read( const std::vector< ReadRequest > & requests ) const override;
+
+private:
+	//! Read requests on ReadPool::global().
+	size_t readParallel( const std::vector< ReadRequest > & requests ) const;
+
+private:
+#ifdef _WIN32
+	//! File stream.
+	std::ifstream m_file;
+	//! Reader over the file stream.
+	IStreamReader m_reader;
+#else
+	//! File descriptor.
+	int m_fd;
+#endif
+
+#if defined( READ_EXCEL_WITH_IO_URING ) && defined( __linux__ )
+	//! io_uring, created on the first batch.
+	mutable std::unique_ptr< IoUring > m_ring;
+	//! Is io_uring failed, so it's not used anymore.
+	mutable bool m_ringFailed;
+	//! Guard of the io_uring.
+	mutable std::mutex m_ringMutex;
+#endif
+}; // class FileReader
+
+
+//
+// Reader
+//
+
+inline
+Reader::~Reader()
+{
+}
+
+inline void
+Reader::prefetch( uint64_t, size_t ) const
+{
+}
+
+inline size_t
+Reader::read( const std::vector< ReadRequest > & requests ) const
+{
+	size_t bytes = 0;
+
+	for( const auto & r : requests )
+		bytes += read( r.m_offset, r.m_data, r.m_size );
+
+	return bytes;
+}
+
+
+//
+// IStreamReader
+//
+
+inline
+IStreamReader::IStreamReader( std::istream & stream )
+	:	m_stream( stream )
+{
+}
+
+inline size_t
+IStreamReader::read( uint64_t offset, char * data, size_t size ) const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	m_stream.clear();
+	m_stream.seekg( static_cast< std::streamoff > ( offset ), std::ios::beg );
+	m_stream.read( data, static_cast< std::streamsize > ( size ) );
+
+	return static_cast< size_t > ( m_stream.gcount() );
+}
+
+
+//
+// FileReader
+//
+
+#ifdef _WIN32
+
+inline
+FileReader::FileReader( const std::string & fileName )
+	:	m_file( fileName, std::ios::in | std::ios::binary )
+	,	m_reader( m_file )
+{
+}
+
+inline
+FileReader::~FileReader()
+{
+}
+
+inline bool
+FileReader::isOpen() const
+{
+	return m_file.is_open();
+}
+
+inline size_t
+FileReader::read( uint64_t offset, char * data, size_t size ) const
+{
+	return m_reader.read( offset, data, size );
+}
+
+inline void
+FileReader::prefetch( uint64_t, size_t ) const
+{
+}
+
+#else
+
+inline
+FileReader::FileReader( const std::string & fileName )
+	:	m_fd( ::open( fileName.c_str(), O_RDONLY ) )
+#if defined( READ_EXCEL_WITH_IO_URING ) && defined( __linux__ )
+	,	m_ringFailed( false )
+#endif
+{
+}
+
+inline
+FileReader::~FileReader()
+{
+	if( m_fd != -1 )
+		::close( m_fd );
+}
+
+inline bool
+FileReader::isOpen() const
+{
+	return ( m_fd != -1 );
+}
+
+inline size_t
+FileReader::read( uint64_t offset, char * data, size_t size ) const
+{
+	size_t done = 0;
+
+	while( done < size )
+	{
+		const ssize_t bytes = ::pread( m_fd, data + done, size - done,
+			static_cast< off_t > ( offset + done ) );
+
+		if( bytes > 0 )
+			done += static_cast< size_t > ( bytes );
+		else if( bytes == -1 && errno == EINTR )
+			continue;
+		else
+			break;
+	}
+
+	return done;
+}
+
+inline void
+FileReader::prefetch( uint64_t offset, size_t size ) const
+{
+	if( m_fd == -1 )
+		return;
+
+#if defined( POSIX_FADV_WILLNEED )
+	::posix_fadvise( m_fd, static_cast< off_t > ( offset ),
+		static_cast< off_t > ( size ), POSIX_FADV_WILLNEED );
+#elif defined( F_RDADVISE )
+	struct radvisory advice;
+	advice.ra_offset = static_cast< off_t > ( offset );
+	advice.ra_count = static_cast< int > ( size );
+
+	::fcntl( m_fd, F_RDADVISE, &advice );
+#else
+	(void) offset;
+	(void) size;
+#endif
+}
+
+#endif // _WIN32
+
+inline size_t
+FileReader::readParallel( const std::vector< ReadRequest > & requests ) const
+{
+	std::atomic< size_t > bytes( 0 );
+
+	ReadPool::global().run( requests.size(), [&] ( size_t i )
+		{
+			bytes += read( requests[ i ].m_offset, requests[ i ].m_data,
+				requests[ i ].m_size );
+		} );
+
+	return bytes;
+}
+
+inline size_t
+FileReader::read( const std::vector< ReadRequest > & requests ) const
+{
+#ifdef _WIN32
+	return Reader::read( requests );
+#else
+	if( requests.size() < 2 )
+		return Reader::read( requests );
+
+#if defined( READ_EXCEL_WITH_IO_URING ) && defined( __linux__ )
+	{
+		std::unique_lock< std::mutex > lock( m_ringMutex, std::try_to_lock );
+
+		if( lock.owns_lock() && !m_ringFailed )
+		{
+			if( !m_ring )
+				m_ring.reset( new IoUring );
+
+			size_t bytes = 0;
+
+			if( m_ring->read( m_fd, requests, bytes ) )
+				return bytes;
+
+			m_ringFailed = true;
+			m_ring.reset();
+		}
+	}
+#endif
+
+	return readParallel( requests );
+#endif // _WIN32
+}
+
+
+//
+// readChain
+//
+
+//! Read sectors of the chain with one batch, contiguous sectors are read
+//! with one request. Sector with index i in the chain is read to
+//! data + i * sectorSize.
+//! \return Count of read bytes.
+inline size_t
+readChain( const Reader & reader, const std::vector< SecID > & chain,
+	int32_t sectorSize, char * data )
+{
+	return reader.read( chainRequests( chain, 0, chain.size(), sectorSize, data ) );
+} // readChain
+
+} /* namespace CompoundFile */
+
+#endif // COMPOUNDFILE__READER_HPP__INCLUDED
@@ -12,6 +12,9 @@
 
 // C++ include.
 #include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
 
 
 namespace CompoundFile {
@@ -49,6 +52,52 @@ calcFileOffset( const SecID & id, size_t sectorSize )
 }
 
 
+//
+// ReadRequest
+//
+
+//! Request of the positional read.
+struct ReadRequest {
+	//! Offset from the beginning of the file.
+	uint64_t m_offset;
+	//! Destination.
+	char * m_data;
+	//! Count of bytes to read.
+	size_t m_size;
+}; // struct ReadRequest
+
+
+//
+// chainRequests
+//
+
+//! \return Read requests for sectors [first, last) of the chain. Contiguous
+//! sectors are coalesced into one request. Sector with index i in the chain
+//! is read to data + ( i - first ) * sectorSize.
+inline std::vector< ReadRequest >
+chainRequests( const std::vector< SecID > & chain, size_t first, size_t last,
+	int32_t sectorSize, char * data )
+{
+	std::vector< ReadRequest > requests;
+
+	for( size_t i = first; i < last; )
+	{
+		size_t next = i + 1;
+
+		while( next < last && chain[ next ] == chain[ next - 1 ] + 1 )
+			++next;
+
+		requests.push_back( { calcFileOffset( chain[ i ], sectorSize ),
+			( data ? data + ( i - first ) * sectorSize : nullptr ),
+			( next - i ) * sectorSize } );
+
+		i = next;
+	}
+
+	return requests;
+} // chainRequests
+
+
 //
 // loadSATSector
 //
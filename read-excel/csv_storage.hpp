@@ -0,0 +1,381 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__CSV_STORAGE_HPP__INCLUDED
+#define EXCEL__CSV_STORAGE_HPP__INCLUDED
+
+// Excel include.
+#include "storage.hpp"
+#include "exceptions.hpp"
+#include "formula.hpp"
+#include "format.hpp"
+#include "utf8.hpp"
+
+// C++ include.
+#include <vector>
+#include <string>
+#include <memory>
+#include <ostream>
+#include <functional>
+
+
+namespace Excel {
+
+//
+// CsvStorage
+//
+
+//! Storage that writes sheets as CSV while parsing.
+/*!
+	Row is written as soon as the cell of the next row comes, so only SST
+	in UTF-8 and one row are kept in memory whatever the size of the sheet
+	is. Output is UTF-8, fields with delimiter, quote or line breaks are
+	quoted as RFC 4180 says, lines end with "\n". Rows without cells are
+	written as empty lines, trailing empty fields of the row are omitted.
+
+	\a output is asked for the stream of every sheet, sheets it returns
+	nullptr for are skipped.
+
+	\code
+	std::ofstream csv( "first.csv" );
+
+	Excel::CsvStorage storage( [&] ( size_t idx, const Excel::String & ) -> std::ostream*
+		{ return ( idx == 0 ? &csv : nullptr ); } );
+
+	Excel::Parser::loadBook( "data.xls", storage );
+	\endcode
+
+	To write sheets in parallel load globals once with one storage and
+	then give its sharedStrings() to storages of the threads, each of them
+	loads own sheet with Parser::loadWorkSheet() from own stream.
+*/
+class CsvStorage
+	:	public IStorage
+{
+public:
+	//! Shared strings in UTF-8.
+	typedef std::vector< std::string > SharedStrings;
+
+	//! \return Stream for the sheet or nullptr to skip the sheet.
+	typedef std::function< std::ostream* ( size_t sheetIdx, const String & name ) > Output;
+
+	explicit CsvStorage( Output output, char delimiter = ',' );
+
+	//! Storage for sheets only, SST is already loaded by other storage.
+	CsvStorage( Output output, std::shared_ptr< const SharedStrings > sst,
+		char delimiter = ',' );
+
+	//! \return Shared strings.
+	std::shared_ptr< const SharedStrings > sharedStrings() const;
+
+	//! Write field to \a line, quoted if needed.
+	static void appendField( std::string & line, const std::string & field, char delimiter );
+
+protected:
+	StringEncoding stringEncoding() const override;
+	void onSharedString( size_t sstSize, size_t idx, const String & value ) override;
+	void onSharedStringUtf8( size_t sstSize, size_t idx, const std::string & value ) override;
+	void onDateMode( uint16_t mode ) override;
+	void onSheet( size_t idx, const String & name ) override;
+	void onSheetEnd( size_t sheetIdx ) override;
+	void onCellSharedString( size_t sheetIdx, size_t row, size_t column, size_t sstIndex ) override;
+	void onCell( size_t sheetIdx, size_t row, size_t column, const String & value ) override;
+	void onCellUtf8( size_t sheetIdx, size_t row, size_t column, const std::string & value ) override;
+	void onCell( size_t sheetIdx, size_t row, size_t column, double value ) override;
+	void onCell( size_t sheetIdx, const Formula & value ) override;
+	void onHeader( size_t sheetIdx, const String & value ) override;
+	void onFooter( size_t sheetIdx, const String & value ) override;
+	void onHeaderView( size_t sheetIdx, StringView value ) override;
+	void onFooterView( size_t sheetIdx, StringView value ) override;
+
+private:
+	//! \return Field of the cell, empty one, or nullptr if the sheet is skipped.
+	std::string * field( size_t row, size_t column );
+
+	//! Write the row and empty lines before it.
+	void flushRow();
+
+private:
+	//! Output.
+	Output m_output;
+	//! Delimiter.
+	char m_delimiter;
+	//! Shared strings.
+	std::shared_ptr< SharedStrings > m_sst;
+	//! Shared strings loaded by other storage.
+	std::shared_ptr< const SharedStrings > m_sharedSst;
+	//! Stream of the current sheet.
+	std::ostream * m_out;
+	//! Index of the current row.
+	size_t m_row;
+	//! Count of rows written.
+	size_t m_written;
+	//! Fields of the current row, they are reused from row to row.
+	std::vector< std::string > m_fields;
+	//! Count of fields of the current row.
+	size_t m_fieldsCount;
+	//! Line buffer.
+	std::string m_line;
+}; // class CsvStorage
+
+inline
+CsvStorage::CsvStorage( Output output, char delimiter )
+	:	m_output( std::move( output ) )
+	,	m_delimiter( delimiter )
+	,	m_sst( std::make_shared< SharedStrings > () )
+	,	m_sharedSst( m_sst )
+	,	m_out( nullptr )
+	,	m_row( 0 )
+	,	m_written( 0 )
+	,	m_fieldsCount( 0 )
+{
+}
+
+inline
+CsvStorage::CsvStorage( Output output, std::shared_ptr< const SharedStrings > sst,
+	char delimiter )
+	:	m_output( std::move( output ) )
+	,	m_delimiter( delimiter )
+	,	m_sharedSst( std::move( sst ) )
+	,	m_out( nullptr )
+	,	m_row( 0 )
+	,	m_written( 0 )
+	,	m_fieldsCount( 0 )
+{
+	if( !m_sharedSst )
+		throw Exception( L"Shared strings are not given to CsvStorage." );
+}
+
+inline std::shared_ptr< const CsvStorage::SharedStrings >
+CsvStorage::sharedStrings() const
+{
+	return m_sharedSst;
+}
+
+inline void
+CsvStorage::appendField( std::string & line, const std::string & field, char delimiter )
+{
+	bool quote = false;
+
+	for( const char c : field )
+	{
+		if( c == delimiter || c == '"' || c == '\r' || c == '\n' )
+		{
+			quote = true;
+
+			break;
+		}
+	}
+
+	if( !quote )
+	{
+		line += field;
+
+		return;
+	}
+
+	line.push_back( '"' );
+
+	for( const char c : field )
+	{
+		if( c == '"' )
+			line.push_back( '"' );
+
+		line.push_back( c );
+	}
+
+	line.push_back( '"' );
+}
+
+inline std::string *
+CsvStorage::field( size_t row, size_t column )
+{
+	if( !m_out )
+		return nullptr;
+
+	if( row != m_row )
+	{
+		if( row < m_row )
+			throw Exception( L"Cells of the sheet are not ordered by rows." );
+
+		flushRow();
+
+		m_row = row;
+	}
+
+	if( m_fields.size() <= column )
+		m_fields.resize( column + 1 );
+
+	for( ; m_fieldsCount <= column; ++m_fieldsCount )
+		m_fields[ m_fieldsCount ].clear();
+
+	return &m_fields[ column ];
+}
+
+inline void
+CsvStorage::flushRow()
+{
+	if( !m_fieldsCount )
+		return;
+
+	m_line.clear();
+
+	for( ; m_written < m_row; ++m_written )
+		m_line.push_back( '\n' );
+
+	for( size_t i = 0; i < m_fieldsCount; ++i )
+	{
+		if( i )
+			m_line.push_back( m_delimiter );
+
+		appendField( m_line, m_fields[ i ], m_delimiter );
+	}
+
+	m_line.push_back( '\n' );
+	++m_written;
+
+	m_out->write( m_line.data(), static_cast< std::streamsize > ( m_line.size() ) );
+
+	m_fieldsCount = 0;
+}
+
+inline IStorage::StringEncoding
+CsvStorage::stringEncoding() const
+{
+	return StringEncoding::Utf8;
+}
+
+inline void
+CsvStorage::onSharedString( size_t sstSize, size_t idx, const String & value )
+{
+	onSharedStringUtf8( sstSize, idx, Utf8::fromString( value ) );
+}
+
+inline void
+CsvStorage::onSharedStringUtf8( size_t sstSize, size_t idx, const std::string & value )
+{
+	if( !m_sst )
+		return;
+
+	m_sst->resize( sstSize );
+
+	if( idx < sstSize )
+		( *m_sst )[ idx ] = value;
+}
+
+inline void
+CsvStorage::onDateMode( uint16_t )
+{
+}
+
+inline void
+CsvStorage::onSheet( size_t idx, const String & name )
+{
+	m_out = m_output( idx, name );
+	m_row = 0;
+	m_written = 0;
+	m_fieldsCount = 0;
+}
+
+inline void
+CsvStorage::onSheetEnd( size_t )
+{
+	if( m_out )
+	{
+		flushRow();
+		m_out->flush();
+	}
+
+	m_out = nullptr;
+}
+
+inline void
+CsvStorage::onCellSharedString( size_t, size_t row, size_t column, size_t sstIndex )
+{
+	std::string * f = field( row, column );
+
+	if( f && sstIndex < m_sharedSst->size() )
+		*f = ( *m_sharedSst )[ sstIndex ];
+}
+
+inline void
+CsvStorage::onCell( size_t sheetIdx, size_t row, size_t column, const String & value )
+{
+	onCellUtf8( sheetIdx, row, column, Utf8::fromString( value ) );
+}
+
+inline void
+CsvStorage::onCellUtf8( size_t, size_t row, size_t column, const std::string & value )
+{
+	std::string * f = field( row, column );
+
+	if( f )
+		*f = value;
+}
+
+inline void
+CsvStorage::onCell( size_t, size_t row, size_t column, double value )
+{
+	std::string * f = field( row, column );
+
+	if( f )
+		*f = formatNumber( value );
+}
+
+inline void
+CsvStorage::onCell( size_t, const Formula & value )
+{
+	std::string * f = field( value.getRow(), value.getColumn() );
+
+	if( !f )
+		return;
+
+	switch( value.valueType() )
+	{
+		case Formula::DoubleValue :
+			*f = formatNumber( value.getDouble() );
+			break;
+
+		case Formula::BooleanValue :
+			*f = ( value.getBoolean() ? "TRUE" : "FALSE" );
+			break;
+
+		case Formula::ErrorValue :
+			*f = formatError( value.getErrorValue() );
+			break;
+
+		case Formula::StringValue :
+			*f = Utf8::fromString( value.getString() );
+			break;
+
+		default :
+			break;
+	}
+}
+
+inline void
+CsvStorage::onHeader( size_t, const String & )
+{
+}
+
+inline void
+CsvStorage::onFooter( size_t, const String & )
+{
+}
+
+inline void
+CsvStorage::onHeaderView( size_t, StringView )
+{
+}
+
+inline void
+CsvStorage::onFooterView( size_t, StringView )
+{
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__CSV_STORAGE_HPP__INCLUDED
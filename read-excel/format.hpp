@@ -0,0 +1,127 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__FORMAT_HPP__INCLUDED
+#define EXCEL__FORMAT_HPP__INCLUDED
+
+// Excel include.
+#include "formula.hpp"
+
+// C++ include.
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+
+
+namespace Excel {
+
+//
+// formatNumber
+//
+
+//! \return The shortest of 15 or 17 significant digits that is read back
+//! as the same number.
+/*!
+	The same as "%.15g" or "%.17g" of printf. Numbers with up to 6 decimal
+	places and 15 significant digits, what most of the cells are, are
+	printed without printf, what is several times faster.
+*/
+inline std::string
+formatNumber( double value )
+{
+	const double abs = std::fabs( value );
+
+	if( abs >= 1E-4 && abs < 1E15 )
+	{
+		double scale = 1.0;
+
+		for( int decimals = 0; decimals <= 6; ++decimals, scale *= 10.0 )
+		{
+			const double scaled = std::floor( abs * scale + 0.5 );
+
+			if( scaled >= 1E15 )
+				break;
+
+			// Division is correctly rounded, so if it gives the value back
+			// the decimal is read back as the same number.
+			if( scaled / scale != abs )
+				continue;
+
+			char buf[ 32 ];
+			char * end = buf + sizeof( buf );
+			char * p = end;
+			uint64_t n = static_cast< uint64_t > ( scaled );
+
+			for( int i = 0; i < decimals; ++i, n /= 10 )
+				*--p = static_cast< char > ( '0' + n % 10 );
+
+			if( decimals > 0 )
+				*--p = '.';
+
+			do {
+				*--p = static_cast< char > ( '0' + n % 10 );
+				n /= 10;
+			} while( n > 0 );
+
+			if( value < 0.0 )
+				*--p = '-';
+
+			return std::string( p, end );
+		}
+	}
+
+	char buf[ 32 ];
+
+	std::snprintf( buf, sizeof( buf ), "%.15g", value );
+
+	if( std::strtod( buf, nullptr ) != value )
+		std::snprintf( buf, sizeof( buf ), "%.17g", value );
+
+	return buf;
+} // formatNumber
+
+
+//
+// formatError
+//
+
+//! \return Error value as Excel shows it.
+inline std::string
+formatError( Formula::ErrorValues value )
+{
+	switch( value )
+	{
+		case Formula::Null :
+			return "#NULL!";
+
+		case Formula::DivZero :
+			return "#DIV/0!";
+
+		case Formula::Value :
+			return "#VALUE!";
+
+		case Formula::Ref :
+			return "#REF!";
+
+		case Formula::Name :
+			return "#NAME?";
+
+		case Formula::Num :
+			return "#NUM!";
+
+		case Formula::NA :
+			return "#N/A";
+
+		default :
+			return "#ERROR!";
+	}
+} // formatError
+
+} /* namespace Excel */
+
+#endif // EXCEL__FORMAT_HPP__INCLUDED
@@ -10,9 +10,13 @@
 // C++ include.
 #include <string>
 #include <cstdint>
+#include <utility>
+#include <memory>
 
 // Excel include.
 #include "record.hpp"
+#include "string_type.hpp"
+#include "formula_tokens.hpp"
 
 
 namespace Excel {
@@ -22,6 +26,12 @@ namespace Excel {
 //
 
 //! Formula in the Excel document.
+/*!
+	Formula keeps cached value and, if the storage wants them, tokens of
+	the parsed expression. Cells of shared and array formulas refer to
+	one FormulaTokens of the formula and differ only by their offsets
+	from its first cell.
+*/
 class Formula {
 public:
 	Formula();
@@ -63,6 +73,10 @@ public:
 		NA = 0x2A
 	}; // enum ErrorValues
 
+	//! Formula at \a row and \a column with value of \a type, the value
+	//! itself is given with setters.
+	Formula( uint16_t row, uint16_t column, ValueType type );
+
 	//! \return Type of the value.
 	ValueType valueType() const;
 
@@ -76,65 +90,105 @@ public:
 	bool getBoolean() const;
 
 	//! \return String value.
-	const std::wstring & getString() const;
+	const String & getString() const;
+
+	//! Set string value.
+	void setString( const String & str );
 
 	//! Set string value.
-	void setString( const std::wstring & str );
+	void setString( String && str );
+
+	//! Set double value.
+	void setDouble( double value );
+
+	//! Set boolean value.
+	void setBoolean( bool value );
+
+	//! Set error value.
+	void setErrorValue( ErrorValues value );
 
 	//! \return Row index.
-	int16_t getRow() const;
+	uint16_t getRow() const;
 
 	//! \return Column index.
-	int16_t getColumn() const;
+	uint16_t getColumn() const;
+
+	//! \return Tokens, nullptr if they are not kept.
+	const std::shared_ptr< const FormulaTokens > & tokens() const;
+
+	//! Set tokens.
+	void setTokens( std::shared_ptr< const FormulaTokens > tokens );
+
+	//! \return Offset of the row from the first row of the tokens' range.
+	int32_t rowOffset() const;
+
+	//! \return Offset of the column from the first column of the tokens' range.
+	int32_t columnOffset() const;
 
 private:
 	//! Parse record.
 	void parse( Record & record );
 
 private:
-	//! Type of the value.
-	ValueType m_valueType;
+	// Members are ordered and small enums are kept in bytes, so tokens
+	// don't make Formula, and so Cell, bigger.
+
 	//! Double value.
 	double m_doubleValue;
-	//! Error value.
-	ErrorValues m_errorValue;
-	//! Boolean value.
-	bool m_boolValue;
 	//! String value.
-	std::wstring m_stringValue;
+	String m_stringValue;
+	//! Tokens.
+	std::shared_ptr< const FormulaTokens > m_tokens;
 	//! Row index.
-	int16_t m_row;
+	uint16_t m_row;
 	//! Column index.
-	int16_t m_column;
+	uint16_t m_column;
+	//! Type of the value, ValueType.
+	uint8_t m_valueType;
+	//! Error value, ErrorValues.
+	uint8_t m_errorValue;
+	//! Boolean value.
+	bool m_boolValue;
 }; // class Formula
 
 inline
 Formula::Formula()
-	:	m_valueType( UnknownValue )
-	,	m_doubleValue( 0.0 )
-	,	m_errorValue( UnknownError )
-	,	m_boolValue( false )
+	:	m_doubleValue( 0.0 )
 	,	m_row( 0 )
 	,	m_column( 0 )
+	,	m_valueType( UnknownValue )
+	,	m_errorValue( UnknownError )
+	,	m_boolValue( false )
 {
 }
 
 inline
 Formula::Formula( Record & record )
-	:	m_valueType( UnknownValue )
-	,	m_doubleValue( 0.0 )
-	,	m_errorValue( UnknownError )
-	,	m_boolValue( false )
+	:	m_doubleValue( 0.0 )
 	,	m_row( 0 )
 	,	m_column( 0 )
+	,	m_valueType( UnknownValue )
+	,	m_errorValue( UnknownError )
+	,	m_boolValue( false )
 {
 	parse( record );
 }
 
+inline
+Formula::Formula( uint16_t row, uint16_t column, ValueType type )
+	:	m_doubleValue( 0.0 )
+	,	m_row( row )
+	,	m_column( column )
+	,	m_valueType( static_cast< uint8_t > ( type ) )
+	,	m_errorValue( UnknownError )
+	,	m_boolValue( false )
+{
+}
+
 inline Formula::ValueType
 Formula::valueType() const
 {
-	return m_valueType;
+	return static_cast< ValueType > ( m_valueType );
 }
 
 inline const double &
@@ -146,7 +200,7 @@ Formula::getDouble() const
 inline Formula::ErrorValues
 Formula::getErrorValue() const
 {
-	return m_errorValue;
+	return static_cast< ErrorValues > ( m_errorValue );
 }
 
 inline bool
@@ -155,30 +209,80 @@ Formula::getBoolean() const
 	return m_boolValue;
 }
 
-inline const std::wstring &
+inline const String &
 Formula::getString() const
 {
 	return m_stringValue;
 }
 
 inline void
-Formula::setString( const std::wstring & str )
+Formula::setString( const String & str )
 {
 	m_stringValue = str;
 }
 
-inline int16_t
+inline void
+Formula::setString( String && str )
+{
+	m_stringValue = std::move( str );
+}
+
+inline void
+Formula::setDouble( double value )
+{
+	m_doubleValue = value;
+}
+
+inline void
+Formula::setBoolean( bool value )
+{
+	m_boolValue = value;
+}
+
+inline void
+Formula::setErrorValue( ErrorValues value )
+{
+	m_errorValue = static_cast< uint8_t > ( value );
+}
+
+inline uint16_t
 Formula::getRow() const
 {
 	return m_row;
 }
 
-inline int16_t
+inline uint16_t
 Formula::getColumn() const
 {
 	return m_column;
 }
 
+inline const std::shared_ptr< const FormulaTokens > &
+Formula::tokens() const
+{
+	return m_tokens;
+}
+
+inline void
+Formula::setTokens( std::shared_ptr< const FormulaTokens > tokens )
+{
+	m_tokens = std::move( tokens );
+}
+
+inline int32_t
+Formula::rowOffset() const
+{
+	return ( m_tokens ? static_cast< int32_t > ( m_row ) -
+		m_tokens->firstRow() : 0 );
+}
+
+inline int32_t
+Formula::columnOffset() const
+{
+	return ( m_tokens ? static_cast< int32_t > ( m_column ) -
+		m_tokens->firstColumn() : 0 );
+}
+
 inline void
 Formula::parse( Record & record )
 {
@@ -212,7 +316,7 @@ Formula::parse( Record & record )
 			static_cast< unsigned char >
 				( ( doubleAsLongLong.m_long & 0x0000000000FF0000 ) >> 16 );
 
-		m_errorValue = (ErrorValues) error;
+		m_errorValue = error;
 		m_valueType = ErrorValue;
 
 		return;
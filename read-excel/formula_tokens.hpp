@@ -0,0 +1,183 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__FORMULA_TOKENS_HPP__INCLUDED
+#define EXCEL__FORMULA_TOKENS_HPP__INCLUDED
+
+// C++ include.
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Excel {
+
+//
+// FormulaTokens
+//
+
+//! Parsed expression of the formula as it's stored in the file.
+/*!
+	Tokens (rgce) and their additional data (rgcb) are kept as is, in
+	BIFF8 format. Shared and array formulas are stored once for all their
+	cells, tokens of shared formula use relative references (PtgRefN,
+	PtgAreaN) that are resolved with Formula::rowOffset() and
+	Formula::columnOffset() of the cell.
+*/
+class FormulaTokens final {
+public:
+	//! Kind of the formula.
+	enum Kind {
+		//! Formula of one cell.
+		CellFormula,
+		//! Shared formula, SHRFMLA record.
+		SharedFormula,
+		//! Array formula, ARRAY record.
+		ArrayFormula
+	}; // enum Kind
+
+	//! Tokens of \a kind for the range of cells. \a data are tokens
+	//! followed by their additional data, \a tokensSize is size of tokens.
+	FormulaTokens( Kind kind, uint16_t firstRow, uint16_t lastRow,
+		uint16_t firstColumn, uint16_t lastColumn,
+		std::vector< uint8_t > && data, size_t tokensSize );
+
+	//! \return Kind of the formula.
+	Kind kind() const;
+
+	//! \return Tokens.
+	const uint8_t * tokens() const;
+
+	//! \return Size of tokens in bytes.
+	size_t tokensSize() const;
+
+	//! \return Additional data of tokens, e.g. elements of constant arrays.
+	const uint8_t * extra() const;
+
+	//! \return Size of additional data in bytes.
+	size_t extraSize() const;
+
+	//! \return First row of the range, the row of the cell for CellFormula.
+	uint16_t firstRow() const;
+
+	//! \return Last row of the range.
+	uint16_t lastRow() const;
+
+	//! \return First column of the range.
+	uint16_t firstColumn() const;
+
+	//! \return Last column of the range.
+	uint16_t lastColumn() const;
+
+	//! \return Is the cell in the range.
+	bool contains( uint16_t row, uint16_t column ) const;
+
+	//! \return Approximate count of bytes taken.
+	size_t memoryUsage() const;
+
+private:
+	//! Kind.
+	Kind m_kind;
+	//! First row.
+	uint16_t m_firstRow;
+	//! Last row.
+	uint16_t m_lastRow;
+	//! First column.
+	uint16_t m_firstColumn;
+	//! Last column.
+	uint16_t m_lastColumn;
+	//! Tokens and additional data.
+	std::vector< uint8_t > m_data;
+	//! Size of tokens.
+	size_t m_tokensSize;
+}; // class FormulaTokens
+
+
+inline
+FormulaTokens::FormulaTokens( Kind kind, uint16_t firstRow, uint16_t lastRow,
+	uint16_t firstColumn, uint16_t lastColumn,
+	std::vector< uint8_t > && data, size_t tokensSize )
+	:	m_kind( kind )
+	,	m_firstRow( firstRow )
+	,	m_lastRow( lastRow )
+	,	m_firstColumn( firstColumn )
+	,	m_lastColumn( lastColumn )
+	,	m_data( std::move( data ) )
+	,	m_tokensSize( tokensSize < m_data.size() ? tokensSize : m_data.size() )
+{
+}
+
+inline FormulaTokens::Kind
+FormulaTokens::kind() const
+{
+	return m_kind;
+}
+
+inline const uint8_t *
+FormulaTokens::tokens() const
+{
+	return m_data.data();
+}
+
+inline size_t
+FormulaTokens::tokensSize() const
+{
+	return m_tokensSize;
+}
+
+inline const uint8_t *
+FormulaTokens::extra() const
+{
+	return m_data.data() + m_tokensSize;
+}
+
+inline size_t
+FormulaTokens::extraSize() const
+{
+	return m_data.size() - m_tokensSize;
+}
+
+inline uint16_t
+FormulaTokens::firstRow() const
+{
+	return m_firstRow;
+}
+
+inline uint16_t
+FormulaTokens::lastRow() const
+{
+	return m_lastRow;
+}
+
+inline uint16_t
+FormulaTokens::firstColumn() const
+{
+	return m_firstColumn;
+}
+
+inline uint16_t
+FormulaTokens::lastColumn() const
+{
+	return m_lastColumn;
+}
+
+inline bool
+FormulaTokens::contains( uint16_t row, uint16_t column ) const
+{
+	return ( row >= m_firstRow && row <= m_lastRow &&
+		column >= m_firstColumn && column <= m_lastColumn );
+}
+
+inline size_t
+FormulaTokens::memoryUsage() const
+{
+	return sizeof( FormulaTokens ) + m_data.capacity();
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__FORMULA_TOKENS_HPP__INCLUDED
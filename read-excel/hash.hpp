@@ -0,0 +1,149 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__HASH_HPP__INCLUDED
+#define EXCEL__HASH_HPP__INCLUDED
+
+// C++ include.
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Excel {
+
+//
+// ContentHash
+//
+
+//! Incremental 64-bit hash of bytes.
+/*!
+	Four independent lanes of multiply and rotate, so the hash goes at the
+	speed of reading rather than at the latency of multiplication. Bytes
+	are taken by blocks of 32, the tail is padded with zeroes and the
+	length is mixed in at the end, so the value doesn't depend on how the
+	bytes are split between calls of update().
+
+	Not cryptographic, it identifies content, it doesn't resist attacks.
+*/
+class ContentHash final {
+public:
+	ContentHash();
+
+	//! Add \a size bytes.
+	void update( const void * data, size_t size );
+
+	//! \return Hash of all bytes added so far.
+	uint64_t value() const;
+
+	//! \return Count of bytes added so far.
+	uint64_t size() const;
+
+private:
+	//! Mix block of 32 bytes into the lanes.
+	static void mix( uint64_t * lanes, const unsigned char * block );
+
+private:
+	//! Lanes.
+	uint64_t m_lanes[ 4 ];
+	//! Not full block.
+	unsigned char m_block[ 32 ];
+	//! Count of bytes in m_block.
+	size_t m_blockSize;
+	//! Count of bytes.
+	uint64_t m_size;
+}; // class ContentHash
+
+
+inline
+ContentHash::ContentHash()
+	:	m_lanes{ 0x243F6A8885A308D3ull, 0x13198A2E03707344ull,
+			0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull }
+	,	m_blockSize( 0 )
+	,	m_size( 0 )
+{
+}
+
+inline void
+ContentHash::mix( uint64_t * lanes, const unsigned char * block )
+{
+	static const uint64_t c_prime = 0x9E3779B97F4A7C15ull;
+
+	for( size_t lane = 0; lane < 4; ++lane )
+	{
+		uint64_t word;
+		std::memcpy( &word, block + lane * 8, 8 );
+
+		const uint64_t h = ( lanes[ lane ] ^ word ) * c_prime;
+		lanes[ lane ] = ( h << 31 ) | ( h >> 33 );
+	}
+}
+
+inline void
+ContentHash::update( const void * data, size_t size )
+{
+	const unsigned char * bytes = static_cast< const unsigned char* > ( data );
+
+	m_size += size;
+
+	if( m_blockSize )
+	{
+		const size_t count = ( size < 32 - m_blockSize ? size : 32 - m_blockSize );
+
+		std::memcpy( m_block + m_blockSize, bytes, count );
+		m_blockSize += count;
+		bytes += count;
+		size -= count;
+
+		if( m_blockSize < 32 )
+			return;
+
+		mix( m_lanes, m_block );
+		m_blockSize = 0;
+	}
+
+	for( ; size >= 32; size -= 32, bytes += 32 )
+		mix( m_lanes, bytes );
+
+	std::memcpy( m_block, bytes, size );
+	m_blockSize = size;
+}
+
+inline uint64_t
+ContentHash::value() const
+{
+	static const uint64_t c_prime = 0x9E3779B97F4A7C15ull;
+
+	uint64_t lanes[ 4 ] = { m_lanes[ 0 ], m_lanes[ 1 ], m_lanes[ 2 ], m_lanes[ 3 ] };
+
+	if( m_blockSize )
+	{
+		unsigned char block[ 32 ] = {};
+		std::memcpy( block, m_block, m_blockSize );
+
+		mix( lanes, block );
+	}
+
+	uint64_t h = m_size * c_prime;
+
+	for( const auto lane : lanes )
+	{
+		h = ( h ^ lane ) * c_prime;
+		h ^= h >> 29;
+	}
+
+	return h;
+}
+
+inline uint64_t
+ContentHash::size() const
+{
+	return m_size;
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__HASH_HPP__INCLUDED
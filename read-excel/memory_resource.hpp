@@ -0,0 +1,386 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__MEMORY_RESOURCE_HPP__INCLUDED
+#define EXCEL__MEMORY_RESOURCE_HPP__INCLUDED
+
+// C++ include.
+#include <new>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Excel {
+
+//
+// MemoryResource
+//
+
+//! Source of memory for Book's containers.
+/*!
+	The same contract as std::pmr::memory_resource, that is not available
+	in C++14.
+*/
+class MemoryResource {
+public:
+	virtual ~MemoryResource();
+
+	//! \return Memory of \a bytes size aligned to \a alignment.
+	void * allocate( size_t bytes, size_t alignment = alignof( std::max_align_t ) );
+
+	//! Return memory got from allocate() with the same size and alignment.
+	void deallocate( void * p, size_t bytes,
+		size_t alignment = alignof( std::max_align_t ) );
+
+	//! \return Can memory allocated by this resource be deallocated by
+	//! \a other and vice versa.
+	bool isEqual( const MemoryResource & other ) const noexcept;
+
+protected:
+	virtual void * doAllocate( size_t bytes, size_t alignment ) = 0;
+	virtual void doDeallocate( void * p, size_t bytes, size_t alignment ) = 0;
+	virtual bool doIsEqual( const MemoryResource & other ) const noexcept;
+}; // class MemoryResource
+
+
+//
+// NewDeleteResource
+//
+
+//! Memory resource over global operator new and delete.
+class NewDeleteResource final
+	:	public MemoryResource
+{
+protected:
+	void * doAllocate( size_t bytes, size_t alignment ) override;
+	void doDeallocate( void * p, size_t bytes, size_t alignment ) override;
+}; // class NewDeleteResource
+
+
+//! \return Resource used when no resource is given, it's NewDeleteResource.
+MemoryResource * defaultResource() noexcept;
+
+
+//
+// MonotonicArena
+//
+
+//! Memory resource that never frees memory until it's released.
+/*!
+	Memory is cut from the chunks, every next chunk is twice bigger than
+	previous one. deallocate() does nothing, all memory is given back to
+	the upstream resource at once on release() or destruction, so tearing
+	down a book loaded into the arena is cheap.
+
+	Not thread-safe.
+*/
+class MonotonicArena final
+	:	public MemoryResource
+{
+public:
+	explicit MonotonicArena( size_t initialSize = 64 * 1024,
+		MemoryResource * upstream = defaultResource() );
+	~MonotonicArena();
+
+	MonotonicArena( const MonotonicArena & ) = delete;
+	MonotonicArena & operator = ( const MonotonicArena & ) = delete;
+
+	//! Free all memory. Memory got from the arena must not be used anymore.
+	void release();
+
+	//! \return Count of bytes got from the upstream resource.
+	size_t capacity() const;
+
+protected:
+	void * doAllocate( size_t bytes, size_t alignment ) override;
+	void doDeallocate( void * p, size_t bytes, size_t alignment ) override;
+
+private:
+	//! Header of the chunk, placed at the beginning of the chunk.
+	struct Chunk {
+		//! Previous chunk.
+		Chunk * m_prev;
+		//! Size of the chunk with the header.
+		size_t m_size;
+	}; // struct Chunk
+
+	//! Get new chunk able to hold \a bytes with \a alignment.
+	void newChunk( size_t bytes, size_t alignment );
+
+private:
+	//! Upstream resource.
+	MemoryResource * m_upstream;
+	//! Last chunk.
+	Chunk * m_chunk;
+	//! Free memory in the last chunk.
+	char * m_current;
+	//! End of the last chunk.
+	char * m_end;
+	//! Size of the next chunk.
+	size_t m_nextSize;
+	//! Size of the first chunk.
+	size_t m_initialSize;
+	//! Count of bytes got from the upstream resource.
+	size_t m_capacity;
+}; // class MonotonicArena
+
+
+//
+// Allocator
+//
+
+//! Allocator over MemoryResource, like std::pmr::polymorphic_allocator.
+template< typename T >
+class Allocator {
+public:
+	typedef T value_type;
+
+	Allocator( MemoryResource * resource = defaultResource() ) noexcept;
+
+	template< typename U >
+	Allocator( const Allocator< U > & other ) noexcept;
+
+	T * allocate( size_t n );
+	void deallocate( T * p, size_t n );
+
+	//! \return Resource.
+	MemoryResource * resource() const noexcept;
+
+	//! Containers copied with copy constructor use default resource,
+	//! as std::pmr containers do.
+	Allocator select_on_container_copy_construction() const;
+
+private:
+	//! Resource.
+	MemoryResource * m_resource;
+}; // class Allocator
+
+template< typename T, typename U >
+bool operator == ( const Allocator< T > & a, const Allocator< U > & b ) noexcept;
+
+template< typename T, typename U >
+bool operator != ( const Allocator< T > & a, const Allocator< U > & b ) noexcept;
+
+
+//
+// MemoryResource
+//
+
+inline
+MemoryResource::~MemoryResource()
+{
+}
+
+inline void *
+MemoryResource::allocate( size_t bytes, size_t alignment )
+{
+	return doAllocate( bytes, alignment );
+}
+
+inline void
+MemoryResource::deallocate( void * p, size_t bytes, size_t alignment )
+{
+	doDeallocate( p, bytes, alignment );
+}
+
+inline bool
+MemoryResource::isEqual( const MemoryResource & other ) const noexcept
+{
+	return doIsEqual( other );
+}
+
+inline bool
+MemoryResource::doIsEqual( const MemoryResource & other ) const noexcept
+{
+	return ( this == &other );
+}
+
+
+//
+// NewDeleteResource
+//
+
+inline void *
+NewDeleteResource::doAllocate( size_t bytes, size_t alignment )
+{
+	if( alignment > alignof( std::max_align_t ) )
+		throw std::bad_alloc();
+
+	return ::operator new( bytes );
+}
+
+inline void
+NewDeleteResource::doDeallocate( void * p, size_t, size_t )
+{
+	::operator delete( p );
+}
+
+
+inline MemoryResource *
+defaultResource() noexcept
+{
+	static NewDeleteResource resource;
+
+	return &resource;
+}
+
+
+//
+// MonotonicArena
+//
+
+inline
+MonotonicArena::MonotonicArena( size_t initialSize, MemoryResource * upstream )
+	:	m_upstream( upstream )
+	,	m_chunk( nullptr )
+	,	m_current( nullptr )
+	,	m_end( nullptr )
+	,	m_nextSize( std::max( initialSize, sizeof( Chunk ) * 2 ) )
+	,	m_initialSize( m_nextSize )
+	,	m_capacity( 0 )
+{
+}
+
+inline
+MonotonicArena::~MonotonicArena()
+{
+	release();
+}
+
+inline void
+MonotonicArena::release()
+{
+	while( m_chunk )
+	{
+		Chunk * prev = m_chunk->m_prev;
+
+		m_upstream->deallocate( m_chunk, m_chunk->m_size );
+
+		m_chunk = prev;
+	}
+
+	m_current = nullptr;
+	m_end = nullptr;
+	m_nextSize = m_initialSize;
+	m_capacity = 0;
+}
+
+inline size_t
+MonotonicArena::capacity() const
+{
+	return m_capacity;
+}
+
+inline void
+MonotonicArena::newChunk( size_t bytes, size_t alignment )
+{
+	const size_t size = std::max( m_nextSize, sizeof( Chunk ) + bytes + alignment );
+
+	Chunk * chunk = static_cast< Chunk* > ( m_upstream->allocate( size ) );
+	chunk->m_prev = m_chunk;
+	chunk->m_size = size;
+
+	m_chunk = chunk;
+	m_current = reinterpret_cast< char* > ( chunk + 1 );
+	m_end = reinterpret_cast< char* > ( chunk ) + size;
+	m_capacity += size;
+	m_nextSize = size * 2;
+}
+
+inline void *
+MonotonicArena::doAllocate( size_t bytes, size_t alignment )
+{
+	auto aligned = [&] () -> char* {
+		const uintptr_t p = reinterpret_cast< uintptr_t > ( m_current );
+		const uintptr_t a = ( p + alignment - 1 ) & ~( uintptr_t ) ( alignment - 1 );
+
+		return m_current + ( a - p );
+	};
+
+	if( !m_current || aligned() > m_end ||
+		static_cast< size_t > ( m_end - aligned() ) < bytes )
+	{
+		newChunk( bytes, alignment );
+	}
+
+	char * p = aligned();
+	m_current = p + bytes;
+
+	return p;
+}
+
+inline void
+MonotonicArena::doDeallocate( void *, size_t, size_t )
+{
+}
+
+
+//
+// Allocator
+//
+
+template< typename T >
+inline
+Allocator< T >::Allocator( MemoryResource * resource ) noexcept
+	:	m_resource( resource ? resource : defaultResource() )
+{
+}
+
+template< typename T >
+template< typename U >
+inline
+Allocator< T >::Allocator( const Allocator< U > & other ) noexcept
+	:	m_resource( other.resource() )
+{
+}
+
+template< typename T >
+inline T *
+Allocator< T >::allocate( size_t n )
+{
+	return static_cast< T* > ( m_resource->allocate( n * sizeof( T ), alignof( T ) ) );
+}
+
+template< typename T >
+inline void
+Allocator< T >::deallocate( T * p, size_t n )
+{
+	m_resource->deallocate( p, n * sizeof( T ), alignof( T ) );
+}
+
+template< typename T >
+inline MemoryResource *
+Allocator< T >::resource() const noexcept
+{
+	return m_resource;
+}
+
+template< typename T >
+inline Allocator< T >
+Allocator< T >::select_on_container_copy_construction() const
+{
+	return Allocator();
+}
+
+template< typename T, typename U >
+inline bool
+operator == ( const Allocator< T > & a, const Allocator< U > & b ) noexcept
+{
+	return ( a.resource() == b.resource() || a.resource()->isEqual( *b.resource() ) );
+}
+
+template< typename T, typename U >
+inline bool
+operator != ( const Allocator< T > & a, const Allocator< U > & b ) noexcept
+{
+	return !( a == b );
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__MEMORY_RESOURCE_HPP__INCLUDED
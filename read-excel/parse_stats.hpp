@@ -0,0 +1,308 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__PARSE_STATS_HPP__INCLUDED
+#define EXCEL__PARSE_STATS_HPP__INCLUDED
+
+// C++ include.
+#include <chrono>
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Excel {
+
+//
+// ParseStats
+//
+
+//! Statistics of parsing.
+/*!
+	Collected only if READ_EXCEL_WITH_PARSE_STATS is defined, otherwise
+	all hooks in the parser are empty inline functions and ParseStats
+	stays zeroed. Install the collector with ParseStatsScope.
+
+	Times of the globals include time of SST.
+*/
+struct ParseStats {
+	//! \return Is collecting compiled in.
+	static constexpr bool enabled()
+	{
+#ifdef READ_EXCEL_WITH_PARSE_STATS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//! Time of loading of the compound file's header, SAT and directory.
+	std::chrono::nanoseconds m_compoundFileTime = std::chrono::nanoseconds::zero();
+	//! Time of the workbook globals substream.
+	std::chrono::nanoseconds m_globalsTime = std::chrono::nanoseconds::zero();
+	//! Time of SST.
+	std::chrono::nanoseconds m_sstTime = std::chrono::nanoseconds::zero();
+	//! Times of the sheets, indexed as sheets in the book.
+	std::vector< std::chrono::nanoseconds > m_sheetsTime;
+
+	//! Count of the records by code, CONTINUE records are not counted here.
+	std::map< uint16_t, uint64_t > m_records;
+	//! Count of the CONTINUE records merged into preceding records.
+	uint64_t m_continues = 0;
+	//! Bytes read from the file.
+	uint64_t m_bytesRead = 0;
+	//! Sectors read from the file.
+	uint64_t m_sectorsFetched = 0;
+	//! Seeks in the compound file's streams and in the preloaded Workbook.
+	uint64_t m_seeks = 0;
+	//! Count of decoded strings.
+	uint64_t m_strings = 0;
+	//! Total count of characters in the decoded strings.
+	uint64_t m_characters = 0;
+
+	//! \return Count of the records with the given code.
+	uint64_t records( uint16_t code ) const
+	{
+		const auto it = m_records.find( code );
+
+		return ( it != m_records.cend() ? it->second : 0 );
+	}
+
+	//! Add counters of \a other, times are not added.
+	void add( const ParseStats & other )
+	{
+		for( const auto & r : other.m_records )
+			m_records[ r.first ] += r.second;
+
+		m_continues += other.m_continues;
+		m_bytesRead += other.m_bytesRead;
+		m_sectorsFetched += other.m_sectorsFetched;
+		m_seeks += other.m_seeks;
+		m_strings += other.m_strings;
+		m_characters += other.m_characters;
+	}
+}; // struct ParseStats
+
+
+//
+// ParsePhase
+//
+
+//! Phases of parsing timed in ParseStats.
+enum ParsePhase {
+	CompoundFilePhase,
+	GlobalsPhase,
+	SSTPhase,
+	SheetPhase
+}; // enum ParsePhase
+
+
+//
+// NoParseStats
+//
+
+//! Policy of not collecting statistics, everything is no-op.
+struct NoParseStats {
+	//! Timer of the phase.
+	struct Timer {
+		explicit Timer( ParsePhase, size_t = 0 ) {}
+
+		void stop() {}
+	}; // struct Timer
+
+	static void onRecord( uint16_t, uint16_t ) {}
+	static void onSectors( size_t, size_t ) {}
+	static void onSeek() {}
+	static void onString( size_t ) {}
+}; // struct NoParseStats
+
+
+//
+// CollectParseStats
+//
+
+//! Policy of collecting statistics to the ParseStats installed for the
+//! current thread with ParseStatsScope.
+struct CollectParseStats {
+	//! \return Statistics of the current thread.
+	static ParseStats *& current()
+	{
+		static thread_local ParseStats * stats = nullptr;
+
+		return stats;
+	}
+
+	//! Timer of the phase, adds time of its life to the statistics.
+	class Timer {
+	public:
+		explicit Timer( ParsePhase phase, size_t sheetIdx = 0 )
+			:	m_phase( phase )
+			,	m_sheetIdx( sheetIdx )
+			,	m_start( std::chrono::steady_clock::now() )
+			,	m_stopped( false )
+		{
+		}
+
+		~Timer()
+		{
+			stop();
+		}
+
+		//! Add time since the start to the statistics.
+		void stop()
+		{
+			ParseStats * stats = current();
+
+			if( m_stopped || !stats )
+				return;
+
+			m_stopped = true;
+
+			const auto time = std::chrono::duration_cast< std::chrono::nanoseconds > (
+				std::chrono::steady_clock::now() - m_start );
+
+			switch( m_phase )
+			{
+				case CompoundFilePhase :
+					stats->m_compoundFileTime += time;
+					break;
+
+				case GlobalsPhase :
+					stats->m_globalsTime += time;
+					break;
+
+				case SSTPhase :
+					stats->m_sstTime += time;
+					break;
+
+				case SheetPhase :
+					if( stats->m_sheetsTime.size() <= m_sheetIdx )
+						stats->m_sheetsTime.resize( m_sheetIdx + 1,
+							std::chrono::nanoseconds::zero() );
+
+					stats->m_sheetsTime[ m_sheetIdx ] += time;
+					break;
+			}
+		}
+
+		Timer( const Timer & ) = delete;
+		Timer & operator = ( const Timer & ) = delete;
+
+	private:
+		//! Phase.
+		ParsePhase m_phase;
+		//! Index of the sheet.
+		size_t m_sheetIdx;
+		//! Start time.
+		std::chrono::steady_clock::time_point m_start;
+		//! Is time added.
+		bool m_stopped;
+	}; // class Timer
+
+	//! Record with the given code and count of CONTINUE records was read.
+	static void onRecord( uint16_t code, uint16_t continues )
+	{
+		if( ParseStats * stats = current() )
+		{
+			++stats->m_records[ code ];
+			stats->m_continues += continues;
+		}
+	}
+
+	//! Sectors were read from the file.
+	static void onSectors( size_t count, size_t bytes )
+	{
+		if( ParseStats * stats = current() )
+		{
+			stats->m_sectorsFetched += count;
+			stats->m_bytesRead += bytes;
+		}
+	}
+
+	//! Seek in the stream.
+	static void onSeek()
+	{
+		if( ParseStats * stats = current() )
+			++stats->m_seeks;
+	}
+
+	//! String with the given count of characters was decoded.
+	static void onString( size_t characters )
+	{
+		if( ParseStats * stats = current() )
+		{
+			++stats->m_strings;
+			stats->m_characters += characters;
+		}
+	}
+}; // struct CollectParseStats
+
+
+//! Policy used by the parser.
+#ifdef READ_EXCEL_WITH_PARSE_STATS
+typedef CollectParseStats ParseStatsPolicy;
+#else
+typedef NoParseStats ParseStatsPolicy;
+#endif
+
+
+//
+// ParseStatsScope
+//
+
+//! Collect statistics of parsing in the current thread to \a stats
+//! while the scope is alive.
+/*!
+	\code
+	Excel::ParseStats stats;
+
+	{
+		Excel::ParseStatsScope scope( stats );
+
+		Excel::Book book( "file.xls" );
+	}
+	\endcode
+*/
+class ParseStatsScope {
+public:
+	explicit ParseStatsScope( ParseStats & stats );
+	~ParseStatsScope();
+
+	ParseStatsScope( const ParseStatsScope & ) = delete;
+	ParseStatsScope & operator = ( const ParseStatsScope & ) = delete;
+
+private:
+#ifdef READ_EXCEL_WITH_PARSE_STATS
+	//! Previous statistics of the thread.
+	ParseStats * m_prev;
+#endif
+}; // class ParseStatsScope
+
+inline
+ParseStatsScope::ParseStatsScope( ParseStats & stats )
+#ifdef READ_EXCEL_WITH_PARSE_STATS
+	:	m_prev( CollectParseStats::current() )
+#endif
+{
+#ifdef READ_EXCEL_WITH_PARSE_STATS
+	CollectParseStats::current() = &stats;
+#else
+	(void) stats;
+#endif
+}
+
+inline
+ParseStatsScope::~ParseStatsScope()
+{
+#ifdef READ_EXCEL_WITH_PARSE_STATS
+	CollectParseStats::current() = m_prev;
+#endif
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__PARSE_STATS_HPP__INCLUDED
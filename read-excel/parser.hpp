@@ -8,27 +8,136 @@
 
 // C++ include.
 #include <string>
+#include <utility>
+#include <atomic>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <unordered_map>
 
 // Excel include.
 #include "storage.hpp"
 #include "sheet.hpp"
+#include "parse_stats.hpp"
+#include "spsc_ring.hpp"
+#include "pipeline_worker.hpp"
+#include "hash.hpp"
+#include "formula_tokens.hpp"
 
 #include "compoundfile/compoundfile.hpp"
 #include "compoundfile/compoundfile_exceptions.hpp"
 
 namespace Excel {
 
+//
+// ProgressReporter
+//
+
+//! Calls IStorage::onProgress() every IStorage::progressInterval() bytes.
+/*!
+	Positions are taken from the records the parser reads anyway, so
+	with reporting turned off it's one comparison per record.
+*/
+class ProgressReporter final {
+public:
+	ProgressReporter( IStorage & storage, Stream & stream, size_t sheetIdx );
+
+	//! Report if the interval is passed, \a pos is the position in the
+	//! Workbook stream after the record.
+	void update( int32_t pos );
+
+	//! Report that the book is loaded.
+	static void finish( IStorage & storage, Stream & stream, size_t sheetIdx );
+
+private:
+	//! Storage.
+	IStorage & m_storage;
+	//! Progress.
+	Progress m_progress;
+	//! Interval.
+	uint32_t m_interval;
+	//! Position of the next report.
+	int64_t m_next;
+}; // class ProgressReporter
+
+
+//
+// SharedFormulas
+//
+
+//! Shared and array formulas of the sheet being loaded.
+class SharedFormulas final {
+public:
+	//! Add tokens of shared or array formula.
+	void add( std::shared_ptr< const FormulaTokens > tokens );
+
+	//! \return Tokens of shared or array formula with the first cell at
+	//! \a row and \a column, nullptr if there is no such formula.
+	std::shared_ptr< const FormulaTokens > find( uint16_t row, uint16_t column );
+
+private:
+	//! Formulas by their first cells.
+	std::unordered_map< uint32_t, std::shared_ptr< const FormulaTokens > > m_formulas;
+	//! Last found formula, cells of filled formula follow each other.
+	std::shared_ptr< const FormulaTokens > m_last;
+}; // class SharedFormulas
+
+
+//
+// SheetHasher
+//
+
+//! Hashes records of the sheet being loaded for IStorage::onSheetHash().
+/*!
+	Records are hashed as they are parsed, so the sheet is read once.
+	Only records that make cells, header and footer are hashed, so sheets
+	that differ in formatting only have equal hashes. With the hash turned
+	off it's one comparison per record.
+*/
+class SheetHasher final {
+public:
+	explicit SheetHasher( IStorage & storage );
+
+	//! Hash the record, LABELSST with the hash of its string instead of
+	//! the index.
+	void update( const Record & record );
+
+	//! Give the hash to the storage.
+	void finish( size_t sheetIdx );
+
+private:
+	//! Storage.
+	IStorage & m_storage;
+	//! Is the hash wanted.
+	bool m_enabled;
+	//! Hash.
+	ContentHash m_hash;
+}; // class SheetHasher
+
+
 //
 // Parser
 //
 
 //! Parser of XLS file.
+/*!
+	Loading stops early, without error, when IStorage::isCancelled()
+	returns true. Progress is reported to IStorage::onProgress() if
+	IStorage::progressInterval() isn't 0.
+*/
 class Parser final {
 public:
 	//! Load WorkBook from stream.
 	static void loadBook( std::istream & fileStream, IStorage & storage,
 		const std::string & fileName = "<custom-stream>" );
 
+	//! Load WorkBook from file.
+	static void loadBook( const std::string & fileName, IStorage & storage );
+
+	//! Load WorkBook from compound file. If File::preload() is on, the
+	//! whole Workbook stream is read into memory before parsing.
+	static void loadBook( CompoundFile::File & file, IStorage & storage );
+
 	//! Store document date mode.
 	static void handleDateMode( Record & r, IStorage & storage );
 
@@ -41,7 +150,16 @@ public:
 
 	//! Load WorkSheets.
 	static void loadWorkSheets( const std::vector< BoundSheet > & boundSheets,
-		Stream & stream, IStorage& storage );
+		Stream & stream, IStorage& storage, bool pipelined = false );
+
+	//! Load one WorkSheet, IStorage::onSheet() is called before its cells.
+	//! Different sheets can be loaded in parallel with own streams and storages.
+	static void loadWorkSheet( size_t sheetIdx, const BoundSheet & boundSheet,
+		Stream & stream, IStorage & storage, bool pipelined = false );
+
+	//! Load one WorkSheet, pipelined on \a worker if it's not nullptr.
+	static void loadWorkSheet( size_t sheetIdx, const BoundSheet & boundSheet,
+		Stream & stream, IStorage & storage, PipelineWorker * worker );
 
 	//! Parse shared string table.
 	static void parseSST( Record & record, IStorage & storage );
@@ -50,6 +168,29 @@ public:
 	static void loadSheet( size_t sheetIdx, const BoundSheet & boundSheet,
 		Stream & stream, IStorage & storage );
 
+	//! Load WorkSheet in two stages: \a worker reads records with
+	//! joined CONTINUE records from \a stream and gives them to this thread
+	//! through SpscRing, this thread decodes them and calls \a storage.
+	//! So reading of sectors and decoding overlap on two cores.
+	static void loadSheetPipelined( size_t sheetIdx, const BoundSheet & boundSheet,
+		Stream & stream, IStorage & storage, PipelineWorker & worker );
+
+	//! Seek to the BOF of the sheet and check its version.
+	static void seekSheet( const BoundSheet & boundSheet, Stream & stream );
+
+	//! \return Is record with such code handled in the sheet.
+	static bool isSheetRecord( uint16_t code );
+
+	//! Handle record of the sheet, \a nextRecord( is, f ) calls f with the
+	//! record that follows this one if is( code ) of it is true, otherwise
+	//! the record is left for the main loop. All records are given to
+	//! \a hasher.
+	//! \return false on the end of the sheet.
+	template< typename NextRecord >
+	static bool handleSheetRecord( Record & record, size_t sheetIdx,
+		IStorage & storage, SharedFormulas & formulas, SheetHasher & hasher,
+		NextRecord nextRecord );
+
 	//! Handle label SST.
 	static void handleLabelSST( Record & record, size_t sheetIdx, IStorage & storage );
 
@@ -69,31 +210,216 @@ public:
 	static void handleFORMULA( Record & record, Stream & stream, size_t sheetIdx,
 		IStorage & storage );
 
+	//! Handle FORMULA, records that follow it, i.e. SHRFMLA, ARRAY or TABLE
+	//! of the first cell of the range and STRING with the value, are got
+	//! with \a nextRecord, any other record is left as is.
+	template< typename NextRecord >
+	static void handleFORMULA( Record & record, size_t sheetIdx, IStorage & storage,
+		SharedFormulas & formulas, NextRecord nextRecord );
+
+	//! \return Tokens of SHRFMLA or ARRAY record.
+	static std::shared_ptr< const FormulaTokens > parseSharedFormula( Record & record );
+
+	//! \return Is record one of those that follow FORMULA of the first cell
+	//! of shared formula, array formula or table.
+	static bool isFormulaRange( uint16_t code );
+
+	//! \return Is record one of those that may follow FORMULA, i.e. range
+	//! records or STRING.
+	static bool followsFormula( uint16_t code );
+
 	//! Handle HEADER.
 	static void handleHeader( Record & record, size_t sheetIdx, IStorage & storage );
 
 	//! Handle FOOTER.
 	static void handleFooter( Record & record, size_t sheetIdx, IStorage & storage );
+
+	//! Skip records which codes are not accepted by \a interesting without
+	//! reading their data. Stream is left at the first interesting record.
+	template< typename Predicate >
+	static void skipRecords( Stream & stream, Predicate interesting );
+
+	//! \return Code of the record at the current position of the stream,
+	//! XL_UNKNOWN if there is no record. Position is not changed.
+	static uint16_t peekCode( Stream & stream );
+
+	//! \return Buffer of this thread for strings handed to IStorage as views.
+	static String & stringBuffer();
+
+	//! Count of SST strings between checks of IStorage::isCancelled().
+	static const int32_t c_cancellationStep = 4096;
 }; // class Parser
 
+
+//
+// ProgressReporter
+//
+
+inline
+ProgressReporter::ProgressReporter( IStorage & storage, Stream & stream, size_t sheetIdx )
+	:	m_storage( storage )
+	,	m_interval( storage.progressInterval() )
+	,	m_next( std::numeric_limits< int64_t >::max() )
+{
+	if( m_interval )
+	{
+		const int32_t size = stream.size();
+
+		m_progress.m_bytesTotal = static_cast< uint64_t > ( size > 0 ? size : 0 );
+		m_progress.m_sheetIdx = sheetIdx;
+		m_next = ( stream.pos() / m_interval + 1 ) * static_cast< int64_t > ( m_interval );
+	}
+}
+
+inline void
+ProgressReporter::update( int32_t pos )
+{
+	if( pos < m_next )
+		return;
+
+	m_progress.m_bytesRead = static_cast< uint64_t > ( pos );
+	m_next = ( pos / m_interval + 1 ) * static_cast< int64_t > ( m_interval );
+
+	m_storage.onProgress( m_progress );
+}
+
+inline void
+ProgressReporter::finish( IStorage & storage, Stream & stream, size_t sheetIdx )
+{
+	if( !storage.progressInterval() || storage.isCancelled() )
+		return;
+
+	const int32_t size = stream.size();
+
+	Progress progress;
+	progress.m_bytesRead = static_cast< uint64_t > ( size > 0 ? size : stream.pos() );
+	progress.m_bytesTotal = ( size > 0 ? progress.m_bytesRead : 0 );
+	progress.m_sheetIdx = sheetIdx;
+
+	storage.onProgress( progress );
+}
+
+
+//
+// SharedFormulas
+//
+
+inline void
+SharedFormulas::add( std::shared_ptr< const FormulaTokens > tokens )
+{
+	const uint32_t key = ( static_cast< uint32_t > ( tokens->firstRow() ) << 16 ) |
+		tokens->firstColumn();
+
+	m_formulas[ key ] = std::move( tokens );
+	m_last.reset();
+}
+
+inline std::shared_ptr< const FormulaTokens >
+SharedFormulas::find( uint16_t row, uint16_t column )
+{
+	if( m_last && m_last->firstRow() == row && m_last->firstColumn() == column )
+		return m_last;
+
+	const auto it = m_formulas.find( ( static_cast< uint32_t > ( row ) << 16 ) | column );
+
+	if( it == m_formulas.cend() )
+		return nullptr;
+
+	m_last = it->second;
+
+	return m_last;
+}
+
+
+//
+// SheetHasher
+//
+
+inline
+SheetHasher::SheetHasher( IStorage & storage )
+	:	m_storage( storage )
+	,	m_enabled( storage.wantsSheetHash() )
+{
+}
+
+inline void
+SheetHasher::update( const Record & record )
+{
+	if( !m_enabled )
+		return;
+
+	const std::vector< char > & data = record.data();
+	const uint16_t code = record.code();
+	const uint32_t length = static_cast< uint32_t > ( data.size() );
+
+	m_hash.update( &code, sizeof( code ) );
+	m_hash.update( &length, sizeof( length ) );
+
+	// Strings are split differently at CONTINUE borders.
+	if( !record.borders().empty() )
+		m_hash.update( record.borders().data(), record.borders().size() * sizeof( int32_t ) );
+
+	if( code == XL_LABELSST && length >= 10 )
+	{
+		const unsigned char * p = reinterpret_cast< const unsigned char* > ( data.data() );
+		const uint32_t idx = static_cast< uint32_t > ( p[ 6 ] ) |
+			( static_cast< uint32_t > ( p[ 7 ] ) << 8 ) |
+			( static_cast< uint32_t > ( p[ 8 ] ) << 16 ) |
+			( static_cast< uint32_t > ( p[ 9 ] ) << 24 );
+		const uint64_t stringHash = m_storage.sharedStringHash( idx );
+
+		m_hash.update( p, 6 );
+		m_hash.update( &stringHash, sizeof( stringHash ) );
+		m_hash.update( p + 10, length - 10 );
+	}
+	else if( length )
+		m_hash.update( data.data(), length );
+}
+
+inline void
+SheetHasher::finish( size_t sheetIdx )
+{
+	if( !m_enabled )
+		return;
+
+	SheetHash hash;
+	hash.m_hash = m_hash.value();
+	hash.m_size = m_hash.size();
+
+	m_storage.onSheetHash( sheetIdx, hash );
+}
+
+
 inline void
 Parser::loadBook( std::istream & fileStream, IStorage & storage,
 	const std::string & fileName )
 {
-	static_assert( sizeof( double ) == 8,
-		"Unsupported platform: double has to be 8 bytes." );
-
 	try {
+		ParseStatsPolicy::Timer timer( CompoundFilePhase );
+
 		CompoundFile::File file( fileStream, fileName );
-		auto stream = file.stream( 
-			file.hasDirectory( L"Workbook" ) ? file.directory( L"Workbook" ) 
-			                                 : file.directory( L"Book") );
 
-		std::vector< BoundSheet > boundSheets;
+		timer.stop();
 
-		loadGlobals( boundSheets, *stream, storage );
+		loadBook( file, storage );
+	}
+	catch( const CompoundFile::Exception & x )
+	{
+		throw Exception( x.whatAsWString() );
+	}
+}
+
+inline void
+Parser::loadBook( const std::string & fileName, IStorage & storage )
+{
+	try {
+		ParseStatsPolicy::Timer timer( CompoundFilePhase );
+
+		CompoundFile::File file( fileName );
 
-		loadWorkSheets( boundSheets, *stream, storage );
+		timer.stop();
+
+		loadBook( file, storage );
 	}
 	catch( const CompoundFile::Exception & x )
 	{
@@ -101,6 +427,42 @@ Parser::loadBook( std::istream & fileStream, IStorage & storage,
 	}
 }
 
+inline void
+Parser::loadBook( CompoundFile::File & file, IStorage & storage )
+{
+	static_assert( sizeof( double ) == 8,
+		"Unsupported platform: double has to be 8 bytes." );
+
+	const auto dir = file.hasDirectory( L"Workbook" ) ? file.directory( L"Workbook" )
+	                                                  : file.directory( L"Book");
+
+	std::vector< BoundSheet > boundSheets;
+
+	if( file.preload() )
+	{
+		const std::vector< char > data = file.readStreamFully( dir );
+
+		MemoryStream stream( data.data(), static_cast< int32_t > ( data.size() ),
+			file.byteOrder() );
+
+		loadGlobals( boundSheets, stream, storage );
+
+		loadWorkSheets( boundSheets, stream, storage, file.pipelined() );
+
+		ProgressReporter::finish( storage, stream, boundSheets.size() - 1 );
+	}
+	else
+	{
+		auto stream = file.stream( dir );
+
+		loadGlobals( boundSheets, *stream, storage );
+
+		loadWorkSheets( boundSheets, *stream, storage, file.pipelined() );
+
+		ProgressReporter::finish( storage, *stream, boundSheets.size() - 1 );
+	}
+}
+
 inline void
 Parser::handleDateMode( Record & r, IStorage & storage )
 {
@@ -115,10 +477,33 @@ inline void
 Parser::loadGlobals( std::vector< BoundSheet > & boundSheets, 
 	Stream & stream, IStorage & storage )
 {
+	ParseStatsPolicy::Timer timer( GlobalsPhase );
+
 	BOF bof;
+	ProgressReporter progress( storage, stream, Progress::c_globals );
 
 	while( true )
 	{
+		if( storage.isCancelled() )
+			return;
+
+		skipRecords( stream, [] ( uint16_t code )
+			{
+				switch( code )
+				{
+					case XL_BOF :
+					case XL_FILEPASS :
+					case XL_SST :
+					case XL_BOUNDSHEET :
+					case XL_DATEMODE :
+					case XL_EOF :
+						return true;
+
+					default:
+						return false;
+				}
+			} );
+
 		auto before = stream.pos();
 		Record r( stream );
 		auto after = stream.pos();
@@ -126,6 +511,8 @@ Parser::loadGlobals( std::vector< BoundSheet > & boundSheets,
 		if (after == before)
 			throw Exception(L"Stream position did not advance while reading record.");
 
+		progress.update( after );
+
 		switch( r.code() )
 		{
 			case XL_BOF :
@@ -164,7 +551,7 @@ Parser::parseBoundSheet( Record & record, BOF::BiffVersion ver )
 {
 	int32_t pos = 0;
 	int16_t sheetType = 0;
-	std::wstring sheetName;
+	String sheetName;
 
 	record.dataStream().read( pos, 4 );
 
@@ -179,37 +566,89 @@ Parser::parseBoundSheet( Record & record, BOF::BiffVersion ver )
 
 inline void
 Parser::loadWorkSheets( const std::vector< BoundSheet > & boundSheets,
-	Stream & stream, IStorage& storage )
+	Stream & stream, IStorage& storage, bool pipelined )
 {
+	std::unique_ptr< PipelineWorker > worker;
+
+	if( pipelined )
+		worker = std::make_unique< PipelineWorker > ();
+
 	for( size_t i = 0; i < boundSheets.size(); ++i )
 	{
+		if( storage.isCancelled() )
+			return;
+
 		if( boundSheets[i].sheetType() == BoundSheet::WorkSheet )
-		{
-			storage.onSheet( i, boundSheets[i].sheetName() );
-			loadSheet( i, boundSheets[i], stream, storage );
-		}
+			loadWorkSheet( i, boundSheets[i], stream, storage, worker.get() );
+	}
+}
+
+inline void
+Parser::loadWorkSheet( size_t sheetIdx, const BoundSheet & boundSheet,
+	Stream & stream, IStorage & storage, bool pipelined )
+{
+	if( pipelined )
+	{
+		PipelineWorker worker;
+
+		loadWorkSheet( sheetIdx, boundSheet, stream, storage, &worker );
 	}
+	else
+		loadWorkSheet( sheetIdx, boundSheet, stream, storage, nullptr );
+}
+
+inline void
+Parser::loadWorkSheet( size_t sheetIdx, const BoundSheet & boundSheet,
+	Stream & stream, IStorage & storage, PipelineWorker * worker )
+{
+	storage.onSheet( sheetIdx, boundSheet.sheetName() );
+
+	if( worker )
+		loadSheetPipelined( sheetIdx, boundSheet, stream, storage, *worker );
+	else
+		loadSheet( sheetIdx, boundSheet, stream, storage );
 }
 
 inline void
 Parser::parseSST( Record & record, IStorage & storage )
 {
+	ParseStatsPolicy::Timer timer( SSTPhase );
+
 	int32_t totalStrings = 0;
 	int32_t uniqueStrings = 0;
 
 	record.dataStream().read( totalStrings, 4 );
 	record.dataStream().read( uniqueStrings, 4 );
 
-	std::vector< std::wstring > sst( uniqueStrings );
+	if( storage.stringEncoding() == IStorage::StringEncoding::Utf8 )
+	{
+		for( int32_t i = 0; i < uniqueStrings; ++i )
+		{
+			if( i % c_cancellationStep == 0 && storage.isCancelled() )
+				return;
+
+			storage.onSharedStringUtf8( uniqueStrings, i,
+				loadStringUtf8( record.dataStream(), record.borders() ) );
+		}
+	}
+	else
+	{
+		String & buffer = stringBuffer();
+
+		for( int32_t i = 0; i < uniqueStrings; ++i )
+		{
+			if( i % c_cancellationStep == 0 && storage.isCancelled() )
+				return;
+
+			loadString( record.dataStream(), record.borders(), buffer );
 
-	for( int32_t i = 0; i < uniqueStrings; ++i )
-		storage.onSharedString( uniqueStrings, i,
-			loadString( record.dataStream(), record.borders() ) );
+			storage.onSharedStringView( uniqueStrings, i, buffer );
+		}
+	}
 }
 
 inline void
-Parser::loadSheet( size_t sheetIdx, const BoundSheet & boundSheet,
-	Stream & stream, IStorage & storage )
+Parser::seekSheet( const BoundSheet & boundSheet, Stream & stream )
 {
 	stream.seek( boundSheet.BOFPosition(), Stream::FromBeginning );
 	BOF bof;
@@ -222,9 +661,125 @@ Parser::loadSheet( size_t sheetIdx, const BoundSheet & boundSheet,
 
 	if( bof.version() != BOF::BIFF8 )
 		throw Exception( L"Unsupported BIFF version. BIFF8 is supported only." );
+}
+
+inline bool
+Parser::isSheetRecord( uint16_t code )
+{
+	switch( code )
+	{
+		case XL_LABELSST :
+		case XL_LABEL :
+		case XL_RK :
+		case XL_RK2 :
+		case XL_MULRK :
+		case XL_NUMBER :
+		case XL_FORMULA :
+		case XL_HEADER :
+		case XL_FOOTER :
+		case XL_EOF :
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+template< typename NextRecord >
+inline bool
+Parser::handleSheetRecord( Record & record, size_t sheetIdx,
+	IStorage & storage, SharedFormulas & formulas, SheetHasher & hasher,
+	NextRecord nextRecord )
+{
+	hasher.update( record );
+
+	switch( record.code() )
+	{
+		case XL_LABELSST :
+			handleLabelSST( record, sheetIdx, storage );
+			break;
+
+		case XL_LABEL :
+			handleLabel( record, sheetIdx, storage );
+			break;
+
+		case XL_RK :
+		case XL_RK2 :
+			handleRK( record, sheetIdx, storage );
+			break;
+
+		case XL_MULRK :
+			handleMULRK( record, sheetIdx, storage );
+			break;
+
+		case XL_NUMBER :
+			handleNUMBER( record, sheetIdx, storage );
+			break;
+
+		case XL_FORMULA :
+			handleFORMULA( record, sheetIdx, storage, formulas,
+				[&] ( auto is, auto handle )
+				{
+					nextRecord( is, [&] ( Record & next )
+						{
+							hasher.update( next );
+							handle( next );
+						} );
+				} );
+			break;
+
+		case XL_HEADER:
+			handleHeader( record, sheetIdx, storage );
+			break;
+
+		case XL_FOOTER:
+			handleFooter( record, sheetIdx, storage );
+			break;
+
+		case XL_EOF :
+			hasher.finish( sheetIdx );
+			storage.onSheetEnd( sheetIdx );
+			return false;
+
+		case XL_UNKNOWN :
+			throw Exception( L"Wrong format." );
+
+		default:
+			break;
+	}
+
+	return true;
+}
+
+inline void
+Parser::loadSheet( size_t sheetIdx, const BoundSheet & boundSheet,
+	Stream & stream, IStorage & storage )
+{
+	ParseStatsPolicy::Timer timer( SheetPhase, sheetIdx );
+
+	seekSheet( boundSheet, stream );
+
+	ProgressReporter progress( storage, stream, sheetIdx );
+	SharedFormulas formulas;
+	SheetHasher hasher( storage );
+
+	auto nextRecord = [&] ( auto is, auto handle )
+	{
+		if( !is( peekCode( stream ) ) )
+			return;
+
+		Record record( stream );
+
+		handle( record );
+	};
 
 	while( true )
 	{
+		if( storage.isCancelled() )
+			return;
+
+		skipRecords( stream, &Parser::isSheetRecord );
+
 		auto before = stream.pos();
 		Record record( stream );
 		auto after = stream.pos();
@@ -232,58 +787,174 @@ Parser::loadSheet( size_t sheetIdx, const BoundSheet & boundSheet,
 		if (after == before)
 			throw Exception(L"Stream position did not advance while reading record.");
 
-		switch( record.code() )
+		progress.update( after );
+
+		if( !handleSheetRecord( record, sheetIdx, storage, formulas, hasher, nextRecord ) )
+			return;
+	}
+}
+
+inline void
+Parser::loadSheetPipelined( size_t sheetIdx, const BoundSheet & boundSheet,
+	Stream & stream, IStorage & storage, PipelineWorker & worker )
+{
+	ParseStatsPolicy::Timer timer( SheetPhase, sheetIdx );
+
+	seekSheet( boundSheet, stream );
+
+	// Created before the producer, that owns the stream after that.
+	ProgressReporter progress( storage, stream, sheetIdx );
+	SharedFormulas formulas;
+	SheetHasher hasher( storage );
+
+	//! Slot of the ring.
+	struct Slot {
+		//! Record.
+		RecordBuffer m_record;
+		//! Error of reading.
+		std::exception_ptr m_error;
+		//! Position in the stream after the record.
+		int32_t m_pos = 0;
+	}; // struct Slot
+
+	// Enough to not wait on the ring because of a long string or a
+	// sector boundary, and small enough to stay in the cache.
+	static const size_t c_ringSize = 256;
+
+	SpscRing< Slot > ring( c_ringSize );
+	std::atomic< bool > stop( false );
+	std::atomic< bool > finished( false );
+	ParseStats producerStats;
+
+	auto stopped = [&] () { return stop.load( std::memory_order_relaxed ); };
+
+	worker.start( [&] ()
 		{
-			case XL_LABELSST :
-				handleLabelSST( record, sheetIdx, storage );
-				break;
+			ParseStatsScope scope( producerStats );
 
-			case XL_LABEL :
-				handleLabel( record, sheetIdx, storage );
-				break;
+			// Records that follow FORMULA record are read as is as
+			// loadSheet() does, other records are skipped as usual.
+			bool afterFormula = false;
 
-			case XL_RK :
-			case XL_RK2 :
-				handleRK( record, sheetIdx, storage );
-				break;
+			while( !stopped() )
+			{
+				Slot * slot = ring.waitBack( stopped );
 
-			case XL_MULRK :
-				handleMULRK( record, sheetIdx, storage );
-				break;
+				if( !slot )
+					break;
 
-			case XL_NUMBER :
-				handleNUMBER( record, sheetIdx, storage );
-				break;
+				try {
+					if( !afterFormula || !followsFormula( peekCode( stream ) ) )
+						skipRecords( stream, &Parser::isSheetRecord );
 
-			case XL_FORMULA :
-				handleFORMULA( record, stream, sheetIdx, storage );
-				break;
+					const auto before = stream.pos();
 
-			case XL_HEADER:
-				handleHeader( record, sheetIdx, storage );
-				break;
+					Record::read( stream, slot->m_record );
 
-			case XL_FOOTER:
-				handleFooter( record, sheetIdx, storage );
-				break;
+					slot->m_pos = stream.pos();
 
-			case XL_EOF :
-				return;
+					if( slot->m_pos == before )
+						throw Exception( L"Stream position did not advance while reading record." );
+				}
+				catch( ... )
+				{
+					slot->m_error = std::current_exception();
+					ring.push();
 
-			case XL_UNKNOWN :
-				throw Exception( L"Wrong format." );
+					break;
+				}
 
-			default:
+				const uint16_t code = slot->m_record.m_code;
+
+				ring.push();
+
+				if( code == XL_EOF || code == XL_UNKNOWN )
+					break;
+
+				afterFormula = ( code == XL_FORMULA || isFormulaRange( code ) );
+			}
+
+			finished.store( true, std::memory_order_release );
+			ring.wake();
+		} );
+
+	auto front = [&] () -> Slot &
+	{
+		Slot * slot = ring.waitFront( [&] ()
+			{
+				return finished.load( std::memory_order_acquire );
+			} );
+
+		if( !slot )
+			throw Exception( L"Unexpected end of the sheet." );
+
+		if( slot->m_error )
+		{
+			std::exception_ptr error = slot->m_error;
+			slot->m_error = nullptr;
+			ring.pop();
+
+			std::rethrow_exception( error );
+		}
+
+		return *slot;
+	};
+
+	auto nextRecord = [&] ( auto is, auto handle )
+	{
+		Slot & slot = front();
+
+		if( !is( slot.m_record.m_code ) )
+			return;
+
+		Record record( slot.m_record, stream.byteOrder() );
+		ring.pop();
+
+		handle( record );
+	};
+
+	auto join = [&] ()
+	{
+		stop.store( true, std::memory_order_relaxed );
+		ring.wake();
+		worker.wait();
+
+		if( ParseStats::enabled() )
+		{
+			if( ParseStats * stats = CollectParseStats::current() )
+				stats->add( producerStats );
+		}
+	};
+
+	try {
+		while( !storage.isCancelled() )
+		{
+			Slot & slot = front();
+
+			progress.update( slot.m_pos );
+
+			Record record( slot.m_record, stream.byteOrder() );
+			ring.pop();
+
+			if( !handleSheetRecord( record, sheetIdx, storage, formulas, hasher, nextRecord ) )
 				break;
 		}
 	}
+	catch( ... )
+	{
+		join();
+
+		throw;
+	}
+
+	join();
 }
 
 inline void
 Parser::handleLabelSST( Record & record, size_t sheetIdx, IStorage & storage )
 {
-	int16_t row = 0;
-	int16_t column = 0;
+	uint16_t row = 0;
+	uint16_t column = 0;
 	int16_t xfIndex = 0;
 	int32_t sstIndex = 0;
 
@@ -298,15 +969,24 @@ Parser::handleLabelSST( Record & record, size_t sheetIdx, IStorage & storage )
 inline void
 Parser::handleLabel( Record & record, size_t sheetIdx, IStorage & storage )
 {
-	int16_t row = 0;
-	int16_t column = 0;
+	uint16_t row = 0;
+	uint16_t column = 0;
 
 	record.dataStream().read( row, 2 );
 	record.dataStream().read( column, 2 );
 	record.dataStream().seek( 2, Excel::Stream::FromCurrent );
-	const auto data = loadString( record.dataStream(), record.borders(), 2, BOF::BIFF7 );
 
-	storage.onCell( sheetIdx, row, column, data );
+	if( storage.stringEncoding() == IStorage::StringEncoding::Utf8 )
+		storage.onCellUtf8( sheetIdx, row, column,
+			loadStringUtf8( record.dataStream(), record.borders(), 2, BOF::BIFF7 ) );
+	else
+	{
+		String & buffer = stringBuffer();
+
+		loadString( record.dataStream(), record.borders(), buffer, 2, BOF::BIFF7 );
+
+		storage.onCellView( sheetIdx, row, column, buffer );
+	}
 }
 
 //
@@ -340,8 +1020,8 @@ doubleFromRK( uint32_t rk )
 inline void
 Parser::handleRK( Record & record, size_t sheetIdx, IStorage & storage )
 {
-	int16_t row = 0;
-	int16_t column = 0;
+	uint16_t row = 0;
+	uint16_t column = 0;
 	uint32_t rk = 0;
 
 	record.dataStream().read( row, 2 );
@@ -356,9 +1036,9 @@ Parser::handleRK( Record & record, size_t sheetIdx, IStorage & storage )
 inline void
 Parser::handleMULRK( Record & record, size_t sheetIdx, IStorage & storage )
 {
-	int16_t row = 0;
-	int16_t colFirst = 0;
-	int16_t colLast = 0;
+	uint16_t row = 0;
+	uint16_t colFirst = 0;
+	uint16_t colLast = 0;
 
 	record.dataStream().read( row, 2 );
 	record.dataStream().read( colFirst, 2 );
@@ -371,9 +1051,9 @@ Parser::handleMULRK( Record & record, size_t sheetIdx, IStorage & storage )
 
 	record.dataStream().seek( pos, Stream::FromBeginning );
 
-	const int16_t rkCount = colLast - colFirst + 1;
+	const int rkCount = colLast - colFirst + 1;
 
-	for( int16_t i = 0; i < rkCount; ++i )
+	for( int i = 0; i < rkCount; ++i )
 	{
 		uint32_t rk = 0;
 
@@ -388,8 +1068,8 @@ Parser::handleMULRK( Record & record, size_t sheetIdx, IStorage & storage )
 inline void
 Parser::handleNUMBER( Record & record, size_t sheetIdx, IStorage & storage )
 {
-	int16_t row = 0;
-	int16_t column = 0;
+	uint16_t row = 0;
+	uint16_t column = 0;
 
 	record.dataStream().read( row, 2 );
 	record.dataStream().read( column, 2 );
@@ -408,19 +1088,149 @@ Parser::handleNUMBER( Record & record, size_t sheetIdx, IStorage & storage )
 
 inline void
 Parser::handleFORMULA( Record & record, Stream & stream, size_t sheetIdx, IStorage & storage )
+{
+	SharedFormulas formulas;
+
+	handleFORMULA( record, sheetIdx, storage, formulas,
+		[&] ( auto is, auto handle )
+		{
+			if( !is( peekCode( stream ) ) )
+				return;
+
+			Record next( stream );
+
+			handle( next );
+		} );
+}
+
+template< typename NextRecord >
+inline void
+Parser::handleFORMULA( Record & record, size_t sheetIdx, IStorage & storage,
+	SharedFormulas & formulas, NextRecord nextRecord )
 {
 	Formula formula( record );
 
-	if( formula.valueType() == Formula::StringValue )
+	const bool wantsTokens = storage.wantsFormulaTokens();
+	const uint16_t row = formula.getRow();
+	const uint16_t column = formula.getColumn();
+
+	// Flags and chn are followed by size of tokens, tokens and their
+	// additional data. Cells of shared formula, array formula or table
+	// have only PtgExp or PtgTbl with the first cell of the range.
+	uint16_t tokensSize = 0;
+	std::vector< uint8_t > data;
+	uint8_t exp[ 5 ] = {};
+	const uint8_t * tokens = exp;
+	uint32_t available = 0;
+
+	if( record.length() >= 22 )
+	{
+		Stream & stream = record.dataStream();
+
+		stream.seek( 20, Stream::FromBeginning );
+		stream.read( tokensSize, 2 );
+
+		if( wantsTokens )
+		{
+			data.resize( record.length() - 22 );
+			available = static_cast< uint32_t > ( stream.readBytes(
+				reinterpret_cast< char* > ( data.data() ), static_cast< int32_t > ( data.size() ) ) );
+			data.resize( available );
+			tokens = data.data();
+		}
+		else if( tokensSize == 5 )
+			available = static_cast< uint32_t > ( stream.readBytes(
+				reinterpret_cast< char* > ( exp ), 5 ) );
+	}
+
+	if( tokensSize == 5 && available >= 5 && ( tokens[ 0 ] == 0x01 || tokens[ 0 ] == 0x02 ) )
 	{
-		Record stringRecord( stream );
+		const uint16_t firstRow = static_cast< uint16_t > ( tokens[ 1 ] | ( tokens[ 2 ] << 8 ) );
+		const uint16_t firstColumn = static_cast< uint16_t > ( tokens[ 3 ] | ( tokens[ 4 ] << 8 ) );
+
+		if( firstRow == row && firstColumn == column )
+		{
+			// TABLE is taken too, but tables are not kept.
+			nextRecord( &Parser::isFormulaRange, [&] ( Record & next )
+				{
+					if( wantsTokens && next.code() != XL_TABLE )
+						formulas.add( parseSharedFormula( next ) );
+				} );
+		}
+
+		if( wantsTokens )
+		{
+			auto shared = formulas.find( firstRow, firstColumn );
 
-		std::vector< int32_t > borders;
+			if( shared && shared->contains( row, column ) )
+				formula.setTokens( std::move( shared ) );
+		}
+	}
+
+	if( wantsTokens && !formula.tokens() )
+		formula.setTokens( std::make_shared< const FormulaTokens > ( FormulaTokens::CellFormula,
+			row, row, column, column, std::move( data ), tokensSize ) );
+
+	if( formula.valueType() == Formula::StringValue )
+	{
+		nextRecord( [] ( uint16_t code ) { return code == XL_STRING; },
+			[&] ( Record & stringRecord )
+			{
+				std::vector< int32_t > borders;
 
-		formula.setString( loadString( stringRecord.dataStream(), borders ) );
+				formula.setString( loadString( stringRecord.dataStream(), borders ) );
+			} );
 	}
 
-	storage.onCell( sheetIdx, formula );
+	storage.onCell( sheetIdx, std::move( formula ) );
+}
+
+inline std::shared_ptr< const FormulaTokens >
+Parser::parseSharedFormula( Record & record )
+{
+	Stream & stream = record.dataStream();
+
+	// Range of the cells, 6 bytes, is followed by reserved byte and count
+	// of cells in SHRFMLA, or by flags and chn in ARRAY.
+	const bool isShared = ( record.code() == XL_SHRFMLA );
+	const uint32_t header = ( isShared ? 8 : 12 );
+
+	if( record.length() < header + 2 )
+		throw Exception( L"Wrong format." );
+
+	uint16_t firstRow = 0;
+	uint16_t lastRow = 0;
+	uint8_t firstColumn = 0;
+	uint8_t lastColumn = 0;
+	uint16_t tokensSize = 0;
+
+	stream.read( firstRow, 2 );
+	stream.read( lastRow, 2 );
+	stream.read( firstColumn, 1 );
+	stream.read( lastColumn, 1 );
+	stream.seek( static_cast< int32_t > ( header ), Stream::FromBeginning );
+	stream.read( tokensSize, 2 );
+
+	std::vector< uint8_t > data( record.length() - header - 2 );
+
+	data.resize( static_cast< size_t > ( stream.readBytes( reinterpret_cast< char* > ( data.data() ),
+		static_cast< int32_t > ( data.size() ) ) ) );
+
+	return std::make_shared< const FormulaTokens > (
+		isShared ? FormulaTokens::SharedFormula : FormulaTokens::ArrayFormula,
+		firstRow, lastRow, firstColumn, lastColumn, std::move( data ), tokensSize );
+}
+
+inline bool
+Parser::isFormulaRange( uint16_t code )
+{
+	return ( code == XL_SHRFMLA || code == XL_ARRAY || code == XL_TABLE );
+}
+
+inline bool
+Parser::followsFormula( uint16_t code )
+{
+	return ( isFormulaRange( code ) || code == XL_STRING );
 }
 
 inline void
@@ -428,8 +1238,10 @@ Parser::handleHeader( Record & record, size_t sheetIdx, IStorage & storage )
 {
 	if ( record.length() > 0 )
 	{
-		auto header = loadString( record.dataStream(), record.borders() );
-		storage.onHeader( sheetIdx, header );
+		String & buffer = stringBuffer();
+
+		loadString( record.dataStream(), record.borders(), buffer );
+		storage.onHeaderView( sheetIdx, buffer );
 	}
 }
 
@@ -438,9 +1250,69 @@ Parser::handleFooter( Record & record, size_t sheetIdx, IStorage & storage )
 {
 	if ( record.length() > 0 )
 	{
-		auto footer = loadString( record.dataStream(), record.borders() );
-		storage.onFooter( sheetIdx, footer );
+		String & buffer = stringBuffer();
+
+		loadString( record.dataStream(), record.borders(), buffer );
+		storage.onFooterView( sheetIdx, buffer );
+	}
+}
+
+inline String &
+Parser::stringBuffer()
+{
+	static thread_local String buffer;
+
+	return buffer;
+}
+
+template< typename Predicate >
+inline void
+Parser::skipRecords( Stream & stream, Predicate interesting )
+{
+	while( true )
+	{
+		const int32_t pos = stream.pos();
+
+		if( pos < 0 )
+			return;
+
+		const uint16_t code = peekCode( stream );
+
+		if( code == XL_UNKNOWN || code == XL_CONTINUE || interesting( code ) )
+			return;
+
+		RecordInfo info;
+
+		if( !Record::skip( stream, info ) )
+		{
+			stream.seek( pos, Stream::FromBeginning );
+
+			return;
+		}
+	}
+}
+
+inline uint16_t
+Parser::peekCode( Stream & stream )
+{
+	const int32_t pos = stream.pos();
+
+	if( pos < 0 )
+		return XL_UNKNOWN;
+
+	uint16_t code = XL_UNKNOWN;
+
+	try {
+		stream.read( code, 2 );
+	}
+	catch( const Exception & )
+	{
+		code = XL_UNKNOWN;
 	}
+
+	stream.seek( pos, Stream::FromBeginning );
+
+	return code;
 }
 
 } /* namespace Excel */
@@ -0,0 +1,135 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__PIPELINE_WORKER_HPP__INCLUDED
+#define EXCEL__PIPELINE_WORKER_HPP__INCLUDED
+
+// C++ include.
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <utility>
+
+
+namespace Excel {
+
+//
+// PipelineWorker
+//
+
+//! Thread that reads records of sheets for the pipelined parser.
+/*!
+	One worker serves all sheets of the book one by one, so the thread is
+	started once per book and not once per sheet. It sleeps between jobs.
+*/
+class PipelineWorker final {
+public:
+	PipelineWorker();
+	~PipelineWorker();
+
+	PipelineWorker( const PipelineWorker & ) = delete;
+	PipelineWorker & operator = ( const PipelineWorker & ) = delete;
+
+	//! Run \a job on the thread. \a job must not throw. The previous job
+	//! must be waited with wait().
+	void start( std::function< void() > job );
+
+	//! Wait for the job to finish.
+	void wait();
+
+private:
+	//! Loop of the thread.
+	void work();
+
+private:
+	//! Mutex of the state below.
+	std::mutex m_mutex;
+	//! Job is started or done.
+	std::condition_variable m_changed;
+	//! Job to run.
+	std::function< void() > m_job;
+	//! Job is running.
+	bool m_busy;
+	//! Stop the thread.
+	bool m_stop;
+	//! Thread, started after the state above.
+	std::thread m_thread;
+}; // class PipelineWorker
+
+inline
+PipelineWorker::PipelineWorker()
+	:	m_busy( false )
+	,	m_stop( false )
+	,	m_thread( &PipelineWorker::work, this )
+{
+}
+
+inline
+PipelineWorker::~PipelineWorker()
+{
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+
+		m_stop = true;
+	}
+
+	m_changed.notify_all();
+
+	m_thread.join();
+}
+
+inline void
+PipelineWorker::start( std::function< void() > job )
+{
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+
+		m_job = std::move( job );
+		m_busy = true;
+	}
+
+	m_changed.notify_all();
+}
+
+inline void
+PipelineWorker::wait()
+{
+	std::unique_lock< std::mutex > lock( m_mutex );
+
+	m_changed.wait( lock, [this] () { return !m_busy; } );
+}
+
+inline void
+PipelineWorker::work()
+{
+	std::unique_lock< std::mutex > lock( m_mutex );
+
+	while( true )
+	{
+		m_changed.wait( lock, [this] () { return m_stop || m_busy; } );
+
+		if( m_stop )
+			return;
+
+		std::function< void() > job = std::move( m_job );
+		m_job = nullptr;
+
+		lock.unlock();
+
+		job();
+
+		lock.lock();
+
+		m_busy = false;
+
+		m_changed.notify_all();
+	}
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__PIPELINE_WORKER_HPP__INCLUDED
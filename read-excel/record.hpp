@@ -13,7 +13,7 @@
 
 // C++ include.
 #include <vector>
-#include <sstream>
+#include <utility>
 
 
 namespace Excel {
@@ -23,6 +23,16 @@ namespace Excel {
 // RecordSubstream
 //
 
+//! Data of the record.
+/*!
+	Behaves as std::stringstream: reading past the end sets
+	EOF and fail states, failed stream doesn't seek and its position is -1,
+	seek clears EOF state.
+
+	Buffers are taken from the pool of the thread and given back on
+	destruction, so a thread that parses many records or many files
+	doesn't allocate memory for every record.
+*/
 class RecordSubstream
 	:	public Stream
 {
@@ -30,6 +40,10 @@ class RecordSubstream
 
 public:
 	explicit RecordSubstream( Stream::ByteOrder byteOrder );
+	~RecordSubstream();
+
+	RecordSubstream( const RecordSubstream & ) = delete;
+	RecordSubstream & operator = ( const RecordSubstream & ) = delete;
 
 	//! Read one byte from the stream.
 	char getByte() override;
@@ -43,13 +57,27 @@ public:
 	//! \return Position in the stream.
 	int32_t pos() override;
 
+	//! Read \a size bytes from the stream.
+	//! \return Count of read bytes, less than \a size on the end of stream.
+	int32_t readBytes( char * data, int32_t size ) override;
+
 protected:
 	//! Write data to the stream.
 	void write( const char * data, size_t size );
 
 private:
-	//! Stream.
-	std::stringstream m_stream;
+	//! \return Free buffers of this thread.
+	static std::vector< std::vector< char > > & pool();
+
+private:
+	//! Data.
+	std::vector< char > m_data;
+	//! Position in the data.
+	int32_t m_pos;
+	//! EOF state.
+	bool m_eof;
+	//! Fail state.
+	bool m_fail;
 }; // class RecordSubstream
 
 
@@ -78,6 +106,8 @@ enum RecordType {
 	XL_NUMBER = 0x203,
 	XL_NAME = 0x18,
 	XL_ARRAY = 0x221,
+	XL_SHRFMLA = 0x4BC,
+	XL_TABLE = 0x236,
 	XL_STRING = 0x207,
 	XL_FORMULA = 0x06,
 	XL_FORMAT = 0x41E,
@@ -90,6 +120,38 @@ enum RecordType {
 	XL_UNKNOWN = 0xFFFF
 }; // enum RecordType
 
+//
+// RecordInfo
+//
+
+//! Position and size of the record in the stream.
+struct RecordInfo {
+	//! Offset of the record's header in the stream.
+	int32_t m_offset;
+	//! Record's code.
+	uint16_t m_code;
+	//! Record's length with all CONTINUE records, without headers.
+	uint32_t m_length;
+	//! Count of joined CONTINUE records.
+	uint16_t m_continues;
+}; // struct RecordInfo
+
+
+//
+// RecordBuffer
+//
+
+//! Record read into memory with data of CONTINUE records joined.
+struct RecordBuffer {
+	//! Record's code.
+	uint16_t m_code = XL_UNKNOWN;
+	//! Data.
+	std::vector< char > m_data;
+	//! Borders indexes of the continue records.
+	std::vector< int32_t > m_borders;
+}; // struct RecordBuffer
+
+
 //
 // Record
 //
@@ -98,8 +160,21 @@ enum RecordType {
 class Record {
 public:
 	Record( Stream & stream );
+	//! Record with data of \a buffer. Data are swapped, not copied, so
+	//! \a buffer gets empty vectors with capacity to reuse.
+	Record( RecordBuffer & buffer, Stream::ByteOrder byteOrder );
 	~Record();
 
+	//! Read the record at the current position of the stream with all
+	//! CONTINUE records that follow it into \a buffer.
+	static void read( Stream & stream, RecordBuffer & buffer );
+
+	//! Skip the record at the current position of the stream with all
+	//! CONTINUE records that follow it. Only headers are read, data is
+	//! seeked over.
+	//! \return false if there is no whole record header in the stream.
+	static bool skip( Stream & stream, RecordInfo & info );
+
 	//! \return Record's code.
 	uint16_t code() const;
 
@@ -112,9 +187,13 @@ public:
 	//! \return Borders indexes of the continue records.
 	const std::vector< int32_t > & borders() const;
 
+	//! \return Data of the record with data of CONTINUE records.
+	const std::vector< char > & data() const;
+
 private:
 	//! Read record from the stream.
-	void read( Stream & stream );
+	static void read( Stream & stream, uint16_t & code,
+		std::vector< char > & data, std::vector< int32_t > & borders );
 
 private:
 	//! Record's code.
@@ -134,49 +213,121 @@ private:
 inline
 RecordSubstream::RecordSubstream( Stream::ByteOrder byteOrder )
 	:	Stream( byteOrder )
+	,	m_pos( 0 )
+	,	m_eof( false )
+	,	m_fail( false )
 {
+	auto & buffers = pool();
+
+	if( !buffers.empty() )
+	{
+		m_data = std::move( buffers.back() );
+		buffers.pop_back();
+	}
+}
+
+inline
+RecordSubstream::~RecordSubstream()
+{
+	// Huge buffers of SST are not kept.
+	static const size_t c_maxPooledBuffers = 8;
+	static const size_t c_maxPooledCapacity = 1024 * 1024;
+
+	auto & buffers = pool();
+
+	if( buffers.size() < c_maxPooledBuffers && m_data.capacity() <= c_maxPooledCapacity )
+	{
+		m_data.clear();
+		buffers.push_back( std::move( m_data ) );
+	}
+}
+
+inline std::vector< std::vector< char > > &
+RecordSubstream::pool()
+{
+	static thread_local std::vector< std::vector< char > > buffers;
+
+	return buffers;
 }
 
 inline char
 RecordSubstream::getByte()
 {
-	char ch;
-	m_stream.get( ch );
+	if( m_fail )
+		return static_cast< char > ( 0xFFu );
+
+	if( m_pos >= static_cast< int32_t > ( m_data.size() ) )
+	{
+		m_eof = true;
+		m_fail = true;
 
-	return ch;
+		return static_cast< char > ( 0xFFu );
+	}
+
+	return m_data[ m_pos++ ];
 }
 
 inline bool
 RecordSubstream::eof() const
 {
-	return m_stream.eof();
+	return m_eof;
 }
 
 inline void
 RecordSubstream::seek( int32_t pos, SeekType type )
 {
-	std::ios::seekdir dir;
+	m_eof = false;
 
-	if( type == Stream::FromBeginning )
-		dir = std::ios::beg;
-	else if( type == Stream::FromCurrent )
-		dir = std::ios::cur;
-	else
-		dir = std::ios::end;
+	if( m_fail )
+		return;
 
-	m_stream.seekg( pos, dir );
+	int64_t p = pos;
+
+	if( type == Stream::FromCurrent )
+		p += m_pos;
+	else if( type == Stream::FromEnd )
+		p += static_cast< int64_t > ( m_data.size() );
+
+	if( p < 0 || p > static_cast< int64_t > ( m_data.size() ) )
+		m_fail = true;
+	else
+		m_pos = static_cast< int32_t > ( p );
 }
 
 inline int32_t
 RecordSubstream::pos()
 {
-	return static_cast< int32_t > ( m_stream.tellg() );
+	return ( m_fail ? -1 : m_pos );
+}
+
+inline int32_t
+RecordSubstream::readBytes( char * data, int32_t size )
+{
+	if( m_fail )
+		return Stream::readBytes( data, size );
+
+	const int32_t left = static_cast< int32_t > ( m_data.size() ) - m_pos;
+	const int32_t bytes = ( size < left ? size : left );
+
+	if( bytes > 0 )
+	{
+		std::memcpy( data, m_data.data() + m_pos, static_cast< size_t > ( bytes ) );
+		m_pos += bytes;
+	}
+
+	if( bytes < size )
+	{
+		m_eof = true;
+		m_fail = true;
+	}
+
+	return ( bytes > 0 ? bytes : 0 );
 }
 
 inline void
 RecordSubstream::write( const char * data, size_t size )
 {
-	m_stream.write( data, size );
+	m_data.insert( m_data.end(), data, data + size );
 }
 
 
@@ -190,7 +341,20 @@ Record::Record( Stream & stream )
 	,	m_length( 0 )
 	,	m_stream( stream.byteOrder() )
 {
-	read( stream );
+	read( stream, m_code, m_stream.m_data, m_borders );
+
+	m_length = static_cast< uint32_t > ( m_stream.m_data.size() );
+}
+
+inline
+Record::Record( RecordBuffer & buffer, Stream::ByteOrder byteOrder )
+	:	m_code( buffer.m_code )
+	,	m_length( static_cast< uint32_t > ( buffer.m_data.size() ) )
+	,	m_stream( byteOrder )
+{
+	m_stream.m_data.clear();
+	m_stream.m_data.swap( buffer.m_data );
+	m_borders.swap( buffer.m_borders );
 }
 
 inline
@@ -199,28 +363,30 @@ Record::~Record()
 }
 
 inline void
-Record::read( Stream & stream )
+Record::read( Stream & stream, RecordBuffer & buffer )
 {
-	stream.read( m_code, 2 );
-	stream.read( m_length, 2 );
+	buffer.m_borders.clear();
 
-	uint16_t nextRecordCode = 0;
-	uint16_t nextRecordLength = 0;
+	read( stream, buffer.m_code, buffer.m_data, buffer.m_borders );
+}
 
-	std::vector< char > data;
+inline void
+Record::read( Stream & stream, uint16_t & code,
+	std::vector< char > & data, std::vector< int32_t > & borders )
+{
+	uint32_t length = 0;
 
-	if( m_length )
-	{
-		data.reserve( m_length );
+	stream.read( code, 2 );
+	stream.read( length, 2 );
 
-		for( size_t i = 0; i < m_length; ++i )
-		{
-			data.push_back( stream.getByte() );
+	uint16_t nextRecordCode = 0;
+	uint16_t nextRecordLength = 0;
 
-			if( stream.eof() )
-				throw Exception( L"Unexpected end of file." );
-		}
-	}
+	data.resize( length );
+
+	if( length && stream.readBytes( &data[ 0 ],
+		static_cast< int32_t > ( length ) ) != static_cast< int32_t > ( length ) )
+			throw Exception( L"Unexpected end of file." );
 
 	try {
 		stream.read( nextRecordCode, 2 );
@@ -232,24 +398,17 @@ Record::read( Stream & stream )
 
 	while( nextRecordCode == XL_CONTINUE )
 	{
-		m_borders.push_back( m_length );
+		borders.push_back( static_cast< int32_t > ( length ) );
 
 		stream.read( nextRecordLength, 2 );
 
-		data.reserve( data.size() + nextRecordLength );
+		data.resize( data.size() + nextRecordLength );
 
-		if( nextRecordLength )
-		{
-			for( uint16_t i = 0; i < nextRecordLength; ++i )
-			{
-				data.push_back( stream.getByte() );
-
-				if( stream.eof() )
-					throw Exception( L"Unexpected end of file." );
-			}
-		}
+		if( nextRecordLength && stream.readBytes( &data[ length ],
+			nextRecordLength ) != nextRecordLength )
+				throw Exception( L"Unexpected end of file." );
 
-		m_length += nextRecordLength;
+		length += nextRecordLength;
 
 		try {
 			stream.read( nextRecordCode, 2 );
@@ -263,8 +422,71 @@ Record::read( Stream & stream )
 	if( !stream.eof() )
 		stream.seek( -2, Stream::FromCurrent );
 
-	if( data.size() )
-		m_stream.write( &data[ 0 ], data.size() );
+	ParseStatsPolicy::onRecord( code, static_cast< uint16_t > ( borders.size() ) );
+}
+
+inline bool
+Record::skip( Stream & stream, RecordInfo & info )
+{
+	info.m_offset = stream.pos();
+	info.m_code = XL_UNKNOWN;
+	info.m_length = 0;
+	info.m_continues = 0;
+
+	if( info.m_offset < 0 )
+		return false;
+
+	uint16_t length = 0;
+
+	try {
+		stream.read( info.m_code, 2 );
+		stream.read( length, 2 );
+	}
+	catch( const Exception & )
+	{
+		return false;
+	}
+
+	if( stream.pos() != info.m_offset + 4 )
+		return false;
+
+	info.m_length = length;
+
+	int32_t next = info.m_offset + 4 + length;
+
+	while( true )
+	{
+		stream.seek( next, Stream::FromBeginning );
+
+		if( stream.pos() != next )
+			break;
+
+		uint16_t nextRecordCode = 0;
+		uint16_t nextRecordLength = 0;
+
+		try {
+			stream.read( nextRecordCode, 2 );
+			stream.read( nextRecordLength, 2 );
+		}
+		catch( const Exception & )
+		{
+			break;
+		}
+
+		if( nextRecordCode != XL_CONTINUE || stream.pos() != next + 4 )
+			break;
+
+		info.m_length += nextRecordLength;
+		++info.m_continues;
+
+		next += 4 + nextRecordLength;
+	}
+
+	stream.seek( next, Stream::FromBeginning );
+
+	ParseStatsPolicy::onRecord( info.m_code, info.m_continues );
+
+	return true;
 }
 
 inline uint16_t
@@ -291,6 +513,12 @@ Record::borders() const
 	return m_borders;
 }
 
+inline const std::vector< char > &
+Record::data() const
+{
+	return m_stream.m_data;
+}
+
 } /* namespace Excel */
 
 #endif // EXCEL__RECORD_HPP__INCLUDED
@@ -0,0 +1,162 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__RECORD_INDEX_HPP__INCLUDED
+#define EXCEL__RECORD_INDEX_HPP__INCLUDED
+
+// Excel include.
+#include "record.hpp"
+#include "stream.hpp"
+
+// C++ include.
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Excel {
+
+//
+// SubstreamInfo
+//
+
+//! Top level BOF..EOF substream in the Workbook stream.
+struct SubstreamInfo {
+	//! Offset of the BOF record.
+	int32_t m_bofOffset;
+	//! Offset right after the EOF record, or end of the indexed data
+	//! if EOF is missing.
+	int32_t m_endOffset;
+	//! Index of the BOF record in RecordIndex::records().
+	size_t m_firstRecord;
+	//! Index of the EOF record in RecordIndex::records().
+	size_t m_lastRecord;
+}; // struct SubstreamInfo
+
+
+//
+// RecordIndex
+//
+
+//! Index of the records in the Workbook stream.
+/*!
+	Index is built with one pass over the stream reading only 4-byte
+	headers of the records, data of the records is seeked over.
+	CONTINUE records are joined to the preceding record the same way
+	Record does it.
+
+	Nested BOF..EOF (charts embedded into sheets) are kept inside
+	of the outer substream.
+*/
+class RecordIndex {
+public:
+	RecordIndex();
+	explicit RecordIndex( Stream & stream );
+
+	//! Build index from the current position of the stream till the end
+	//! of the stream or the first broken record.
+	void build( Stream & stream );
+
+	//! \return All records.
+	const std::vector< RecordInfo > & records() const;
+
+	//! \return Top level substreams.
+	const std::vector< SubstreamInfo > & substreams() const;
+
+	//! \return Substream that starts at the given offset, nullptr if
+	//! there is no such substream.
+	const SubstreamInfo * substream( int32_t bofOffset ) const;
+
+private:
+	//! Records.
+	std::vector< RecordInfo > m_records;
+	//! Substreams.
+	std::vector< SubstreamInfo > m_substreams;
+}; // class RecordIndex
+
+inline
+RecordIndex::RecordIndex()
+{
+}
+
+inline
+RecordIndex::RecordIndex( Stream & stream )
+{
+	build( stream );
+}
+
+inline void
+RecordIndex::build( Stream & stream )
+{
+	m_records.clear();
+	m_substreams.clear();
+
+	// Depth of nested BOF..EOF.
+	size_t depth = 0;
+	RecordInfo info;
+
+	while( Record::skip( stream, info ) )
+	{
+		if( info.m_code == XL_UNKNOWN )
+			break;
+
+		m_records.push_back( info );
+
+		const bool inside = ( depth > 0 || info.m_code == XL_BOF );
+
+		if( info.m_code == XL_BOF )
+		{
+			if( depth == 0 )
+			{
+				SubstreamInfo sub;
+				sub.m_bofOffset = info.m_offset;
+				sub.m_firstRecord = m_records.size() - 1;
+
+				m_substreams.push_back( sub );
+			}
+
+			++depth;
+		}
+		else if( info.m_code == XL_EOF && depth > 0 )
+			--depth;
+
+		if( inside )
+		{
+			m_substreams.back().m_lastRecord = m_records.size() - 1;
+			m_substreams.back().m_endOffset = info.m_offset + 4 * ( info.m_continues + 1 ) +
+				static_cast< int32_t > ( info.m_length );
+		}
+	}
+}
+
+inline const std::vector< RecordInfo > &
+RecordIndex::records() const
+{
+	return m_records;
+}
+
+inline const std::vector< SubstreamInfo > &
+RecordIndex::substreams() const
+{
+	return m_substreams;
+}
+
+inline const SubstreamInfo *
+RecordIndex::substream( int32_t bofOffset ) const
+{
+	const auto it = std::lower_bound( m_substreams.cbegin(), m_substreams.cend(),
+		bofOffset,
+		[] ( const SubstreamInfo & sub, int32_t offset )
+			{ return sub.m_bofOffset < offset; } );
+
+	return ( it != m_substreams.cend() && it->m_bofOffset == bofOffset ?
+		&*it : nullptr );
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__RECORD_INDEX_HPP__INCLUDED
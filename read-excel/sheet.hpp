@@ -15,10 +15,13 @@
 #include "string.hpp"
 #include "exceptions.hpp"
 #include "storage.hpp"
+#include "memory_resource.hpp"
 
 // C++ include.
 #include <vector>
 #include <string>
+#include <utility>
+#include <limits>
 
 
 namespace Excel {
@@ -43,7 +46,7 @@ public:
 	}; // enum SheetType
 
 	BoundSheet( int32_t pos,
-		SheetType type, const std::wstring & name );
+		SheetType type, const String & name );
 
 	//! \return BOF position.
 	int32_t BOFPosition() const;
@@ -52,7 +55,7 @@ public:
 	SheetType sheetType() const;
 
 	//! \return Sheet's name.
-	const std::wstring & sheetName() const;
+	const String & sheetName() const;
 
 	//! Convert 2-bytes type field to the SheetType.
 	static SheetType convertSheetType( int16_t type );
@@ -63,10 +66,13 @@ private:
 	//! Sheet's type.
 	SheetType m_sheetType;
 	//! Sheet's name.
-	std::wstring m_sheetName;
+	String m_sheetName;
 }; // class BoundSheet
 
 
+class FrozenSheet;
+
+
 //
 // Sheet
 //
@@ -74,7 +80,8 @@ private:
 //! Excel's sheet.
 class Sheet {
 public:
-	explicit Sheet( const std::wstring & name );
+	explicit Sheet( const String & name,
+		MemoryResource * resource = defaultResource() );
 
 	//! \return Cell.
 	const Cell & cell( size_t row, size_t column ) const;
@@ -85,44 +92,130 @@ public:
 	//! \return Column's count.
 	size_t columnsCount() const;
 
-	//! Set cell.
+	//! \return Numbers of the column, one per row. Numeric formulas give
+	//! their values, other cells give \a missing.
+	std::vector< double > columnAsDoubles( size_t column,
+		double missing = std::numeric_limits< double >::quiet_NaN() ) const;
+
+	//! \return Strings of the column, one per row. String formulas give
+	//! their values, other cells give empty string.
+	std::vector< String > columnAsStrings( size_t column ) const;
+
+	//! Set cell. Rvalues are moved into the cell.
 	template< typename Value >
-	void setCell( size_t row, size_t column, Value value );
+	void setCell( size_t row, size_t column, Value && value );
+
+	//! Set Header.
+	void setHeader( const String & header );
 
 	//! Set Header.
-	void setHeader( const std::wstring & header );
+	void setHeader( String && header );
+
+	//! Set Footer.
+	void setFooter( const String & footer );
 
 	//! Set Footer.
-	void setFooter( const std::wstring & footer );
+	void setFooter( String && footer );
 
 	//! \return Name of the sheet.
-	const std::wstring & sheetName() const;
+	const String & sheetName() const;
 
 	//! \return Header of the sheet.
-	const std::wstring & sheetHeader() const;
+	const String & sheetHeader() const;
 
 	//! \return Footer of the sheet.
-	const std::wstring & sheetFooter() const;
+	const String & sheetFooter() const;
+
+	//! \return Approximate count of bytes taken by the sheet.
+	size_t memoryUsage() const;
 
 private:
+	friend class FrozenSheet;
+
 	//! Init cell's table with given cell.
 	void initCell( size_t row, size_t column );
 
 private:
+	//! Row of cells.
+	typedef std::vector< Cell, Allocator< Cell > > Row;
+
+	//! Resource of the rows.
+	MemoryResource * m_resource;
 	//! Cells.
-	std::vector< std::vector< Cell > > m_cells;
+	std::vector< Row, Allocator< Row > > m_cells;
 	//! Dummy cell.
 	Cell m_dummyCell;
 	//! Column's count;
 	size_t m_columnsCount;
 	//! Name of the sheet.
-	std::wstring m_name;
+	String m_name;
 	//! Header of the sheet.
-	std::wstring m_header;
+	String m_header;
 	//! Footer of the sheet.
-	std::wstring m_footer;
+	String m_footer;
 }; // class Sheet
 
+
+//
+// FrozenSheet
+//
+
+//! Immutable sheet for concurrent readers.
+/*!
+	Cells are kept in one contiguous array, row by row, every row has
+	columnsCount() cells. Nothing is changed after construction, there
+	are no lazy computations, so any count of threads can read the sheet
+	at the same time without locks.
+*/
+class FrozenSheet final {
+public:
+	//! Copy cells of \a sheet.
+	explicit FrozenSheet( const Sheet & sheet );
+
+	//! Move cells of \a sheet, it's left empty.
+	explicit FrozenSheet( Sheet && sheet );
+
+	//! \return Cell.
+	const Cell & cell( size_t row, size_t column ) const;
+
+	//! \return Row's count.
+	size_t rowsCount() const;
+
+	//! \return Column's count.
+	size_t columnsCount() const;
+
+	//! \return Name of the sheet.
+	const String & sheetName() const;
+
+	//! \return Header of the sheet.
+	const String & sheetHeader() const;
+
+	//! \return Footer of the sheet.
+	const String & sheetFooter() const;
+
+private:
+	//! Take cells of \a rows, copied or moved by \a take.
+	template< typename Rows, typename Take >
+	void init( Rows & rows, size_t columnsCount, Take take );
+
+private:
+	//! Cells.
+	std::vector< Cell > m_cells;
+	//! Dummy cell.
+	Cell m_dummyCell;
+	//! Row's count.
+	size_t m_rowsCount;
+	//! Column's count.
+	size_t m_columnsCount;
+	//! Name of the sheet.
+	String m_name;
+	//! Header of the sheet.
+	String m_header;
+	//! Footer of the sheet.
+	String m_footer;
+}; // class FrozenSheet
+
+
 //
 // BoundSheet
 //
@@ -141,7 +234,7 @@ enum SheetType {
 
 inline
 BoundSheet::BoundSheet( int32_t pos,
-	SheetType type, const std::wstring & name )
+	SheetType type, const String & name )
 	:	m_BOFPosition( pos )
 	,	m_sheetType( type )
 	,	m_sheetName( name )
@@ -160,7 +253,7 @@ BoundSheet::sheetType() const
 	return m_sheetType;
 }
 
-inline const std::wstring &
+inline const String &
 BoundSheet::sheetName() const
 {
 	return m_sheetName;
@@ -178,45 +271,59 @@ BoundSheet::convertSheetType( int16_t type )
 //
 
 inline
-Sheet::Sheet( const std::wstring & name )
-	:	m_columnsCount( 0 )
+Sheet::Sheet( const String & name, MemoryResource * resource )
+	:	m_resource( resource )
+	,	m_cells( Allocator< Row > ( resource ) )
+	,	m_columnsCount( 0 )
 	,	m_name( name )
 {
 }
 
 template< typename Value >
 inline void
-Sheet::setCell( size_t row, size_t column, Value value )
+Sheet::setCell( size_t row, size_t column, Value && value )
 {
 	initCell( row, column );
-	m_cells[ row ][ column ].setData( value );
+	m_cells[ row ][ column ].setData( std::forward< Value > ( value ) );
 }
 
 inline void
-Sheet::setHeader( const std::wstring & header )
+Sheet::setHeader( const String & header )
 {
 	m_header = header;
 }
 
 inline void
-Sheet::setFooter( const std::wstring & footer )
+Sheet::setHeader( String && header )
+{
+	m_header = std::move( header );
+}
+
+inline void
+Sheet::setFooter( const String & footer )
 {
 	m_footer = footer;
 }
 
-inline const std::wstring &
+inline void
+Sheet::setFooter( String && footer )
+{
+	m_footer = std::move( footer );
+}
+
+inline const String &
 Sheet::sheetName() const
 {
 	return m_name;
 }
 
-inline const std::wstring &
+inline const String &
 Sheet::sheetHeader() const
 {
 	return m_header;
 }
 
-inline const std::wstring &
+inline const String &
 Sheet::sheetFooter() const
 {
 	return m_footer;
@@ -225,8 +332,10 @@ Sheet::sheetFooter() const
 inline void
 Sheet::initCell( size_t row, size_t column )
 {
-	if( m_cells.size() < row + 1 )
-		m_cells.resize( row + 1 );
+	// Rows are not copied from a prototype, as a copy takes the default
+	// resource, see Allocator::select_on_container_copy_construction().
+	while( m_cells.size() < row + 1 )
+		m_cells.emplace_back( Allocator< Cell > ( m_resource ) );
 
 	if( m_cells[ row ].size() < column + 1 )
 	{
@@ -240,11 +349,8 @@ Sheet::initCell( size_t row, size_t column )
 
 		if( all )
 		{
-			for( std::vector< std::vector< Cell > >::iterator it = m_cells.begin(),
-				last = m_cells.end(); it != last; ++it )
-			{
+			for( auto it = m_cells.begin(), last = m_cells.end(); it != last; ++it )
 				it->resize( m_columnsCount );
-			}
 		}
 		else
 			m_cells.back().resize( m_columnsCount );
@@ -254,15 +360,96 @@ Sheet::initCell( size_t row, size_t column )
 inline const Cell &
 Sheet::cell( size_t row, size_t column ) const
 {
-	if( m_cells.size() > 0 )
+	// Rows skipped by initCell() are empty, so the size of the row is checked.
+	if( row < m_cells.size() && column < m_cells[ row ].size() )
+		return m_cells[ row ][ column ];
+
+	return m_dummyCell;
+}
+
+inline std::vector< double >
+Sheet::columnAsDoubles( size_t column, double missing ) const
+{
+	std::vector< double > res( m_cells.size(), missing );
+
+	for( size_t row = 0; row < m_cells.size(); ++row )
 	{
-		if( m_cells.size() - 1 < row || m_cells[ 0 ].size() - 1 < column )
-			return m_dummyCell;
-		else
-			return m_cells[ row ][ column ];
+		if( column >= m_cells[ row ].size() )
+			continue;
+
+		const Cell & cell = m_cells[ row ][ column ];
+
+		if( cell.dataType() == Cell::DataType::Double )
+			res[ row ] = cell.getDouble();
+		else if( cell.dataType() == Cell::DataType::Formula &&
+			cell.getFormula().valueType() == Formula::DoubleValue )
+		{
+			res[ row ] = cell.getFormula().getDouble();
+		}
 	}
 
-	return m_dummyCell;
+	return res;
+}
+
+inline std::vector< String >
+Sheet::columnAsStrings( size_t column ) const
+{
+	std::vector< String > res( m_cells.size() );
+
+	for( size_t row = 0; row < m_cells.size(); ++row )
+	{
+		if( column >= m_cells[ row ].size() )
+			continue;
+
+		const Cell & cell = m_cells[ row ][ column ];
+
+		if( cell.dataType() == Cell::DataType::String )
+			res[ row ] = cell.getString();
+		else if( cell.dataType() == Cell::DataType::Formula &&
+			cell.getFormula().valueType() == Formula::StringValue )
+		{
+			res[ row ] = cell.getFormula().getString();
+		}
+	}
+
+	return res;
+}
+
+inline size_t
+Sheet::memoryUsage() const
+{
+	auto stringBytes = [] ( const String & str ) -> size_t
+	{
+		// Short strings are kept inside String.
+		return ( str.capacity() * sizeof( Char ) >= sizeof( String ) ?
+			( str.capacity() + 1 ) * sizeof( Char ) : 0 );
+	};
+
+	size_t bytes = sizeof( Sheet ) + m_cells.capacity() * sizeof( Row ) +
+		stringBytes( m_name ) + stringBytes( m_header ) + stringBytes( m_footer );
+
+	for( const auto & row : m_cells )
+	{
+		bytes += row.capacity() * sizeof( Cell );
+
+		for( const auto & cell : row )
+		{
+			if( cell.dataType() == Cell::DataType::String )
+				bytes += stringBytes( cell.getString() );
+			else if( cell.dataType() == Cell::DataType::Formula )
+			{
+				const Formula & f = cell.getFormula();
+
+				bytes += stringBytes( f.getString() );
+
+				// Shared tokens are counted at the first cell of the range.
+				if( f.tokens() && f.rowOffset() == 0 && f.columnOffset() == 0 )
+					bytes += f.tokens()->memoryUsage();
+			}
+		}
+	}
+
+	return bytes;
 }
 
 inline size_t
@@ -277,6 +464,96 @@ Sheet::columnsCount() const
 	return m_columnsCount;
 }
 
+
+//
+// FrozenSheet
+//
+
+inline
+FrozenSheet::FrozenSheet( const Sheet & sheet )
+	:	m_rowsCount( 0 )
+	,	m_columnsCount( 0 )
+	,	m_name( sheet.m_name )
+	,	m_header( sheet.m_header )
+	,	m_footer( sheet.m_footer )
+{
+	init( sheet.m_cells, sheet.m_columnsCount,
+		[] ( const Cell & cell ) -> const Cell & { return cell; } );
+}
+
+inline
+FrozenSheet::FrozenSheet( Sheet && sheet )
+	:	m_rowsCount( 0 )
+	,	m_columnsCount( 0 )
+	,	m_name( std::move( sheet.m_name ) )
+	,	m_header( std::move( sheet.m_header ) )
+	,	m_footer( std::move( sheet.m_footer ) )
+{
+	init( sheet.m_cells, sheet.m_columnsCount,
+		[] ( Cell & cell ) -> Cell && { return std::move( cell ); } );
+
+	sheet.m_cells.clear();
+	sheet.m_columnsCount = 0;
+}
+
+template< typename Rows, typename Take >
+inline void
+FrozenSheet::init( Rows & rows, size_t columnsCount, Take take )
+{
+	m_rowsCount = rows.size();
+	m_columnsCount = columnsCount;
+
+	m_cells.reserve( m_rowsCount * m_columnsCount );
+
+	// Rows skipped by Sheet::initCell() are shorter, they are filled with empty cells.
+	for( auto & row : rows )
+	{
+		for( auto & cell : row )
+			m_cells.push_back( take( cell ) );
+
+		m_cells.resize( m_cells.size() + m_columnsCount - row.size() );
+	}
+}
+
+inline const Cell &
+FrozenSheet::cell( size_t row, size_t column ) const
+{
+	if( row < m_rowsCount && column < m_columnsCount )
+		return m_cells[ row * m_columnsCount + column ];
+
+	return m_dummyCell;
+}
+
+inline size_t
+FrozenSheet::rowsCount() const
+{
+	return m_rowsCount;
+}
+
+inline size_t
+FrozenSheet::columnsCount() const
+{
+	return m_columnsCount;
+}
+
+inline const String &
+FrozenSheet::sheetName() const
+{
+	return m_name;
+}
+
+inline const String &
+FrozenSheet::sheetHeader() const
+{
+	return m_header;
+}
+
+inline const String &
+FrozenSheet::sheetFooter() const
+{
+	return m_footer;
+}
+
 } /* namespace Excel */
 
 #endif // EXCEL__SHEET_HPP__INCLUDED
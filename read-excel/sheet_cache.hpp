@@ -0,0 +1,255 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__SHEET_CACHE_HPP__INCLUDED
+#define EXCEL__SHEET_CACHE_HPP__INCLUDED
+
+// Excel include.
+#include "sheet.hpp"
+#include "storage.hpp"
+
+// C++ include.
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace Excel {
+
+//
+// SheetCache
+//
+
+//! Cache of decoded sheets shared between books.
+/*!
+	Book with the cache (Book::setSheetCache()) hashes records of every
+	worksheet while decoding it. If a sheet with the same hash was
+	decoded before, by this or another book, the book drops its copy and
+	takes that Sheet, so equal sheets of many books take memory once.
+	Sheets in the cache are immutable and shared.
+
+	Least recently used sheets are dropped when their memory exceeds the
+	budget, books that hold a dropped sheet keep it alive. Sheet bigger
+	than the budget is not cached.
+
+	Thread-safe.
+*/
+class SheetCache final {
+public:
+	//! Default budget, 256 MB.
+	static const size_t c_defaultBudget = 256 * 1024 * 1024;
+
+	explicit SheetCache( size_t budget = c_defaultBudget );
+
+	SheetCache( const SheetCache & ) = delete;
+	SheetCache & operator = ( const SheetCache & ) = delete;
+
+	//! \return Process-wide cache.
+	static SheetCache & global();
+
+	//! \return Sheet with given hash, or nullptr if there is no such sheet.
+	std::shared_ptr< const Sheet > find( const SheetHash & hash );
+
+	//! Put sheet with given hash to the cache.
+	void insert( const SheetHash & hash, std::shared_ptr< const Sheet > sheet );
+
+	//! Set memory budget, drops sheets that don't fit.
+	void setBudget( size_t bytes );
+
+	//! \return Memory budget.
+	size_t budget() const;
+
+	//! \return Memory taken by cached sheets.
+	size_t memoryUsage() const;
+
+	//! \return Count of cached sheets.
+	size_t size() const;
+
+	//! \return Count of successful find().
+	size_t hits() const;
+
+	//! \return Count of unsuccessful find().
+	size_t misses() const;
+
+	//! Drop all sheets and reset counters.
+	void clear();
+
+private:
+	//! Cached sheet.
+	struct Entry {
+		//! Hash.
+		SheetHash m_hash;
+		//! Sheet.
+		std::shared_ptr< const Sheet > m_sheet;
+		//! Memory taken by the sheet.
+		size_t m_bytes;
+	}; // struct Entry
+
+	//! Hasher of SheetHash.
+	struct Hasher {
+		size_t operator () ( const SheetHash & hash ) const;
+	}; // struct Hasher
+
+	//! Drop least recently used sheets while memory exceeds the budget.
+	void shrink();
+
+private:
+	//! Mutex.
+	mutable std::mutex m_mutex;
+	//! Sheets, most recently used first.
+	std::list< Entry > m_entries;
+	//! Index of the sheets.
+	std::unordered_map< SheetHash, std::list< Entry >::iterator, Hasher > m_index;
+	//! Memory budget.
+	size_t m_budget;
+	//! Memory taken by the sheets.
+	size_t m_memory;
+	//! Count of hits.
+	size_t m_hits;
+	//! Count of misses.
+	size_t m_misses;
+}; // class SheetCache
+
+
+inline
+SheetCache::SheetCache( size_t budget )
+	:	m_budget( budget )
+	,	m_memory( 0 )
+	,	m_hits( 0 )
+	,	m_misses( 0 )
+{
+}
+
+inline SheetCache &
+SheetCache::global()
+{
+	static SheetCache cache;
+
+	return cache;
+}
+
+inline size_t
+SheetCache::Hasher::operator () ( const SheetHash & hash ) const
+{
+	return static_cast< size_t > ( hash.m_hash ^ ( hash.m_size * 0x9E3779B97F4A7C15ull ) );
+}
+
+inline std::shared_ptr< const Sheet >
+SheetCache::find( const SheetHash & hash )
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	auto it = m_index.find( hash );
+
+	if( it == m_index.cend() )
+	{
+		++m_misses;
+
+		return nullptr;
+	}
+
+	++m_hits;
+
+	m_entries.splice( m_entries.begin(), m_entries, it->second );
+
+	return it->second->m_sheet;
+}
+
+inline void
+SheetCache::insert( const SheetHash & hash, std::shared_ptr< const Sheet > sheet )
+{
+	// Memory is counted out of the lock, the sheet is immutable.
+	const size_t bytes = sheet->memoryUsage();
+
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	if( bytes > m_budget || m_index.find( hash ) != m_index.cend() )
+		return;
+
+	m_entries.push_front( Entry{ hash, std::move( sheet ), bytes } );
+	m_index.emplace( hash, m_entries.begin() );
+	m_memory += bytes;
+
+	shrink();
+}
+
+inline void
+SheetCache::shrink()
+{
+	while( m_memory > m_budget && !m_entries.empty() )
+	{
+		m_memory -= m_entries.back().m_bytes;
+		m_index.erase( m_entries.back().m_hash );
+		m_entries.pop_back();
+	}
+}
+
+inline void
+SheetCache::setBudget( size_t bytes )
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	m_budget = bytes;
+
+	shrink();
+}
+
+inline size_t
+SheetCache::budget() const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	return m_budget;
+}
+
+inline size_t
+SheetCache::memoryUsage() const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	return m_memory;
+}
+
+inline size_t
+SheetCache::size() const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	return m_entries.size();
+}
+
+inline size_t
+SheetCache::hits() const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	return m_hits;
+}
+
+inline size_t
+SheetCache::misses() const
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	return m_misses;
+}
+
+inline void
+SheetCache::clear()
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	m_index.clear();
+	m_entries.clear();
+	m_memory = 0;
+	m_hits = 0;
+	m_misses = 0;
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__SHEET_CACHE_HPP__INCLUDED
@@ -0,0 +1,527 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__SNAPSHOT_HPP__INCLUDED
+#define EXCEL__SNAPSHOT_HPP__INCLUDED
+
+// Excel include.
+#include "string_type.hpp"
+#include "exceptions.hpp"
+#include "hash.hpp"
+
+// C++ include.
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// System include.
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+	#define READ_EXCEL_SNAPSHOT_MMAP
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+	#include <process.h>
+#endif
+
+
+namespace Excel {
+
+//
+// SnapshotKey
+//
+
+//! Identity of the source file of the snapshot.
+struct SnapshotKey {
+	//! Size of the file.
+	uint64_t m_size = 0;
+	//! Time of the last modification, in nanoseconds where available.
+	int64_t m_mtime = 0;
+	//! Hash of the content, Snapshot::contentHash().
+	uint64_t m_hash = 0;
+}; // struct SnapshotKey
+
+
+//
+// Snapshot
+//
+
+//! Binary layout of the snapshot of Book.
+/*!
+	Snapshot is one file of 8-byte aligned sections in the byte order of
+	the machine that wrote it, so it can be mapped to memory and read in
+	place:
+
+	- Header;
+	- offsets of the strings, m_stringsCount + 1 of uint64_t, in characters;
+	- characters of all strings, Char each;
+	- SheetEntry per sheet;
+	- CellEntry per not empty cell, sheet by sheet, row by row.
+
+	The first m_sstCount strings are the shared string table, other
+	strings are names, headers, footers, cells and formulas, equal strings
+	are written once. Formulas keep only their values, not tokens.
+	Snapshot written with another version, byte order or Char is not
+	valid and should be recreated from the source file.
+*/
+class Snapshot final {
+public:
+	//! Version of the layout.
+	static const uint32_t c_version = 1;
+	//! Index of absent string.
+	static const uint32_t c_noString = 0xFFFFFFFFu;
+
+	//! Hash of the characters of the string.
+	struct StringHash {
+		size_t operator () ( StringView str ) const;
+	}; // struct StringHash
+
+	//! Header of the snapshot.
+	struct Header {
+		//! "RXLSNAP".
+		char m_magic[ 8 ];
+		//! Version of the layout.
+		uint32_t m_version;
+		//! 0x01020304 in the byte order of the writer.
+		uint32_t m_byteOrder;
+		//! Size of Char.
+		uint32_t m_charSize;
+		//! Book::DateMode.
+		int32_t m_dateMode;
+		//! Source file.
+		SnapshotKey m_source;
+		//! Count of the strings.
+		uint64_t m_stringsCount;
+		//! Count of the strings of SST.
+		uint64_t m_sstCount;
+		//! Count of the sheets.
+		uint64_t m_sheetsCount;
+		//! Offset of the offsets of the strings.
+		uint64_t m_stringsOffset;
+		//! Offset of the characters.
+		uint64_t m_charsOffset;
+		//! Offset of the sheets.
+		uint64_t m_sheetsOffset;
+		//! Offset of the cells.
+		uint64_t m_cellsOffset;
+		//! Size of the snapshot.
+		uint64_t m_size;
+	}; // struct Header
+
+	//! Sheet.
+	struct SheetEntry {
+		//! Index of the name.
+		uint32_t m_name;
+		//! Index of the header.
+		uint32_t m_header;
+		//! Index of the footer.
+		uint32_t m_footer;
+		//! Padding.
+		uint32_t m_reserved;
+		//! Index of the first cell.
+		uint64_t m_firstCell;
+		//! Count of the cells.
+		uint64_t m_cellsCount;
+	}; // struct SheetEntry
+
+	//! Cell.
+	struct CellEntry {
+		//! Row.
+		uint32_t m_row;
+		//! Column.
+		uint16_t m_column;
+		//! Cell::DataType.
+		uint8_t m_type;
+		//! Formula::ValueType of formula.
+		uint8_t m_valueType;
+		//! Index of the string of string cell or string formula.
+		uint32_t m_string;
+		//! Formula::ErrorValues or boolean of formula.
+		uint32_t m_value;
+		//! Number of double cell or numeric formula.
+		double m_double;
+	}; // struct CellEntry
+
+	//! \return Header for the current build.
+	static Header header();
+
+	//! \return Offset aligned to 8 bytes.
+	static uint64_t align( uint64_t offset );
+
+	//! Check that \a data of \a size bytes is a valid snapshot, i.e. header,
+	//! sections and indices are in range.
+	//! \return Header of the snapshot.
+	static const Header & check( const char * data, uint64_t size );
+
+	//! \return Key of the source file stored in the snapshot, or false
+	//! if there is no valid snapshot.
+	static bool readKey( const std::string & fileName, SnapshotKey & key );
+
+	//! \return Size and modification time of the file, and hash of the
+	//! content if \a withHash.
+	static SnapshotKey fileKey( const std::string & fileName, bool withHash = true );
+
+	//! \return Hash of the content of the stream till the end.
+	static uint64_t contentHash( std::istream & stream );
+
+	//! \return Name of the temporary file to write snapshot \a fileName,
+	//! unique for the process, thread and call, so concurrent writers
+	//! don't write to the same file before renaming.
+	static std::string tempName( const std::string & fileName );
+
+private:
+	//! Throw error about broken snapshot.
+	static void broken();
+}; // class Snapshot
+
+static_assert( sizeof( Snapshot::Header ) % 8 == 0 && sizeof( Snapshot::SheetEntry ) == 32 &&
+	sizeof( Snapshot::CellEntry ) == 24, "Layout of the snapshot must not depend on compiler." );
+
+
+//
+// MappedFile
+//
+
+//! Read-only file mapped to memory.
+/*!
+	Where mmap() is not available the file is read into memory.
+*/
+class MappedFile final {
+public:
+	explicit MappedFile( const std::string & fileName );
+	~MappedFile();
+
+	MappedFile( const MappedFile & ) = delete;
+	MappedFile & operator = ( const MappedFile & ) = delete;
+
+	//! \return Data.
+	const char * data() const;
+
+	//! \return Size.
+	uint64_t size() const;
+
+private:
+	//! Data.
+	const char * m_data;
+	//! Size.
+	uint64_t m_size;
+#ifdef READ_EXCEL_SNAPSHOT_MMAP
+	//! Mapping.
+	void * m_map;
+#else
+	//! Content.
+	std::vector< char > m_content;
+#endif
+}; // class MappedFile
+
+
+//
+// Snapshot
+//
+
+inline Snapshot::Header
+Snapshot::header()
+{
+	Header h{};
+	std::memcpy( h.m_magic, "RXLSNAP", 8 );
+	h.m_version = c_version;
+	h.m_byteOrder = 0x01020304u;
+	h.m_charSize = sizeof( Char );
+
+	return h;
+}
+
+inline uint64_t
+Snapshot::align( uint64_t offset )
+{
+	return ( offset + 7 ) & ~static_cast< uint64_t > ( 7 );
+}
+
+inline std::string
+Snapshot::tempName( const std::string & fileName )
+{
+	static std::atomic< uint64_t > counter( 0 );
+
+#ifdef _WIN32
+	const auto pid = _getpid();
+#else
+	const auto pid = ::getpid();
+#endif
+
+	return fileName + "." + std::to_string( pid ) + "." +
+		std::to_string( std::hash< std::thread::id > ()( std::this_thread::get_id() ) ) +
+		"." + std::to_string( counter++ ) + ".tmp";
+}
+
+inline void
+Snapshot::broken()
+{
+	throw Exception( L"Snapshot is broken or was written by another version." );
+}
+
+inline const Snapshot::Header &
+Snapshot::check( const char * data, uint64_t size )
+{
+	if( size < sizeof( Header ) )
+		broken();
+
+	const Header & h = *reinterpret_cast< const Header* > ( data );
+	const Header expected = header();
+
+	if( std::memcmp( h.m_magic, expected.m_magic, sizeof( h.m_magic ) ) != 0 ||
+		h.m_version != expected.m_version || h.m_byteOrder != expected.m_byteOrder ||
+		h.m_charSize != expected.m_charSize || h.m_size != size )
+	{
+		broken();
+	}
+
+	// Sections follow each other, so every section is checked against the next one.
+	if( h.m_stringsCount >= c_noString || h.m_sstCount > h.m_stringsCount ||
+		h.m_stringsOffset != align( sizeof( Header ) ) || h.m_charsOffset < h.m_stringsOffset ||
+		( h.m_charsOffset - h.m_stringsOffset ) / sizeof( uint64_t ) < h.m_stringsCount + 1 ||
+		h.m_charsOffset > h.m_sheetsOffset || h.m_sheetsOffset > h.m_cellsOffset ||
+		h.m_cellsOffset > size || h.m_charsOffset % 8 || h.m_sheetsOffset % 8 ||
+		h.m_cellsOffset % 8 ||
+		( h.m_cellsOffset - h.m_sheetsOffset ) / sizeof( SheetEntry ) < h.m_sheetsCount )
+	{
+		broken();
+	}
+
+	const uint64_t * offsets = reinterpret_cast< const uint64_t* > ( data + h.m_stringsOffset );
+	const uint64_t chars = ( h.m_sheetsOffset - h.m_charsOffset ) / sizeof( Char );
+
+	for( uint64_t i = 0; i < h.m_stringsCount; ++i )
+	{
+		if( offsets[ i ] > offsets[ i + 1 ] )
+			broken();
+	}
+
+	if( offsets[ 0 ] != 0 || offsets[ h.m_stringsCount ] > chars )
+		broken();
+
+	const SheetEntry * sheets = reinterpret_cast< const SheetEntry* > ( data + h.m_sheetsOffset );
+	const uint64_t cells = ( size - h.m_cellsOffset ) / sizeof( CellEntry );
+
+	auto checkString = [&] ( uint32_t idx ) {
+		if( idx != c_noString && idx >= h.m_stringsCount )
+			broken();
+	};
+
+	for( uint64_t i = 0; i < h.m_sheetsCount; ++i )
+	{
+		checkString( sheets[ i ].m_name );
+		checkString( sheets[ i ].m_header );
+		checkString( sheets[ i ].m_footer );
+
+		if( sheets[ i ].m_firstCell > cells ||
+			sheets[ i ].m_cellsCount > cells - sheets[ i ].m_firstCell )
+		{
+			broken();
+		}
+	}
+
+	const CellEntry * entries = reinterpret_cast< const CellEntry* > ( data + h.m_cellsOffset );
+
+	// Cell types are Cell::DataType, value types are Formula::ValueType.
+	for( uint64_t i = 0; i < cells; ++i )
+	{
+		checkString( entries[ i ].m_string );
+
+		if( entries[ i ].m_row > 0xFFFF || entries[ i ].m_type < 1 ||
+			entries[ i ].m_type > 3 || entries[ i ].m_valueType > 5 )
+		{
+			broken();
+		}
+	}
+
+	return h;
+}
+
+inline size_t
+Snapshot::StringHash::operator () ( StringView str ) const
+{
+	uint64_t h = 0xCBF29CE484222325ull;
+
+	for( const auto c : str )
+		h = ( h ^ static_cast< uint64_t > ( c ) ) * 0x100000001B3ull;
+
+	return static_cast< size_t > ( h );
+}
+
+inline bool
+Snapshot::readKey( const std::string & fileName, SnapshotKey & key )
+{
+	std::ifstream stream( fileName, std::ios::in | std::ios::binary );
+
+	Header h;
+
+	if( !stream.read( reinterpret_cast< char* > ( &h ), sizeof( h ) ) )
+		return false;
+
+	const Header expected = header();
+
+	if( std::memcmp( h.m_magic, expected.m_magic, sizeof( h.m_magic ) ) != 0 ||
+		h.m_version != expected.m_version || h.m_byteOrder != expected.m_byteOrder ||
+		h.m_charSize != expected.m_charSize )
+	{
+		return false;
+	}
+
+	key = h.m_source;
+
+	return true;
+}
+
+inline SnapshotKey
+Snapshot::fileKey( const std::string & fileName, bool withHash )
+{
+	SnapshotKey key;
+
+	struct stat st;
+
+	if( ::stat( fileName.c_str(), &st ) != 0 )
+		throw Exception( L"Unable to get size and time of the file." );
+
+	key.m_size = static_cast< uint64_t > ( st.st_size );
+
+#if defined( __linux__ )
+	key.m_mtime = static_cast< int64_t > ( st.st_mtim.tv_sec ) * 1000000000 +
+		st.st_mtim.tv_nsec;
+#else
+	key.m_mtime = static_cast< int64_t > ( st.st_mtime ) * 1000000000;
+#endif
+
+	if( withHash )
+	{
+		std::ifstream stream( fileName, std::ios::in | std::ios::binary );
+
+		if( !stream )
+			throw Exception( L"Unable to open file." );
+
+		key.m_hash = contentHash( stream );
+	}
+
+	return key;
+}
+
+inline uint64_t
+Snapshot::contentHash( std::istream & stream )
+{
+	ContentHash hash;
+	std::vector< char > buffer( 64 * 1024 );
+
+	while( stream )
+	{
+		stream.read( buffer.data(), static_cast< std::streamsize > ( buffer.size() ) );
+
+		const size_t count = static_cast< size_t > ( stream.gcount() );
+
+		if( !count )
+			break;
+
+		hash.update( buffer.data(), count );
+	}
+
+	return hash.value();
+}
+
+
+//
+// MappedFile
+//
+
+inline
+MappedFile::MappedFile( const std::string & fileName )
+	:	m_data( nullptr )
+	,	m_size( 0 )
+#ifdef READ_EXCEL_SNAPSHOT_MMAP
+	,	m_map( nullptr )
+#endif
+{
+#ifdef READ_EXCEL_SNAPSHOT_MMAP
+	const int fd = ::open( fileName.c_str(), O_RDONLY );
+
+	if( fd < 0 )
+		throw Exception( L"Unable to open file." );
+
+	struct stat st;
+
+	if( ::fstat( fd, &st ) != 0 )
+	{
+		::close( fd );
+
+		throw Exception( L"Unable to get size of the file." );
+	}
+
+	m_size = static_cast< uint64_t > ( st.st_size );
+
+	if( m_size )
+	{
+		void * map = ::mmap( nullptr, static_cast< size_t > ( m_size ), PROT_READ,
+			MAP_PRIVATE, fd, 0 );
+
+		if( map == MAP_FAILED )
+		{
+			::close( fd );
+
+			throw Exception( L"Unable to map file to memory." );
+		}
+
+		m_map = map;
+		m_data = static_cast< const char* > ( map );
+	}
+
+	::close( fd );
+#else
+	std::ifstream stream( fileName, std::ios::in | std::ios::binary | std::ios::ate );
+
+	if( !stream )
+		throw Exception( L"Unable to open file." );
+
+	m_content.resize( static_cast< size_t > ( stream.tellg() ) );
+	stream.seekg( 0 );
+	stream.read( m_content.data(), static_cast< std::streamsize > ( m_content.size() ) );
+
+	m_data = m_content.data();
+	m_size = m_content.size();
+#endif
+}
+
+inline
+MappedFile::~MappedFile()
+{
+#ifdef READ_EXCEL_SNAPSHOT_MMAP
+	if( m_map )
+		::munmap( m_map, static_cast< size_t > ( m_size ) );
+#endif
+}
+
+inline const char *
+MappedFile::data() const
+{
+	return m_data;
+}
+
+inline uint64_t
+MappedFile::size() const
+{
+	return m_size;
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__SNAPSHOT_HPP__INCLUDED
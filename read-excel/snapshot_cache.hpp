@@ -0,0 +1,171 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__SNAPSHOT_CACHE_HPP__INCLUDED
+#define EXCEL__SNAPSHOT_CACHE_HPP__INCLUDED
+
+// Excel include.
+#include "book.hpp"
+#include "snapshot.hpp"
+
+// C++ include.
+#include <string>
+#include <functional>
+#include <cstdio>
+
+
+namespace Excel {
+
+//
+// SnapshotCache
+//
+
+//! Directory of snapshots of parsed workbooks.
+/*!
+	Snapshot of the file is reused when the file has the same size and
+	modification time as when the snapshot was written, without reading
+	the file at all. If only the time differs the content is hashed and
+	compared with the hash kept in the snapshot, so copied or touched
+	files don't need parsing either. Otherwise the file is parsed and
+	the snapshot is written again.
+
+	\code
+	Excel::SnapshotCache cache( "/var/cache/dashboards" );
+	Excel::Book book;
+	cache.load( "report.xls", book );
+	\endcode
+
+	Snapshots are named by the path of the file as it's given. Several
+	caches may share the directory, snapshots are replaced atomically.
+*/
+class SnapshotCache final {
+public:
+	//! Snapshots are kept in \a directory, that should exist.
+	explicit SnapshotCache( const std::string & directory );
+
+	//! Load \a book from the snapshot of the file, or parse the file and
+	//! write its snapshot. If the snapshot can't be written the book is
+	//! loaded anyway. Book that keeps tokens of formulas is always parsed,
+	//! as snapshots don't have them.
+	//! \return true if the book was loaded from the snapshot.
+	bool load( const std::string & fileName, Book & book ) const;
+
+	//! \return Path of the snapshot of the file.
+	std::string snapshotPath( const std::string & fileName ) const;
+
+private:
+	//! Write snapshot ignoring errors.
+	static void save( const std::string & path, const Book & book, const SnapshotKey & key );
+
+private:
+	//! Directory.
+	std::string m_directory;
+}; // class SnapshotCache
+
+
+inline
+SnapshotCache::SnapshotCache( const std::string & directory )
+	:	m_directory( directory )
+{
+}
+
+inline std::string
+SnapshotCache::snapshotPath( const std::string & fileName ) const
+{
+	char name[ 32 ];
+	std::snprintf( name, sizeof( name ), "%016llx.snapshot",
+		static_cast< unsigned long long > ( std::hash< std::string > () ( fileName ) ) );
+
+	if( m_directory.empty() )
+		return name;
+
+	const char last = m_directory.back();
+
+	return m_directory + ( last == '/' || last == '\\' ? "" : "/" ) + name;
+}
+
+inline bool
+SnapshotCache::load( const std::string & fileName, Book & book ) const
+{
+	if( book.formulaTokens() )
+	{
+		book.clear();
+
+		Parser::loadBook( fileName, book );
+
+		return false;
+	}
+
+	const std::string path = snapshotPath( fileName );
+
+	SnapshotKey key = Snapshot::fileKey( fileName, false );
+	SnapshotKey stored;
+	bool hashed = false;
+
+	if( Snapshot::readKey( path, stored ) && stored.m_size == key.m_size )
+	{
+		bool same = ( stored.m_mtime == key.m_mtime );
+
+		if( !same )
+		{
+			key = Snapshot::fileKey( fileName );
+			hashed = true;
+			same = ( stored.m_hash == key.m_hash );
+		}
+
+		if( same )
+		{
+			bool loaded = false;
+
+			try {
+				book.loadSnapshot( path );
+
+				loaded = true;
+			}
+			catch( const Exception & )
+			{
+				// Broken snapshot is written again below.
+			}
+
+			if( loaded )
+			{
+				// Snapshot is rewritten with the new time, so the content is
+				// hashed only once after the file is touched.
+				if( hashed )
+					save( path, book, key );
+
+				return true;
+			}
+		}
+	}
+
+	if( !hashed )
+		key = Snapshot::fileKey( fileName );
+
+	book.clear();
+
+	Parser::loadBook( fileName, book );
+
+	save( path, book, key );
+
+	return false;
+}
+
+inline void
+SnapshotCache::save( const std::string & path, const Book & book, const SnapshotKey & key )
+{
+	try {
+		book.saveSnapshot( path, key );
+	}
+	catch( const Exception & )
+	{
+		// Cache is only an optimization, the book is loaded anyway.
+	}
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__SNAPSHOT_CACHE_HPP__INCLUDED
@@ -0,0 +1,268 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__SPSC_RING_HPP__INCLUDED
+#define EXCEL__SPSC_RING_HPP__INCLUDED
+
+// C++ include.
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstddef>
+
+
+namespace Excel {
+
+//
+// SpscRing
+//
+
+//! Lock-free ring of slots for one producer and one consumer thread.
+/*!
+	Slots are allocated once and filled in place, so buffers in them are
+	reused from round to round. Producer fills the slot got by back() and
+	publishes it with push(), consumer reads the slot got by front() and
+	gives it back with pop().
+
+	waitBack() and waitFront() spin for a while and then sleep until the
+	other side pushes or pops, so a stalled side doesn't burn the core.
+	push() and pop() lock the mutex only if the other side sleeps.
+
+	\code
+	// Producer.
+	while( !stopped() && ( slot = ring.waitBack( stopped ) ) ) { fill( *slot ); ring.push(); }
+
+	// Consumer.
+	while( ( slot = ring.waitFront( stopped ) ) ) { use( *slot ); ring.pop(); }
+
+	// Anyone.
+	stop(); ring.wake();
+	\endcode
+*/
+template< typename T >
+class SpscRing final {
+public:
+	//! Capacity is rounded up to the power of two.
+	explicit SpscRing( size_t capacity );
+
+	SpscRing( const SpscRing & ) = delete;
+	SpscRing & operator = ( const SpscRing & ) = delete;
+
+	//! \return Count of slots.
+	size_t capacity() const;
+
+	//! \return Free slot to fill or nullptr if the ring is full.
+	//! Producer only.
+	T * back();
+
+	//! Publish the slot got by back(). Producer only.
+	void push();
+
+	//! \return The oldest published slot or nullptr if the ring is empty.
+	//! Consumer only.
+	T * front();
+
+	//! Give the slot got by front() back to the producer. Consumer only.
+	void pop();
+
+	//! \return Free slot to fill, waits while the ring is full, nullptr
+	//! if it's still full when \a stopped() returns true. Producer only.
+	template< typename Stopped >
+	T * waitBack( Stopped stopped );
+
+	//! \return The oldest published slot, waits while the ring is empty,
+	//! nullptr if it's still empty when \a stopped() returns true.
+	//! Consumer only.
+	template< typename Stopped >
+	T * waitFront( Stopped stopped );
+
+	//! Wake waiting threads to check their stopped() again, to be called
+	//! after the state checked by it is changed.
+	void wake();
+
+private:
+	//! Wait for \a get() to return a slot.
+	template< typename Get, typename Stopped >
+	T * wait( Get get, Stopped stopped, std::atomic< bool > & sleeping );
+
+	//! Wake the other side if it sleeps.
+	void notify( std::atomic< bool > & sleeping );
+
+private:
+	//! Size of the cache line, counters are kept in different lines.
+	static const size_t c_cacheLine = 64;
+	//! Count of checks before sleeping.
+	static const size_t c_spinCount = 128;
+
+	//! Slots.
+	std::vector< T > m_slots;
+	//! Mask of the index.
+	size_t m_mask;
+	char m_pad0[ c_cacheLine ];
+	//! Count of slots popped by consumer.
+	std::atomic< size_t > m_head;
+	char m_pad1[ c_cacheLine - sizeof( std::atomic< size_t > ) ];
+	//! Count of slots pushed by producer.
+	std::atomic< size_t > m_tail;
+	char m_pad2[ c_cacheLine - sizeof( std::atomic< size_t > ) ];
+	//! Producer sleeps.
+	std::atomic< bool > m_producerSleeps;
+	//! Consumer sleeps.
+	std::atomic< bool > m_consumerSleeps;
+	//! Mutex of sleeping.
+	std::mutex m_mutex;
+	//! Wakes sleeping side.
+	std::condition_variable m_wake;
+}; // class SpscRing
+
+template< typename T >
+inline
+SpscRing< T >::SpscRing( size_t capacity )
+	:	m_mask( 0 )
+	,	m_head( 0 )
+	,	m_tail( 0 )
+	,	m_producerSleeps( false )
+	,	m_consumerSleeps( false )
+{
+	size_t size = 1;
+
+	while( size < capacity )
+		size *= 2;
+
+	m_slots.resize( size );
+	m_mask = size - 1;
+}
+
+template< typename T >
+inline size_t
+SpscRing< T >::capacity() const
+{
+	return m_slots.size();
+}
+
+template< typename T >
+inline T *
+SpscRing< T >::back()
+{
+	const size_t tail = m_tail.load( std::memory_order_relaxed );
+
+	if( tail - m_head.load( std::memory_order_acquire ) == m_slots.size() )
+		return nullptr;
+
+	return &m_slots[ tail & m_mask ];
+}
+
+template< typename T >
+inline void
+SpscRing< T >::push()
+{
+	m_tail.store( m_tail.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+	notify( m_consumerSleeps );
+}
+
+template< typename T >
+inline T *
+SpscRing< T >::front()
+{
+	const size_t head = m_head.load( std::memory_order_relaxed );
+
+	if( head == m_tail.load( std::memory_order_acquire ) )
+		return nullptr;
+
+	return &m_slots[ head & m_mask ];
+}
+
+template< typename T >
+inline void
+SpscRing< T >::pop()
+{
+	m_head.store( m_head.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+
+	notify( m_producerSleeps );
+}
+
+template< typename T >
+template< typename Stopped >
+inline T *
+SpscRing< T >::waitBack( Stopped stopped )
+{
+	return wait( [this] () { return back(); }, stopped, m_producerSleeps );
+}
+
+template< typename T >
+template< typename Stopped >
+inline T *
+SpscRing< T >::waitFront( Stopped stopped )
+{
+	return wait( [this] () { return front(); }, stopped, m_consumerSleeps );
+}
+
+template< typename T >
+inline void
+SpscRing< T >::wake()
+{
+	std::lock_guard< std::mutex > lock( m_mutex );
+
+	m_wake.notify_all();
+}
+
+template< typename T >
+template< typename Get, typename Stopped >
+inline T *
+SpscRing< T >::wait( Get get, Stopped stopped, std::atomic< bool > & sleeping )
+{
+	for( size_t i = 0; i < c_spinCount; ++i )
+	{
+		if( T * slot = get() )
+			return slot;
+
+		// The slot can be published right before stop.
+		if( stopped() )
+			return get();
+
+		std::this_thread::yield();
+	}
+
+	std::unique_lock< std::mutex > lock( m_mutex );
+
+	sleeping.store( true, std::memory_order_relaxed );
+
+	// Pairs with the fence in notify(): either the other side sees that
+	// this one sleeps, or this one sees the slot.
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+
+	T * slot = nullptr;
+
+	m_wake.wait( lock, [&] ()
+		{
+			return ( slot = get() ) || ( stopped() && ( slot = get(), true ) );
+		} );
+
+	sleeping.store( false, std::memory_order_relaxed );
+
+	return slot;
+}
+
+template< typename T >
+inline void
+SpscRing< T >::notify( std::atomic< bool > & sleeping )
+{
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+
+	if( sleeping.load( std::memory_order_relaxed ) )
+	{
+		std::lock_guard< std::mutex > lock( m_mutex );
+
+		m_wake.notify_all();
+	}
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__SPSC_RING_HPP__INCLUDED
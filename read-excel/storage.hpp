@@ -8,54 +8,169 @@
 
 // C++ include.
 #include <string>
+#include <cstdint>
 
 // Excel include.
 #include "formula.hpp"
 
 namespace Excel {
 
+//
+// SheetHash
+//
+
+//! Hash of the records of the sheet that make its cells, header and footer.
+struct SheetHash {
+	//! ContentHash of the records.
+	uint64_t m_hash = 0;
+	//! Count of hashed bytes.
+	uint64_t m_size = 0;
+}; // struct SheetHash
+
+inline bool
+operator == ( const SheetHash & a, const SheetHash & b )
+{
+	return ( a.m_hash == b.m_hash && a.m_size == b.m_size );
+}
+
+inline bool
+operator != ( const SheetHash & a, const SheetHash & b )
+{
+	return !( a == b );
+}
+
+
+//
+// Progress
+//
+
+//! Progress of loading of the book.
+struct Progress {
+	//! Index of the sheet when the globals are read. Enumerator, so it
+	//! can be taken by reference without definition.
+	enum : size_t { c_globals = static_cast< size_t > ( -1 ) };
+
+	//! Bytes of the Workbook stream read so far.
+	uint64_t m_bytesRead = 0;
+	//! Size of the Workbook stream, 0 if it's unknown.
+	uint64_t m_bytesTotal = 0;
+	//! Index of the sheet being read, or c_globals. The last report, with
+	//! all bytes read, has index of the last sheet.
+	size_t m_sheetIdx = c_globals;
+}; // struct Progress
+
+
 //
 // IStorage
 //
 
 //! Excel storage interface.
 struct IStorage {
+	//! Encoding of strings of SST and cells.
+	enum class StringEncoding {
+		//! Excel::String, onSharedString() and onCell() are called.
+		Native,
+		//! UTF-8, onSharedStringUtf8() and onCellUtf8() are called.
+		Utf8
+	}; // enum class StringEncoding
+
 	virtual ~IStorage() = default;
 
 protected:
 	friend class Parser;
+	friend class ProgressReporter;
+	friend class SheetHasher;
+
+	//! \return Encoding of strings of SST and cells the storage wants.
+	virtual StringEncoding stringEncoding() const { return StringEncoding::Native; }
 
 	//! Handler of SST.
-	virtual void onSharedString( size_t sstSize, size_t idx, const std::wstring & value ) = 0;
+	virtual void onSharedString( size_t sstSize, size_t idx, const String & value ) = 0;
 	//! Handler of date mode.
 	virtual void onDateMode( uint16_t mode ) = 0;
 	//! Handler of sheet.
-	virtual void onSheet( size_t idx, const std::wstring & value ) = 0;
+	virtual void onSheet( size_t idx, const String & value ) = 0;
 	//! Handler of cell with text from SST.
 	virtual void onCellSharedString( size_t sheetIdx, size_t row, size_t column, size_t sstIndex ) = 0;
 	//! Handler of cell with text.
-	virtual void onCell( size_t sheetIdx, size_t row, size_t column, const std::wstring & value ) = 0;
+	virtual void onCell( size_t sheetIdx, size_t row, size_t column, const String & value ) = 0;
 	//! Handler of cell with double.
 	virtual void onCell( size_t sheetIdx, size_t row, size_t column, double value ) = 0;
 	//! Handler of cell with formula.
 	virtual void onCell( size_t sheetIdx, const Formula & value ) = 0;
+	//! Handler of cell with formula that can be moved. By default calls
+	//! handler above.
+	virtual void onCell( size_t sheetIdx, Formula && value )
+		{ onCell( sheetIdx, static_cast< const Formula & > ( value ) ); }
+	//! Handler of sheet header.
+	virtual void onHeader( size_t sheetIdx, const String & value ) = 0;
+	//! Handler of sheet footer.
+	virtual void onFooter( size_t sheetIdx, const String & value ) = 0;
+	//! Handler of the end of the sheet, all its cells are given.
+	virtual void onSheetEnd( size_t ) {}
+	//! Handler of SST in UTF-8, called instead of onSharedString() with
+	//! StringEncoding::Utf8.
+	virtual void onSharedStringUtf8( size_t, size_t, const std::string & ) {}
+	//! Handler of cell with text in UTF-8, called instead of onCell() with
+	//! text with StringEncoding::Utf8.
+	virtual void onCellUtf8( size_t, size_t, size_t, const std::string & ) {}
+	//! \return Does the storage want hash of every sheet, then onSheetHash() is
+	//! called after the cells of the sheet before onSheetEnd(). Records are
+	//! hashed while they are parsed, there is no second pass.
+	virtual bool wantsSheetHash() const { return false; }
+	//! \return Hash of SST string with given index. It's hashed instead of the
+	//! index in LABELSST records, so equal sheets of books with different
+	//! SST have equal hashes.
+	virtual uint64_t sharedStringHash( size_t sstIndex ) { return sstIndex; }
+	//! Handler of hash of the whole sheet.
+	virtual void onSheetHash( size_t, const SheetHash & ) {}
+	//! \return Should parsing stop. It's checked between records, sheets and
+	//! blocks of SST strings. Once it returns true the parser skips the rest
+	//! of the file and returns normally, the storage keeps what is loaded,
+	//! onSheetEnd() is not called for the interrupted sheet.
+	virtual bool isCancelled() const { return false; }
+	//! \return Count of bytes of the Workbook stream between calls of
+	//! onProgress(), 0 turns reporting off.
+	virtual uint32_t progressInterval() const { return 0; }
+	//! Handler of progress, called between records every progressInterval()
+	//! bytes and once more with all bytes read when the book is loaded.
+	virtual void onProgress( const Progress & ) {}
+	//! \return Does the storage want tokens of formulas, Formula::tokens().
+	//! Tokens of shared and array formulas are given once for all their
+	//! cells, other formulas cost an allocation each.
+	virtual bool wantsFormulaTokens() const { return false; }
+
+	/*!
+		Parser calls handlers below with views to its decode buffer, that
+		are valid only during the call. By default they copy the string
+		and call handlers above, override them to avoid the copy.
+	*/
+
+	//! Handler of SST.
+	virtual void onSharedStringView( size_t sstSize, size_t idx, StringView value )
+		{ onSharedString( sstSize, idx, value.str() ); }
+	//! Handler of cell with text.
+	virtual void onCellView( size_t sheetIdx, size_t row, size_t column, StringView value )
+		{ onCell( sheetIdx, row, column, value.str() ); }
 	//! Handler of sheet header.
-	virtual void onHeader( size_t sheetIdx, const std::wstring & value ) = 0;
+	virtual void onHeaderView( size_t sheetIdx, StringView value )
+		{ onHeader( sheetIdx, value.str() ); }
 	//! Handler of sheet footer.
-	virtual void onFooter( size_t sheetIdx, const std::wstring & value ) = 0;
+	virtual void onFooterView( size_t sheetIdx, StringView value )
+		{ onFooter( sheetIdx, value.str() ); }
 }; // struct IStorage
 
 struct EmptyStorage : public IStorage {
 protected:
-	void onSharedString( size_t sstSize, size_t idx, const std::wstring & value ) override {}
-	void onDateMode( uint16_t mode ) override {}
-	void onSheet( size_t idx, const std::wstring & value ) override {}
-	void onCellSharedString( size_t sheetIdx, size_t row, size_t column, size_t sstIndex ) override {}
-	void onCell( size_t sheetIdx, size_t row, size_t column, const std::wstring & value ) override {}
-	void onCell( size_t sheetIdx, size_t row, size_t column, double value ) override {}
-	void onCell( size_t sheetIdx, const Formula & value ) override {}
-	void onHeader( size_t sheetIdx, const std::wstring & value ) override {}
-	void onFooter( size_t sheetIdx, const std::wstring & value ) override {}
+	void onSharedString( size_t, size_t, const String & ) override {}
+	void onDateMode( uint16_t ) override {}
+	void onSheet( size_t, const String & ) override {}
+	void onCellSharedString( size_t, size_t, size_t, size_t ) override {}
+	void onCell( size_t, size_t, size_t, const String & ) override {}
+	void onCell( size_t, size_t, size_t, double ) override {}
+	void onCell( size_t, const Formula & ) override {}
+	void onHeader( size_t, const String & ) override {}
+	void onFooter( size_t, const String & ) override {}
 }; // struct EmptyStorage
 
 } /* namespace Excel */
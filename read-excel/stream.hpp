@@ -9,9 +9,11 @@
 
 // C++ include.
 #include <cstdint>
+#include <cstring>
 
 // read-excel include.
 #include "exceptions.hpp"
+#include "parse_stats.hpp"
 
 namespace Excel {
 
@@ -78,6 +80,14 @@ public:
 	//! \return Position in the stream.
 	virtual int32_t pos() = 0;
 
+	//! Read \a size bytes from the stream. Default implementation reads
+	//! byte by byte.
+	//! \return Count of read bytes, less than \a size on the end of stream.
+	virtual int32_t readBytes( char * data, int32_t size );
+
+	//! \return Size of the stream, -1 if it's unknown.
+	virtual int32_t size() const;
+
 	//! Read data from the stream.
 	template< typename Type >
 	void read( Type & retVal, int32_t bytes = 0 )
@@ -115,12 +125,160 @@ Stream::~Stream()
 {
 }
 
+inline int32_t
+Stream::size() const
+{
+	return -1;
+}
+
 inline Stream::ByteOrder
 Stream::byteOrder() const
 {
 	return m_byteOrder;
 }
 
+inline int32_t
+Stream::readBytes( char * data, int32_t size )
+{
+	for( int32_t i = 0; i < size; ++i )
+	{
+		data[ i ] = getByte();
+
+		if( eof() )
+			return i;
+	}
+
+	return size;
+}
+
+
+//
+// MemoryStream
+//
+
+//! Stream over the bytes in memory.
+/*!
+	Doesn't own the data. Behaves as CompoundFile::Stream, i.e. reading
+	past the end gives 0xFF bytes.
+*/
+class MemoryStream
+	:	public Stream
+{
+public:
+	MemoryStream( const char * data, int32_t size,
+		ByteOrder byteOrder = LittleEndian );
+
+	//! Read one byte from the stream.
+	char getByte() override;
+
+	//! \return true if EOF reached.
+	bool eof() const override;
+
+	//! Seek stream to new position.
+	void seek( int32_t pos, SeekType type = FromBeginning ) override;
+
+	//! \return Position in the stream.
+	int32_t pos() override;
+
+	//! Read \a size bytes from the stream.
+	//! \return Count of read bytes, less than \a size on the end of stream.
+	int32_t readBytes( char * data, int32_t size ) override;
+
+	//! \return Data.
+	const char * data() const;
+
+	//! \return Size of the data.
+	int32_t size() const override;
+
+private:
+	//! Data.
+	const char * m_data;
+	//! Size of the data.
+	int32_t m_size;
+	//! Position in the stream.
+	int32_t m_pos;
+}; // class MemoryStream
+
+inline
+MemoryStream::MemoryStream( const char * data, int32_t size,
+	ByteOrder byteOrder )
+	:	Stream( byteOrder )
+	,	m_data( data )
+	,	m_size( size )
+	,	m_pos( 0 )
+{
+}
+
+inline char
+MemoryStream::getByte()
+{
+	if( m_pos >= m_size )
+		return 0xFFu;
+
+	return m_data[ m_pos++ ];
+}
+
+inline bool
+MemoryStream::eof() const
+{
+	return ( m_pos > m_size );
+}
+
+inline void
+MemoryStream::seek( int32_t pos, SeekType type )
+{
+	ParseStatsPolicy::onSeek();
+
+	if( type == FromCurrent )
+	{
+		pos += m_pos;
+
+		if( pos < 0 )
+			pos += m_size;
+	}
+	else if( type == FromEnd && pos > 0 )
+		pos = m_size - pos;
+	else if( type == FromEnd && pos < 0 )
+		pos = -pos;
+	else if( type == FromBeginning && pos < 0 )
+		pos = m_size - pos;
+
+	m_pos = ( pos >= m_size ? m_size : pos );
+}
+
+inline int32_t
+MemoryStream::pos()
+{
+	return m_pos;
+}
+
+inline int32_t
+MemoryStream::readBytes( char * data, int32_t size )
+{
+	const int32_t bytes = ( size < m_size - m_pos ? size : m_size - m_pos );
+
+	if( bytes > 0 )
+	{
+		std::memcpy( data, m_data + m_pos, bytes );
+
+		m_pos += bytes;
+	}
+
+	return ( bytes > 0 ? bytes : 0 );
+}
+
+inline const char *
+MemoryStream::data() const
+{
+	return m_data;
+}
+
+inline int32_t
+MemoryStream::size() const
+{
+	return m_size;
+}
+
 } /* namespace Excel */
 
 #endif // EXCEL__STREAM_HPP__INCLUDED
@@ -16,6 +16,8 @@
 // Excel include.
 #include "stream.hpp"
 #include "bof.hpp"
+#include "string_type.hpp"
+#include "utf8.hpp"
 
 
 namespace Excel {
@@ -81,72 +83,191 @@ isSkipByte( int32_t pos, const std::vector< int32_t > & borders )
 
 
 //
-// loadString
+// StringHeader
 //
 
-//! Load string from the stream.
-inline std::wstring
-loadString( Stream & stream,
-	const std::vector< int32_t > & borders,
-	int32_t lengthFieldSize = 2,
-	BOF::BiffVersion biffVer = BOF::BIFF8 )
+//! Header of the string.
+struct StringHeader {
+	//! Count of characters.
+	int16_t m_charactersCount = 0;
+	//! Options.
+	char m_options = 0;
+	//! Count of formatting runs after characters.
+	int16_t m_formattingRuns = 0;
+	//! Size of extended data after formatting runs.
+	int32_t m_extStringLength = 0;
+
+	//! Read header.
+	void read( Stream & stream, int32_t lengthFieldSize, BOF::BiffVersion biffVer );
+
+	//! \return Bytes per character with given options.
+	static int16_t bytesPerChar( char options, BOF::BiffVersion biffVer );
+
+	//! Skip formatting runs and extended data that follow characters.
+	void skipTail( Stream & stream ) const;
+}; // struct StringHeader
+
+inline void
+StringHeader::read( Stream & stream, int32_t lengthFieldSize, BOF::BiffVersion biffVer )
 {
-	int16_t charactersCount = 0;
-	char options = 0;
-	int16_t formattingRuns = 0;
-	int32_t extStringLength = 0;
-
-	stream.read( charactersCount, lengthFieldSize );
+	stream.read( m_charactersCount, lengthFieldSize );
 
-	if( biffVer == BOF::BIFF7 && charactersCount > 255 )
+	if( biffVer == BOF::BIFF7 && m_charactersCount > 255 )
 		throw Exception( L"Wrong format of XLS file." );
 
 	if( biffVer == BOF::BIFF8 )
 	{
-		stream.read( options, 1 );
+		stream.read( m_options, 1 );
 
-		if( isRichString( options ) )
-			stream.read( formattingRuns, 2 );
+		if( isRichString( m_options ) )
+			stream.read( m_formattingRuns, 2 );
 
-		if( isExtString( options ) )
-			stream.read( extStringLength, 4 );
+		if( isExtString( m_options ) )
+			stream.read( m_extStringLength, 4 );
 	}
+}
+
+inline int16_t
+StringHeader::bytesPerChar( char options, BOF::BiffVersion biffVer )
+{
+	return ( biffVer == BOF::BIFF8 ? ( isHighByte( options ) ? 2 : 1 ) : 1 );
+}
 
-	int16_t bytesPerChar = ( biffVer == BOF::BIFF8 ? ( isHighByte( options ) ? 2 : 1 ) : 1 );
+inline void
+StringHeader::skipTail( Stream & stream ) const
+{
+	char dummy = 0;
 
-	std::vector< uint16_t > stringData( charactersCount );
+	for( int32_t i = 0; i < m_formattingRuns * 4; ++i )
+		stream.read( dummy, 1 );
+
+	for( int32_t i = 0; i < m_extStringLength; ++i )
+		stream.read( dummy, 1 );
+}
 
-	for( int16_t i = 0; i < charactersCount; ++i )
+
+//
+// loadString
+//
+
+//! Load string from the stream into \a str. Capacity of \a str is
+//! reused, so one buffer can be used for many strings.
+inline void
+loadString( Stream & stream,
+	const std::vector< int32_t > & borders,
+	String & str,
+	int32_t lengthFieldSize = 2,
+	BOF::BiffVersion biffVer = BOF::BIFF8 )
+{
+	StringHeader header;
+	header.read( stream, lengthFieldSize, biffVer );
+
+	char options = header.m_options;
+	int16_t bytesPerChar = StringHeader::bytesPerChar( options, biffVer );
+
+	str.resize( static_cast< size_t > ( std::max< int16_t > ( header.m_charactersCount, 0 ) ) );
+
+	for( int16_t i = 0; i < header.m_charactersCount; ++i )
 	{
 		if( isSkipByte( stream.pos(), borders ) )
 		{
 			stream.read( options, 1 );
-			bytesPerChar = ( biffVer == BOF::BIFF8 ? ( isHighByte( options ) ? 2 : 1 ) : 1 );
+			bytesPerChar = StringHeader::bytesPerChar( options, biffVer );
 		}
 
-		stream.read( stringData[ i ], bytesPerChar );
+		uint16_t c = 0;
+		stream.read( c, bytesPerChar );
+		str[ i ] = static_cast< Char > ( c );
 	}
 
-	if( formattingRuns > 0 )
-	{
-		const size_t dummySize = formattingRuns * 4;
-		std::vector< char > dummy( dummySize );
+	header.skipTail( stream );
 
-		for( size_t i = 0; i < dummySize; ++i )
-			stream.read( dummy[ i ], 1 );
-	}
+	ParseStatsPolicy::onString( str.size() );
+}
 
-	if( extStringLength > 0 )
+//! Load string from the stream.
+inline String
+loadString( Stream & stream,
+	const std::vector< int32_t > & borders,
+	int32_t lengthFieldSize = 2,
+	BOF::BiffVersion biffVer = BOF::BIFF8 )
+{
+	String str;
+
+	loadString( stream, borders, str, lengthFieldSize, biffVer );
+
+	return str;
+}
+
+
+//
+// loadStringUtf8
+//
+
+//! Load string from the stream as UTF-8.
+/*!
+	Characters between CONTINUE borders are read with one readBytes()
+	call and transcoded with Utf8, without intermediate wide string.
+*/
+inline std::string
+loadStringUtf8( Stream & stream,
+	const std::vector< int32_t > & borders,
+	int32_t lengthFieldSize = 2,
+	BOF::BiffVersion biffVer = BOF::BIFF8 )
+{
+	StringHeader header;
+	header.read( stream, lengthFieldSize, biffVer );
+
+	char options = header.m_options;
+	int16_t bytesPerChar = StringHeader::bytesPerChar( options, biffVer );
+
+	const int32_t count = std::max< int32_t > ( header.m_charactersCount, 0 );
+
+	std::string str( static_cast< size_t > ( count ) * Utf8::c_maxPerUtf16 + 3, 0 );
+	char * out = &str[ 0 ];
+	uint16_t highSurrogate = 0;
+	unsigned char buf[ 1024 ];
+
+	for( int32_t left = count; left > 0; )
 	{
-		const size_t dummySize = extStringLength;
-		std::vector< char > dummy( dummySize );
+		const int32_t pos = stream.pos();
+
+		if( isSkipByte( pos, borders ) )
+		{
+			stream.read( options, 1 );
+			bytesPerChar = StringHeader::bytesPerChar( options, biffVer );
+
+			continue;
+		}
+
+		int32_t chars = std::min< int32_t > ( left,
+			static_cast< int32_t > ( sizeof( buf ) ) / bytesPerChar );
 
-		for( size_t i = 0; i < dummySize; ++i )
-			stream.read( dummy[ i ], 1 );
+		const auto border = std::upper_bound( borders.cbegin(), borders.cend(), pos );
+
+		if( border != borders.cend() )
+			chars = std::min( chars, ( *border - pos + bytesPerChar - 1 ) / bytesPerChar );
+
+		const int32_t bytes = chars * bytesPerChar;
+
+		if( stream.readBytes( reinterpret_cast< char* > ( buf ), bytes ) != bytes )
+			throw Exception( L"Unexpected end of file." );
+
+		if( bytesPerChar == 2 )
+			out = Utf8::fromUtf16( out, buf, static_cast< size_t > ( chars ), highSurrogate );
+		else
+			out = Utf8::fromCompressed( out, buf, static_cast< size_t > ( chars ) );
+
+		left -= chars;
 	}
 
-	std::wstring str;
-	str.assign( stringData.begin(), stringData.end() );
+	out = Utf8::finish( out, highSurrogate );
+
+	str.resize( static_cast< size_t > ( out - str.data() ) );
+
+	header.skipTail( stream );
+
+	ParseStatsPolicy::onString( static_cast< size_t > ( count ) );
 
 	return str;
 }
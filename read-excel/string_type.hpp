@@ -0,0 +1,226 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__STRING_TYPE_HPP__INCLUDED
+#define EXCEL__STRING_TYPE_HPP__INCLUDED
+
+// C++ include.
+#include <string>
+#include <cstddef>
+
+#if __cplusplus >= 201703L
+	#include <string_view>
+#endif
+
+
+namespace Excel {
+
+//
+// Char
+//
+
+#ifdef READ_EXCEL_WITH_UTF16_STRINGS
+
+//! Character of the strings, UTF-16 code unit as in XLS file.
+typedef char16_t Char;
+
+#else
+
+//! Character of the strings.
+typedef wchar_t Char;
+
+#endif // READ_EXCEL_WITH_UTF16_STRINGS
+
+
+//
+// String
+//
+
+//! String of the cells, formulas, SST, names of sheets, headers and footers.
+/*!
+	It's std::wstring by default. With READ_EXCEL_WITH_UTF16_STRINGS
+	defined it's std::u16string that holds UTF-16 as it is in the file,
+	what is twice less memory where wchar_t is 4 bytes.
+*/
+typedef std::basic_string< Char > String;
+
+
+//
+// StringView
+//
+
+//! Not owning view of the characters of String.
+/*!
+	std::basic_string_view is C++17, this is the part of it the parser needs.
+*/
+class StringView {
+public:
+	StringView() noexcept;
+	StringView( const Char * data, size_t size ) noexcept;
+	StringView( const Char * str );
+	StringView( const String & str ) noexcept;
+
+	//! \return Characters.
+	const Char * data() const noexcept;
+
+	//! \return Count of characters.
+	size_t size() const noexcept;
+
+	//! \return Is view empty.
+	bool empty() const noexcept;
+
+	const Char * begin() const noexcept;
+	const Char * end() const noexcept;
+
+	const Char & operator [] ( size_t idx ) const noexcept;
+
+	//! \return Copy of the characters.
+	String str() const;
+
+#if __cplusplus >= 201703L
+	operator std::basic_string_view< Char > () const noexcept;
+#endif
+
+private:
+	//! Characters.
+	const Char * m_data;
+	//! Count of characters.
+	size_t m_size;
+}; // class StringView
+
+bool operator == ( StringView a, StringView b ) noexcept;
+bool operator != ( StringView a, StringView b ) noexcept;
+
+
+inline
+StringView::StringView() noexcept
+	:	m_data( nullptr )
+	,	m_size( 0 )
+{
+}
+
+inline
+StringView::StringView( const Char * data, size_t size ) noexcept
+	:	m_data( data )
+	,	m_size( size )
+{
+}
+
+inline
+StringView::StringView( const Char * str )
+	:	m_data( str )
+	,	m_size( std::char_traits< Char >::length( str ) )
+{
+}
+
+inline
+StringView::StringView( const String & str ) noexcept
+	:	m_data( str.data() )
+	,	m_size( str.size() )
+{
+}
+
+inline const Char *
+StringView::data() const noexcept
+{
+	return m_data;
+}
+
+inline size_t
+StringView::size() const noexcept
+{
+	return m_size;
+}
+
+inline bool
+StringView::empty() const noexcept
+{
+	return ( m_size == 0 );
+}
+
+inline const Char *
+StringView::begin() const noexcept
+{
+	return m_data;
+}
+
+inline const Char *
+StringView::end() const noexcept
+{
+	return m_data + m_size;
+}
+
+inline const Char &
+StringView::operator [] ( size_t idx ) const noexcept
+{
+	return m_data[ idx ];
+}
+
+inline String
+StringView::str() const
+{
+	return String( m_data, m_size );
+}
+
+#if __cplusplus >= 201703L
+inline
+StringView::operator std::basic_string_view< Char > () const noexcept
+{
+	return std::basic_string_view< Char > ( m_data, m_size );
+}
+#endif
+
+inline bool
+operator == ( StringView a, StringView b ) noexcept
+{
+	return ( a.size() == b.size() &&
+		std::char_traits< Char >::compare( a.data(), b.data(), a.size() ) == 0 );
+}
+
+inline bool
+operator != ( StringView a, StringView b ) noexcept
+{
+	return !( a == b );
+}
+
+
+//
+// toWString
+//
+
+//! \return String converted to std::wstring.
+inline std::wstring
+toWString( const String & str )
+{
+#ifdef READ_EXCEL_WITH_UTF16_STRINGS
+	std::wstring res;
+	res.reserve( str.size() );
+
+	for( size_t i = 0; i < str.size(); ++i )
+	{
+		const char32_t c = str[ i ];
+
+		if( sizeof( wchar_t ) == 4 && c >= 0xD800 && c < 0xDC00 &&
+			i + 1 < str.size() && str[ i + 1 ] >= 0xDC00 && str[ i + 1 ] < 0xE000 )
+		{
+			res.push_back( static_cast< wchar_t > ( 0x10000 +
+				( ( c - 0xD800 ) << 10 ) + ( str[ i + 1 ] - 0xDC00 ) ) );
+
+			++i;
+		}
+		else
+			res.push_back( static_cast< wchar_t > ( c ) );
+	}
+
+	return res;
+#else
+	return str;
+#endif // READ_EXCEL_WITH_UTF16_STRINGS
+} // toWString
+
+} /* namespace Excel */
+
+#endif // EXCEL__STRING_TYPE_HPP__INCLUDED
@@ -0,0 +1,246 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef EXCEL__UTF8_HPP__INCLUDED
+#define EXCEL__UTF8_HPP__INCLUDED
+
+// Excel include.
+#include "string_type.hpp"
+
+// C++ include.
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || \
+	( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+	#define READ_EXCEL_UTF8_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+namespace Excel {
+
+//
+// Utf8
+//
+
+//! Transcoders of XLS characters to UTF-8.
+/*!
+	Characters in XLS file are either compressed (one byte, high byte
+	of UTF-16 is zero) or UTF-16LE. With SSE2 blocks of 16 ASCII
+	characters are copied at once, other blocks are encoded one by one.
+
+	Output buffer should have room for 2 bytes per compressed character
+	and 3 bytes per UTF-16 code unit plus 3 bytes for the last lone
+	surrogate.
+*/
+class Utf8 final {
+public:
+	//! Maximum count of bytes per compressed character.
+	static const size_t c_maxPerCompressed = 2;
+	//! Maximum count of bytes per UTF-16 code unit.
+	static const size_t c_maxPerUtf16 = 3;
+
+	//! Encode \a count compressed characters.
+	//! \return End of written bytes.
+	static char * fromCompressed( char * out, const unsigned char * data, size_t count );
+
+	//! Encode \a count UTF-16LE code units. \a highSurrogate keeps high
+	//! surrogate of the pair that is split between calls, it should be 0
+	//! before the first call.
+	//! \return End of written bytes.
+	static char * fromUtf16( char * out, const unsigned char * data, size_t count,
+		uint16_t & highSurrogate );
+
+	//! Finish UTF-16 string, unpaired high surrogate is written as U+FFFD.
+	//! \return End of written bytes.
+	static char * finish( char * out, uint16_t & highSurrogate );
+
+	//! \return UTF-8 of Excel::String, UTF-16 or UTF-32 depending on Char.
+	static std::string fromString( StringView str );
+
+private:
+	//! Write code point.
+	static char * put( char * out, uint32_t c );
+	//! Encode compressed characters without SIMD.
+	static char * fromCompressedScalar( char * out, const unsigned char * data, size_t count );
+	//! Encode UTF-16LE code units without SIMD.
+	static char * fromUtf16Scalar( char * out, const unsigned char * data, size_t count,
+		uint16_t & highSurrogate );
+}; // class Utf8
+
+
+inline char *
+Utf8::put( char * out, uint32_t c )
+{
+	if( c < 0x80 )
+		*out++ = static_cast< char > ( c );
+	else if( c < 0x800 )
+	{
+		*out++ = static_cast< char > ( 0xC0 | ( c >> 6 ) );
+		*out++ = static_cast< char > ( 0x80 | ( c & 0x3F ) );
+	}
+	else if( c < 0x10000 )
+	{
+		*out++ = static_cast< char > ( 0xE0 | ( c >> 12 ) );
+		*out++ = static_cast< char > ( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+		*out++ = static_cast< char > ( 0x80 | ( c & 0x3F ) );
+	}
+	else
+	{
+		*out++ = static_cast< char > ( 0xF0 | ( c >> 18 ) );
+		*out++ = static_cast< char > ( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+		*out++ = static_cast< char > ( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+		*out++ = static_cast< char > ( 0x80 | ( c & 0x3F ) );
+	}
+
+	return out;
+}
+
+inline char *
+Utf8::fromCompressedScalar( char * out, const unsigned char * data, size_t count )
+{
+	for( size_t i = 0; i < count; ++i )
+		out = put( out, data[ i ] );
+
+	return out;
+}
+
+inline char *
+Utf8::fromCompressed( char * out, const unsigned char * data, size_t count )
+{
+	size_t i = 0;
+
+#ifdef READ_EXCEL_UTF8_SSE2
+	for( ; i + 16 <= count; i += 16 )
+	{
+		const __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i* > ( data + i ) );
+
+		if( _mm_movemask_epi8( v ) == 0 )
+		{
+			_mm_storeu_si128( reinterpret_cast< __m128i* > ( out ), v );
+			out += 16;
+		}
+		else
+			out = fromCompressedScalar( out, data + i, 16 );
+	}
+#endif // READ_EXCEL_UTF8_SSE2
+
+	return fromCompressedScalar( out, data + i, count - i );
+}
+
+inline char *
+Utf8::fromUtf16Scalar( char * out, const unsigned char * data, size_t count,
+	uint16_t & highSurrogate )
+{
+	for( size_t i = 0; i < count; ++i )
+	{
+		const uint16_t c = static_cast< uint16_t > ( data[ i * 2 ] |
+			( data[ i * 2 + 1 ] << 8 ) );
+
+		if( highSurrogate )
+		{
+			if( c >= 0xDC00 && c < 0xE000 )
+			{
+				out = put( out, 0x10000 + ( ( highSurrogate - 0xD800u ) << 10 ) +
+					( c - 0xDC00u ) );
+				highSurrogate = 0;
+
+				continue;
+			}
+
+			out = finish( out, highSurrogate );
+		}
+
+		if( c >= 0xD800 && c < 0xDC00 )
+			highSurrogate = c;
+		else if( c >= 0xDC00 && c < 0xE000 )
+			out = put( out, 0xFFFD );
+		else
+			out = put( out, c );
+	}
+
+	return out;
+}
+
+inline char *
+Utf8::fromUtf16( char * out, const unsigned char * data, size_t count,
+	uint16_t & highSurrogate )
+{
+	size_t i = 0;
+
+#ifdef READ_EXCEL_UTF8_SSE2
+	const __m128i nonAscii = _mm_set1_epi16( static_cast< short > ( 0xFF80 ) );
+	const __m128i zero = _mm_setzero_si128();
+
+	for( ; i + 16 <= count; i += 16 )
+	{
+		const __m128i a = _mm_loadu_si128(
+			reinterpret_cast< const __m128i* > ( data + i * 2 ) );
+		const __m128i b = _mm_loadu_si128(
+			reinterpret_cast< const __m128i* > ( data + i * 2 + 16 ) );
+		const __m128i high = _mm_and_si128( _mm_or_si128( a, b ), nonAscii );
+
+		if( !highSurrogate && _mm_movemask_epi8( _mm_cmpeq_epi16( high, zero ) ) == 0xFFFF )
+		{
+			_mm_storeu_si128( reinterpret_cast< __m128i* > ( out ), _mm_packus_epi16( a, b ) );
+			out += 16;
+		}
+		else
+			out = fromUtf16Scalar( out, data + i * 2, 16, highSurrogate );
+	}
+#endif // READ_EXCEL_UTF8_SSE2
+
+	return fromUtf16Scalar( out, data + i * 2, count - i, highSurrogate );
+}
+
+inline char *
+Utf8::finish( char * out, uint16_t & highSurrogate )
+{
+	if( highSurrogate )
+	{
+		highSurrogate = 0;
+
+		return put( out, 0xFFFD );
+	}
+
+	return out;
+}
+
+inline std::string
+Utf8::fromString( StringView str )
+{
+	std::string res( str.size() * 4, 0 );
+	char * out = &res[ 0 ];
+
+	for( size_t i = 0; i < str.size(); ++i )
+	{
+		const uint32_t c = static_cast< uint32_t > ( str[ i ] );
+
+		if( c >= 0xD800 && c < 0xDC00 && i + 1 < str.size() &&
+			static_cast< uint32_t > ( str[ i + 1 ] ) >= 0xDC00 &&
+			static_cast< uint32_t > ( str[ i + 1 ] ) < 0xE000 )
+		{
+			out = put( out, 0x10000 + ( ( c - 0xD800 ) << 10 ) +
+				( static_cast< uint32_t > ( str[ i + 1 ] ) - 0xDC00 ) );
+
+			++i;
+		}
+		else if( ( c >= 0xD800 && c < 0xE000 ) || c > 0x10FFFF )
+			out = put( out, 0xFFFD );
+		else
+			out = put( out, c );
+	}
+
+	res.resize( static_cast< size_t > ( out - res.data() ) );
+
+	return res;
+}
+
+} /* namespace Excel */
+
+#endif // EXCEL__UTF8_HPP__INCLUDED
@@ -0,0 +1,195 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/parser.hpp>
+#include <read-excel/record_index.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Count of allocations made with global operator new.
+static std::atomic< uint64_t > allocations( 0 );
+
+void * operator new( std::size_t size )
+{
+	++allocations;
+
+	if( void * p = std::malloc( size ? size : 1 ) )
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void * operator new[]( std::size_t size )
+{
+	return operator new( size );
+}
+
+void * operator new( std::size_t size, const std::nothrow_t & ) noexcept
+{
+	++allocations;
+
+	return std::malloc( size ? size : 1 );
+}
+
+void * operator new[]( std::size_t size, const std::nothrow_t & tag ) noexcept
+{
+	return operator new( size, tag );
+}
+
+void operator delete( void * p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void * p ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete( void * p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void * p, std::size_t ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete( void * p, const std::nothrow_t & ) noexcept
+{
+	std::free( p );
+}
+
+void operator delete[]( void * p, const std::nothrow_t & ) noexcept
+{
+	std::free( p );
+}
+
+
+//! Upper bound of allocations per record of the Workbook stream.
+/*!
+	Buffers of records and strings are reused, so parsing of big.xls
+	(16071 records) makes a few dozens of allocations in total, not one
+	or more per record as without the pool of buffers. Raise it only with
+	a good reason.
+*/
+static const double c_maxAllocationsPerRecord = 0.01;
+
+//! Upper bound of allocations per cell.
+static const double c_maxAllocationsPerCell = 0.001;
+
+
+//
+// CountingStorage
+//
+
+//! Storage that only counts cells.
+struct CountingStorage
+	:	public Excel::EmptyStorage
+{
+	//! Count of cells.
+	size_t m_cells = 0;
+
+protected:
+	void onCellSharedString( size_t, size_t, size_t, size_t ) override { ++m_cells; }
+	void onCell( size_t, size_t, size_t, const std::wstring & ) override { ++m_cells; }
+	void onCell( size_t, size_t, size_t, double ) override { ++m_cells; }
+	void onCell( size_t, const Excel::Formula & ) override { ++m_cells; }
+}; // struct CountingStorage
+
+
+TEST_CASE( "test_allocations_of_big_xls" )
+{
+	CompoundFile::File file( "./test/data/big.xls" );
+
+	size_t records = 0;
+
+	{
+		auto stream = file.stream( file.directory( L"Workbook" ) );
+
+		records = Excel::RecordIndex( *stream ).records().size();
+	}
+
+	CountingStorage storage;
+
+	const uint64_t before = allocations;
+
+	Excel::Parser::loadBook( file, storage );
+
+	const uint64_t count = allocations - before;
+
+	MESSAGE( "records: " << records << ", cells: " << storage.m_cells <<
+		", allocations: " << count );
+
+	REQUIRE( records > 0 );
+	REQUIRE( storage.m_cells > 0 );
+
+	REQUIRE( static_cast< double > ( count ) / records <=
+		c_maxAllocationsPerRecord );
+	REQUIRE( static_cast< double > ( count ) / storage.m_cells <=
+		c_maxAllocationsPerCell );
+}
+
+//! Storage that counts cells and looks at strings only through views.
+struct ViewCountingStorage
+	:	public CountingStorage
+{
+protected:
+	void onSharedStringView( size_t, size_t, Excel::StringView ) override {}
+	void onCellView( size_t, size_t, size_t, Excel::StringView ) override { ++m_cells; }
+}; // struct ViewCountingStorage
+
+TEST_CASE( "test_allocations_with_string_views" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 100;
+	opts.m_columns = 10;
+	opts.m_sstSize = 500;
+	opts.m_stringLength = 40;
+	opts.m_stringEvery = 2;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	CompoundFile::File file( stream );
+
+	CountingStorage storage;
+
+	uint64_t before = allocations;
+
+	Excel::Parser::loadBook( file, storage );
+
+	const uint64_t withStrings = allocations - before;
+
+	ViewCountingStorage viewStorage;
+
+	before = allocations;
+
+	Excel::Parser::loadBook( file, viewStorage );
+
+	const uint64_t withViews = allocations - before;
+
+	MESSAGE( "allocations with strings: " << withStrings <<
+		", with views: " << withViews );
+
+	REQUIRE( viewStorage.m_cells == storage.m_cells );
+	REQUIRE( withViews + opts.m_sstSize <= withStrings );
+}
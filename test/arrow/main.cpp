@@ -0,0 +1,196 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/arrow.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! \return Is bit set in the bitmap.
+bool isBitSet( const void * bitmap, int64_t idx )
+{
+	return ( static_cast< const uint8_t* > ( bitmap )[ idx / 8 ] >> ( idx % 8 ) ) & 1;
+}
+
+//! \return Is value valid.
+bool isValid( const ArrowArray * array, int64_t idx )
+{
+	return ( !array->buffers[ 0 ] || isBitSet( array->buffers[ 0 ], idx ) );
+}
+
+//! \return String value of utf8 array.
+std::string stringValue( const ArrowArray * array, int64_t idx )
+{
+	const int32_t * offsets = static_cast< const int32_t* > ( array->buffers[ 1 ] );
+	const char * chars = static_cast< const char* > ( array->buffers[ 2 ] );
+
+	return std::string( chars + offsets[ idx ], chars + offsets[ idx + 1 ] );
+}
+
+
+TEST_CASE( "test_arrow_column_names" )
+{
+	REQUIRE( Excel::ArrowExporter::columnName( 0 ) == "A" );
+	REQUIRE( Excel::ArrowExporter::columnName( 25 ) == "Z" );
+	REQUIRE( Excel::ArrowExporter::columnName( 26 ) == "AA" );
+	REQUIRE( Excel::ArrowExporter::columnName( 255 ) == "IV" );
+}
+
+TEST_CASE( "test_arrow_book" )
+{
+	Excel::Book book( "test/data/test.xls" );
+
+	ArrowSchema schema;
+	ArrowArray array;
+
+	Excel::ArrowExporter::exportSheet( *book.sheet( 0 ), &schema, &array );
+
+	book.clear();
+
+	REQUIRE( std::strcmp( schema.format, "+s" ) == 0 );
+	REQUIRE( std::strcmp( schema.name, "Sheet" ) == 0 );
+	REQUIRE( schema.n_children == 4 );
+	REQUIRE( array.length == 3 );
+	REQUIRE( array.n_children == 4 );
+
+	REQUIRE( std::strcmp( schema.children[ 0 ]->format, "u" ) == 0 );
+	REQUIRE( std::strcmp( schema.children[ 0 ]->name, "A" ) == 0 );
+	REQUIRE( schema.children[ 0 ]->flags == ARROW_FLAG_NULLABLE );
+	REQUIRE( std::strcmp( schema.children[ 1 ]->format, "g" ) == 0 );
+	REQUIRE( std::strcmp( schema.children[ 3 ]->format, "g" ) == 0 );
+
+	const ArrowArray * strings = array.children[ 0 ];
+
+	REQUIRE( strings->length == 3 );
+	REQUIRE( strings->null_count == 0 );
+	REQUIRE( strings->n_buffers == 3 );
+	REQUIRE( stringValue( strings, 0 ) == "String #1" );
+	REQUIRE( stringValue( strings, 2 ) == "String #3" );
+
+	const double * numbers = static_cast< const double* > ( array.children[ 1 ]->buffers[ 1 ] );
+
+	REQUIRE( std::fabs( numbers[ 1 ] - 2.0 ) < 1E-9 );
+
+	const double * formulas = static_cast< const double* > ( array.children[ 3 ]->buffers[ 1 ] );
+
+	REQUIRE( std::fabs( formulas[ 2 ] - 3.3 ) < 1E-9 );
+
+	schema.release( &schema );
+	array.release( &array );
+
+	REQUIRE( schema.release == nullptr );
+	REQUIRE( array.release == nullptr );
+}
+
+TEST_CASE( "test_arrow_nulls_and_mixed" )
+{
+	Excel::Sheet sheet( L"Mixed" );
+
+	sheet.setCell( 0, 0, 1.5 );
+	sheet.setCell( 0, 1, 2.0 );
+	sheet.setCell( 5, 0, L"caf\u00E9" );
+	sheet.setCell( 5, 1, 3.0 );
+
+	ArrowSchema schema;
+	ArrowArray array;
+
+	Excel::ArrowExporter::exportSheet( sheet, &schema, &array );
+
+	REQUIRE( array.length == 6 );
+
+	// Mixed column is utf8.
+	REQUIRE( std::strcmp( schema.children[ 0 ]->format, "u" ) == 0 );
+
+	const ArrowArray * mixed = array.children[ 0 ];
+
+	REQUIRE( mixed->null_count == 4 );
+	REQUIRE( isValid( mixed, 0 ) );
+	REQUIRE( !isValid( mixed, 3 ) );
+	REQUIRE( stringValue( mixed, 0 ) == "1.5" );
+	REQUIRE( stringValue( mixed, 3 ).empty() );
+	REQUIRE( stringValue( mixed, 5 ) == "caf\xC3\xA9" );
+
+	const ArrowArray * numbers = array.children[ 1 ];
+
+	REQUIRE( std::strcmp( schema.children[ 1 ]->format, "g" ) == 0 );
+	REQUIRE( numbers->null_count == 4 );
+	REQUIRE( isValid( numbers, 5 ) );
+	REQUIRE( !isValid( numbers, 1 ) );
+	REQUIRE( static_cast< const double* > ( numbers->buffers[ 1 ] )[ 5 ] == 3.0 );
+
+	// Consumer can move child out and release it separately.
+	ArrowArray moved = *array.children[ 1 ];
+	array.children[ 1 ]->release = nullptr;
+
+	array.release( &array );
+	moved.release( &moved );
+	schema.release( &schema );
+
+	REQUIRE( moved.release == nullptr );
+}
+
+TEST_CASE( "test_arrow_generated" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 300;
+	opts.m_columns = 30;
+	opts.m_stringEvery = 30;
+	opts.m_formulaEvery = 29;
+	opts.m_fractions = true;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	stream.seekg( 0 );
+
+	Excel::Book book( stream );
+	Excel::Sheet * sheet = book.sheet( 0 );
+
+	ArrowSchema schema;
+	ArrowArray array;
+
+	Excel::ArrowExporter::exportSheet( *sheet, &schema, &array );
+
+	REQUIRE( array.n_children == opts.m_columns );
+	REQUIRE( std::strcmp( schema.children[ 26 ]->name, "AA" ) == 0 );
+
+	for( int64_t c = 0; c < array.n_children; ++c )
+	{
+		const ArrowArray * column = array.children[ c ];
+
+		REQUIRE( column->length == opts.m_rows );
+
+		if( std::strcmp( schema.children[ c ]->format, "g" ) == 0 )
+		{
+			const auto expected = sheet->columnAsDoubles( static_cast< size_t > ( c ) );
+			const double * values = static_cast< const double* > ( column->buffers[ 1 ] );
+
+			for( int64_t r = 0; r < column->length; ++r )
+			{
+				if( std::isnan( expected[ r ] ) )
+					REQUIRE( !isValid( column, r ) );
+				else
+					REQUIRE( values[ r ] == expected[ r ] );
+			}
+		}
+	}
+
+	array.release( &array );
+	schema.release( &schema );
+}
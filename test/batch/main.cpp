@@ -0,0 +1,235 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/batch_loader.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <atomic>
+#include <set>
+#include <sstream>
+#include <thread>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Check that books have the same cells.
+void requireSameBooks( const Excel::Book & a, const Excel::Book & b )
+{
+	REQUIRE( a.sheetsCount() == b.sheetsCount() );
+
+	for( size_t s = 0; s < a.sheetsCount(); ++s )
+	{
+		const Excel::Sheet & sa = *a.sheet( s );
+		const Excel::Sheet & sb = *b.sheet( s );
+
+		REQUIRE( sa.sheetName() == sb.sheetName() );
+		REQUIRE( sa.rowsCount() == sb.rowsCount() );
+		REQUIRE( sa.columnsCount() == sb.columnsCount() );
+
+		for( size_t r = 0; r < sa.rowsCount(); ++r )
+		{
+			for( size_t c = 0; c < sa.columnsCount(); ++c )
+			{
+				const Excel::Cell & ca = sa.cell( r, c );
+				const Excel::Cell & cb = sb.cell( r, c );
+
+				REQUIRE( ca.dataType() == cb.dataType() );
+
+				switch( ca.dataType() )
+				{
+					case Excel::Cell::DataType::String :
+						REQUIRE( ca.getString() == cb.getString() );
+						break;
+
+					case Excel::Cell::DataType::Double :
+						REQUIRE( ca.getDouble() == cb.getDouble() );
+						break;
+
+					case Excel::Cell::DataType::Formula :
+						REQUIRE( ca.getFormula().valueType() == cb.getFormula().valueType() );
+						break;
+
+					default :
+						break;
+				}
+			}
+		}
+	}
+}
+
+//! \return Factory of books.
+auto bookFactory()
+{
+	return [] ( size_t ) { return std::make_unique< Excel::Book > (); };
+}
+
+
+TEST_CASE( "test_batch_files" )
+{
+	const std::vector< std::string > files = { "test/data/test.xls",
+		"test/data/sample.xls", "test/data/no-such-file.xls",
+		"test/data/datetime.xls", "test/data/stringformula.xls" };
+
+	Excel::BatchLoader loader( 2 );
+
+	REQUIRE( loader.threadsCount() == 2 );
+
+	const auto results = loader.load( files, bookFactory() );
+
+	REQUIRE( results.size() == files.size() );
+
+	for( size_t i = 0; i < files.size(); ++i )
+	{
+		CAPTURE( files[ i ] );
+
+		if( i == 2 )
+		{
+			REQUIRE( !results[ i ].ok() );
+			REQUIRE( !results[ i ].m_error.empty() );
+		}
+		else
+		{
+			REQUIRE( results[ i ].ok() );
+			REQUIRE( results[ i ].m_error.empty() );
+
+			Excel::Book book( files[ i ] );
+
+			requireSameBooks( *results[ i ].m_storage, book );
+		}
+	}
+
+	// Pool is reused by the next batch.
+	const auto second = loader.load( std::vector< std::string > ( 10, files[ 0 ] ),
+		bookFactory() );
+
+	REQUIRE( second.size() == 10 );
+
+	for( const auto & r : second )
+	{
+		REQUIRE( r.ok() );
+		REQUIRE( r.m_storage->sheet( 0 )->cell( 0, 0 ).getString() == L"String #1" );
+	}
+
+	REQUIRE( loader.load( std::vector< std::string > (), bookFactory() ).empty() );
+}
+
+TEST_CASE( "test_batch_streams" )
+{
+	const size_t count = 40;
+
+	std::vector< std::unique_ptr< std::stringstream > > data;
+	std::vector< std::istream* > streams;
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		GeneratorOptions opts;
+		opts.m_rows = 20 + i * 13;
+		opts.m_columns = 1 + i % 9;
+		opts.m_sheets = 1 + i % 3;
+		opts.m_sstSize = i % 4 ? 10 : 0;
+		opts.m_stringEvery = opts.m_sstSize ? 3 : 0;
+		opts.m_formulaEvery = i % 5;
+		opts.m_formulaStringEvery = i % 2;
+		opts.m_fractions = ( i % 2 == 0 );
+
+		data.push_back( std::make_unique< std::stringstream > (
+			std::ios::in | std::ios::out | std::ios::binary ) );
+
+		if( i == 17 )
+			*data.back() << "This is not a compound file, but it's long enough to be read as it.";
+		else
+			generateWorkbook( opts, *data.back() );
+
+		streams.push_back( data.back().get() );
+	}
+
+	streams.push_back( nullptr );
+
+	std::mutex mutex;
+	std::set< std::thread::id > threads;
+
+	Excel::BatchLoader loader( 4 );
+
+	const auto results = loader.load( streams, [&] ( size_t )
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+
+			threads.insert( std::this_thread::get_id() );
+
+			return std::make_unique< Excel::Book > ();
+		} );
+
+	REQUIRE( results.size() == count + 1 );
+	REQUIRE( threads.size() <= 4 );
+	REQUIRE( threads.count( std::this_thread::get_id() ) == 0 );
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		CAPTURE( i );
+
+		if( i == 17 )
+		{
+			REQUIRE( !results[ i ].ok() );
+			REQUIRE( !results[ i ].m_error.empty() );
+
+			continue;
+		}
+
+		REQUIRE( results[ i ].ok() );
+
+		data[ i ]->clear();
+		data[ i ]->seekg( 0 );
+
+		Excel::Book book( *data[ i ] );
+
+		requireSameBooks( *results[ i ].m_storage, book );
+	}
+
+	REQUIRE( !results[ count ].ok() );
+}
+
+TEST_CASE( "test_batch_factory_errors" )
+{
+	Excel::BatchLoader loader;
+
+	REQUIRE( loader.threadsCount() >= 1 );
+
+	const std::vector< std::string > files( 6, "test/data/test.xls" );
+
+	const auto results = loader.load( files, [] ( size_t i ) -> std::unique_ptr< Excel::Book >
+		{
+			if( i == 1 )
+				throw std::runtime_error( "factory failed" );
+			else if( i == 3 )
+				return nullptr;
+
+			return std::make_unique< Excel::Book > ();
+		} );
+
+	REQUIRE( results[ 0 ].ok() );
+	REQUIRE( results[ 1 ].m_error == L"factory failed" );
+	REQUIRE( !results[ 3 ].ok() );
+	REQUIRE( !results[ 3 ].m_error.empty() );
+	REQUIRE( results[ 5 ].ok() );
+
+	// Plain tasks.
+	std::vector< std::atomic< int > > done( 1000 );
+
+	for( auto & d : done )
+		d = 0;
+
+	loader.run( done.size(), [&] ( size_t i ) { ++done[ i ]; } );
+
+	for( const auto & d : done )
+		REQUIRE( d == 1 );
+}
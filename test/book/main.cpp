@@ -9,6 +9,7 @@
 
 // C++ include.
 #include <cmath>
+#include <cstddef>
 
 // unit test helper.
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -97,6 +98,153 @@ TEST_CASE( "test_book_empty_storage" )
 	Excel::Parser::loadBook( fileStream, emptyStorage );
 }
 
+TEST_CASE( "test_book_preloaded" )
+{
+	Excel::Book expected( "test/data/big.xls" );
+
+	CompoundFile::File file( "test/data/big.xls" );
+	file.setPreload();
+
+	Excel::Book book;
+	Excel::Parser::loadBook( file, book );
+
+	REQUIRE( book.sheetsCount() == expected.sheetsCount() );
+
+	Excel::Sheet * sheet = book.sheet( 0 );
+	Excel::Sheet * expectedSheet = expected.sheet( 0 );
+
+	REQUIRE( sheet->rowsCount() == expectedSheet->rowsCount() );
+	REQUIRE( sheet->columnsCount() == expectedSheet->columnsCount() );
+
+	for( size_t row = 0; row < sheet->rowsCount(); ++row )
+	{
+		for( size_t column = 0; column < sheet->columnsCount(); ++column )
+		{
+			REQUIRE( sheet->cell( row, column ).dataType() ==
+				expectedSheet->cell( row, column ).dataType() );
+			REQUIRE( sheet->cell( row, column ).getDouble() ==
+				expectedSheet->cell( row, column ).getDouble() );
+		}
+	}
+}
+
+//
+// CountingResource
+//
+
+//! Resource that counts allocations of cells and strings and forwards
+//! to upstream.
+class CountingResource final
+	:	public Excel::MemoryResource
+{
+public:
+	explicit CountingResource( Excel::MemoryResource * upstream )
+		:	m_upstream( upstream )
+		,	m_cellsAllocations( 0 )
+		,	m_stringsAllocations( 0 )
+	{
+	}
+
+	//! Upstream.
+	Excel::MemoryResource * m_upstream;
+	//! Count of allocations of cells.
+	size_t m_cellsAllocations;
+	//! Count of allocations of characters.
+	size_t m_stringsAllocations;
+
+protected:
+	void * doAllocate( size_t bytes, size_t alignment ) override
+	{
+		if( alignment == alignof( Excel::Cell ) && bytes % sizeof( Excel::Cell ) == 0 )
+			++m_cellsAllocations;
+		else if( alignment == alignof( Excel::Char ) )
+			++m_stringsAllocations;
+
+		return m_upstream->allocate( bytes, alignment );
+	}
+
+	void doDeallocate( void * p, size_t bytes, size_t alignment ) override
+	{
+		m_upstream->deallocate( p, bytes, alignment );
+	}
+}; // class CountingResource
+
+TEST_CASE( "test_book_in_arena" )
+{
+	Excel::Book expected( "test/data/big.xls" );
+
+	Excel::MonotonicArena arena( 1024 );
+	CountingResource counter( &arena );
+
+	{
+		Excel::Book book( "test/data/big.xls", &counter );
+
+		REQUIRE( book.resource() == &counter );
+		REQUIRE( arena.capacity() > 0 );
+		REQUIRE( book.sheetsCount() == expected.sheetsCount() );
+
+		Excel::Sheet * sheet = book.sheet( 0 );
+		Excel::Sheet * expectedSheet = expected.sheet( 0 );
+
+		REQUIRE( sheet->rowsCount() == expectedSheet->rowsCount() );
+		REQUIRE( sheet->columnsCount() == expectedSheet->columnsCount() );
+
+		// Every row has cells allocated from the resource.
+		REQUIRE( counter.m_cellsAllocations >= sheet->rowsCount() );
+
+		for( size_t row = 0; row < sheet->rowsCount(); ++row )
+		{
+			for( size_t column = 0; column < sheet->columnsCount(); ++column )
+			{
+				const auto & cell = sheet->cell( row, column );
+				const auto & expectedCell = expectedSheet->cell( row, column );
+
+				REQUIRE( cell.dataType() == expectedCell.dataType() );
+				REQUIRE( cell.getDouble() == expectedCell.getDouble() );
+				REQUIRE( cell.getString() == expectedCell.getString() );
+			}
+		}
+	}
+
+	arena.release();
+
+	REQUIRE( arena.capacity() == 0 );
+}
+
+TEST_CASE( "test_book_sst_in_arena" )
+{
+	Excel::MonotonicArena arena( 1024 );
+	CountingResource counter( &arena );
+
+	{
+		Excel::Book book( "test/data/test.xls", &counter );
+
+		REQUIRE( book.sheet( 0 )->cell( 0, 0 ).getString() == L"String #1" );
+
+		// Strings of SST are longer than small string buffer.
+		REQUIRE( counter.m_stringsAllocations >= 3 );
+	}
+}
+
+TEST_CASE( "test_arena_alignment" )
+{
+	Excel::MonotonicArena arena( 64 );
+
+	for( size_t alignment = 1; alignment <= 64; alignment *= 2 )
+	{
+		arena.allocate( 1, 1 );
+
+		void * p = arena.allocate( 3, alignment );
+
+		REQUIRE( reinterpret_cast< uintptr_t > ( p ) % alignment == 0 );
+	}
+
+	void * big = arena.allocate( 4096 );
+
+	REQUIRE( big != nullptr );
+	REQUIRE( arena.capacity() >= 4096 );
+}
+
 TEST_CASE( "test_very_small_book" )
 {
 	Excel::Book book( "test/data/MiscOperatorTests.xls" );
@@ -0,0 +1,223 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/cancellation.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <thread>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Storage that counts calls and stops after given count of cells.
+struct CountingStorage
+	:	public Excel::EmptyStorage
+{
+	//! Count of cells to stop after.
+	size_t m_stopAfter = static_cast< size_t > ( -1 );
+	//! Stop after the first row.
+	bool m_firstRowOnly = false;
+	//! Count of cells.
+	size_t m_cells = 0;
+	//! Count of SST strings.
+	size_t m_strings = 0;
+	//! Count of sheets.
+	size_t m_sheets = 0;
+	//! Count of finished sheets.
+	size_t m_finishedSheets = 0;
+	//! Maximum row.
+	size_t m_maxRow = 0;
+
+protected:
+	bool isCancelled() const override
+	{
+		return ( m_cells >= m_stopAfter || ( m_firstRowOnly && m_maxRow > 0 ) );
+	}
+
+	void onSharedString( size_t, size_t, const Excel::String & ) override
+	{
+		++m_strings;
+	}
+
+	void onSheet( size_t, const Excel::String & ) override
+	{
+		++m_sheets;
+	}
+
+	void onSheetEnd( size_t ) override
+	{
+		++m_finishedSheets;
+	}
+
+	void onCellSharedString( size_t, size_t row, size_t, size_t ) override
+	{
+		cell( row );
+	}
+
+	void onCell( size_t, size_t row, size_t, const Excel::String & ) override
+	{
+		cell( row );
+	}
+
+	void onCell( size_t, size_t row, size_t, double ) override
+	{
+		cell( row );
+	}
+
+	void onCell( size_t, const Excel::Formula & f ) override
+	{
+		cell( f.getRow() );
+	}
+
+private:
+	void cell( size_t row )
+	{
+		++m_cells;
+		m_maxRow = std::max( m_maxRow, row );
+	}
+}; // struct CountingStorage
+
+//! \return Options of the generated workbook.
+GeneratorOptions options( int32_t sheets, int32_t sst )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 2000;
+	opts.m_columns = 10;
+	opts.m_sheets = sheets;
+	opts.m_sstSize = sst;
+	opts.m_stringEvery = 3;
+	opts.m_formulaEvery = 5;
+
+	return opts;
+}
+
+
+TEST_CASE( "test_cancel_cells" )
+{
+	const std::string data = generate( options( 3, 100 ) );
+
+	CountingStorage full;
+	load( data, full );
+
+	REQUIRE( full.m_cells == 3 * 2000 * 10 );
+	REQUIRE( full.m_finishedSheets == 3 );
+
+	for( const bool pipelined : { false, true } )
+	{
+		CAPTURE( pipelined );
+
+		CountingStorage storage;
+		storage.m_stopAfter = 100;
+
+		load( data, storage, false, pipelined );
+
+		// MULRK gives several cells at once.
+		REQUIRE( storage.m_cells >= 100 );
+		REQUIRE( storage.m_cells < 100 + 10 );
+		REQUIRE( storage.m_sheets == 1 );
+		REQUIRE( storage.m_finishedSheets == 0 );
+	}
+
+	// Records after the last cell are not read, so the sheet isn't finished
+	// and the second sheet is not started.
+	CountingStorage oneSheet;
+	oneSheet.m_stopAfter = 2000 * 10;
+
+	load( data, oneSheet );
+
+	REQUIRE( oneSheet.m_cells == 2000 * 10 );
+	REQUIRE( oneSheet.m_sheets == 1 );
+	REQUIRE( oneSheet.m_finishedSheets == 0 );
+}
+
+TEST_CASE( "test_cancel_first_row" )
+{
+	const std::string data = generate( options( 2, 10 ) );
+
+	CountingStorage storage;
+	storage.m_firstRowOnly = true;
+
+	load( data, storage );
+
+	REQUIRE( storage.m_maxRow == 1 );
+	REQUIRE( storage.m_cells <= 10 + 10 );
+	REQUIRE( storage.m_sheets == 1 );
+}
+
+TEST_CASE( "test_cancel_sst" )
+{
+	const std::string data = generate( options( 1, 20000 ) );
+
+	CountingStorage full;
+	load( data, full );
+
+	REQUIRE( full.m_strings == 20000 );
+
+	// Already cancelled.
+	CountingStorage storage;
+	storage.m_stopAfter = 0;
+
+	load( data, storage );
+
+	REQUIRE( storage.m_strings == 0 );
+	REQUIRE( storage.m_sheets == 0 );
+	REQUIRE( storage.m_cells == 0 );
+}
+
+TEST_CASE( "test_cancel_book" )
+{
+	const std::string data = generate( options( 3, 100 ) );
+
+	Excel::CancellationToken token;
+
+	// Cancelled before loading.
+	{
+		token.cancel();
+
+		Excel::Book book;
+		book.setCancellationToken( &token );
+
+		load( data, book );
+
+		REQUIRE( book.sheetsCount() == 0 );
+	}
+
+	// Not cancelled.
+	{
+		token.reset();
+
+		Excel::Book book;
+		book.setCancellationToken( &token );
+
+		load( data, book );
+
+		REQUIRE( book.sheetsCount() == 3 );
+		REQUIRE( book.sheet( 2 )->rowsCount() == 2000 );
+	}
+
+	// Cancelled from another thread, the load ends without error.
+	{
+		token.reset();
+
+		Excel::Book book;
+		book.setCancellationToken( &token );
+
+		std::thread canceller( [&token] () { token.cancel(); } );
+
+		load( data, book, false, true );
+
+		canceller.join();
+
+		REQUIRE( book.sheetsCount() <= 3 );
+	}
+}
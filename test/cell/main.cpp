@@ -33,3 +33,25 @@ TEST_CASE( "test_cell" )
 	REQUIRE( cell.getString() == L"qwerty" );
 
 }
+
+TEST_CASE( "test_cell_move" )
+{
+	Excel::Cell cell;
+
+	std::wstring str( 100, L'x' );
+	const wchar_t * data = str.data();
+
+	cell.setData( std::move( str ) );
+
+	REQUIRE( cell.dataType() == Excel::Cell::DataType::String );
+	REQUIRE( cell.getString().data() == data );
+
+	Excel::Formula formula;
+	formula.setString( std::wstring( 100, L'y' ) );
+	data = formula.getString().data();
+
+	cell.setData( std::move( formula ) );
+
+	REQUIRE( cell.dataType() == Excel::Cell::DataType::Formula );
+	REQUIRE( cell.getFormula().getString().data() == data );
+}
@@ -0,0 +1,119 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/column_storage.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <cmath>
+#include <sstream>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+TEST_CASE( "test_sheet_columns" )
+{
+	Excel::Book book( "test/data/test.xls" );
+
+	Excel::Sheet * sheet = book.sheet( 0 );
+
+	const auto strings = sheet->columnAsStrings( 0 );
+
+	REQUIRE( strings.size() == 3 );
+	REQUIRE( strings[ 0 ] == L"String #1" );
+	REQUIRE( strings[ 2 ] == L"String #3" );
+
+	const auto numbers = sheet->columnAsDoubles( 1 );
+
+	REQUIRE( numbers.size() == 3 );
+	REQUIRE( std::fabs( numbers[ 0 ] - 1.0 ) < 1E-9 );
+	REQUIRE( std::fabs( numbers[ 2 ] - 3.0 ) < 1E-9 );
+
+	// Strings are missing in numbers.
+	const auto missing = sheet->columnAsDoubles( 0, -1.0 );
+
+	REQUIRE( missing == std::vector< double > ( 3, -1.0 ) );
+	REQUIRE( std::isnan( sheet->columnAsDoubles( 0 )[ 1 ] ) );
+
+	// Numeric formulas.
+	const auto formulas = sheet->columnAsDoubles( 3 );
+
+	REQUIRE( std::fabs( formulas[ 1 ] - 2.2 ) < 1E-9 );
+
+	// Column out of the sheet.
+	REQUIRE( sheet->columnAsStrings( 100 ) == std::vector< std::wstring > ( 3 ) );
+}
+
+TEST_CASE( "test_column_storage" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 200;
+	opts.m_columns = 12;
+	opts.m_sheets = 2;
+	opts.m_stringEvery = 5;
+	opts.m_formulaEvery = 7;
+	opts.m_mulrkPercent = 50;
+	opts.m_fractions = true;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	stream.seekg( 0 );
+	Excel::Book book( stream );
+
+	stream.clear();
+	stream.seekg( 0 );
+	Excel::ColumnStorage all;
+	Excel::Parser::loadBook( stream, all );
+
+	stream.clear();
+	stream.seekg( 0 );
+	Excel::ColumnStorage some( { 3 }, -1.0 );
+	Excel::Parser::loadBook( stream, some );
+
+	REQUIRE( all.sheetsCount() == book.sheetsCount() );
+
+	for( size_t s = 0; s < book.sheetsCount(); ++s )
+	{
+		Excel::Sheet * sheet = book.sheet( s );
+
+		REQUIRE( all.sheetName( s ) == sheet->sheetName() );
+		REQUIRE( all.rowsCount( s ) == sheet->rowsCount() );
+
+		for( size_t c = 0; c < sheet->columnsCount(); ++c )
+		{
+			const auto expected = sheet->columnAsDoubles( c );
+			const auto & column = all.column( s, c );
+
+			REQUIRE( column.size() == expected.size() );
+
+			for( size_t r = 0; r < expected.size(); ++r )
+			{
+				if( std::isnan( expected[ r ] ) )
+					REQUIRE( std::isnan( column[ r ] ) );
+				else
+					REQUIRE( column[ r ] == expected[ r ] );
+			}
+		}
+
+		REQUIRE( some.columnsCount( s ) == 4 );
+
+		const auto & selected = some.column( s, 3 );
+		const auto expected = sheet->columnAsDoubles( 3, -1.0 );
+
+		REQUIRE( selected == expected );
+		REQUIRE( some.column( s, 2 ) == std::vector< double > ( opts.m_rows, -1.0 ) );
+	}
+
+	REQUIRE_THROWS_AS( all.rowsCount( 5 ), Excel::Exception );
+}
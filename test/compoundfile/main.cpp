@@ -8,6 +8,11 @@
 #include <read-excel/compoundfile/compoundfile.hpp>
 #include <read-excel/compoundfile/compoundfile_exceptions.hpp>
 
+// C++ include.
+#include <thread>
+#include <vector>
+#include <atomic>
+
 // unit test helper.
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <test/doctest/doctest.h>
@@ -139,3 +144,251 @@ TEST_CASE( "test_stream_name" )
 
 	REQUIRE( stream->getByte() == (char) 0x01 );
 }
+
+
+//
+// readAll
+//
+
+std::vector< char >
+readAll( Excel::Stream & stream, int32_t size )
+{
+	std::vector< char > data;
+	data.reserve( size );
+
+	for( int32_t i = 0; i < size; ++i )
+		data.push_back( stream.getByte() );
+
+	return data;
+}
+
+
+//
+// test_concurrent_streams
+//
+
+TEST_CASE( "test_concurrent_streams" )
+{
+	CompoundFile::File file( "./test/data/big.xls" );
+
+	const CompoundFile::Directory dir = file.directory( L"Workbook" );
+
+	std::vector< char > expected;
+
+	{
+		std::unique_ptr< Excel::Stream > stream( file.stream( dir ) );
+
+		expected = readAll( *stream, dir.streamSize() );
+	}
+
+	const size_t threadsCount = 4;
+
+	std::vector< std::unique_ptr< Excel::Stream > > streams;
+	std::vector< std::vector< char > > results( threadsCount );
+	std::vector< std::thread > threads;
+
+	for( size_t i = 0; i < threadsCount; ++i )
+		streams.push_back( file.stream( dir ) );
+
+	for( size_t i = 0; i < threadsCount; ++i )
+	{
+		threads.emplace_back( [&, i] () {
+			results[ i ] = readAll( *streams[ i ], dir.streamSize() );
+		} );
+	}
+
+	for( auto & t : threads )
+		t.join();
+
+	for( size_t i = 0; i < threadsCount; ++i )
+		REQUIRE( results[ i ] == expected );
+}
+
+
+//
+// test_read_ahead
+//
+
+TEST_CASE( "test_read_ahead" )
+{
+	CompoundFile::File file( "./test/data/big.xls" );
+
+	const CompoundFile::Directory dir = file.directory( L"Workbook" );
+
+	std::unique_ptr< Excel::Stream > stream( file.stream( dir ) );
+
+	const std::vector< char > expected = readAll( *stream, dir.streamSize() );
+
+	REQUIRE( file.readAhead() == 0 );
+
+	file.setReadAhead( 16 );
+
+	REQUIRE( file.readAhead() == 16 );
+
+	std::unique_ptr< Excel::Stream > readAheadStream( file.stream( dir ) );
+
+	REQUIRE( readAll( *readAheadStream, dir.streamSize() ) == expected );
+
+	readAheadStream->seek( 100000, Excel::Stream::FromBeginning );
+	stream->seek( 100000, Excel::Stream::FromBeginning );
+
+	REQUIRE( readAll( *readAheadStream, 10000 ) == readAll( *stream, 10000 ) );
+}
+
+
+//
+// test_preload
+//
+
+TEST_CASE( "test_preload" )
+{
+	CompoundFile::File file( "./test/data/big.xls" );
+
+	const CompoundFile::Directory dir = file.directory( L"Workbook" );
+
+	std::unique_ptr< Excel::Stream > stream( file.stream( dir ) );
+
+	const std::vector< char > expected = readAll( *stream, dir.streamSize() );
+
+	REQUIRE( !file.preload() );
+
+	file.setPreload();
+
+	REQUIRE( file.preload() );
+
+	std::unique_ptr< Excel::Stream > preloaded( file.stream( dir ) );
+
+	REQUIRE( static_cast< CompoundFile::Stream* > ( preloaded.get() )->isPreloaded() );
+
+	REQUIRE( readAll( *preloaded, dir.streamSize() ) == expected );
+
+	preloaded->seek( 100000, Excel::Stream::FromBeginning );
+	stream->seek( 100000, Excel::Stream::FromBeginning );
+
+	REQUIRE( readAll( *preloaded, 10000 ) == readAll( *stream, 10000 ) );
+
+	preloaded->seek( -20000, Excel::Stream::FromCurrent );
+	stream->seek( -20000, Excel::Stream::FromCurrent );
+
+	REQUIRE( readAll( *preloaded, 10000 ) == readAll( *stream, 10000 ) );
+}
+
+
+//
+// test_batch_read
+//
+
+TEST_CASE( "test_batch_read" )
+{
+	std::ifstream fileStream( "./test/data/big.xls", std::ios::in | std::ios::binary );
+	CompoundFile::IStreamReader streamReader( fileStream );
+	CompoundFile::FileReader fileReader( "./test/data/big.xls" );
+
+	REQUIRE( fileReader.isOpen() );
+
+	const size_t size = 512;
+	const size_t count = 64;
+
+	std::vector< char > expected( size * count );
+	std::vector< char > data( size * count );
+	std::vector< CompoundFile::ReadRequest > requests;
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		const uint64_t offset = ( ( i * 37 ) % count ) * size;
+
+		REQUIRE( streamReader.read( offset, &expected[ i * size ], size ) == size );
+
+		requests.push_back( { offset, &data[ i * size ], size } );
+	}
+
+	REQUIRE( fileReader.read( requests ) == size * count );
+	REQUIRE( data == expected );
+}
+
+
+//
+// test_read_pool
+//
+
+TEST_CASE( "test_read_pool" )
+{
+	CompoundFile::ReadPool pool( 3 );
+
+	REQUIRE( pool.threadsCount() == 3 );
+
+	const size_t count = 1000;
+
+	// Every index runs once, concurrent batches don't wait for each other.
+	std::vector< std::thread > callers;
+	std::vector< std::vector< std::atomic< int > > > hits( 4 );
+
+	for( auto & h : hits )
+		h = std::vector< std::atomic< int > > ( count );
+
+	for( size_t c = 0; c < hits.size(); ++c )
+	{
+		callers.emplace_back( [&pool, &hits, c] ()
+			{
+				for( int batch = 0; batch < 20; ++batch )
+					pool.run( count, [&hits, c] ( size_t i ) { ++hits[ c ][ i ]; } );
+			} );
+	}
+
+	for( auto & t : callers )
+		t.join();
+
+	for( const auto & h : hits )
+	{
+		for( const auto & v : h )
+			REQUIRE( v == 20 );
+	}
+}
+
+
+//
+// test_read_stream_fully
+//
+
+TEST_CASE( "test_read_stream_fully" )
+{
+	CompoundFile::File file( "./test/data/test.xls" );
+
+	const wchar_t summary[] = {
+		0x05, 0x53, 0x75, 0x6D, 0x6D, 0x61, 0x72, 0x79,
+		0x49, 0x6E, 0x66, 0x6F, 0x72, 0x6D, 0x61, 0x74,
+		0x69, 0x6F, 0x6E, 0x00
+	};
+
+	for( const auto & name : { std::wstring( L"Workbook" ), std::wstring( summary ) } )
+	{
+		const CompoundFile::Directory dir = file.directory( name );
+
+		std::unique_ptr< Excel::Stream > stream( file.stream( dir ) );
+
+		const std::vector< char > data = file.readStreamFully( dir );
+
+		REQUIRE( data.size() == static_cast< size_t > ( dir.streamSize() ) );
+		REQUIRE( data == readAll( *stream, dir.streamSize() ) );
+
+		Excel::MemoryStream memory( data.data(), static_cast< int32_t > ( data.size() ),
+			file.byteOrder() );
+
+		stream->seek( 0, Excel::Stream::FromBeginning );
+
+		REQUIRE( readAll( memory, dir.streamSize() ) == readAll( *stream, dir.streamSize() ) );
+
+		REQUIRE( memory.getByte() == stream->getByte() );
+		REQUIRE( memory.pos() == stream->pos() );
+
+		memory.seek( 128, Excel::Stream::FromEnd );
+		stream->seek( 128, Excel::Stream::FromEnd );
+
+		std::vector< char > fromMemory( 200, 0 );
+		std::vector< char > fromStream( 200, 0 );
+
+		REQUIRE( memory.readBytes( &fromMemory[ 0 ], 200 ) == 128 );
+		REQUIRE( stream->readBytes( &fromStream[ 0 ], 200 ) == 128 );
+		REQUIRE( fromMemory == fromStream );
+	}
+}
@@ -0,0 +1,329 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/csv_storage.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <map>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! \return Field of the cell as CsvStorage writes it.
+std::string cellToCsv( const Excel::Cell & cell )
+{
+	switch( cell.dataType() )
+	{
+		case Excel::Cell::DataType::String :
+			return Excel::Utf8::fromString( cell.getString() );
+
+		case Excel::Cell::DataType::Double :
+			return Excel::formatNumber( cell.getDouble() );
+
+		case Excel::Cell::DataType::Formula :
+		{
+			const Excel::Formula & f = cell.getFormula();
+
+			switch( f.valueType() )
+			{
+				case Excel::Formula::DoubleValue :
+					return Excel::formatNumber( f.getDouble() );
+
+				case Excel::Formula::BooleanValue :
+					return ( f.getBoolean() ? "TRUE" : "FALSE" );
+
+				case Excel::Formula::ErrorValue :
+					return Excel::formatError( f.getErrorValue() );
+
+				case Excel::Formula::StringValue :
+					return Excel::Utf8::fromString( f.getString() );
+
+				default :
+					return std::string();
+			}
+		}
+
+		default :
+			return std::string();
+	}
+}
+
+//! \return CSV of the sheet made from Book.
+std::string sheetToCsv( const Excel::Sheet & sheet, char delimiter = ',' )
+{
+	std::string csv;
+
+	for( size_t row = 0; row < sheet.rowsCount(); ++row )
+	{
+		size_t columns = sheet.columnsCount();
+
+		while( columns > 0 &&
+			sheet.cell( row, columns - 1 ).dataType() == Excel::Cell::DataType::Unknown )
+				--columns;
+
+		for( size_t column = 0; column < columns; ++column )
+		{
+			if( column )
+				csv.push_back( delimiter );
+
+			Excel::CsvStorage::appendField( csv, cellToCsv( sheet.cell( row, column ) ),
+				delimiter );
+		}
+
+		csv.push_back( '\n' );
+	}
+
+	return csv;
+}
+
+//! \return CSV of all sheets of the book.
+std::map< size_t, std::string > loadCsv( std::istream & stream, char delimiter = ',' )
+{
+	std::map< size_t, std::ostringstream > out;
+
+	Excel::CsvStorage storage( [&] ( size_t idx, const Excel::String & ) -> std::ostream*
+		{ return &out[ idx ]; }, delimiter );
+
+	Excel::Parser::loadBook( stream, storage );
+
+	std::map< size_t, std::string > res;
+
+	for( const auto & s : out )
+		res[ s.first ] = s.second.str();
+
+	return res;
+}
+
+
+TEST_CASE( "test_csv_quoting" )
+{
+	std::string line;
+
+	Excel::CsvStorage::appendField( line, "plain", ',' );
+	REQUIRE( line == "plain" );
+
+	line.clear();
+	Excel::CsvStorage::appendField( line, "a,b", ',' );
+	REQUIRE( line == "\"a,b\"" );
+
+	line.clear();
+	Excel::CsvStorage::appendField( line, "say \"hi\"", ',' );
+	REQUIRE( line == "\"say \"\"hi\"\"\"" );
+
+	line.clear();
+	Excel::CsvStorage::appendField( line, "two\nlines", ',' );
+	REQUIRE( line == "\"two\nlines\"" );
+
+	line.clear();
+	Excel::CsvStorage::appendField( line, "cr\r", ',' );
+	REQUIRE( line == "\"cr\r\"" );
+
+	// Comma isn't special with other delimiter.
+	line.clear();
+	Excel::CsvStorage::appendField( line, "a,b", ';' );
+	REQUIRE( line == "a,b" );
+
+	line.clear();
+	Excel::CsvStorage::appendField( line, "a;b", ';' );
+	REQUIRE( line == "\"a;b\"" );
+}
+
+TEST_CASE( "test_format_number" )
+{
+	auto printf = [] ( double value ) -> std::string
+	{
+		char buf[ 32 ];
+
+		std::snprintf( buf, sizeof( buf ), "%.15g", value );
+
+		if( std::strtod( buf, nullptr ) != value )
+			std::snprintf( buf, sizeof( buf ), "%.17g", value );
+
+		return buf;
+	};
+
+	for( const double value : { 0.0, -0.0, 1.0, -1.0, 0.5, 2.2, 0.1, 0.3, -123.456,
+		1E-4, 9.99E-5, 0.000123, 123456789012345.0, 1E15, 1E16, 1E300, 1.0 / 3.0,
+		0.1 + 0.2, 65536.5, 3.14159265358979 } )
+	{
+		CAPTURE( value );
+
+		REQUIRE( Excel::formatNumber( value ) == printf( value ) );
+	}
+
+	for( int i = -100000; i < 100000; i += 7 )
+	{
+		for( const double scale : { 1.0, 10.0, 100.0, 1000.0, 1E6, 1E7 } )
+			REQUIRE( Excel::formatNumber( i / scale ) == printf( i / scale ) );
+	}
+
+	REQUIRE( Excel::formatError( Excel::Formula::DivZero ) == "#DIV/0!" );
+	REQUIRE( Excel::formatError( Excel::Formula::NA ) == "#N/A" );
+}
+
+TEST_CASE( "test_csv_files" )
+{
+	for( const char * file : { "test/data/test.xls", "test/data/sample.xls",
+		"test/data/stringformula.xls", "test/data/datetime.xls" } )
+	{
+		CAPTURE( file );
+
+		Excel::Book book( file );
+
+		std::ifstream stream( file, std::ios::in | std::ios::binary );
+
+		const auto csv = loadCsv( stream );
+
+		REQUIRE( csv.size() == book.sheetsCount() );
+
+		for( size_t i = 0; i < book.sheetsCount(); ++i )
+			REQUIRE( csv.at( i ) == sheetToCsv( *book.sheet( i ) ) );
+	}
+}
+
+TEST_CASE( "test_csv_generated" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 300;
+	opts.m_columns = 10;
+	opts.m_sheets = 3;
+	opts.m_sstSize = 50;
+	opts.m_stringEvery = 4;
+	opts.m_wideStrings = true;
+	opts.m_formulaEvery = 6;
+	opts.m_formulaStringEvery = 2;
+	opts.m_mulrkPercent = 50;
+	opts.m_fractions = true;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	stream.seekg( 0 );
+	Excel::Book book( stream );
+
+	stream.clear();
+	stream.seekg( 0 );
+	const auto csv = loadCsv( stream, ';' );
+
+	REQUIRE( csv.size() == 3 );
+
+	for( size_t i = 0; i < book.sheetsCount(); ++i )
+	{
+		REQUIRE( csv.at( i ) == sheetToCsv( *book.sheet( i ), ';' ) );
+		REQUIRE( std::count( csv.at( i ).cbegin(), csv.at( i ).cend(), '\n' ) == 300 );
+	}
+
+	// Skipped sheets.
+	stream.clear();
+	stream.seekg( 0 );
+
+	std::ostringstream second;
+
+	Excel::CsvStorage storage( [&] ( size_t idx, const Excel::String & ) -> std::ostream*
+		{ return ( idx == 1 ? &second : nullptr ); } );
+
+	Excel::Parser::loadBook( stream, storage );
+
+	REQUIRE( second.str() == sheetToCsv( *book.sheet( 1 ) ) );
+}
+
+TEST_CASE( "test_csv_rows_above_32767" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 40000;
+	opts.m_columns = 3;
+	opts.m_formulaEvery = 2;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	stream.seekg( 0 );
+	Excel::Book book( stream );
+
+	REQUIRE( book.sheet( 0 )->rowsCount() == 40000 );
+	REQUIRE( book.sheet( 0 )->cell( 39999, 2 ).dataType() != Excel::Cell::DataType::Unknown );
+
+	stream.clear();
+	stream.seekg( 0 );
+	const auto csv = loadCsv( stream );
+
+	REQUIRE( csv.at( 0 ) == sheetToCsv( *book.sheet( 0 ) ) );
+}
+
+TEST_CASE( "test_csv_parallel_sheets" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 500;
+	opts.m_columns = 8;
+	opts.m_sheets = 4;
+	opts.m_sstSize = 20;
+	opts.m_stringEvery = 3;
+	opts.m_formulaEvery = 5;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	stream.seekg( 0 );
+	const auto expected = loadCsv( stream );
+
+	stream.clear();
+	stream.seekg( 0 );
+	CompoundFile::File file( stream );
+
+	const auto dir = file.directory( L"Workbook" );
+
+	std::vector< Excel::BoundSheet > boundSheets;
+
+	Excel::CsvStorage globals( [] ( size_t, const Excel::String & ) -> std::ostream*
+		{ return nullptr; } );
+
+	{
+		auto s = file.stream( dir );
+
+		Excel::Parser::loadGlobals( boundSheets, *s, globals );
+	}
+
+	REQUIRE( boundSheets.size() == 4 );
+	REQUIRE( globals.sharedStrings()->size() == 20 );
+
+	std::vector< std::ostringstream > out( boundSheets.size() );
+	std::vector< std::thread > threads;
+
+	for( size_t i = 0; i < boundSheets.size(); ++i )
+	{
+		threads.emplace_back( [&, i] ()
+			{
+				Excel::CsvStorage storage( [&] ( size_t, const Excel::String & ) -> std::ostream*
+					{ return &out[ i ]; }, globals.sharedStrings() );
+
+				auto s = file.stream( dir );
+
+				Excel::Parser::loadWorkSheet( i, boundSheets[ i ], *s, storage );
+			} );
+	}
+
+	for( auto & t : threads )
+		t.join();
+
+	for( size_t i = 0; i < boundSheets.size(); ++i )
+		REQUIRE( out[ i ].str() == expected.at( i ) );
+}
@@ -8,6 +8,7 @@
 #include <read-excel/formula.hpp>
 #include <read-excel/record.hpp>
 #include <read-excel/string.hpp>
+#include <read-excel/parser.hpp>
 
 // unit test helper.
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -154,3 +155,26 @@ TEST_CASE( "test_formula" )
 		REQUIRE( formula.getBoolean() == false );
 	}
 }
+
+struct MoveFormulaStorage : public Excel::EmptyStorage {
+	Excel::Formula m_formula;
+	void onCell( size_t, const Excel::Formula & ) override { FAIL( "" ); }
+	void onCell( size_t, Excel::Formula && value ) override
+	{
+		m_formula = std::move( value );
+	}
+}; // struct MoveFormulaStorage
+
+TEST_CASE( "test_formula_moved_to_storage" )
+{
+	TestStream stream( &data4[ 0 ], 48 );
+
+	Excel::Record record( stream );
+
+	MoveFormulaStorage storage;
+	Excel::Parser::handleFORMULA( record, stream, 0, storage );
+
+	REQUIRE( storage.m_formula.valueType() == Excel::Formula::StringValue );
+	REQUIRE( storage.m_formula.getRow() == 0x04 );
+	REQUIRE( storage.m_formula.getString() == L"this is red ink" );
+}
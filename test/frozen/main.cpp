@@ -0,0 +1,168 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+
+// C++ include.
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Check that frozen book is equal to the book.
+void requireSameBooks( const Excel::Book & book, const Excel::FrozenBook & frozen )
+{
+	REQUIRE( book.dateMode() == frozen.dateMode() );
+	REQUIRE( book.sheetsCount() == frozen.sheetsCount() );
+
+	for( size_t s = 0; s < book.sheetsCount(); ++s )
+	{
+		const Excel::Sheet * a = book.sheet( s );
+		const Excel::FrozenSheet * b = frozen.sheet( s );
+
+		REQUIRE( !a == !b );
+
+		if( !a )
+			continue;
+
+		REQUIRE( a->sheetName() == b->sheetName() );
+		REQUIRE( a->sheetHeader() == b->sheetHeader() );
+		REQUIRE( a->sheetFooter() == b->sheetFooter() );
+		REQUIRE( a->rowsCount() == b->rowsCount() );
+		REQUIRE( a->columnsCount() == b->columnsCount() );
+
+		// One more row and column to check cells out of range.
+		for( size_t r = 0; r <= a->rowsCount(); ++r )
+		{
+			for( size_t c = 0; c <= a->columnsCount(); ++c )
+			{
+				const Excel::Cell & ca = a->cell( r, c );
+				const Excel::Cell & cb = b->cell( r, c );
+
+				REQUIRE( ca.dataType() == cb.dataType() );
+				REQUIRE( ca.isNull() == cb.isNull() );
+				REQUIRE( ca.getString() == cb.getString() );
+				REQUIRE( ca.getDouble() == cb.getDouble() );
+				REQUIRE( ca.getFormula().valueType() == cb.getFormula().valueType() );
+				REQUIRE( ca.getFormula().getString() == cb.getFormula().getString() );
+			}
+		}
+	}
+}
+
+
+TEST_CASE( "test_frozen_book" )
+{
+	for( const char * fileName : { "test/data/test.xls", "test/data/sample.xls",
+		"test/data/big.xls", "test/data/stringformula.xls", "test/data/datetime.xls",
+		"test/data/strange.xls", "test/data/verybig.xls" } )
+	{
+		CAPTURE( fileName );
+
+		Excel::Book book( fileName );
+
+		auto copy = book.freeze();
+
+		requireSameBooks( book, *copy );
+
+		Excel::Book moved( fileName );
+
+		auto frozen = std::move( moved ).freeze();
+
+		REQUIRE( moved.sheetsCount() == 0 );
+
+		requireSameBooks( book, *frozen );
+
+		REQUIRE_THROWS_AS( frozen->sheet( frozen->sheetsCount() ), Excel::Exception );
+	}
+}
+
+TEST_CASE( "test_frozen_book_shared_sheets" )
+{
+	Excel::SheetCache cache;
+
+	Excel::Book first;
+	first.setSheetCache( &cache );
+	Excel::Parser::loadBook( "test/data/big.xls", first );
+
+	Excel::Book second;
+	second.setSheetCache( &cache );
+	Excel::Parser::loadBook( "test/data/big.xls", second );
+
+	REQUIRE( cache.hits() == second.sheetsCount() );
+
+	// Sheets of the cache are copied, not moved.
+	auto frozen = std::move( second ).freeze();
+
+	requireSameBooks( first, *frozen );
+
+	Excel::Book third;
+	third.setSheetCache( &cache );
+	Excel::Parser::loadBook( "test/data/big.xls", third );
+
+	requireSameBooks( third, *frozen );
+}
+
+TEST_CASE( "test_frozen_book_threads" )
+{
+	Excel::Book reference( "test/data/big.xls" );
+
+	std::shared_ptr< const Excel::FrozenBook > current = reference.freeze();
+
+	std::atomic< bool > stop( false );
+	std::atomic< size_t > errors( 0 );
+	std::vector< std::thread > readers;
+
+	const Excel::Sheet & sheet = *reference.sheet( 0 );
+
+	for( size_t i = 0; i < 4; ++i )
+	{
+		readers.emplace_back( [&, i] ()
+			{
+				size_t checked = 0;
+
+				while( !stop || checked == 0 )
+				{
+					auto book = std::atomic_load( &current );
+					const Excel::FrozenSheet * s = book->sheet( 0 );
+
+					for( size_t r = i; r < s->rowsCount(); r += 4 )
+					{
+						for( size_t c = 0; c < s->columnsCount(); ++c )
+						{
+							if( s->cell( r, c ).dataType() != sheet.cell( r, c ).dataType() ||
+								s->cell( r, c ).getString() != sheet.cell( r, c ).getString() )
+							{
+								++errors;
+							}
+						}
+					}
+
+					++checked;
+				}
+			} );
+	}
+
+	// Hot reload.
+	for( size_t i = 0; i < 3; ++i )
+	{
+		Excel::Book book( "test/data/big.xls" );
+
+		std::atomic_store( &current, std::move( book ).freeze() );
+	}
+
+	stop = true;
+
+	for( auto & t : readers )
+		t.join();
+
+	REQUIRE( errors == 0 );
+}
@@ -0,0 +1,177 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <sstream>
+#include <string>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! \return Wide string from UTF-16 string of the generator.
+std::wstring toWString( const std::u16string & str )
+{
+	return std::wstring( str.cbegin(), str.cend() );
+}
+
+//! Generate workbook and check every cell of it.
+void checkGenerated( const GeneratorOptions & opts, int32_t sheets,
+	std::string * content = nullptr )
+{
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	if( content )
+		*content = stream.str();
+
+	stream.seekg( 0 );
+
+	Excel::Book book( stream );
+
+	REQUIRE( book.sheetsCount() == static_cast< size_t > ( sheets ) );
+
+	for( int32_t s = 0; s < sheets; ++s )
+	{
+		Excel::Sheet * sheet = book.sheet( s );
+
+		REQUIRE( sheet->rowsCount() == static_cast< size_t > ( opts.m_rows ) );
+		REQUIRE( sheet->columnsCount() == static_cast< size_t > ( opts.m_columns ) );
+
+		for( int32_t r = 0; r < opts.m_rows; ++r )
+		{
+			for( int32_t c = 0; c < opts.m_columns; ++c )
+			{
+				const Excel::Cell & cell = sheet->cell( r, c );
+				const int64_t k = static_cast< int64_t > ( r ) * opts.m_columns + c + 1;
+
+				switch( WorkbookWriter::cellType( opts, r, c ) )
+				{
+					case 0 :
+						REQUIRE( cell.dataType() == Excel::Cell::DataType::Double );
+						REQUIRE( cell.getDouble() == WorkbookWriter::cellValue( opts, r, c ) );
+						break;
+
+					case 1 :
+						REQUIRE( cell.dataType() == Excel::Cell::DataType::String );
+						REQUIRE( cell.getString() == toWString( WorkbookWriter::sstString( opts,
+							static_cast< int32_t > ( k % opts.m_sstSize ) ) ) );
+						break;
+
+					default :
+						REQUIRE( cell.dataType() == Excel::Cell::DataType::Formula );
+
+						if( WorkbookWriter::isStringFormula( opts, r, c ) )
+						{
+							REQUIRE( cell.getFormula().valueType() == Excel::Formula::StringValue );
+							REQUIRE( cell.getFormula().getString() ==
+								toWString( WorkbookWriter::formulaString( r, c ) ) );
+						}
+						else
+						{
+							REQUIRE( cell.getFormula().valueType() == Excel::Formula::DoubleValue );
+							REQUIRE( cell.getFormula().getDouble() ==
+								WorkbookWriter::cellValue( opts, r, c ) );
+						}
+						break;
+				}
+			}
+		}
+	}
+}
+
+
+TEST_CASE( "test_generated_short_stream" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 3;
+	opts.m_columns = 2;
+
+	std::string content;
+
+	checkGenerated( opts, 1, &content );
+
+	// Header, Workbook in short-stream container, SSAT, directory and SAT.
+	REQUIRE( content.size() == 512 * 5 );
+}
+
+TEST_CASE( "test_generated_mix" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 300;
+	opts.m_columns = 20;
+	opts.m_sheets = 3;
+	opts.m_sstSize = 50;
+	opts.m_stringLength = 100;
+	opts.m_stringEvery = 3;
+	opts.m_wideStrings = true;
+	opts.m_maxRecordSize = 64;
+	opts.m_mulrkPercent = 50;
+	opts.m_formulaEvery = 7;
+	opts.m_formulaStringEvery = 2;
+
+	checkGenerated( opts, 3 );
+
+	opts.m_wideStrings = false;
+	opts.m_maxRecordSize = 8224;
+	opts.m_stringLength = 5000;
+
+	checkGenerated( opts, 3 );
+}
+
+TEST_CASE( "test_generated_fractions" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 100;
+	opts.m_columns = 10;
+	opts.m_fractions = true;
+	opts.m_formulaEvery = 9;
+
+	checkGenerated( opts, 1 );
+}
+
+TEST_CASE( "test_generated_msat_sectors" )
+{
+	// More than 109 SAT sectors, so MSAT has its own sectors.
+	GeneratorOptions opts;
+	opts.m_rows = 30000;
+	opts.m_columns = 26;
+
+	std::string content;
+
+	checkGenerated( opts, 1, &content );
+
+	REQUIRE( content.size() > 109u * 128u * 512u );
+}
+
+TEST_CASE( "test_generated_target_size" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 1000;
+	opts.m_columns = 10;
+	opts.m_mulrkPercent = 100;
+	opts.m_targetSize = 1024 * 1024;
+
+	std::string content;
+
+	ByteWriter counter( nullptr );
+	WorkbookWriter( opts, counter ).writeSheet();
+
+	const int32_t sheets = static_cast< int32_t > (
+		( opts.m_targetSize + counter.offset() - 1 ) / counter.offset() );
+
+	checkGenerated( opts, sheets, &content );
+
+	REQUIRE( content.size() >= opts.m_targetSize );
+}
@@ -0,0 +1,1043 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+#ifndef TEST__GENERATOR_HPP__INCLUDED
+#define TEST__GENERATOR_HPP__INCLUDED
+
+// Excel include.
+#include <read-excel/parser.hpp>
+#include <read-excel/compoundfile/compoundfile.hpp>
+
+// C++ include.
+#include <string>
+#include <vector>
+#include <utility>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+
+
+//
+// GeneratorOptions
+//
+
+//! Options of the generated workbook.
+/*!
+	Every sheet has the same cells. Cell (r, c) is numeric with value
+	(r + 1) * (c + 1) (plus 0.5 with m_fractions) unless it's a string or
+	a formula. For linear 1-based index k = r * m_columns + c + 1 cell is
+	a formula if k is divisible by m_formulaEvery, otherwise it's a string
+	from SST with index k % m_sstSize if k is divisible by m_stringEvery.
+	Formulas have the same cached value as the numeric cell would have,
+	every m_formulaStringEvery-th formula has string result instead.
+
+	With m_sharedFormulas formulas of every column are one shared formula,
+	SHRFMLA follows the first formula of the column and all formulas of
+	the column have PtgExp to it. With m_arrayFormulas it's ARRAY instead.
+	With m_noSharedRecords PtgExp is written but SHRFMLA or ARRAY is not,
+	so the first formula of the column is followed by the next cell.
+*/
+struct GeneratorOptions {
+	//! Count of rows in every sheet, up to 65536.
+	int32_t m_rows = 1000;
+	//! Count of columns in every sheet, up to 256.
+	int32_t m_columns = 26;
+	//! Count of sheets.
+	int32_t m_sheets = 1;
+	//! If not 0 count of sheets is chosen to make file at least such size.
+	uint64_t m_targetSize = 0;
+	//! Count of strings in SST.
+	int32_t m_sstSize = 0;
+	//! Count of characters in every SST string.
+	int32_t m_stringLength = 16;
+	//! Every such cell is a string, 0 means no string cells.
+	int32_t m_stringEvery = 0;
+	//! Store SST strings with 16-bit characters.
+	bool m_wideStrings = false;
+	//! Maximum size of record's data, longer data is split into CONTINUE records.
+	int32_t m_maxRecordSize = 8224;
+	//! Percent of rows where numbers are stored as MULRK.
+	int32_t m_mulrkPercent = 0;
+	//! Every such cell is a formula, 0 means no formulas.
+	int32_t m_formulaEvery = 0;
+	//! Every such formula has string result, 0 means only numeric results.
+	int32_t m_formulaStringEvery = 0;
+	//! Numbers have fractional part and are stored as NUMBER records.
+	bool m_fractions = false;
+	//! Formulas of every column are shared.
+	bool m_sharedFormulas = false;
+	//! Formulas of every column are array formula.
+	bool m_arrayFormulas = false;
+	//! SHRFMLA and ARRAY records are not written.
+	bool m_noSharedRecords = false;
+}; // struct GeneratorOptions
+
+
+//
+// ByteWriter
+//
+
+//! Buffered writer of the bytes, only counts bytes if there is no output.
+class ByteWriter {
+public:
+	//! \a base is the offset in the output of the first written byte.
+	explicit ByteWriter( std::ostream * out, uint64_t base = 0 );
+
+	//! \return Count of written bytes.
+	uint64_t offset() const;
+
+	void write( const char * data, size_t size );
+	void put8( uint8_t v );
+	void put16( uint16_t v );
+	void put32( uint32_t v );
+	void putDouble( double v );
+	void fill( char ch, size_t count );
+
+	//! Overwrite 4 bytes at the given offset.
+	void patch32( uint64_t offset, uint32_t v );
+
+	//! Write buffered bytes to the output.
+	void flush();
+
+private:
+	//! Output.
+	std::ostream * m_out;
+	//! Offset in the output of the first written byte.
+	uint64_t m_base;
+	//! Count of bytes written to the output.
+	uint64_t m_flushed;
+	//! Buffer.
+	std::vector< char > m_buf;
+}; // class ByteWriter
+
+
+//
+// WorkbookWriter
+//
+
+//! Writer of BIFF8 Workbook stream.
+class WorkbookWriter {
+public:
+	WorkbookWriter( const GeneratorOptions & opts, ByteWriter & out );
+
+	//! Write all substreams.
+	void write();
+
+	//! Write one worksheet substream.
+	void writeSheet();
+
+	//! \return SST string with the given index.
+	static std::u16string sstString( const GeneratorOptions & opts, int32_t idx );
+
+	//! \return Type of the cell, 0 - number, 1 - string, 2 - formula.
+	static int cellType( const GeneratorOptions & opts, int32_t row, int32_t column );
+
+	//! \return Value of the numeric cell.
+	static double cellValue( const GeneratorOptions & opts, int32_t row, int32_t column );
+
+	//! \return Is formula in the cell with string result.
+	static bool isStringFormula( const GeneratorOptions & opts, int32_t row, int32_t column );
+
+	//! \return String result of the formula.
+	static std::u16string formulaString( int32_t row, int32_t column );
+
+	//! \return Tokens of shared or array formula.
+	static std::vector< char > sharedTokens();
+
+	//! \return Rows of the first and last formulas in the column, -1 if there
+	//! are no formulas.
+	static std::pair< int32_t, int32_t > formulaRows( const GeneratorOptions & opts,
+		int32_t column );
+
+private:
+	//! Write BOF.
+	void bof( uint16_t type );
+	//! Write SST.
+	void sst();
+	//! Write row of the sheet.
+	void row( int32_t r );
+	//! Write numeric cells [ first, last ] of the row.
+	void numbers( int32_t r, int32_t first, int32_t last );
+	//! Write SHRFMLA or ARRAY of the column.
+	void sharedFormula( int32_t column );
+
+private:
+	//! Options.
+	const GeneratorOptions & m_opts;
+	//! Output.
+	ByteWriter & m_out;
+	//! Record's data.
+	std::vector< char > m_data;
+	//! Rows of the first and last formulas by columns.
+	std::vector< std::pair< int32_t, int32_t > > m_formulaRows;
+}; // class WorkbookWriter
+
+
+//
+// generateWorkbook
+//
+
+//! Generate compound file with Workbook stream.
+void generateWorkbook( const GeneratorOptions & opts, std::ostream & out );
+
+//! Generate compound file with Workbook stream.
+void generateWorkbook( const GeneratorOptions & opts, const std::string & fileName );
+
+//! \return Compound file with Workbook stream.
+std::string generate( const GeneratorOptions & opts );
+
+//! Load compound file \a data, e.g. made by generate(), into \a storage.
+void load( const std::string & data, Excel::IStorage & storage,
+	bool preload = false, bool pipelined = false );
+
+
+//
+// ByteWriter
+//
+
+inline
+ByteWriter::ByteWriter( std::ostream * out, uint64_t base )
+	:	m_out( out )
+	,	m_base( base )
+	,	m_flushed( 0 )
+{
+	m_buf.reserve( 1 << 20 );
+}
+
+inline uint64_t
+ByteWriter::offset() const
+{
+	return m_flushed + m_buf.size();
+}
+
+inline void
+ByteWriter::write( const char * data, size_t size )
+{
+	m_buf.insert( m_buf.end(), data, data + size );
+
+	if( m_buf.size() >= ( 1 << 20 ) )
+		flush();
+}
+
+inline void
+ByteWriter::put8( uint8_t v )
+{
+	m_buf.push_back( static_cast< char > ( v ) );
+}
+
+inline void
+ByteWriter::put16( uint16_t v )
+{
+	const char data[] = { static_cast< char > ( v & 0xFF ),
+		static_cast< char > ( v >> 8 ) };
+
+	write( data, 2 );
+}
+
+inline void
+ByteWriter::put32( uint32_t v )
+{
+	put16( static_cast< uint16_t > ( v & 0xFFFF ) );
+	put16( static_cast< uint16_t > ( v >> 16 ) );
+}
+
+inline void
+ByteWriter::putDouble( double v )
+{
+	uint64_t bits = 0;
+	std::memcpy( &bits, &v, 8 );
+
+	put32( static_cast< uint32_t > ( bits & 0xFFFFFFFF ) );
+	put32( static_cast< uint32_t > ( bits >> 32 ) );
+}
+
+inline void
+ByteWriter::fill( char ch, size_t count )
+{
+	m_buf.insert( m_buf.end(), count, ch );
+
+	if( m_buf.size() >= ( 1 << 20 ) )
+		flush();
+}
+
+inline void
+ByteWriter::patch32( uint64_t offset, uint32_t v )
+{
+	const char data[] = { static_cast< char > ( v & 0xFF ),
+		static_cast< char > ( ( v >> 8 ) & 0xFF ),
+		static_cast< char > ( ( v >> 16 ) & 0xFF ),
+		static_cast< char > ( v >> 24 ) };
+
+	if( offset >= m_flushed )
+		std::memcpy( &m_buf[ offset - m_flushed ], data, 4 );
+	else if( m_out )
+	{
+		const auto end = m_out->tellp();
+
+		m_out->seekp( static_cast< std::streamoff > ( m_base + offset ) );
+		m_out->write( data, 4 );
+		m_out->seekp( end );
+	}
+}
+
+inline void
+ByteWriter::flush()
+{
+	if( m_out && !m_buf.empty() )
+	{
+		m_out->write( m_buf.data(), static_cast< std::streamsize > ( m_buf.size() ) );
+
+		if( !*m_out )
+			throw std::runtime_error( "Unable to write output." );
+	}
+
+	m_flushed += m_buf.size();
+	m_buf.clear();
+}
+
+
+//
+// WorkbookWriter
+//
+
+//! BIFF8 record codes used by the generator.
+enum GeneratorRecord : uint16_t {
+	GenBOF = 0x809,
+	GenEOF = 0x0A,
+	GenBOUNDSHEET = 0x85,
+	GenDIMENSION = 0x200,
+	GenCONTINUE = 0x3C,
+	GenSST = 0xFC,
+	GenLABELSST = 0xFD,
+	GenNUMBER = 0x203,
+	GenRK = 0x27E,
+	GenMULRK = 0xBD,
+	GenFORMULA = 0x06,
+	GenSTRING = 0x207,
+	GenSHRFMLA = 0x4BC,
+	GenARRAY = 0x221,
+	GenDATEMODE = 0x22,
+	GenCODEPAGE = 0x42
+}; // enum GeneratorRecord
+
+inline
+WorkbookWriter::WorkbookWriter( const GeneratorOptions & opts, ByteWriter & out )
+	:	m_opts( opts )
+	,	m_out( out )
+{
+}
+
+inline std::u16string
+WorkbookWriter::sstString( const GeneratorOptions & opts, int32_t idx )
+{
+	std::u16string str;
+	str.reserve( opts.m_stringLength );
+
+	const std::string prefix = "s" + std::to_string( idx ) + "_";
+
+	for( int32_t i = 0; i < opts.m_stringLength; ++i )
+	{
+		if( i < static_cast< int32_t > ( prefix.size() ) )
+			str.push_back( static_cast< char16_t > ( prefix[ i ] ) );
+		else if( opts.m_wideStrings && i % 2 )
+			str.push_back( static_cast< char16_t > ( 0x0410 + ( idx + i ) % 32 ) );
+		else
+			str.push_back( static_cast< char16_t > ( 'a' + ( idx + i ) % 26 ) );
+	}
+
+	return str;
+}
+
+inline int
+WorkbookWriter::cellType( const GeneratorOptions & opts, int32_t row, int32_t column )
+{
+	const int64_t k = static_cast< int64_t > ( row ) * opts.m_columns + column + 1;
+
+	if( opts.m_formulaEvery > 0 && k % opts.m_formulaEvery == 0 )
+		return 2;
+
+	if( opts.m_stringEvery > 0 && opts.m_sstSize > 0 && k % opts.m_stringEvery == 0 )
+		return 1;
+
+	return 0;
+}
+
+inline double
+WorkbookWriter::cellValue( const GeneratorOptions & opts, int32_t row, int32_t column )
+{
+	const double v = static_cast< double > ( row + 1 ) * ( column + 1 );
+
+	return ( opts.m_fractions ? v + 0.5 : v );
+}
+
+inline bool
+WorkbookWriter::isStringFormula( const GeneratorOptions & opts, int32_t row, int32_t column )
+{
+	if( opts.m_formulaEvery <= 0 || opts.m_formulaStringEvery <= 0 )
+		return false;
+
+	const int64_t k = static_cast< int64_t > ( row ) * opts.m_columns + column + 1;
+
+	return ( ( k / opts.m_formulaEvery ) % opts.m_formulaStringEvery == 0 );
+}
+
+inline std::u16string
+WorkbookWriter::formulaString( int32_t row, int32_t column )
+{
+	const std::string str = "r" + std::to_string( row ) + "c" + std::to_string( column );
+
+	return std::u16string( str.cbegin(), str.cend() );
+}
+
+inline std::vector< char >
+WorkbookWriter::sharedTokens()
+{
+	// PtgRefN to the cell at the left multiplied by ptgInt 2.
+	return { 0x2C, 0x00, 0x00, static_cast< char > ( 0xFF ), static_cast< char > ( 0xFF ),
+		0x1E, 0x02, 0x00, 0x05 };
+}
+
+inline std::pair< int32_t, int32_t >
+WorkbookWriter::formulaRows( const GeneratorOptions & opts, int32_t column )
+{
+	std::pair< int32_t, int32_t > res( -1, -1 );
+
+	for( int32_t r = 0; r < opts.m_rows; ++r )
+	{
+		if( cellType( opts, r, column ) == 2 )
+		{
+			if( res.first < 0 )
+				res.first = r;
+
+			res.second = r;
+		}
+	}
+
+	return res;
+}
+
+inline void
+WorkbookWriter::bof( uint16_t type )
+{
+	m_out.put16( GenBOF );
+	m_out.put16( 16 );
+	m_out.put16( 0x0600 );
+	m_out.put16( type );
+	// Build identifier and year.
+	m_out.put16( 0x0DBB );
+	m_out.put16( 0x07CC );
+	// File history and lowest BIFF version.
+	m_out.put32( 0 );
+	m_out.put32( 0x06 );
+}
+
+inline void
+WorkbookWriter::write()
+{
+	if( m_opts.m_rows < 1 || m_opts.m_rows > 65536 ||
+		m_opts.m_columns < 1 || m_opts.m_columns > 256 )
+			throw std::invalid_argument( "Rows should be in [1, 65536], "
+				"columns should be in [1, 256]." );
+
+	if( m_opts.m_sheets < 1 )
+		throw std::invalid_argument( "There should be at least one sheet." );
+
+	if( m_opts.m_maxRecordSize < 32 || m_opts.m_maxRecordSize > 8224 )
+		throw std::invalid_argument( "Maximum record size should be in [32, 8224]." );
+
+	if( m_opts.m_stringLength < 1 || m_opts.m_stringLength > 32767 )
+		throw std::invalid_argument( "String length should be in [1, 32767]." );
+
+	bof( 0x0005 );
+
+	// UTF-16 code page.
+	m_out.put16( GenCODEPAGE );
+	m_out.put16( 2 );
+	m_out.put16( 1200 );
+
+	m_out.put16( GenDATEMODE );
+	m_out.put16( 2 );
+	m_out.put16( 0 );
+
+	sst();
+
+	std::vector< uint64_t > positions;
+
+	for( int32_t i = 0; i < m_opts.m_sheets; ++i )
+	{
+		const std::string name = "Sheet" + std::to_string( i + 1 );
+
+		m_out.put16( GenBOUNDSHEET );
+		m_out.put16( static_cast< uint16_t > ( 8 + name.size() ) );
+		positions.push_back( m_out.offset() );
+		m_out.put32( 0 );
+		// Visible worksheet.
+		m_out.put16( 0 );
+		m_out.put8( static_cast< uint8_t > ( name.size() ) );
+		m_out.put8( 0 );
+		m_out.write( name.data(), name.size() );
+	}
+
+	m_out.put16( GenEOF );
+	m_out.put16( 0 );
+
+	for( int32_t i = 0; i < m_opts.m_sheets; ++i )
+	{
+		if( m_out.offset() > static_cast< uint64_t > ( std::numeric_limits< int32_t >::max() ) )
+			throw std::length_error( "Workbook stream is larger than 2 GB." );
+
+		m_out.patch32( positions[ i ], static_cast< uint32_t > ( m_out.offset() ) );
+
+		writeSheet();
+	}
+
+	if( m_out.offset() > static_cast< uint64_t > ( std::numeric_limits< int32_t >::max() ) )
+		throw std::length_error( "Workbook stream is larger than 2 GB." );
+}
+
+inline void
+WorkbookWriter::sst()
+{
+	const size_t maxSize = static_cast< size_t > ( m_opts.m_maxRecordSize );
+	const size_t bytesPerChar = ( m_opts.m_wideStrings ? 2 : 1 );
+	const char options = ( m_opts.m_wideStrings ? 0x01 : 0x00 );
+
+	// Bytes of the current record.
+	std::vector< char > data;
+	bool first = true;
+
+	auto put = [&] ( char ch ) { data.push_back( ch ); };
+
+	auto flush = [&] ()
+	{
+		m_out.put16( first ? static_cast< uint16_t > ( GenSST ) :
+			static_cast< uint16_t > ( GenCONTINUE ) );
+		m_out.put16( static_cast< uint16_t > ( data.size() ) );
+
+		if( !data.empty() )
+			m_out.write( data.data(), data.size() );
+
+		data.clear();
+		first = false;
+	};
+
+	const int32_t count = std::max( m_opts.m_sstSize, 0 );
+	const int64_t total = static_cast< int64_t > ( m_opts.m_rows ) * m_opts.m_columns *
+		m_opts.m_sheets;
+
+	for( int i = 0; i < 4; ++i )
+		put( static_cast< char > ( ( total >> ( 8 * i ) ) & 0xFF ) );
+
+	for( int i = 0; i < 4; ++i )
+		put( static_cast< char > ( ( count >> ( 8 * i ) ) & 0xFF ) );
+
+	for( int32_t idx = 0; idx < count; ++idx )
+	{
+		const std::u16string str = sstString( m_opts, idx );
+
+		// Header of the string is never split.
+		if( data.size() + 3 + bytesPerChar > maxSize )
+			flush();
+
+		put( static_cast< char > ( str.size() & 0xFF ) );
+		put( static_cast< char > ( str.size() >> 8 ) );
+		put( options );
+
+		for( const char16_t ch : str )
+		{
+			if( data.size() + bytesPerChar > maxSize )
+			{
+				flush();
+				put( options );
+			}
+
+			put( static_cast< char > ( ch & 0xFF ) );
+
+			if( bytesPerChar == 2 )
+				put( static_cast< char > ( ch >> 8 ) );
+		}
+	}
+
+	flush();
+}
+
+inline void
+WorkbookWriter::writeSheet()
+{
+	bof( 0x0010 );
+
+	m_out.put16( GenDIMENSION );
+	m_out.put16( 14 );
+	m_out.put32( 0 );
+	m_out.put32( static_cast< uint32_t > ( m_opts.m_rows ) );
+	m_out.put16( 0 );
+	m_out.put16( static_cast< uint16_t > ( m_opts.m_columns ) );
+	m_out.put16( 0 );
+
+	m_formulaRows.clear();
+
+	if( m_opts.m_sharedFormulas || m_opts.m_arrayFormulas )
+	{
+		for( int32_t c = 0; c < m_opts.m_columns; ++c )
+			m_formulaRows.push_back( formulaRows( m_opts, c ) );
+	}
+
+	for( int32_t r = 0; r < m_opts.m_rows; ++r )
+		row( r );
+
+	m_out.put16( GenEOF );
+	m_out.put16( 0 );
+}
+
+inline void
+WorkbookWriter::row( int32_t r )
+{
+	int32_t runStart = -1;
+
+	for( int32_t c = 0; c < m_opts.m_columns; ++c )
+	{
+		const int type = cellType( m_opts, r, c );
+
+		if( type == 0 )
+		{
+			if( runStart < 0 )
+				runStart = c;
+
+			continue;
+		}
+
+		if( runStart >= 0 )
+		{
+			numbers( r, runStart, c - 1 );
+			runStart = -1;
+		}
+
+		if( type == 1 )
+		{
+			const int64_t k = static_cast< int64_t > ( r ) * m_opts.m_columns + c + 1;
+
+			m_out.put16( GenLABELSST );
+			m_out.put16( 10 );
+			m_out.put16( static_cast< uint16_t > ( r ) );
+			m_out.put16( static_cast< uint16_t > ( c ) );
+			m_out.put16( 0x0F );
+			m_out.put32( static_cast< uint32_t > ( k % m_opts.m_sstSize ) );
+		}
+		else
+		{
+			const bool isString = isStringFormula( m_opts, r, c );
+			const double v = cellValue( m_opts, r, c );
+
+			// Parsed expression: v as two ptgNum multiplied by 1, or
+			// string literal as ptgStr.
+			m_data.clear();
+
+			const std::u16string str = ( isString ? formulaString( r, c ) : std::u16string() );
+			const bool shared = !m_formulaRows.empty();
+
+			if( shared )
+			{
+				// PtgExp to the first formula of the column.
+				const int32_t first = m_formulaRows[ c ].first;
+
+				m_data.push_back( 0x01 );
+				m_data.push_back( static_cast< char > ( first & 0xFF ) );
+				m_data.push_back( static_cast< char > ( first >> 8 ) );
+				m_data.push_back( static_cast< char > ( c & 0xFF ) );
+				m_data.push_back( static_cast< char > ( c >> 8 ) );
+			}
+			else if( isString )
+			{
+				m_data.push_back( 0x17 );
+				m_data.push_back( static_cast< char > ( str.size() ) );
+				m_data.push_back( 0x00 );
+
+				for( const char16_t ch : str )
+					m_data.push_back( static_cast< char > ( ch ) );
+			}
+			else
+			{
+				const double one = 1.0;
+
+				m_data.push_back( 0x1F );
+				m_data.insert( m_data.end(), reinterpret_cast< const char* > ( &v ),
+					reinterpret_cast< const char* > ( &v ) + 8 );
+				m_data.push_back( 0x1F );
+				m_data.insert( m_data.end(), reinterpret_cast< const char* > ( &one ),
+					reinterpret_cast< const char* > ( &one ) + 8 );
+				// ptgMul.
+				m_data.push_back( 0x05 );
+			}
+
+			m_out.put16( GenFORMULA );
+			m_out.put16( static_cast< uint16_t > ( 22 + m_data.size() ) );
+			m_out.put16( static_cast< uint16_t > ( r ) );
+			m_out.put16( static_cast< uint16_t > ( c ) );
+			m_out.put16( 0x0F );
+
+			if( isString )
+			{
+				m_out.put32( 0 );
+				m_out.put32( 0xFFFF0000 );
+			}
+			else
+				m_out.putDouble( v );
+
+			// Flags, chn and size of the parsed expression.
+			m_out.put16( shared && !m_opts.m_arrayFormulas ? 0x0008 : 0 );
+			m_out.put32( 0 );
+			m_out.put16( static_cast< uint16_t > ( m_data.size() ) );
+			m_out.write( m_data.data(), m_data.size() );
+
+			if( shared && r == m_formulaRows[ c ].first && !m_opts.m_noSharedRecords )
+				sharedFormula( c );
+
+			if( isString )
+			{
+				m_out.put16( GenSTRING );
+				m_out.put16( static_cast< uint16_t > ( 3 + str.size() ) );
+				m_out.put16( static_cast< uint16_t > ( str.size() ) );
+				m_out.put8( 0 );
+
+				for( const char16_t ch : str )
+					m_out.put8( static_cast< uint8_t > ( ch ) );
+			}
+		}
+	}
+
+	if( runStart >= 0 )
+		numbers( r, runStart, m_opts.m_columns - 1 );
+}
+
+inline void
+WorkbookWriter::sharedFormula( int32_t column )
+{
+	const std::vector< char > tokens = sharedTokens();
+	const int32_t first = m_formulaRows[ column ].first;
+	const int32_t last = m_formulaRows[ column ].second;
+
+	if( m_opts.m_arrayFormulas )
+	{
+		m_out.put16( GenARRAY );
+		m_out.put16( static_cast< uint16_t > ( 14 + tokens.size() ) );
+	}
+	else
+	{
+		m_out.put16( GenSHRFMLA );
+		m_out.put16( static_cast< uint16_t > ( 10 + tokens.size() ) );
+	}
+
+	m_out.put16( static_cast< uint16_t > ( first ) );
+	m_out.put16( static_cast< uint16_t > ( last ) );
+	m_out.put8( static_cast< uint8_t > ( column ) );
+	m_out.put8( static_cast< uint8_t > ( column ) );
+
+	if( m_opts.m_arrayFormulas )
+	{
+		// Flags and chn.
+		m_out.put16( 0 );
+		m_out.put32( 0 );
+	}
+	else
+	{
+		// Reserved and count of cells.
+		m_out.put8( 0 );
+		m_out.put8( static_cast< uint8_t > ( std::min( last - first + 1, 255 ) ) );
+	}
+
+	m_out.put16( static_cast< uint16_t > ( tokens.size() ) );
+	m_out.write( tokens.data(), tokens.size() );
+}
+
+inline void
+WorkbookWriter::numbers( int32_t r, int32_t first, int32_t last )
+{
+	const bool mulrk = !m_opts.m_fractions && ( r % 100 ) < m_opts.m_mulrkPercent;
+
+	if( mulrk && last > first )
+	{
+		m_out.put16( GenMULRK );
+		m_out.put16( static_cast< uint16_t > ( 6 + 6 * ( last - first + 1 ) ) );
+		m_out.put16( static_cast< uint16_t > ( r ) );
+		m_out.put16( static_cast< uint16_t > ( first ) );
+
+		for( int32_t c = first; c <= last; ++c )
+		{
+			m_out.put16( 0x0F );
+			m_out.put32( ( static_cast< uint32_t > ( cellValue( m_opts, r, c ) ) << 2 ) | 0x02u );
+		}
+
+		m_out.put16( static_cast< uint16_t > ( last ) );
+
+		return;
+	}
+
+	for( int32_t c = first; c <= last; ++c )
+	{
+		const double v = cellValue( m_opts, r, c );
+
+		if( m_opts.m_fractions || v >= ( 1 << 29 ) )
+		{
+			m_out.put16( GenNUMBER );
+			m_out.put16( 14 );
+			m_out.put16( static_cast< uint16_t > ( r ) );
+			m_out.put16( static_cast< uint16_t > ( c ) );
+			m_out.put16( 0x0F );
+			m_out.putDouble( v );
+		}
+		else
+		{
+			m_out.put16( GenRK );
+			m_out.put16( 10 );
+			m_out.put16( static_cast< uint16_t > ( r ) );
+			m_out.put16( static_cast< uint16_t > ( c ) );
+			m_out.put16( 0x0F );
+			m_out.put32( ( static_cast< uint32_t > ( v ) << 2 ) | 0x02u );
+		}
+	}
+}
+
+
+//
+// generateWorkbook
+//
+
+inline void
+generateWorkbook( const GeneratorOptions & options, std::ostream & out )
+{
+	GeneratorOptions opts = options;
+
+	// Count of the sheets for the target size, all sheets are the same.
+	if( opts.m_targetSize > 0 )
+	{
+		GeneratorOptions one = opts;
+		one.m_sheets = 1;
+
+		ByteWriter book( nullptr );
+		WorkbookWriter( one, book ).write();
+
+		ByteWriter sheet( nullptr );
+		WorkbookWriter( one, sheet ).writeSheet();
+
+		const uint64_t sheetSize = sheet.offset();
+		const uint64_t globalsSize = book.offset() - sheetSize;
+		const uint64_t rest = ( opts.m_targetSize > globalsSize ?
+			opts.m_targetSize - globalsSize : 0 );
+
+		opts.m_sheets = static_cast< int32_t > ( std::max< uint64_t > ( 1,
+			( rest + sheetSize - 1 ) / sheetSize ) );
+	}
+
+	const uint32_t sectorSize = 512;
+	const uint32_t shortSectorSize = 64;
+	const uint32_t minStreamSize = 4096;
+	const uint32_t idsInSector = sectorSize / 4;
+
+	// Header is written at the end.
+	out.write( std::string( sectorSize, '\0' ).data(), sectorSize );
+
+	ByteWriter writer( &out, sectorSize );
+
+	WorkbookWriter( opts, writer ).write();
+
+	const uint64_t workbookSize = writer.offset();
+	const bool isShort = ( workbookSize < minStreamSize );
+
+	// Short Workbook is the only stream in the short-stream container.
+	const uint64_t containerSize = ( isShort ?
+		( workbookSize + shortSectorSize - 1 ) / shortSectorSize * shortSectorSize : 0 );
+	const uint64_t dataSectors = ( ( isShort ? containerSize : workbookSize ) +
+		sectorSize - 1 ) / sectorSize;
+
+	writer.fill( '\0', static_cast< size_t > ( dataSectors * sectorSize - workbookSize ) );
+
+	const uint64_t ssatSector = dataSectors;
+	const uint64_t dirSector = ssatSector + ( isShort ? 1 : 0 );
+	const uint64_t satFirst = dirSector + 1;
+
+	uint64_t satSectors = 0;
+	uint64_t msatSectors = 0;
+
+	while( true )
+	{
+		const uint64_t total = satFirst + satSectors + msatSectors;
+		const uint64_t needSat = ( total + idsInSector - 1 ) / idsInSector;
+		const uint64_t needMsat = ( needSat > 109 ?
+			( needSat - 109 + idsInSector - 2 ) / ( idsInSector - 1 ) : 0 );
+
+		if( needSat == satSectors && needMsat == msatSectors )
+			break;
+
+		satSectors = needSat;
+		msatSectors = needMsat;
+	}
+
+	const uint64_t msatFirst = satFirst + satSectors;
+	const uint64_t totalSectors = msatFirst + msatSectors;
+
+	auto put32 = [] ( char * data, uint32_t v )
+	{
+		data[ 0 ] = static_cast< char > ( v & 0xFF );
+		data[ 1 ] = static_cast< char > ( ( v >> 8 ) & 0xFF );
+		data[ 2 ] = static_cast< char > ( ( v >> 16 ) & 0xFF );
+		data[ 3 ] = static_cast< char > ( v >> 24 );
+	};
+
+	const uint32_t freeSecID = 0xFFFFFFFF;
+	const uint32_t endOfChain = 0xFFFFFFFE;
+	const uint32_t satSecID = 0xFFFFFFFD;
+	const uint32_t msatSecID = 0xFFFFFFFC;
+
+	// SSAT.
+	if( isShort )
+	{
+		const uint32_t shortSectors = static_cast< uint32_t > ( containerSize / shortSectorSize );
+
+		for( uint32_t i = 0; i < idsInSector; ++i )
+			writer.put32( i + 1 < shortSectors ? i + 1 :
+				( i + 1 == shortSectors ? endOfChain : freeSecID ) );
+	}
+
+	// Directory: root entry, Workbook and two empty entries.
+	{
+		auto entry = [&] ( const std::string & name, uint8_t type, uint32_t child,
+			uint32_t start, uint32_t size )
+		{
+			char data[ 128 ];
+			std::memset( data, 0, sizeof( data ) );
+
+			for( size_t i = 0; i < name.size(); ++i )
+				data[ i * 2 ] = name[ i ];
+
+			data[ 64 ] = static_cast< char > ( name.empty() ? 0 : ( name.size() + 1 ) * 2 );
+			data[ 66 ] = static_cast< char > ( type );
+			// Black node.
+			data[ 67 ] = static_cast< char > ( name.empty() ? 0 : 1 );
+			put32( data + 68, freeSecID );
+			put32( data + 72, freeSecID );
+			put32( data + 76, child );
+			put32( data + 116, start );
+			put32( data + 120, size );
+
+			writer.write( data, sizeof( data ) );
+		};
+
+		entry( "Root Entry", 5, 1, ( isShort ? 0 : endOfChain ),
+			static_cast< uint32_t > ( containerSize ) );
+		entry( "Workbook", 2, freeSecID, 0, static_cast< uint32_t > ( workbookSize ) );
+		entry( "", 0, freeSecID, 0, 0 );
+		entry( "", 0, freeSecID, 0, 0 );
+	}
+
+	// SAT.
+	for( uint64_t i = 0; i < satSectors * idsInSector; ++i )
+	{
+		uint32_t id = freeSecID;
+
+		if( i < dataSectors )
+			id = ( i + 1 < dataSectors ? static_cast< uint32_t > ( i + 1 ) : endOfChain );
+		else if( i == dirSector || ( isShort && i == ssatSector ) )
+			id = endOfChain;
+		else if( i >= satFirst && i < msatFirst )
+			id = satSecID;
+		else if( i >= msatFirst && i < totalSectors )
+			id = msatSecID;
+
+		writer.put32( id );
+	}
+
+	// MSAT sectors.
+	for( uint64_t s = 0; s < msatSectors; ++s )
+	{
+		for( uint64_t i = 0; i < idsInSector - 1; ++i )
+		{
+			const uint64_t idx = 109 + s * ( idsInSector - 1 ) + i;
+
+			writer.put32( idx < satSectors ? static_cast< uint32_t > ( satFirst + idx ) :
+				freeSecID );
+		}
+
+		writer.put32( s + 1 < msatSectors ? static_cast< uint32_t > ( msatFirst + s + 1 ) :
+			endOfChain );
+	}
+
+	writer.flush();
+
+	// Header.
+	{
+		char header[ 512 ];
+		std::memset( header, 0, sizeof( header ) );
+
+		const unsigned char id[] = { 0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1 };
+		std::memcpy( header, id, 8 );
+
+		// Revision, version, byte order, sector and short sector sizes.
+		header[ 24 ] = 0x3E;
+		header[ 26 ] = 0x03;
+		header[ 28 ] = static_cast< char > ( 0xFE );
+		header[ 29 ] = static_cast< char > ( 0xFF );
+		header[ 30 ] = 9;
+		header[ 32 ] = 6;
+
+		put32( header + 44, static_cast< uint32_t > ( satSectors ) );
+		put32( header + 48, static_cast< uint32_t > ( dirSector ) );
+		put32( header + 56, minStreamSize );
+		put32( header + 60, ( isShort ? static_cast< uint32_t > ( ssatSector ) : endOfChain ) );
+		put32( header + 64, ( isShort ? 1 : 0 ) );
+		put32( header + 68, ( msatSectors ? static_cast< uint32_t > ( msatFirst ) : endOfChain ) );
+		put32( header + 72, static_cast< uint32_t > ( msatSectors ) );
+
+		for( uint64_t i = 0; i < 109; ++i )
+			put32( header + 76 + i * 4, ( i < satSectors ?
+				static_cast< uint32_t > ( satFirst + i ) : freeSecID ) );
+
+		out.seekp( 0 );
+		out.write( header, sizeof( header ) );
+		out.seekp( 0, std::ios::end );
+	}
+
+	if( !out )
+		throw std::runtime_error( "Unable to write output." );
+}
+
+inline void
+generateWorkbook( const GeneratorOptions & opts, const std::string & fileName )
+{
+	std::ofstream out( fileName, std::ios::out | std::ios::binary | std::ios::trunc );
+
+	if( !out )
+		throw std::runtime_error( "Unable to open " + fileName );
+
+	generateWorkbook( opts, out );
+}
+
+inline std::string
+generate( const GeneratorOptions & opts )
+{
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	return stream.str();
+}
+
+inline void
+load( const std::string & data, Excel::IStorage & storage, bool preload, bool pipelined )
+{
+	std::istringstream stream( data );
+	CompoundFile::File file( stream );
+	file.setPreload( preload );
+	file.setPipelined( pipelined );
+
+	Excel::Parser::loadBook( file, storage );
+}
+
+#endif // TEST__GENERATOR_HPP__INCLUDED
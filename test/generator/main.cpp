@@ -0,0 +1,149 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+
+//
+// parseSize
+//
+
+//! \return Size with optional K, M or G suffix.
+inline uint64_t
+parseSize( const std::string & value )
+{
+	char * end = nullptr;
+	uint64_t size = std::strtoull( value.c_str(), &end, 10 );
+
+	switch( *end )
+	{
+		case 'G' : case 'g' : size *= 1024;
+		// fall through
+		case 'M' : case 'm' : size *= 1024;
+		// fall through
+		case 'K' : case 'k' : size *= 1024;
+			break;
+
+		default:
+			break;
+	}
+
+	return size;
+}
+
+
+//
+// usage
+//
+
+inline void
+usage( const char * app )
+{
+	std::printf( "Usage: %s [options] output.xls\n\n"
+		"Generates BIFF8 workbook for scalability testing.\n\n"
+		"  --rows=N                  rows in every sheet, up to 65536 (1000)\n"
+		"  --columns=N               columns in every sheet, up to 256 (26)\n"
+		"  --sheets=N                count of sheets (1)\n"
+		"  --size=N[K|M|G]           add sheets until the file has such size\n"
+		"  --sst=N                   count of strings in SST (0)\n"
+		"  --string-length=N         characters in every SST string (16)\n"
+		"  --string-every=N          every N-th cell is a string (0 - none)\n"
+		"  --wide-strings            store SST strings with 16-bit characters\n"
+		"  --max-record=N            maximum data size of the record before\n"
+		"                            splitting to CONTINUE, 32..8224 (8224)\n"
+		"  --mulrk=P                 percent of rows with MULRK records (0)\n"
+		"  --formula-every=N         every N-th cell is a formula (0 - none)\n"
+		"  --formula-string-every=N  every N-th formula has string result (0)\n"
+		"  --fractions               numbers with fractional part (NUMBER records)\n",
+		app );
+}
+
+
+//
+// main
+//
+
+int main( int argc, char ** argv )
+{
+	GeneratorOptions opts;
+	std::string output;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		const std::string arg = argv[ i ];
+		const auto eq = arg.find( '=' );
+		const std::string name = arg.substr( 0, eq );
+		const std::string value = ( eq == std::string::npos ? std::string() : arg.substr( eq + 1 ) );
+
+		if( name == "--rows" )
+			opts.m_rows = std::atoi( value.c_str() );
+		else if( name == "--columns" )
+			opts.m_columns = std::atoi( value.c_str() );
+		else if( name == "--sheets" )
+			opts.m_sheets = std::atoi( value.c_str() );
+		else if( name == "--size" )
+			opts.m_targetSize = parseSize( value );
+		else if( name == "--sst" )
+			opts.m_sstSize = std::atoi( value.c_str() );
+		else if( name == "--string-length" )
+			opts.m_stringLength = std::atoi( value.c_str() );
+		else if( name == "--string-every" )
+			opts.m_stringEvery = std::atoi( value.c_str() );
+		else if( name == "--wide-strings" )
+			opts.m_wideStrings = true;
+		else if( name == "--max-record" )
+			opts.m_maxRecordSize = std::atoi( value.c_str() );
+		else if( name == "--mulrk" )
+			opts.m_mulrkPercent = std::atoi( value.c_str() );
+		else if( name == "--formula-every" )
+			opts.m_formulaEvery = std::atoi( value.c_str() );
+		else if( name == "--formula-string-every" )
+			opts.m_formulaStringEvery = std::atoi( value.c_str() );
+		else if( name == "--fractions" )
+			opts.m_fractions = true;
+		else if( name == "--help" || name == "-h" )
+		{
+			usage( argv[ 0 ] );
+
+			return 0;
+		}
+		else if( !name.empty() && name[ 0 ] != '-' && output.empty() )
+			output = arg;
+		else
+		{
+			std::fprintf( stderr, "Unknown argument: %s\n\n", arg.c_str() );
+			usage( argv[ 0 ] );
+
+			return 1;
+		}
+	}
+
+	if( output.empty() )
+	{
+		usage( argv[ 0 ] );
+
+		return 1;
+	}
+
+	try {
+		generateWorkbook( opts, output );
+	}
+	catch( const std::exception & x )
+	{
+		std::fprintf( stderr, "%s\n", x.what() );
+
+		return 1;
+	}
+
+	return 0;
+}
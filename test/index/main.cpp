@@ -0,0 +1,65 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/record_index.hpp>
+#include <read-excel/parser.hpp>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+TEST_CASE( "test_record_index" )
+{
+	CompoundFile::File file( "./test/data/test.xls" );
+
+	std::unique_ptr< Excel::Stream > stream = file.stream(
+		file.directory( L"Workbook" ) );
+
+	Excel::RecordIndex index( *stream );
+
+	REQUIRE( !index.records().empty() );
+	REQUIRE( index.records().front().m_offset == 0 );
+	REQUIRE( index.records().front().m_code == Excel::XL_BOF );
+	REQUIRE( index.substreams().size() == 2 );
+	REQUIRE( index.substreams().front().m_bofOffset == 0 );
+	REQUIRE( index.substreams().front().m_firstRecord == 0 );
+	REQUIRE( index.substream( 1 ) == nullptr );
+
+	// Headers in the index are the same as read by Record.
+	stream->seek( 0, Excel::Stream::FromBeginning );
+
+	std::vector< Excel::BoundSheet > boundSheets;
+
+	for( const auto & info : index.records() )
+	{
+		REQUIRE( stream->pos() == info.m_offset );
+
+		Excel::Record record( *stream );
+
+		REQUIRE( record.code() == info.m_code );
+		REQUIRE( record.length() == info.m_length );
+		REQUIRE( record.borders().size() == info.m_continues );
+
+		if( record.code() == Excel::XL_BOUNDSHEET )
+			boundSheets.push_back( Excel::Parser::parseBoundSheet( record,
+				Excel::BOF::BIFF8 ) );
+	}
+
+	REQUIRE( boundSheets.size() == 1 );
+
+	const Excel::SubstreamInfo * sheet =
+		index.substream( boundSheets.front().BOFPosition() );
+
+	REQUIRE( sheet != nullptr );
+	REQUIRE( sheet == &index.substreams().back() );
+	REQUIRE( index.records()[ sheet->m_firstRecord ].m_code == Excel::XL_BOF );
+	REQUIRE( index.records()[ sheet->m_lastRecord ].m_code == Excel::XL_EOF );
+	REQUIRE( sheet->m_endOffset ==
+		index.records()[ sheet->m_lastRecord ].m_offset + 4 );
+	REQUIRE( index.substreams().front().m_endOffset <= sheet->m_bofOffset );
+}
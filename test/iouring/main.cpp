@@ -0,0 +1,170 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// CompoundFile include.
+#include <read-excel/compoundfile/reader.hpp>
+#include <read-excel/compoundfile/io_uring.hpp>
+
+// C++ include.
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Linux include.
+#include <fcntl.h>
+#include <unistd.h>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+namespace /* anonymous */ {
+
+const char * c_fileName = "./test/data/iouring.bin";
+
+const size_t c_fileSize = 1024 * 1024;
+
+const size_t c_chunk = 4096;
+
+//! \return Byte of the file at \a offset.
+char byteAt( size_t offset )
+{
+	return static_cast< char > ( ( offset * 31 + offset / 4096 ) & 0xFF );
+}
+
+//! Write the test file.
+void writeFile()
+{
+	std::ofstream out( c_fileName, std::ios::binary | std::ios::trunc );
+
+	for( size_t i = 0; i < c_fileSize; ++i )
+		out.put( byteAt( i ) );
+}
+
+//! \return Requests for every second chunk of the file in reverse order.
+std::vector< CompoundFile::ReadRequest > requests( std::vector< char > & data )
+{
+	const size_t count = c_fileSize / c_chunk / 2;
+
+	data.assign( count * c_chunk, 0 );
+
+	std::vector< CompoundFile::ReadRequest > res;
+
+	for( size_t i = 0; i < count; ++i )
+		res.push_back( { ( count - 1 - i ) * 2 * c_chunk, data.data() + i * c_chunk,
+			c_chunk } );
+
+	return res;
+}
+
+//! \return Is data read by \a requests match the file.
+bool matches( const std::vector< CompoundFile::ReadRequest > & requests )
+{
+	for( const auto & r : requests )
+	{
+		for( size_t i = 0; i < r.m_size; ++i )
+		{
+			if( r.m_data[ i ] != byteAt( static_cast< size_t > ( r.m_offset ) + i ) )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+} /* namespace anonymous */
+
+
+//
+// test_ring_read
+//
+
+TEST_CASE( "test_ring_read" )
+{
+	writeFile();
+
+	CompoundFile::IoUring ring( 8 );
+
+	if( !ring.isValid() )
+	{
+		MESSAGE( "io_uring is not available, skipped." );
+		return;
+	}
+
+	const int fd = ::open( c_fileName, O_RDONLY );
+	REQUIRE( fd >= 0 );
+
+	std::vector< char > data;
+	const auto r = requests( data );
+	size_t bytes = 0;
+
+	REQUIRE( ring.read( fd, r, bytes ) );
+	REQUIRE( bytes == data.size() );
+	REQUIRE( matches( r ) );
+
+	::close( fd );
+}
+
+
+//
+// test_ring_after_error
+//
+
+TEST_CASE( "test_ring_after_error" )
+{
+	writeFile();
+
+	CompoundFile::IoUring ring( 8 );
+
+	if( !ring.isValid() )
+	{
+		MESSAGE( "io_uring is not available, skipped." );
+		return;
+	}
+
+	std::vector< char > data;
+	auto r = requests( data );
+	size_t bytes = 0;
+
+	// Every read fails, the ring should wait for all submitted reads.
+	REQUIRE( !ring.read( -1, r, bytes ) );
+
+	const int fd = ::open( c_fileName, O_RDONLY );
+	REQUIRE( fd >= 0 );
+
+	// No completions of the failed batch are left in the ring.
+	r = requests( data );
+
+	REQUIRE( ring.read( fd, r, bytes ) );
+	REQUIRE( bytes == data.size() );
+	REQUIRE( matches( r ) );
+
+	::close( fd );
+}
+
+
+//
+// test_file_reader
+//
+
+TEST_CASE( "test_file_reader" )
+{
+	writeFile();
+
+	CompoundFile::FileReader reader( c_fileName );
+	REQUIRE( reader.isOpen() );
+
+	for( int i = 0; i < 3; ++i )
+	{
+		std::vector< char > data;
+		const auto r = requests( data );
+
+		REQUIRE( reader.read( r ) == data.size() );
+		REQUIRE( matches( r ) );
+	}
+}
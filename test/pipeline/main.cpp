@@ -0,0 +1,346 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/spsc_ring.hpp>
+#include <read-excel/pipeline_worker.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Check that books have the same cells.
+void requireSameBooks( const Excel::Book & a, const Excel::Book & b )
+{
+	REQUIRE( a.sheetsCount() == b.sheetsCount() );
+
+	for( size_t s = 0; s < a.sheetsCount(); ++s )
+	{
+		const Excel::Sheet & sa = *a.sheet( s );
+		const Excel::Sheet & sb = *b.sheet( s );
+
+		REQUIRE( sa.sheetName() == sb.sheetName() );
+		REQUIRE( sa.rowsCount() == sb.rowsCount() );
+		REQUIRE( sa.columnsCount() == sb.columnsCount() );
+
+		for( size_t r = 0; r < sa.rowsCount(); ++r )
+		{
+			for( size_t c = 0; c < sa.columnsCount(); ++c )
+			{
+				const Excel::Cell & ca = sa.cell( r, c );
+				const Excel::Cell & cb = sb.cell( r, c );
+
+				REQUIRE( ca.dataType() == cb.dataType() );
+
+				switch( ca.dataType() )
+				{
+					case Excel::Cell::DataType::String :
+						REQUIRE( ca.getString() == cb.getString() );
+						break;
+
+					case Excel::Cell::DataType::Double :
+						REQUIRE( ca.getDouble() == cb.getDouble() );
+						break;
+
+					case Excel::Cell::DataType::Formula :
+					{
+						const Excel::Formula & fa = ca.getFormula();
+						const Excel::Formula & fb = cb.getFormula();
+
+						REQUIRE( fa.valueType() == fb.valueType() );
+
+						if( fa.valueType() == Excel::Formula::StringValue )
+							REQUIRE( fa.getString() == fb.getString() );
+						else if( fa.valueType() == Excel::Formula::DoubleValue )
+							REQUIRE( fa.getDouble() == fb.getDouble() );
+					}
+						break;
+
+					default :
+						break;
+				}
+			}
+		}
+	}
+}
+
+//! Load book from the stream, with or without pipeline.
+void loadBook( std::istream & stream, Excel::IStorage & storage, bool pipelined,
+	bool preload = false )
+{
+	stream.clear();
+	stream.seekg( 0 );
+
+	CompoundFile::File file( stream );
+	file.setPipelined( pipelined );
+	file.setPreload( preload );
+
+	Excel::Parser::loadBook( file, storage );
+}
+
+
+TEST_CASE( "test_spsc_ring" )
+{
+	Excel::SpscRing< int > ring( 5 );
+
+	REQUIRE( ring.capacity() == 8 );
+	REQUIRE( ring.front() == nullptr );
+
+	for( int i = 0; i < 8; ++i )
+	{
+		int * slot = ring.back();
+
+		REQUIRE( slot != nullptr );
+
+		*slot = i;
+		ring.push();
+	}
+
+	REQUIRE( ring.back() == nullptr );
+
+	REQUIRE( *ring.front() == 0 );
+	ring.pop();
+
+	REQUIRE( ring.back() != nullptr );
+
+	// Producer and consumer in different threads.
+	Excel::SpscRing< size_t > numbers( 16 );
+	const size_t count = 200000;
+
+	std::thread producer( [&] ()
+		{
+			for( size_t i = 0; i < count; ++i )
+			{
+				size_t * slot = nullptr;
+
+				while( !( slot = numbers.back() ) )
+					std::this_thread::yield();
+
+				*slot = i;
+				numbers.push();
+			}
+		} );
+
+	bool ordered = true;
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		size_t * slot = nullptr;
+
+		while( !( slot = numbers.front() ) )
+			std::this_thread::yield();
+
+		ordered = ordered && ( *slot == i );
+		numbers.pop();
+	}
+
+	producer.join();
+
+	REQUIRE( ordered );
+	REQUIRE( numbers.front() == nullptr );
+}
+
+TEST_CASE( "test_spsc_ring_wait" )
+{
+	// Small ring and slow consumer, so producer sleeps.
+	Excel::SpscRing< size_t > numbers( 2 );
+	const size_t count = 2000;
+	std::atomic< bool > done( false );
+	auto never = [] () { return false; };
+
+	std::thread producer( [&] ()
+		{
+			for( size_t i = 0; i < count; ++i )
+			{
+				*numbers.waitBack( never ) = i;
+				numbers.push();
+			}
+
+			done = true;
+			numbers.wake();
+		} );
+
+	bool ordered = true;
+	size_t received = 0;
+
+	while( size_t * slot = numbers.waitFront( [&] () { return done.load(); } ) )
+	{
+		ordered = ordered && ( *slot == received++ );
+		numbers.pop();
+
+		if( received % 500 == 0 )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+	}
+
+	producer.join();
+
+	REQUIRE( ordered );
+	REQUIRE( received == count );
+
+	// Stop wakes the sleeping consumer.
+	std::atomic< bool > stop( false );
+	bool stopped = false;
+
+	std::thread waiter( [&] ()
+		{
+			stopped = ( numbers.waitFront( [&] () { return stop.load(); } ) == nullptr );
+		} );
+
+	std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+
+	stop = true;
+	numbers.wake();
+
+	waiter.join();
+
+	REQUIRE( stopped );
+}
+
+TEST_CASE( "test_pipeline_worker" )
+{
+	Excel::PipelineWorker worker;
+	size_t sum = 0;
+
+	for( size_t i = 1; i <= 100; ++i )
+	{
+		worker.start( [&, i] () { sum += i; } );
+		worker.wait();
+	}
+
+	REQUIRE( sum == 5050 );
+}
+
+TEST_CASE( "test_pipelined_files" )
+{
+	for( const char * fileName : { "test/data/test.xls", "test/data/sample.xls",
+		"test/data/big.xls", "test/data/stringformula.xls", "test/data/datetime.xls",
+		"test/data/MiscOperatorTests.xls", "test/data/strange.xls" } )
+	{
+		CAPTURE( fileName );
+
+		std::ifstream stream( fileName, std::ios::in | std::ios::binary );
+
+		Excel::Book sequential;
+		loadBook( stream, sequential, false );
+
+		Excel::Book pipelined;
+		loadBook( stream, pipelined, true );
+
+		requireSameBooks( sequential, pipelined );
+
+		Excel::Book preloaded;
+		loadBook( stream, preloaded, true, true );
+
+		requireSameBooks( sequential, preloaded );
+	}
+}
+
+TEST_CASE( "test_pipelined_generated" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 2000;
+	opts.m_columns = 12;
+	opts.m_sheets = 3;
+	opts.m_sstSize = 100;
+	opts.m_stringLength = 300;
+	opts.m_stringEvery = 4;
+	opts.m_wideStrings = true;
+	opts.m_maxRecordSize = 200;
+	opts.m_mulrkPercent = 30;
+	opts.m_formulaEvery = 3;
+	opts.m_formulaStringEvery = 2;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	Excel::Book sequential;
+	loadBook( stream, sequential, false );
+
+	Excel::Book pipelined;
+	loadBook( stream, pipelined, true );
+
+	REQUIRE( pipelined.sheetsCount() == 3 );
+	REQUIRE( pipelined.sheet( 2 )->rowsCount() == 2000 );
+
+	requireSameBooks( sequential, pipelined );
+}
+
+//! Storage that fails on the cell.
+struct FailingStorage
+	:	public Excel::EmptyStorage
+{
+	//! Count of cells to fail after.
+	size_t m_failAfter = 0;
+
+protected:
+	void onCell( size_t, size_t, size_t, double ) override
+	{
+		if( m_failAfter-- == 0 )
+			throw Excel::Exception( L"Storage failed." );
+	}
+}; // struct FailingStorage
+
+TEST_CASE( "test_pipelined_errors" )
+{
+	std::ifstream stream( "test/data/big.xls", std::ios::in | std::ios::binary );
+
+	// Error of the storage stops reading thread.
+	for( const size_t failAfter : { 0, 100, 1000 } )
+	{
+		FailingStorage storage;
+		storage.m_failAfter = failAfter;
+
+		REQUIRE_THROWS_AS( loadBook( stream, storage, true ), Excel::Exception );
+	}
+
+	// Error of reading comes to the caller.
+	GeneratorOptions opts;
+	opts.m_rows = 500;
+	opts.m_columns = 5;
+
+	std::stringstream generated( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, generated );
+
+	CompoundFile::File file( generated );
+	const std::vector< char > workbook = file.readStreamFully(
+		file.directory( L"Workbook" ) );
+
+	std::vector< Excel::BoundSheet > sheets;
+
+	{
+		Excel::MemoryStream globals( workbook.data(),
+			static_cast< int32_t > ( workbook.size() ) );
+		Excel::EmptyStorage storage;
+
+		Excel::Parser::loadGlobals( sheets, globals, storage );
+	}
+
+	REQUIRE( sheets.size() == 1 );
+
+	// Workbook is cut in the middle of the sheet.
+	const int32_t cut = sheets.front().BOFPosition() +
+		( static_cast< int32_t > ( workbook.size() ) - sheets.front().BOFPosition() ) / 2;
+
+	Excel::MemoryStream truncated( workbook.data(), cut );
+	Excel::Book book;
+
+	REQUIRE_THROWS_AS( Excel::Parser::loadWorkSheet( 0, sheets.front(), truncated, book,
+		true ), Excel::Exception );
+}
@@ -0,0 +1,164 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <vector>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Storage that keeps progress reports.
+struct ProgressStorage
+	:	public Excel::EmptyStorage
+{
+	//! Interval.
+	uint32_t m_interval = 0;
+	//! Reports.
+	std::vector< Excel::Progress > m_reports;
+	//! Stop after given count of reports.
+	size_t m_stopAfter = static_cast< size_t > ( -1 );
+
+protected:
+	uint32_t progressInterval() const override
+	{
+		return m_interval;
+	}
+
+	void onProgress( const Excel::Progress & progress ) override
+	{
+		m_reports.push_back( progress );
+	}
+
+	bool isCancelled() const override
+	{
+		return ( m_reports.size() >= m_stopAfter );
+	}
+}; // struct ProgressStorage
+
+//! \return Options of the generated workbook.
+GeneratorOptions options()
+{
+	GeneratorOptions opts;
+	opts.m_rows = 3000;
+	opts.m_columns = 10;
+	opts.m_sheets = 3;
+	opts.m_sstSize = 100;
+	opts.m_stringEvery = 3;
+	opts.m_formulaEvery = 5;
+
+	return opts;
+}
+
+
+TEST_CASE( "test_progress_off" )
+{
+	ProgressStorage storage;
+
+	load( generate( options() ), storage, true );
+
+	REQUIRE( storage.m_reports.empty() );
+}
+
+TEST_CASE( "test_progress_reports" )
+{
+	const std::string data = generate( options() );
+
+	for( const bool preload : { true, false } )
+	{
+		for( const bool pipelined : { false, true } )
+		{
+			CAPTURE( preload );
+			CAPTURE( pipelined );
+
+			ProgressStorage storage;
+			storage.m_interval = 16 * 1024;
+
+			load( data, storage, preload, pipelined );
+
+			REQUIRE( storage.m_reports.size() > 2 );
+
+			const Excel::Progress & last = storage.m_reports.back();
+			const uint64_t total = last.m_bytesTotal;
+
+			REQUIRE( total > 0 );
+			REQUIRE( last.m_bytesRead == total );
+			REQUIRE( last.m_sheetIdx == 2 );
+
+			// One report per interval, a record may cross several intervals.
+			REQUIRE( storage.m_reports.size() <= total / storage.m_interval + 1 );
+			REQUIRE( storage.m_reports.size() >= total / storage.m_interval / 2 );
+
+			uint64_t bytes = 0;
+			size_t sheet = Excel::Progress::c_globals;
+
+			for( const auto & p : storage.m_reports )
+			{
+				REQUIRE( p.m_bytesTotal == total );
+				REQUIRE( p.m_bytesRead > bytes );
+				REQUIRE( p.m_bytesRead <= total );
+
+				bytes = p.m_bytesRead;
+
+				if( sheet == Excel::Progress::c_globals )
+					sheet = p.m_sheetIdx;
+				else
+				{
+					REQUIRE( p.m_sheetIdx != Excel::Progress::c_globals );
+					REQUIRE( p.m_sheetIdx >= sheet );
+
+					sheet = p.m_sheetIdx;
+				}
+			}
+
+			REQUIRE( sheet == 2 );
+		}
+	}
+}
+
+TEST_CASE( "test_progress_cancel" )
+{
+	ProgressStorage storage;
+	storage.m_interval = 16 * 1024;
+	storage.m_stopAfter = 3;
+
+	load( generate( options() ), storage, true );
+
+	// No final report for cancelled load.
+	REQUIRE( storage.m_reports.size() == 3 );
+	REQUIRE( storage.m_reports.back().m_bytesRead < storage.m_reports.back().m_bytesTotal );
+}
+
+TEST_CASE( "test_progress_book" )
+{
+	Excel::Book book;
+
+	std::vector< Excel::Progress > reports;
+
+	book.setProgressHandler( [&reports] ( const Excel::Progress & p )
+		{ reports.push_back( p ); }, 64 * 1024 );
+
+	load( generate( options() ), book, true );
+
+	REQUIRE( book.sheetsCount() == 3 );
+	REQUIRE( !reports.empty() );
+	REQUIRE( reports.back().m_bytesRead == reports.back().m_bytesTotal );
+
+	reports.clear();
+	book.clear();
+	book.setProgressHandler( nullptr );
+
+	load( generate( options() ), book, true );
+
+	REQUIRE( reports.empty() );
+}
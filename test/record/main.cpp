@@ -148,3 +148,30 @@ TEST_CASE( "test_record" )
 	REQUIRE( stream.getByte() == (char) 0x52u );
 	REQUIRE( stream.getByte() == (char) 0x00u );
 }
+
+TEST_CASE( "test_record_skip" )
+{
+	std::vector< char > withEOF( data.cbegin(), data.cend() );
+	withEOF.insert( withEOF.end(), { 0x0A, 0x00, 0x00, 0x00 } );
+
+	Excel::MemoryStream stream( &withEOF[ 0 ],
+		static_cast< int32_t > ( withEOF.size() ) );
+
+	Excel::RecordInfo info;
+
+	REQUIRE( Excel::Record::skip( stream, info ) );
+	REQUIRE( info.m_offset == 0 );
+	REQUIRE( info.m_code == 0xFC );
+	REQUIRE( info.m_length == 0x5A );
+	REQUIRE( info.m_continues == 3 );
+	REQUIRE( stream.pos() == 106 );
+
+	REQUIRE( Excel::Record::skip( stream, info ) );
+	REQUIRE( info.m_offset == 106 );
+	REQUIRE( info.m_code == Excel::XL_EOF );
+	REQUIRE( info.m_length == 0 );
+	REQUIRE( info.m_continues == 0 );
+	REQUIRE( stream.pos() == 110 );
+
+	REQUIRE( !Excel::Record::skip( stream, info ) );
+}
@@ -0,0 +1,315 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/sheet_cache.hpp>
+
+// C++ include.
+#include <fstream>
+#include <thread>
+#include <vector>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Check that sheets are equal.
+void requireSameSheets( const Excel::Sheet & a, const Excel::Sheet & b )
+{
+	REQUIRE( a.sheetName() == b.sheetName() );
+	REQUIRE( a.rowsCount() == b.rowsCount() );
+	REQUIRE( a.columnsCount() == b.columnsCount() );
+
+	for( size_t r = 0; r < a.rowsCount(); ++r )
+	{
+		for( size_t c = 0; c < a.columnsCount(); ++c )
+		{
+			REQUIRE( a.cell( r, c ).dataType() == b.cell( r, c ).dataType() );
+			REQUIRE( a.cell( r, c ).getString() == b.cell( r, c ).getString() );
+			REQUIRE( a.cell( r, c ).getDouble() == b.cell( r, c ).getDouble() );
+		}
+	}
+}
+
+//! Load book with the cache.
+void loadBook( const std::string & fileName, Excel::Book & book, Excel::SheetCache & cache )
+{
+	book.setSheetCache( &cache );
+
+	Excel::Parser::loadBook( fileName, book );
+}
+
+//! \return Sheet with given count of cells.
+std::shared_ptr< const Excel::Sheet > makeSheet( size_t cells )
+{
+	auto sheet = std::make_shared< Excel::Sheet > ( L"Sheet" );
+
+	for( size_t i = 0; i < cells; ++i )
+		sheet->setCell( i, 0, static_cast< double > ( i ) );
+
+	return sheet;
+}
+
+//! \return Hash.
+Excel::SheetHash makeHash( uint64_t value )
+{
+	Excel::SheetHash hash;
+	hash.m_hash = value;
+	hash.m_size = 100;
+
+	return hash;
+}
+
+
+TEST_CASE( "test_sheet_cache_books" )
+{
+	Excel::SheetCache cache;
+
+	for( const char * fileName : { "test/data/big.xls", "test/data/sample.xls",
+		"test/data/verybig.xls" } )
+	{
+		CAPTURE( fileName );
+
+		cache.clear();
+
+		Excel::Book reference( fileName );
+
+		Excel::Book first;
+		loadBook( fileName, first, cache );
+
+		REQUIRE( cache.hits() == 0 );
+		REQUIRE( cache.misses() == first.sheetsCount() );
+		REQUIRE( cache.size() == first.sheetsCount() );
+		REQUIRE( cache.memoryUsage() > 0 );
+
+		Excel::Book second;
+		loadBook( fileName, second, cache );
+
+		REQUIRE( cache.hits() == second.sheetsCount() );
+		REQUIRE( second.sheetsCount() == reference.sheetsCount() );
+
+		const Excel::Book & firstConst = first;
+		const Excel::Book & secondConst = second;
+
+		for( size_t i = 0; i < second.sheetsCount(); ++i )
+		{
+			REQUIRE( secondConst.sheet( i ) == firstConst.sheet( i ) );
+			REQUIRE( secondConst.sheet( i )->sheetHeader() == reference.sheet( i )->sheetHeader() );
+
+			requireSameSheets( *reference.sheet( i ), *secondConst.sheet( i ) );
+		}
+
+		// Shared sheet is read-only, it's copied only on request.
+		const Excel::Sheet * shared = secondConst.sheet( 0 );
+
+		REQUIRE( second.isSheetShared( 0 ) );
+		REQUIRE_THROWS_AS( second.sheet( 0 ), Excel::Exception );
+		REQUIRE( secondConst.sheet( 0 ) == shared );
+
+		Excel::Sheet * own = second.detachSheet( 0 );
+
+		REQUIRE( own != shared );
+		REQUIRE( !second.isSheetShared( 0 ) );
+		REQUIRE( second.sheet( 0 ) == own );
+		REQUIRE( second.detachSheet( 0 ) == own );
+		requireSameSheets( *reference.sheet( 0 ), *own );
+
+		own->setHeader( Excel::String( L"Changed" ) );
+
+		REQUIRE( firstConst.sheet( 0 ) == shared );
+		REQUIRE( shared->sheetHeader() == reference.sheet( 0 )->sheetHeader() );
+
+		Excel::Book third;
+		loadBook( fileName, third, cache );
+
+		const Excel::Book & thirdConst = third;
+
+		REQUIRE( thirdConst.sheet( 0 ) == shared );
+	}
+
+	// Book in arena doesn't use the cache, its sheets may not outlive it.
+	cache.clear();
+
+	Excel::MonotonicArena arena;
+	Excel::Book book( &arena );
+	loadBook( "test/data/big.xls", book, cache );
+
+	REQUIRE( cache.size() == 0 );
+	REQUIRE( cache.misses() == 0 );
+}
+
+//! Storage that gives own hashes of SST strings and keeps hashes of sheets.
+struct HashingStorage
+	:	public Excel::EmptyStorage
+{
+	explicit HashingStorage( uint64_t seed )
+		:	m_seed( seed )
+	{
+	}
+
+	uint64_t m_seed;
+	//! Hashes of the sheets.
+	std::vector< Excel::SheetHash > m_hashes;
+	//! Count of ended sheets.
+	size_t m_ended = 0;
+
+protected:
+	bool wantsSheetHash() const override
+	{
+		return true;
+	}
+
+	uint64_t sharedStringHash( size_t sstIndex ) override
+	{
+		return m_seed + sstIndex;
+	}
+
+	void onSheetHash( size_t sheetIdx, const Excel::SheetHash & hash ) override
+	{
+		// Hash comes before the end of the sheet.
+		REQUIRE( m_ended == sheetIdx );
+
+		m_hashes.push_back( hash );
+	}
+
+	void onSheetEnd( size_t ) override
+	{
+		++m_ended;
+	}
+}; // struct HashingStorage
+
+TEST_CASE( "test_sheet_hash" )
+{
+	std::ifstream fileStream( "test/data/test.xls", std::ios::in | std::ios::binary );
+
+	CompoundFile::File file( fileStream );
+	auto stream = file.stream( file.directory( L"Workbook" ) );
+
+	std::vector< Excel::BoundSheet > sheets;
+	Excel::EmptyStorage storage;
+	Excel::Parser::loadGlobals( sheets, *stream, storage );
+
+	REQUIRE( !sheets.empty() );
+
+	HashingStorage a( 1 );
+	HashingStorage b( 1 );
+	HashingStorage c( 1000 );
+
+	Excel::Parser::loadWorkSheet( 0, sheets[ 0 ], *stream, a );
+	Excel::Parser::loadWorkSheet( 0, sheets[ 0 ], *stream, b, true );
+	Excel::Parser::loadWorkSheet( 0, sheets[ 0 ], *stream, c );
+
+	REQUIRE( a.m_hashes.size() == 1 );
+	REQUIRE( b.m_hashes.size() == 1 );
+	REQUIRE( c.m_hashes.size() == 1 );
+
+	const Excel::SheetHash ha = a.m_hashes.front();
+	const Excel::SheetHash hb = b.m_hashes.front();
+	const Excel::SheetHash hc = c.m_hashes.front();
+
+	// Pipelined load gives the same hash.
+	REQUIRE( ha.m_size > 0 );
+	REQUIRE( ha == hb );
+
+	// Strings of SST are a part of the hash.
+	REQUIRE( ha != hc );
+	REQUIRE( ha.m_size == hc.m_size );
+}
+
+TEST_CASE( "test_sheet_cache_lru" )
+{
+	auto a = makeSheet( 100 );
+	auto b = makeSheet( 100 );
+	auto c = makeSheet( 100 );
+	auto big = makeSheet( 1000 );
+
+	const size_t bytes = a->memoryUsage();
+
+	REQUIRE( bytes >= 100 * sizeof( Excel::Cell ) );
+	REQUIRE( big->memoryUsage() > bytes * 3 );
+
+	Excel::SheetCache cache( bytes * 2 );
+
+	cache.insert( makeHash( 1 ), a );
+	cache.insert( makeHash( 2 ), b );
+
+	REQUIRE( cache.size() == 2 );
+	REQUIRE( cache.memoryUsage() == bytes * 2 );
+
+	// Used sheet stays, least recently used is dropped.
+	REQUIRE( cache.find( makeHash( 1 ) ) == a );
+
+	cache.insert( makeHash( 3 ), c );
+
+	REQUIRE( cache.size() == 2 );
+	REQUIRE( cache.find( makeHash( 1 ) ) == a );
+	REQUIRE( cache.find( makeHash( 2 ) ) == nullptr );
+	REQUIRE( cache.find( makeHash( 3 ) ) == c );
+
+	// Sheet bigger than the budget is not cached.
+	cache.insert( makeHash( 4 ), big );
+
+	REQUIRE( cache.find( makeHash( 4 ) ) == nullptr );
+	REQUIRE( cache.size() == 2 );
+
+	// The same hash is not replaced.
+	cache.insert( makeHash( 1 ), b );
+
+	REQUIRE( cache.find( makeHash( 1 ) ) == a );
+
+	REQUIRE( cache.hits() == 4 );
+	REQUIRE( cache.misses() == 2 );
+
+	cache.setBudget( bytes );
+
+	REQUIRE( cache.size() == 1 );
+	REQUIRE( cache.memoryUsage() <= bytes );
+	REQUIRE( cache.find( makeHash( 1 ) ) == a );
+
+	cache.clear();
+
+	REQUIRE( cache.size() == 0 );
+	REQUIRE( cache.memoryUsage() == 0 );
+	REQUIRE( cache.hits() == 0 );
+}
+
+TEST_CASE( "test_sheet_cache_threads" )
+{
+	Excel::SheetCache & cache = Excel::SheetCache::global();
+	cache.clear();
+
+	Excel::Book reference( "test/data/big.xls" );
+
+	std::vector< std::unique_ptr< Excel::Book > > books( 4 );
+	std::vector< std::thread > threads;
+
+	for( auto & book : books )
+	{
+		book.reset( new Excel::Book );
+
+		Excel::Book * b = book.get();
+
+		threads.emplace_back( [b, &cache] () { loadBook( "test/data/big.xls", *b, cache ); } );
+	}
+
+	for( auto & t : threads )
+		t.join();
+
+	REQUIRE( cache.size() == reference.sheetsCount() );
+	REQUIRE( cache.hits() + cache.misses() == books.size() * reference.sheetsCount() );
+
+	for( const auto & book : books )
+	{
+		const Excel::Book & b = *book;
+
+		for( size_t i = 0; i < b.sheetsCount(); ++i )
+			requireSameSheets( *reference.sheet( i ), *b.sheet( i ) );
+	}
+
+	cache.clear();
+}
@@ -0,0 +1,366 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/snapshot_cache.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+// POSIX include.
+#include <utime.h>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! Check that books are equal.
+void requireSameBooks( const Excel::Book & a, const Excel::Book & b )
+{
+	REQUIRE( a.dateMode() == b.dateMode() );
+	REQUIRE( a.sheetsCount() == b.sheetsCount() );
+
+	for( size_t s = 0; s < a.sheetsCount(); ++s )
+	{
+		const Excel::Sheet * sa = a.sheet( s );
+		const Excel::Sheet * sb = b.sheet( s );
+
+		REQUIRE( !sa == !sb );
+
+		if( !sa )
+			continue;
+
+		REQUIRE( sa->sheetName() == sb->sheetName() );
+		REQUIRE( sa->sheetHeader() == sb->sheetHeader() );
+		REQUIRE( sa->sheetFooter() == sb->sheetFooter() );
+		REQUIRE( sa->rowsCount() == sb->rowsCount() );
+		REQUIRE( sa->columnsCount() == sb->columnsCount() );
+
+		for( size_t r = 0; r < sa->rowsCount(); ++r )
+		{
+			for( size_t c = 0; c < sa->columnsCount(); ++c )
+			{
+				const Excel::Cell & ca = sa->cell( r, c );
+				const Excel::Cell & cb = sb->cell( r, c );
+
+				REQUIRE( ca.dataType() == cb.dataType() );
+				REQUIRE( ca.isNull() == cb.isNull() );
+
+				switch( ca.dataType() )
+				{
+					case Excel::Cell::DataType::String :
+						REQUIRE( ca.getString() == cb.getString() );
+						break;
+
+					case Excel::Cell::DataType::Double :
+						REQUIRE( ca.getDouble() == cb.getDouble() );
+						break;
+
+					case Excel::Cell::DataType::Formula :
+					{
+						const Excel::Formula & fa = ca.getFormula();
+						const Excel::Formula & fb = cb.getFormula();
+
+						REQUIRE( fa.valueType() == fb.valueType() );
+						REQUIRE( fa.getRow() == fb.getRow() );
+						REQUIRE( fa.getColumn() == fb.getColumn() );
+						REQUIRE( fa.getString() == fb.getString() );
+						REQUIRE( fa.getBoolean() == fb.getBoolean() );
+						REQUIRE( fa.getErrorValue() == fb.getErrorValue() );
+
+						if( fa.valueType() == Excel::Formula::DoubleValue )
+							REQUIRE( fa.getDouble() == fb.getDouble() );
+					}
+						break;
+
+					default :
+						break;
+				}
+			}
+		}
+	}
+}
+
+//! Write generated workbook to the file.
+void writeWorkbook( const std::string & fileName, size_t rows )
+{
+	GeneratorOptions opts;
+	opts.m_rows = rows;
+	opts.m_columns = 10;
+	opts.m_sheets = 2;
+	opts.m_sstSize = 50;
+	opts.m_stringEvery = 3;
+	opts.m_wideStrings = true;
+	opts.m_formulaEvery = 4;
+	opts.m_formulaStringEvery = 2;
+	opts.m_fractions = true;
+
+	std::ofstream stream( fileName, std::ios::out | std::ios::binary | std::ios::trunc );
+
+	generateWorkbook( opts, stream );
+}
+
+//! Set modification time of the file.
+void setTime( const std::string & fileName, time_t t )
+{
+	utimbuf times;
+	times.actime = t;
+	times.modtime = t;
+
+	REQUIRE( utime( fileName.c_str(), &times ) == 0 );
+}
+
+
+TEST_CASE( "test_snapshot_files" )
+{
+	for( const char * fileName : { "test/data/test.xls", "test/data/sample.xls",
+		"test/data/big.xls", "test/data/stringformula.xls", "test/data/datetime.xls",
+		"test/data/MiscOperatorTests.xls", "test/data/strange.xls", "test/data/verybig.xls" } )
+	{
+		CAPTURE( fileName );
+
+		Excel::Book book( fileName );
+
+		Excel::SnapshotKey key;
+		key.m_size = 1;
+		key.m_mtime = 2;
+		key.m_hash = 3;
+
+		book.saveSnapshot( "test.snapshot", key );
+
+		Excel::Book restored;
+		const Excel::SnapshotKey source = restored.loadSnapshot( "test.snapshot" );
+
+		REQUIRE( source.m_size == 1 );
+		REQUIRE( source.m_mtime == 2 );
+		REQUIRE( source.m_hash == 3 );
+
+		requireSameBooks( book, restored );
+
+		// Loading replaces previous content.
+		restored.loadSnapshot( "test.snapshot" );
+
+		requireSameBooks( book, restored );
+	}
+
+	std::remove( "test.snapshot" );
+}
+
+TEST_CASE( "test_snapshot_generated" )
+{
+	writeWorkbook( "test.snapshot.xls", 3000 );
+
+	Excel::Book book( "test.snapshot.xls" );
+
+	book.saveSnapshot( "test.snapshot" );
+
+	Excel::Book restored;
+	restored.loadSnapshot( "test.snapshot" );
+
+	REQUIRE( restored.sheetsCount() == 2 );
+	REQUIRE( restored.sheet( 1 )->rowsCount() == 3000 );
+
+	requireSameBooks( book, restored );
+
+	std::remove( "test.snapshot" );
+	std::remove( "test.snapshot.xls" );
+}
+
+TEST_CASE( "test_snapshot_concurrent_writers" )
+{
+	REQUIRE( Excel::Snapshot::tempName( "test.snapshot" ) !=
+		Excel::Snapshot::tempName( "test.snapshot" ) );
+
+	Excel::Book expected( "test/data/big.xls" );
+
+	std::vector< std::thread > writers;
+
+	for( int i = 0; i < 4; ++i )
+	{
+		writers.emplace_back( [] ()
+			{
+				Excel::Book book( "test/data/big.xls" );
+
+				for( int j = 0; j < 5; ++j )
+					book.saveSnapshot( "test.snapshot" );
+			} );
+	}
+
+	for( auto & t : writers )
+		t.join();
+
+	// Every writer has own temporary file, so the last renamed is whole.
+	Excel::Book restored;
+	restored.loadSnapshot( "test.snapshot" );
+
+	requireSameBooks( expected, restored );
+
+	std::remove( "test.snapshot" );
+}
+
+TEST_CASE( "test_snapshot_broken" )
+{
+	Excel::Book book( "test/data/big.xls" );
+
+	book.saveSnapshot( "test.snapshot" );
+
+	std::string content;
+
+	{
+		std::ifstream stream( "test.snapshot", std::ios::in | std::ios::binary );
+		std::stringstream buffer;
+		buffer << stream.rdbuf();
+		content = buffer.str();
+	}
+
+	auto write = [] ( const std::string & data )
+	{
+		std::ofstream stream( "test.snapshot", std::ios::out | std::ios::binary | std::ios::trunc );
+		stream.write( data.data(), static_cast< std::streamsize > ( data.size() ) );
+	};
+
+	Excel::Book restored;
+
+	// Truncated.
+	write( content.substr( 0, content.size() - 1 ) );
+	REQUIRE_THROWS_AS( restored.loadSnapshot( "test.snapshot" ), Excel::Exception );
+
+	write( content.substr( 0, 10 ) );
+	REQUIRE_THROWS_AS( restored.loadSnapshot( "test.snapshot" ), Excel::Exception );
+
+	// Another version.
+	std::string changed = content;
+	changed[ 8 ] = 2;
+	write( changed );
+	REQUIRE_THROWS_AS( restored.loadSnapshot( "test.snapshot" ), Excel::Exception );
+
+	Excel::SnapshotKey key;
+	REQUIRE_FALSE( Excel::Snapshot::readKey( "test.snapshot", key ) );
+
+	// String index out of range in the first cell.
+	changed = content;
+	Excel::Snapshot::Header header;
+	std::memcpy( &header, content.data(), sizeof( header ) );
+	const uint32_t wrongString = static_cast< uint32_t > ( header.m_stringsCount );
+	std::memcpy( &changed[ static_cast< size_t > ( header.m_cellsOffset ) + 8 ],
+		&wrongString, 4 );
+	write( changed );
+	REQUIRE_THROWS_AS( restored.loadSnapshot( "test.snapshot" ), Excel::Exception );
+
+	REQUIRE_THROWS_AS( restored.loadSnapshot( "test.snapshot.none" ), Excel::Exception );
+
+	std::remove( "test.snapshot" );
+}
+
+TEST_CASE( "test_snapshot_hash" )
+{
+	std::istringstream a( std::string( 100000, 'a' ) );
+	std::istringstream b( std::string( 100000, 'a' ) + std::string( 1, '\0' ) );
+	std::istringstream c( std::string( 99999, 'a' ) + "b" );
+	std::istringstream d( std::string( 100000, 'a' ) );
+
+	const uint64_t ha = Excel::Snapshot::contentHash( a );
+
+	REQUIRE( ha != Excel::Snapshot::contentHash( b ) );
+	REQUIRE( ha != Excel::Snapshot::contentHash( c ) );
+	REQUIRE( ha == Excel::Snapshot::contentHash( d ) );
+}
+
+TEST_CASE( "test_snapshot_cache" )
+{
+	const std::string fileName = "test.snapshot.xls";
+
+	writeWorkbook( fileName, 500 );
+	setTime( fileName, 1000000000 );
+
+	Excel::SnapshotCache cache( "." );
+	const std::string path = cache.snapshotPath( fileName );
+
+	std::remove( path.c_str() );
+
+	Excel::Book parsed;
+	REQUIRE_FALSE( cache.load( fileName, parsed ) );
+
+	Excel::SnapshotKey key;
+	REQUIRE( Excel::Snapshot::readKey( path, key ) );
+	REQUIRE( key.m_size == Excel::Snapshot::fileKey( fileName ).m_size );
+	REQUIRE( key.m_hash == Excel::Snapshot::fileKey( fileName ).m_hash );
+
+	// The same file.
+	Excel::Book cached;
+	REQUIRE( cache.load( fileName, cached ) );
+	requireSameBooks( parsed, cached );
+
+	// Touched file with the same content.
+	setTime( fileName, 1100000000 );
+
+	Excel::Book touched;
+	REQUIRE( cache.load( fileName, touched ) );
+	requireSameBooks( parsed, touched );
+
+	REQUIRE( Excel::Snapshot::readKey( path, key ) );
+	REQUIRE( key.m_mtime == Excel::Snapshot::fileKey( fileName, false ).m_mtime );
+
+	// Size and time are the same, the file is not read.
+	Excel::Book empty;
+	empty.saveSnapshot( path, Excel::Snapshot::fileKey( fileName ) );
+
+	Excel::Book trusted;
+	REQUIRE( cache.load( fileName, trusted ) );
+	REQUIRE( trusted.sheetsCount() == 0 );
+
+	// Another time and content.
+	key = Excel::Snapshot::fileKey( fileName );
+	key.m_mtime -= 1;
+	key.m_hash ^= 1;
+	empty.saveSnapshot( path, key );
+
+	Excel::Book changed;
+	REQUIRE_FALSE( cache.load( fileName, changed ) );
+	requireSameBooks( parsed, changed );
+
+	// Another size.
+	writeWorkbook( fileName, 400 );
+
+	Excel::Book reparsed;
+	REQUIRE_FALSE( cache.load( fileName, reparsed ) );
+	REQUIRE( reparsed.sheet( 0 )->rowsCount() == 400 );
+
+	// Broken snapshot is written again.
+	std::string content;
+
+	{
+		std::ifstream stream( path, std::ios::in | std::ios::binary );
+		std::stringstream buffer;
+		buffer << stream.rdbuf();
+		content = buffer.str();
+	}
+
+	{
+		std::ofstream stream( path, std::ios::out | std::ios::binary | std::ios::trunc );
+		stream.write( content.data(), static_cast< std::streamsize > ( content.size() / 2 ) );
+	}
+
+	Excel::Book repaired;
+	REQUIRE_FALSE( cache.load( fileName, repaired ) );
+	requireSameBooks( reparsed, repaired );
+
+	Excel::Book again;
+	REQUIRE( cache.load( fileName, again ) );
+	requireSameBooks( reparsed, again );
+
+	std::remove( path.c_str() );
+	std::remove( fileName.c_str() );
+}
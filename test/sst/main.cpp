@@ -45,11 +45,21 @@ struct TestSstStorage : public Excel::EmptyStorage {
 }; // struct TestSstStorage
 
 inline void
-TestSstStorage::onSharedString( size_t sstSize, size_t idx, const std::wstring & value )
+TestSstStorage::onSharedString( size_t, size_t, const std::wstring & value )
 {
 	m_sst.push_back( value );
 }
 
+struct TestSstUtf8Storage : public Excel::EmptyStorage {
+	std::vector< std::string > m_sst;
+	StringEncoding stringEncoding() const override { return StringEncoding::Utf8; }
+	void onSharedString( size_t, size_t, const std::wstring & ) override { FAIL( "" ); }
+	void onSharedStringUtf8( size_t, size_t, const std::string & value ) override
+	{
+		m_sst.push_back( value );
+	}
+}; // struct TestSstUtf8Storage
+
 //
 // test_sst
 //
@@ -69,3 +79,46 @@ TEST_CASE( "test_sst" )
 	REQUIRE( sst.m_sst[ 1 ] == L"QRQRQRQRQRQRQRQR" );
 	REQUIRE( sst.m_sst[ 2 ] == L"QRQRQRQRQRQRQRQR" );
 }
+
+TEST_CASE( "test_sst_utf8" )
+{
+	TestStream testStream( &data[ 0 ], 106 );
+
+	Excel::Record record( testStream );
+
+	TestSstUtf8Storage sst;
+	Excel::Parser::parseSST( record, sst );
+
+	REQUIRE( sst.m_sst.size() == 3 );
+
+	REQUIRE( sst.m_sst[ 0 ] == "STSTSTSTSTSTSTST" );
+	REQUIRE( sst.m_sst[ 1 ] == "QRQRQRQRQRQRQRQR" );
+	REQUIRE( sst.m_sst[ 2 ] == "QRQRQRQRQRQRQRQR" );
+}
+
+struct TestSstViewStorage : public Excel::EmptyStorage {
+	std::vector< std::wstring > m_sst;
+	void onSharedString( size_t, size_t, const std::wstring & ) override { FAIL( "" ); }
+	void onSharedStringView( size_t, size_t idx, Excel::StringView value ) override
+	{
+		REQUIRE( idx == m_sst.size() );
+
+		m_sst.push_back( value.str() );
+	}
+}; // struct TestSstViewStorage
+
+TEST_CASE( "test_sst_view" )
+{
+	TestStream testStream( &data[ 0 ], 106 );
+
+	Excel::Record record( testStream );
+
+	TestSstViewStorage sst;
+	Excel::Parser::parseSST( record, sst );
+
+	REQUIRE( sst.m_sst.size() == 3 );
+
+	REQUIRE( sst.m_sst[ 0 ] == L"STSTSTSTSTSTSTST" );
+	REQUIRE( sst.m_sst[ 1 ] == L"QRQRQRQRQRQRQRQR" );
+	REQUIRE( sst.m_sst[ 2 ] == L"QRQRQRQRQRQRQRQR" );
+}
@@ -0,0 +1,186 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+#include <read-excel/parse_stats.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <sstream>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+TEST_CASE( "test_parse_stats" )
+{
+	REQUIRE( Excel::ParseStats::enabled() );
+
+	GeneratorOptions opts;
+	opts.m_rows = 50;
+	opts.m_columns = 4;
+	opts.m_sheets = 2;
+	opts.m_sstSize = 20;
+	opts.m_stringLength = 100;
+	opts.m_stringEvery = 3;
+	opts.m_maxRecordSize = 64;
+	opts.m_formulaEvery = 5;
+	opts.m_formulaStringEvery = 2;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+	generateWorkbook( opts, stream );
+	stream.seekg( 0 );
+
+	uint64_t labels = 0;
+	uint64_t formulas = 0;
+	uint64_t stringFormulas = 0;
+	uint64_t characters = opts.m_sstSize * opts.m_stringLength + 6 * 2;
+
+	for( int32_t r = 0; r < opts.m_rows; ++r )
+	{
+		for( int32_t c = 0; c < opts.m_columns; ++c )
+		{
+			switch( WorkbookWriter::cellType( opts, r, c ) )
+			{
+				case 1 :
+					++labels;
+					break;
+
+				case 2 :
+					++formulas;
+
+					if( WorkbookWriter::isStringFormula( opts, r, c ) )
+					{
+						++stringFormulas;
+						characters += WorkbookWriter::formulaString( r, c ).size() * 2;
+					}
+					break;
+
+				default :
+					break;
+			}
+		}
+	}
+
+	Excel::ParseStats stats;
+
+	{
+		Excel::ParseStatsScope scope( stats );
+
+		Excel::Book book( stream );
+
+		REQUIRE( book.sheetsCount() == 2 );
+	}
+
+	REQUIRE( stats.records( Excel::XL_BOF ) == 3 );
+	REQUIRE( stats.records( Excel::XL_EOF ) == 3 );
+	REQUIRE( stats.records( Excel::XL_BOUNDSHEET ) == 2 );
+	REQUIRE( stats.records( Excel::XL_SST ) == 1 );
+	REQUIRE( stats.records( Excel::XL_LABELSST ) == labels * 2 );
+	REQUIRE( stats.records( Excel::XL_FORMULA ) == formulas * 2 );
+	REQUIRE( stats.records( Excel::XL_STRING ) == stringFormulas * 2 );
+	REQUIRE( stats.records( Excel::XL_CONTINUE ) == 0 );
+	REQUIRE( stats.m_continues > 20 * 100 / 64 );
+
+	REQUIRE( stats.m_strings == opts.m_sstSize + 2 + stringFormulas * 2 );
+	REQUIRE( stats.m_characters == characters );
+
+	REQUIRE( stats.m_bytesRead > 0 );
+	REQUIRE( stats.m_sectorsFetched > 0 );
+	REQUIRE( stats.m_seeks > 0 );
+
+	REQUIRE( stats.m_compoundFileTime.count() > 0 );
+	REQUIRE( stats.m_globalsTime.count() > 0 );
+	REQUIRE( stats.m_sstTime.count() > 0 );
+	REQUIRE( stats.m_globalsTime >= stats.m_sstTime );
+	REQUIRE( stats.m_sheetsTime.size() == 2 );
+	REQUIRE( stats.m_sheetsTime[ 0 ].count() > 0 );
+	REQUIRE( stats.m_sheetsTime[ 1 ].count() > 0 );
+}
+
+TEST_CASE( "test_parse_stats_scope" )
+{
+	Excel::ParseStats outer;
+	Excel::ParseStats inner;
+
+	{
+		Excel::ParseStatsScope outerScope( outer );
+
+		{
+			Excel::ParseStatsScope innerScope( inner );
+
+			Excel::Book book( "test/data/test.xls" );
+		}
+
+		REQUIRE( inner.records( Excel::XL_BOF ) == 2 );
+		REQUIRE( outer.records( Excel::XL_BOF ) == 0 );
+
+		Excel::Book book( "test/data/sample.xls" );
+	}
+
+	REQUIRE( outer.records( Excel::XL_BOF ) == 2 );
+	REQUIRE( inner.records( Excel::XL_BOF ) == 2 );
+
+	// Nothing is collected without scope.
+	Excel::Book book( "test/data/test.xls" );
+
+	REQUIRE( outer.records( Excel::XL_BOF ) == 2 );
+	REQUIRE( inner.records( Excel::XL_BOF ) == 2 );
+}
+
+TEST_CASE( "test_parse_stats_pipelined" )
+{
+	Excel::ParseStats sequential;
+	Excel::ParseStats pipelined;
+
+	for( const bool pipeline : { false, true } )
+	{
+		CompoundFile::File file( "test/data/big.xls" );
+		file.setPipelined( pipeline );
+
+		Excel::ParseStatsScope scope( pipeline ? pipelined : sequential );
+
+		Excel::Book book;
+
+		Excel::Parser::loadBook( file, book );
+	}
+
+	// Counters of the reading thread are added to the scope of the caller.
+	REQUIRE( pipelined.m_records == sequential.m_records );
+	REQUIRE( pipelined.m_continues == sequential.m_continues );
+	REQUIRE( pipelined.m_strings == sequential.m_strings );
+	REQUIRE( pipelined.m_characters == sequential.m_characters );
+	REQUIRE( pipelined.m_bytesRead == sequential.m_bytesRead );
+	REQUIRE( pipelined.m_sheetsTime.size() == sequential.m_sheetsTime.size() );
+}
+
+TEST_CASE( "test_parse_stats_preload" )
+{
+	CompoundFile::File file( "test/data/big.xls" );
+	file.setPreload();
+
+	const auto dir = file.directory( L"Workbook" );
+
+	Excel::ParseStats stats;
+
+	{
+		Excel::ParseStatsScope scope( stats );
+
+		Excel::Book book;
+
+		Excel::Parser::loadBook( file, book );
+	}
+
+	// Workbook is read at once, all seeks are in memory.
+	REQUIRE( stats.m_bytesRead >= static_cast< uint64_t > ( dir.streamSize() ) );
+	REQUIRE( stats.m_bytesRead < static_cast< uint64_t > ( dir.streamSize() ) + 512 );
+	REQUIRE( stats.m_sectorsFetched == ( stats.m_bytesRead + 511 ) / 512 );
+	REQUIRE( stats.m_compoundFileTime.count() == 0 );
+}
@@ -81,3 +81,109 @@ TEST_CASE( "test_string" )
 
 	REQUIRE( str == L"this is red ink" );
 }
+
+TEST_CASE( "test_string_utf8" )
+{
+	std::vector< int32_t > borders;
+
+	TestStream stream( &data[ 0 ], 159 );
+
+	for( int i = 0; i < 6; ++i )
+		REQUIRE( Excel::loadStringUtf8( stream, borders ) == "this is red ink" );
+}
+
+//! \return XLS string with given UTF-16 characters.
+std::vector< char > makeString( const std::u16string & str, bool wide )
+{
+	std::vector< char > res;
+	res.push_back( static_cast< char > ( str.size() & 0xFF ) );
+	res.push_back( static_cast< char > ( str.size() >> 8 ) );
+	res.push_back( wide ? 0x01 : 0x00 );
+
+	for( const auto c : str )
+	{
+		res.push_back( static_cast< char > ( c & 0xFF ) );
+
+		if( wide )
+			res.push_back( static_cast< char > ( c >> 8 ) );
+	}
+
+	return res;
+}
+
+//! \return UTF-8 string loaded from XLS string with given characters.
+std::string loadUtf8( const std::u16string & str, bool wide )
+{
+	const auto bytes = makeString( str, wide );
+	Excel::MemoryStream stream( bytes.data(), static_cast< int32_t > ( bytes.size() ) );
+
+	return Excel::loadStringUtf8( stream, std::vector< int32_t > () );
+}
+
+TEST_CASE( "test_string_utf8_non_ascii" )
+{
+	REQUIRE( loadUtf8( u"caf\u00E9", false ) == "caf\xC3\xA9" );
+	REQUIRE( loadUtf8( u"caf\u00E9", true ) == "caf\xC3\xA9" );
+	REQUIRE( loadUtf8( u"\u041F\u0440\u0438\u0432\u0435\u0442", true ) ==
+		"\xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82" );
+	REQUIRE( loadUtf8( u"\u20AC", true ) == "\xE2\x82\xAC" );
+	REQUIRE( loadUtf8( u"a\U0001F600b", true ) == "a\xF0\x9F\x98\x80" "b" );
+
+	// Unpaired surrogates.
+	REQUIRE( loadUtf8( std::u16string( 1, char16_t( 0xD83D ) ) + u"a", true ) ==
+		"\xEF\xBF\xBD" "a" );
+	REQUIRE( loadUtf8( std::u16string( 1, char16_t( 0xDE00 ) ), true ) == "\xEF\xBF\xBD" );
+	REQUIRE( loadUtf8( std::u16string( 1, char16_t( 0xD83D ) ), true ) == "\xEF\xBF\xBD" );
+}
+
+TEST_CASE( "test_string_utf8_blocks" )
+{
+	// Long enough for SIMD blocks, with non-ASCII characters in some of them.
+	std::u16string str;
+	std::string expected;
+
+	for( int i = 0; i < 100; ++i )
+	{
+		if( i % 37 == 5 )
+		{
+			str.push_back( 0x00E9 );
+			expected += "\xC3\xA9";
+		}
+		else
+		{
+			str.push_back( static_cast< char16_t > ( 'a' + i % 26 ) );
+			expected.push_back( static_cast< char > ( 'a' + i % 26 ) );
+		}
+	}
+
+	REQUIRE( loadUtf8( str, false ) == expected );
+	REQUIRE( loadUtf8( str, true ) == expected );
+
+	// Surrogate pair on the border of the block.
+	std::u16string pair( 15, u'x' );
+	pair += u"\U0001F600";
+	pair += std::u16string( 20, u'y' );
+
+	REQUIRE( loadUtf8( pair, true ) == std::string( 15, 'x' ) + "\xF0\x9F\x98\x80" +
+		std::string( 20, 'y' ) );
+}
+
+TEST_CASE( "test_string_utf8_continue" )
+{
+	// 4 compressed characters, then CONTINUE with UTF-16 characters.
+	const auto data = make_data(
+		0x08u, 0x00u, 0x00u, 0x61u, 0x62u, 0x63u, 0x64u,
+		0x01u, 0x3Du, 0xD8u, 0x00u, 0xDEu, 0x1Fu, 0x04u, 0x65u, 0x00u );
+
+	const std::vector< int32_t > borders = { 7 };
+
+	TestStream stream( &data[ 0 ], static_cast< int32_t > ( data.size() ) );
+
+	REQUIRE( Excel::loadStringUtf8( stream, borders ) ==
+		"abcd\xF0\x9F\x98\x80\xD0\x9F" "e" );
+
+	stream.seek( 0 );
+
+	REQUIRE( Excel::loadString( stream, borders ) ==
+		std::wstring( L"abcd" ) + wchar_t( 0xD83D ) + wchar_t( 0xDE00 ) + L"\u041Fe" );
+}
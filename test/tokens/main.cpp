@@ -0,0 +1,367 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <set>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+//! \return Options of the generated workbook.
+GeneratorOptions options( bool shared, bool array )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 300;
+	opts.m_columns = 6;
+	opts.m_sheets = 2;
+	opts.m_sstSize = 10;
+	opts.m_stringEvery = 5;
+	opts.m_formulaEvery = 4;
+	opts.m_formulaStringEvery = 3;
+	opts.m_sharedFormulas = shared;
+	opts.m_arrayFormulas = array;
+
+	return opts;
+}
+
+//! Check values of the formulas.
+void checkValues( const GeneratorOptions & opts, const Excel::Book & book )
+{
+	REQUIRE( book.sheetsCount() == static_cast< size_t > ( opts.m_sheets ) );
+
+	for( size_t i = 0; i < book.sheetsCount(); ++i )
+	{
+		const Excel::Sheet & sheet = *book.sheet( i );
+
+		for( int32_t r = 0; r < opts.m_rows; ++r )
+		{
+			for( int32_t c = 0; c < opts.m_columns; ++c )
+			{
+				if( WorkbookWriter::cellType( opts, r, c ) != 2 )
+					continue;
+
+				const Excel::Cell & cell = sheet.cell( r, c );
+
+				REQUIRE( cell.dataType() == Excel::Cell::DataType::Formula );
+
+				const Excel::Formula & f = cell.getFormula();
+
+				if( WorkbookWriter::isStringFormula( opts, r, c ) )
+				{
+					const std::u16string str = WorkbookWriter::formulaString( r, c );
+
+					REQUIRE( f.valueType() == Excel::Formula::StringValue );
+					REQUIRE( f.getString() == Excel::String( str.cbegin(), str.cend() ) );
+				}
+				else
+				{
+					REQUIRE( f.valueType() == Excel::Formula::DoubleValue );
+					REQUIRE( f.getDouble() == WorkbookWriter::cellValue( opts, r, c ) );
+				}
+			}
+		}
+	}
+}
+
+
+TEST_CASE( "test_tokens_off" )
+{
+	// SHRFMLA and ARRAY are between FORMULA and STRING with its value.
+	for( const bool array : { false, true } )
+	{
+		const GeneratorOptions opts = options( true, array );
+		const std::string data = generate( opts );
+
+		for( const bool pipelined : { false, true } )
+		{
+			CAPTURE( array );
+			CAPTURE( pipelined );
+
+			Excel::Book book;
+			load( data, book, false, pipelined );
+
+			checkValues( opts, book );
+
+			REQUIRE( !book.sheet( 0 )->cell( 0, 3 ).getFormula().tokens() );
+		}
+	}
+}
+
+TEST_CASE( "test_tokens_cell" )
+{
+	const GeneratorOptions opts = options( false, false );
+	const std::string data = generate( opts );
+
+	Excel::Book book;
+	book.setFormulaTokens();
+
+	load( data, book, true, false );
+
+	checkValues( opts, book );
+
+	const Excel::Sheet & sheet = *book.sheet( 1 );
+
+	for( int32_t r = 0; r < opts.m_rows; ++r )
+	{
+		for( int32_t c = 0; c < opts.m_columns; ++c )
+		{
+			if( WorkbookWriter::cellType( opts, r, c ) != 2 )
+				continue;
+
+			const Excel::Formula & f = sheet.cell( r, c ).getFormula();
+			const auto & tokens = f.tokens();
+
+			REQUIRE( tokens );
+			REQUIRE( tokens->kind() == Excel::FormulaTokens::CellFormula );
+			REQUIRE( tokens->firstRow() == r );
+			REQUIRE( tokens->lastRow() == r );
+			REQUIRE( tokens->firstColumn() == c );
+			REQUIRE( f.rowOffset() == 0 );
+			REQUIRE( f.columnOffset() == 0 );
+			REQUIRE( tokens->extraSize() == 0 );
+
+			if( WorkbookWriter::isStringFormula( opts, r, c ) )
+			{
+				// ptgStr.
+				REQUIRE( tokens->tokens()[ 0 ] == 0x17 );
+			}
+			else
+			{
+				// Two ptgNum and ptgMul.
+				REQUIRE( tokens->tokensSize() == 19 );
+				REQUIRE( tokens->tokens()[ 0 ] == 0x1F );
+				REQUIRE( tokens->tokens()[ 18 ] == 0x05 );
+
+				double v = 0.0;
+				std::memcpy( &v, tokens->tokens() + 1, 8 );
+
+				REQUIRE( v == WorkbookWriter::cellValue( opts, r, c ) );
+			}
+		}
+	}
+}
+
+TEST_CASE( "test_tokens_shared" )
+{
+	const std::vector< char > expected = WorkbookWriter::sharedTokens();
+
+	for( const bool array : { false, true } )
+	{
+		const GeneratorOptions opts = options( true, array );
+		const std::string data = generate( opts );
+
+		for( const bool preload : { false, true } )
+		{
+			for( const bool pipelined : { false, true } )
+			{
+				CAPTURE( array );
+				CAPTURE( preload );
+				CAPTURE( pipelined );
+
+				Excel::Book book;
+				book.setFormulaTokens();
+
+				load( data, book, preload, pipelined );
+
+				checkValues( opts, book );
+
+				const Excel::Sheet & sheet = *book.sheet( 0 );
+				std::set< const Excel::FormulaTokens* > unique;
+				size_t columns = 0;
+
+				for( int32_t c = 0; c < opts.m_columns; ++c )
+				{
+					const auto rows = WorkbookWriter::formulaRows( opts, c );
+
+					if( rows.first < 0 )
+						continue;
+
+					++columns;
+
+					const auto & first = sheet.cell( rows.first, c ).getFormula().tokens();
+
+					REQUIRE( first );
+					REQUIRE( first->kind() == ( array ? Excel::FormulaTokens::ArrayFormula :
+						Excel::FormulaTokens::SharedFormula ) );
+					REQUIRE( first->firstRow() == rows.first );
+					REQUIRE( first->lastRow() == rows.second );
+					REQUIRE( first->firstColumn() == c );
+					REQUIRE( first->lastColumn() == c );
+					REQUIRE( first->tokensSize() == expected.size() );
+					REQUIRE( std::memcmp( first->tokens(), expected.data(), expected.size() ) == 0 );
+
+					for( int32_t r = rows.first; r <= rows.second; ++r )
+					{
+						if( WorkbookWriter::cellType( opts, r, c ) != 2 )
+							continue;
+
+						const Excel::Formula & f = sheet.cell( r, c ).getFormula();
+
+						REQUIRE( f.tokens().get() == first.get() );
+						REQUIRE( f.rowOffset() == r - rows.first );
+						REQUIRE( f.columnOffset() == 0 );
+
+						unique.insert( f.tokens().get() );
+					}
+				}
+
+				REQUIRE( columns > 1 );
+				REQUIRE( unique.size() == columns );
+			}
+		}
+	}
+}
+
+TEST_CASE( "test_tokens_anchor_without_range" )
+{
+	// PtgExp of the first formula points to itself, but SHRFMLA isn't
+	// written, so FORMULA is followed by the next cell or STRING.
+	GeneratorOptions opts = options( true, false );
+	opts.m_noSharedRecords = true;
+
+	const std::string data = generate( opts );
+
+	size_t followedByCell = 0;
+
+	for( int32_t c = 0; c + 1 < opts.m_columns; ++c )
+	{
+		const auto rows = WorkbookWriter::formulaRows( opts, c );
+
+		if( rows.first >= 0 && !WorkbookWriter::isStringFormula( opts, rows.first, c ) &&
+			WorkbookWriter::cellType( opts, rows.first, c + 1 ) != 2 )
+		{
+			++followedByCell;
+		}
+	}
+
+	REQUIRE( followedByCell > 0 );
+
+	Excel::Book expected;
+	load( generate( options( false, false ) ), expected, true, false );
+
+	for( const bool tokens : { false, true } )
+	{
+		for( const bool pipelined : { false, true } )
+		{
+			CAPTURE( tokens );
+			CAPTURE( pipelined );
+
+			Excel::Book book;
+			book.setFormulaTokens( tokens );
+
+			load( data, book, false, pipelined );
+
+			checkValues( opts, book );
+
+			for( size_t i = 0; i < book.sheetsCount(); ++i )
+			{
+				const Excel::Sheet & sheet = *book.sheet( i );
+				const Excel::Sheet & expectedSheet = *expected.sheet( i );
+
+				REQUIRE( sheet.rowsCount() == expectedSheet.rowsCount() );
+				REQUIRE( sheet.columnsCount() == expectedSheet.columnsCount() );
+
+				for( size_t r = 0; r < sheet.rowsCount(); ++r )
+				{
+					for( size_t c = 0; c < sheet.columnsCount(); ++c )
+					{
+						const Excel::Cell & cell = sheet.cell( r, c );
+						const Excel::Cell & expectedCell = expectedSheet.cell( r, c );
+
+						REQUIRE( cell.dataType() == expectedCell.dataType() );
+						REQUIRE( cell.getDouble() == expectedCell.getDouble() );
+						REQUIRE( cell.getString() == expectedCell.getString() );
+					}
+				}
+			}
+
+			if( tokens )
+			{
+				// Not resolved PtgExp is kept as tokens of the cell.
+				const auto rows = WorkbookWriter::formulaRows( opts, 3 );
+				const auto & f = book.sheet( 0 )->cell( rows.first, 3 ).getFormula().tokens();
+
+				REQUIRE( f );
+				REQUIRE( f->kind() == Excel::FormulaTokens::CellFormula );
+				REQUIRE( f->tokensSize() == 5 );
+				REQUIRE( f->tokens()[ 0 ] == 0x01 );
+			}
+		}
+	}
+}
+
+TEST_CASE( "test_tokens_memory" )
+{
+	GeneratorOptions opts = options( true, false );
+	opts.m_rows = 5000;
+
+	const std::string shared = generate( opts );
+
+	opts.m_sharedFormulas = false;
+
+	const std::string single = generate( opts );
+
+	Excel::Book values;
+	load( shared, values, true, false );
+
+	Excel::Book sharedTokens;
+	sharedTokens.setFormulaTokens();
+	load( shared, sharedTokens, true, false );
+
+	Excel::Book singleTokens;
+	singleTokens.setFormulaTokens();
+	load( single, singleTokens, true, false );
+
+	const size_t base = values.sheet( 0 )->memoryUsage();
+
+	// Shared formulas take memory per column, not per cell.
+	REQUIRE( sharedTokens.sheet( 0 )->memoryUsage() - base <=
+		static_cast< size_t > ( opts.m_columns ) * 256 );
+	REQUIRE( singleTokens.sheet( 0 )->memoryUsage() - base >=
+		static_cast< size_t > ( opts.m_rows * opts.m_columns / opts.m_formulaEvery ) * 19 );
+}
+
+TEST_CASE( "test_tokens_sheet_cache" )
+{
+	const std::string data = generate( options( true, false ) );
+
+	Excel::SheetCache cache;
+
+	Excel::Book values;
+	values.setSheetCache( &cache );
+	load( data, values, true, false );
+
+	// Sheets decoded without tokens are not taken.
+	Excel::Book tokens;
+	tokens.setSheetCache( &cache );
+	tokens.setFormulaTokens();
+	load( data, tokens, true, false );
+
+	const Excel::Book & tokensConst = tokens;
+	const Excel::Book & valuesConst = values;
+
+	REQUIRE( tokensConst.sheet( 0 ) != valuesConst.sheet( 0 ) );
+	REQUIRE( tokensConst.sheet( 0 )->cell( 0, 3 ).getFormula().tokens() );
+
+	Excel::Book tokens2;
+	tokens2.setSheetCache( &cache );
+	tokens2.setFormulaTokens();
+	load( data, tokens2, true, false );
+
+	const Excel::Book & tokens2Const = tokens2;
+
+	// Shared sheets are read-only through the book.
+	REQUIRE( tokens2.isSheetShared( 0 ) );
+	REQUIRE( tokens2Const.sheet( 0 ) == tokensConst.sheet( 0 ) );
+}
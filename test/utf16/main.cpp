@@ -0,0 +1,107 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/book.hpp>
+
+// Test include.
+#include <test/generator/generator.hpp>
+
+// C++ include.
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// unit test helper.
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <test/doctest/doctest.h>
+
+
+static_assert( std::is_same< Excel::String, std::u16string >::value,
+	"READ_EXCEL_WITH_UTF16_STRINGS should be defined." );
+
+
+TEST_CASE( "test_utf16_book" )
+{
+	Excel::Book book( "test/data/test.xls" );
+
+	REQUIRE( book.sheetsCount() == 1 );
+
+	Excel::Sheet * sheet = book.sheet( 0 );
+
+	REQUIRE( sheet->sheetName() == u"Sheet" );
+	REQUIRE( sheet->cell( 0, 0 ).getString() == u"String #1" );
+	REQUIRE( sheet->cell( 1, 0 ).getString() == u"String #2" );
+	REQUIRE( sheet->cell( 2, 0 ).getString() == u"String #3" );
+
+	REQUIRE( Excel::toWString( sheet->cell( 0, 0 ).getString() ) == L"String #1" );
+}
+
+TEST_CASE( "test_utf16_wide_strings" )
+{
+	GeneratorOptions opts;
+	opts.m_rows = 100;
+	opts.m_columns = 10;
+	opts.m_sstSize = 30;
+	opts.m_stringLength = 50;
+	opts.m_stringEvery = 2;
+	opts.m_wideStrings = true;
+	opts.m_maxRecordSize = 64;
+	opts.m_formulaEvery = 7;
+	opts.m_formulaStringEvery = 2;
+
+	std::stringstream stream( std::ios::in | std::ios::out | std::ios::binary );
+
+	generateWorkbook( opts, stream );
+
+	stream.seekg( 0 );
+
+	Excel::Book book( stream );
+
+	Excel::Sheet * sheet = book.sheet( 0 );
+
+	size_t strings = 0;
+
+	for( int32_t r = 0; r < opts.m_rows; ++r )
+	{
+		for( int32_t c = 0; c < opts.m_columns; ++c )
+		{
+			const Excel::Cell & cell = sheet->cell( r, c );
+			const int64_t k = static_cast< int64_t > ( r ) * opts.m_columns + c + 1;
+
+			if( WorkbookWriter::cellType( opts, r, c ) == 1 )
+			{
+				REQUIRE( cell.getString() == WorkbookWriter::sstString( opts,
+					static_cast< int32_t > ( k % opts.m_sstSize ) ) );
+
+				++strings;
+			}
+			else if( WorkbookWriter::cellType( opts, r, c ) == 2 &&
+				WorkbookWriter::isStringFormula( opts, r, c ) )
+			{
+				REQUIRE( cell.getFormula().getString() ==
+					WorkbookWriter::formulaString( r, c ) );
+			}
+		}
+	}
+
+	REQUIRE( strings > 0 );
+}
+
+TEST_CASE( "test_utf16_to_wstring" )
+{
+	const Excel::String str = { u'a', 0xD83D, 0xDE00, u'b' };
+
+	const std::wstring wide = Excel::toWString( str );
+
+	if( sizeof( wchar_t ) == 4 )
+	{
+		REQUIRE( wide.size() == 3 );
+		REQUIRE( wide[ 1 ] == static_cast< wchar_t > ( 0x1F600 ) );
+	}
+	else
+		REQUIRE( wide.size() == 4 );
+}
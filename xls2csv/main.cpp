@@ -0,0 +1,314 @@
+
+/*
+	SPDX-FileCopyrightText: 2011-2024 Igor Mironchik <igor.mironchik@gmail.com>
+	SPDX-License-Identifier: MIT
+*/
+
+// Excel include.
+#include <read-excel/parser.hpp>
+#include <read-excel/csv_storage.hpp>
+
+// C++ include.
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <stdexcept>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//
+// Options
+//
+
+//! Command line options.
+struct Options {
+	//! Sheets to convert, indexes or names, all sheets if empty.
+	std::vector< std::string > m_sheets;
+	//! Delimiter.
+	char m_delimiter = ',';
+	//! Count of threads, hardware concurrency if 0.
+	size_t m_threads = 0;
+	//! Directory for CSV files, stdout if empty.
+	std::string m_outputDir;
+	//! XLS file.
+	std::string m_file;
+}; // struct Options
+
+
+//
+// usage
+//
+
+inline void
+usage( const char * app )
+{
+	std::fprintf( stderr,
+		"Usage: %s [options] file.xls\n\n"
+		"Converts worksheets to CSV in UTF-8 while parsing, memory is limited\n"
+		"to shared strings and one row.\n\n"
+		"Options:\n"
+		"  --sheet=INDEX|NAME  sheet to convert, can be repeated (all sheets)\n"
+		"  --delimiter=C       delimiter of fields, \"tab\" for tabulation (,)\n"
+		"  --output-dir=DIR    write every sheet to DIR/NAME.csv, sheets are\n"
+		"                      converted in parallel (stdout, one by one,\n"
+		"                      each after a line \"--- sheet INDEX: NAME\"\n"
+		"                      unless only one --sheet is given)\n"
+		"  --threads=N         threads for --output-dir (hardware concurrency)\n",
+		app );
+}
+
+
+//
+// isSelected
+//
+
+//! \return Is sheet requested to convert.
+inline bool
+isSelected( const Options & opts, size_t idx, const Excel::String & name )
+{
+	if( opts.m_sheets.empty() )
+		return true;
+
+	const std::string utf8 = Excel::Utf8::fromString( name );
+
+	for( const auto & s : opts.m_sheets )
+	{
+		if( s == utf8 || ( !s.empty() && s.find_first_not_of( "0123456789" ) == std::string::npos &&
+			std::strtoull( s.c_str(), nullptr, 10 ) == idx ) )
+				return true;
+	}
+
+	return false;
+}
+
+
+//
+// fileName
+//
+
+//! \return Name of CSV file of the sheet.
+inline std::string
+fileName( const Options & opts, size_t idx, const Excel::String & name )
+{
+	std::string file = Excel::Utf8::fromString( name );
+
+	for( auto & c : file )
+	{
+		switch( c )
+		{
+			case '/' : case '\\' : case ':' : case '*' : case '?' :
+			case '"' : case '<' : case '>' : case '|' :
+				c = '_';
+				break;
+
+			default :
+				break;
+		}
+	}
+
+	if( file.empty() || file == "." || file == ".." )
+		file = std::to_string( idx );
+
+	return opts.m_outputDir + "/" + file + ".csv";
+}
+
+
+//
+// convertToStdout
+//
+
+//! Write requested sheets to stdout one by one, every sheet after a
+//! header line if there can be more than one of them.
+inline void
+convertToStdout( const Options & opts )
+{
+	std::ios::sync_with_stdio( false );
+
+	const bool headers = ( opts.m_sheets.size() != 1 );
+
+	Excel::CsvStorage storage( [&] ( size_t idx, const Excel::String & name ) -> std::ostream*
+		{
+			if( !isSelected( opts, idx, name ) )
+				return nullptr;
+
+			if( headers )
+				std::cout << "--- sheet " << idx << ": " << Excel::Utf8::fromString( name ) << '\n';
+
+			return &std::cout;
+		},
+		opts.m_delimiter );
+
+	Excel::Parser::loadBook( opts.m_file, storage );
+}
+
+
+//
+// convertToFiles
+//
+
+//! Write requested sheets to files, sheets are parsed in parallel, each
+//! thread with own stream of the workbook.
+inline void
+convertToFiles( const Options & opts )
+{
+	CompoundFile::File file( opts.m_file );
+
+	const auto dir = file.hasDirectory( L"Workbook" ) ? file.directory( L"Workbook" )
+	                                                  : file.directory( L"Book" );
+
+	std::vector< Excel::BoundSheet > boundSheets;
+
+	Excel::CsvStorage globals( [] ( size_t, const Excel::String & ) -> std::ostream*
+		{ return nullptr; } );
+
+	{
+		auto stream = file.stream( dir );
+
+		Excel::Parser::loadGlobals( boundSheets, *stream, globals );
+	}
+
+	std::vector< size_t > sheets;
+
+	for( size_t i = 0; i < boundSheets.size(); ++i )
+	{
+		if( boundSheets[ i ].sheetType() == Excel::BoundSheet::WorkSheet &&
+			isSelected( opts, i, boundSheets[ i ].sheetName() ) )
+				sheets.push_back( i );
+	}
+
+	size_t threadsCount = ( opts.m_threads ? opts.m_threads :
+		std::max( std::thread::hardware_concurrency(), 1u ) );
+	threadsCount = std::min( threadsCount, sheets.size() );
+
+	std::atomic< size_t > next( 0 );
+	std::vector< std::exception_ptr > errors( threadsCount );
+	std::vector< std::thread > threads;
+
+	for( size_t t = 0; t < threadsCount; ++t )
+	{
+		threads.emplace_back( [&, t] ()
+			{
+				try {
+					for( size_t i = next++; i < sheets.size(); i = next++ )
+					{
+						const size_t idx = sheets[ i ];
+						std::ofstream out;
+
+						Excel::CsvStorage storage(
+							[&] ( size_t, const Excel::String & name ) -> std::ostream*
+							{
+								const std::string path = fileName( opts, idx, name );
+
+								out.open( path, std::ios::binary );
+
+								if( !out )
+									throw std::runtime_error( "Can't open " + path );
+
+								return &out;
+							},
+							globals.sharedStrings(), opts.m_delimiter );
+
+						auto stream = file.stream( dir );
+
+						Excel::Parser::loadWorkSheet( idx, boundSheets[ idx ], *stream, storage );
+					}
+				}
+				catch( ... )
+				{
+					errors[ t ] = std::current_exception();
+					next = sheets.size();
+				}
+			} );
+	}
+
+	for( auto & t : threads )
+		t.join();
+
+	for( const auto & e : errors )
+	{
+		if( e )
+			std::rethrow_exception( e );
+	}
+}
+
+
+//
+// main
+//
+
+int main( int argc, char ** argv )
+{
+	Options opts;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		const std::string arg = argv[ i ];
+		const auto eq = arg.find( '=' );
+		const std::string name = arg.substr( 0, eq );
+		const std::string value = ( eq == std::string::npos ? std::string() : arg.substr( eq + 1 ) );
+
+		if( name == "--sheet" )
+			opts.m_sheets.push_back( value );
+		else if( name == "--delimiter" && ( value.size() == 1 || value == "tab" ) )
+			opts.m_delimiter = ( value == "tab" ? '\t' : value[ 0 ] );
+		else if( name == "--output-dir" )
+			opts.m_outputDir = value;
+		else if( name == "--threads" )
+			opts.m_threads = std::strtoull( value.c_str(), nullptr, 10 );
+		else if( name == "--help" || name == "-h" )
+		{
+			usage( argv[ 0 ] );
+
+			return 0;
+		}
+		else if( !name.empty() && name[ 0 ] != '-' && opts.m_file.empty() )
+			opts.m_file = arg;
+		else
+		{
+			std::fprintf( stderr, "Unknown argument: %s\n\n", arg.c_str() );
+			usage( argv[ 0 ] );
+
+			return 1;
+		}
+	}
+
+	if( opts.m_file.empty() )
+	{
+		usage( argv[ 0 ] );
+
+		return 1;
+	}
+
+	try {
+		if( opts.m_outputDir.empty() )
+			convertToStdout( opts );
+		else
+			convertToFiles( opts );
+	}
+	catch( const Excel::Exception & x )
+	{
+		std::fprintf( stderr, "%ls\n", x.whatAsWString().c_str() );
+
+		return 1;
+	}
+	catch( const CompoundFile::Exception & x )
+	{
+		std::fprintf( stderr, "%ls\n", x.whatAsWString().c_str() );
+
+		return 1;
+	}
+	catch( const std::exception & x )
+	{
+		std::fprintf( stderr, "%s\n", x.what() );
+
+		return 1;
+	}
+
+	return 0;
+}